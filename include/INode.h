@@ -74,6 +74,17 @@ public:
   virtual void getNewBlocks(std::vector<crypto::Hash>&& knownBlockIds, std::vector<cryptonote::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) = 0;
   virtual void getTransactionOutsGlobalIndices(const crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) = 0;
   virtual void queryBlocks(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) = 0;
+  // Same blocks as queryBlocks, with only what wallets scan for
+  virtual void queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight, const Callback& callback) = 0;
+  // Daemon side scanning of the wallet transactions, served by a local daemon running with --enable-wallet-scan
+  virtual void registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys, uint32_t startHeight,
+    uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) = 0;
+  virtual void unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) = 0;
+  virtual void watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken, std::vector<crypto::KeyImage>&& keyImages,
+    const Callback& callback) = 0;
+  // Acknowledges the events before firstSequence and returns up to maxCount following ones
+  virtual void getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence, uint32_t maxCount,
+    std::vector<WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) = 0;
   virtual void getPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual, std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback) = 0;
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) = 0;
 
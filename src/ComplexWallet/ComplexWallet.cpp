@@ -197,7 +197,8 @@ bool complex_wallet::init(const boost::program_options::variables_map &vm)
 
   std::cout << "NodeRPCProxy iniialized!" << std::endl;
 
-  m_wallet.reset(new SingleWallet(m_currency, *m_node));
+  m_blockchain_sync.reset(new SharedBlockchainSynchronizer(*m_node, m_currency.genesisBlockHash(), 0));
+  m_wallet.reset(new SingleWallet(m_currency, *m_node, *m_blockchain_sync));
 
   try
   {
@@ -251,7 +252,7 @@ bool complex_wallet::new_wallet(const std::string &wallet_file, const std::strin
 {
   m_wallet_file = wallet_file;
 
-  m_wallet.reset(new SingleWallet(m_currency, *m_node.get()));
+  m_wallet.reset(new SingleWallet(m_currency, *m_node.get(), *m_blockchain_sync));
   m_node->addObserver(static_cast<INodeObserver *>(this));
   m_wallet->addObserver(this);
   try
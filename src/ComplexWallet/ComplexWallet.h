@@ -18,6 +18,7 @@
 #include "cryptonote/core/CryptoNoteBasicImpl.h"
 #include "cryptonote/core/Currency.h"
 #include "NodeRpcProxy/NodeRpcProxy.h"
+#include "transfers/SharedBlockchainSynchronizer.h"
 #include "wallet_legacy/WalletHelper.h"
 
 #include <logging/LoggerRef.h>
@@ -167,6 +168,7 @@ private:
   Logging::LoggerRef logger;
 
   std::unique_ptr<cryptonote::NodeRpcProxy> m_node;
+  std::unique_ptr<cryptonote::SharedBlockchainSynchronizer> m_blockchain_sync;
   std::unique_ptr<cryptonote::IWalletLegacy> m_wallet;
 
   // Wallet Manager
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "common/ScopeExit.h"
 #include "wallet_legacy/WalletHelper.h"
 #include "wallet_legacy/WalletLegacySerialization.h"
 #include "wallet_legacy/WalletLegacySerializer.h"
@@ -91,7 +92,7 @@ namespace ComplexWallet
 class SyncStarter : public cryptonote::IWalletLegacyObserver
 {
 public:
-  SyncStarter(BlockchainSynchronizer &sync) : m_sync(sync) {}
+  SyncStarter(IBlockchainSynchronizer &sync) : m_sync(sync) {}
   virtual ~SyncStarter() {}
 
   virtual void initCompleted(std::error_code result) override
@@ -102,16 +103,16 @@ public:
     }
   }
 
-  BlockchainSynchronizer &m_sync;
+  IBlockchainSynchronizer &m_sync;
 };
 
-SingleWallet::SingleWallet(const cryptonote::Currency &currency, INode &node) : m_state(NOT_INITIALIZED),
+SingleWallet::SingleWallet(const cryptonote::Currency &currency, INode &node, SharedBlockchainSynchronizer &blockchainSync) : m_state(NOT_INITIALIZED),
                                                                                 m_currency(currency),
                                                                                 m_node(node),
                                                                                 m_isStopping(false),
                                                                                 m_lastNotifiedActualBalance(0),
                                                                                 m_lastNotifiedPendingBalance(0),
-                                                                                m_blockchainSync(node, currency.genesisBlockHash()),
+                                                                                m_blockchainSync(blockchainSync),
                                                                                 m_transfersSync(currency, m_blockchainSync, node),
                                                                                 m_transferDetails(nullptr),
                                                                                 m_transactionsCache(m_currency.mempoolTxLiveTime()),
@@ -134,10 +135,21 @@ SingleWallet::~SingleWallet()
     }
   }
 
+  // other wallets keep synchronizing once the subscription is gone
+  m_blockchainSync.pause();
   m_blockchainSync.removeObserver(this);
-  m_blockchainSync.stop();
   m_asyncContextCounter.waitAsyncContextsFinish();
   m_sender.release();
+
+  const auto &accountAddress = m_account.getAccountKeys().address;
+  auto subObject = m_transfersSync.getSubscription(accountAddress);
+  if (subObject != nullptr)
+  {
+    subObject->removeObserver(this);
+    m_transfersSync.removeSubscription(accountAddress);
+  }
+
+  m_blockchainSync.resume();
 }
 
 void SingleWallet::addObserver(IWalletLegacyObserver *observer)
@@ -231,6 +243,10 @@ void SingleWallet::initSync()
 void SingleWallet::doLoad(std::istream &source)
 {
   ContextCounterHolder counterHolder(m_asyncContextCounter);
+  // consumer states are loaded while the shared synchronizer is stopped
+  m_blockchainSync.pause();
+  Tools::ScopeExit resumeSync([this] { m_blockchainSync.resume(); });
+
   try
   {
     std::unique_lock<std::mutex> lock(m_cacheMutex);
@@ -294,8 +310,9 @@ void SingleWallet::shutdown()
     m_sender->stop();
   }
 
+  m_blockchainSync.pause();
+  Tools::ScopeExit resumeSync([this] { m_blockchainSync.resume(); });
   m_blockchainSync.removeObserver(this);
-  m_blockchainSync.stop();
   m_asyncContextCounter.waitAsyncContextsFinish();
 
   m_sender.release();
@@ -371,9 +388,11 @@ void SingleWallet::doSave(std::ostream &destination, bool saveDetailed, bool sav
 {
   ContextCounterHolder counterHolder(m_asyncContextCounter);
 
+  m_blockchainSync.pause();
+  Tools::ScopeExit resumeSync([this] { m_blockchainSync.resume(); });
+
   try
   {
-    m_blockchainSync.stop();
     std::unique_lock<std::mutex> lock(m_cacheMutex);
 
     WalletLegacySerializer serializer(m_account, m_transactionsCache);
@@ -389,7 +408,6 @@ void SingleWallet::doSave(std::ostream &destination, bool saveDetailed, bool sav
     serializer.serialize(destination, m_password, saveDetailed, cache);
 
     m_state = INITIALIZED;
-    m_blockchainSync.start(); //XXX: start can throw. what to do in this case?
   }
   catch (std::system_error &e)
   {
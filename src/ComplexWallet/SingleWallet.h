@@ -24,7 +24,7 @@
 #include "wallet_legacy/WalletTransactionSender.h"
 #include "wallet_legacy/WalletRequest.h"
 
-#include "transfers/BlockchainSynchronizer.h"
+#include "transfers/SharedBlockchainSynchronizer.h"
 #include "transfers/TransfersSynchronizer.h"
 
 
@@ -40,7 +40,7 @@ class SingleWallet :
   ITransfersObserver {
 
 public:
-  SingleWallet(const cryptonote::Currency& currency, INode& node);
+  SingleWallet(const cryptonote::Currency& currency, INode& node, SharedBlockchainSynchronizer& blockchainSync);
   virtual ~SingleWallet();
 
   virtual void addObserver(IWalletLegacyObserver* observer) override;
@@ -117,7 +117,7 @@ private:
   std::atomic<uint64_t> m_lastNotifiedActualBalance;
   std::atomic<uint64_t> m_lastNotifiedPendingBalance;
 
-  BlockchainSynchronizer m_blockchainSync;
+  SharedBlockchainSynchronizer& m_blockchainSync;
   TransfersSyncronizer m_transfersSync;
   ITransfersContainer* m_transferDetails;
 
@@ -48,10 +48,19 @@ using namespace cryptonote;
 namespace ComplexWallet
 {
 
+namespace
+{
+
+// Recent blocks kept for wallets added after the others have synchronized
+const size_t SHARED_BLOCK_CACHE_SIZE = 1000;
+
+} // namespace
+
 WalletManager::WalletManager(System::Dispatcher &dispatcher, const Currency &currency, INode &node, Logging::LoggerManager &logger) : m_dispatcher(dispatcher),
                                                                                                                                       m_currency(currency),
                                                                                                                                       m_node(node),
-                                                                                                                                      m_logger(logger)
+                                                                                                                                      m_logger(logger),
+                                                                                                                                      m_blockchainSync(node, currency.genesisBlockHash(), SHARED_BLOCK_CACHE_SIZE)
 {
 }
 
@@ -63,7 +72,7 @@ bool WalletManager::createWallet(const AccountKeys &accountKeys)
 {
 
   Logging::LoggerRef(m_logger, "inteface")(Logging::INFO) << "creating new wallet" << endl;
-  cryptonote::IWalletLegacy *wallet = new SingleWallet(m_currency, m_node);
+  cryptonote::IWalletLegacy *wallet = new SingleWallet(m_currency, m_node, m_blockchainSync);
   // cryptonote::IWalletLegacy *wallet = new WalletLegacy(m_currency, m_node);
 
   // WalletHelper::InitWalletResultObserver initObserver;
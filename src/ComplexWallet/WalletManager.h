@@ -14,7 +14,7 @@
 #include <system/Dispatcher.h>
 #include <system/Event.h>
 #include "transfers/TransfersSynchronizer.h"
-#include "transfers/BlockchainSynchronizer.h"
+#include "transfers/SharedBlockchainSynchronizer.h"
 
 #include "logging/LoggerManager.h"
 
@@ -48,6 +48,8 @@ private:
   System::Dispatcher &m_dispatcher;
   const Currency &m_currency;
   INode &m_node;
+  // all wallets are synchronized by one synchronizer, blocks are downloaded once
+  SharedBlockchainSynchronizer m_blockchainSync;
   std::map<std::string, void *> m_wallets;
 };
 
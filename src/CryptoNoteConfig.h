@@ -59,6 +59,10 @@ const uint64_t CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS    = DIFFICULTY_TARGET
 const uint64_t CRYPTONOTE_MEMPOOL_TX_LIVETIME                = 60 * 60 * 24;     //seconds, one day
 const uint64_t CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME = 60 * 60 * 24 * 7; //seconds, one week
 const uint64_t CRYPTONOTE_NUMBER_OF_PERIODS_TO_FORGET_TX_DELETED_FROM_POOL = 7;  // CRYPTONOTE_NUMBER_OF_PERIODS_TO_FORGET_TX_DELETED_FROM_POOL * CRYPTONOTE_MEMPOOL_TX_LIVETIME = time to forget tx
+const uint64_t CRYPTONOTE_BLOCK_TEMPLATE_POOL_REFRESH_INTERVAL = 10;           //seconds, pool changes update the block template not more often
+const size_t   CRYPTONOTE_WALLET_SCAN_MAX_PENDING_EVENTS     = 10000;         // scanning of a registration pauses until the wallet acknowledges events
+const size_t   CRYPTONOTE_WALLET_SCAN_MAX_REGISTRATIONS      = 1000;
+const uint32_t CRYPTONOTE_WALLET_SCAN_MAX_RESCAN_DEPTH       = 60 * 60 * 24 * 30 / DIFFICULTY_TARGET; // blocks below the top a registration may start at, about a month
 
 const size_t   FUSION_TX_MAX_SIZE                            = CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE * 30 / 100;
 const size_t   FUSION_TX_MIN_INPUT_COUNT                     = 12;
@@ -66,10 +70,13 @@ const size_t   FUSION_TX_MIN_IN_OUT_COUNT_RATIO              = 4;
 
 const char     CRYPTONOTE_BLOCKS_FILENAME[]                  = "blocks.dat";
 const char     CRYPTONOTE_BLOCKINDEXES_FILENAME[]            = "blockindexes.dat";
+const char     CRYPTONOTE_RAWBLOCKS_FILENAME[]               = "rawblocks.dat";
+const char     CRYPTONOTE_RAWBLOCKINDEXES_FILENAME[]         = "rawblockindexes.dat";
 const char     CRYPTONOTE_BLOCKSCACHE_FILENAME[]             = "blockscache.dat";
 const char     CRYPTONOTE_POOLDATA_FILENAME[]                = "poolstate.bin";
 const char     P2P_NET_DATA_FILENAME[]                       = "p2pstate.bin";
 const char     CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME[]      = "blockchainindices.dat";
+const char     CRYPTONOTE_WALLET_SCAN_FILENAME[]             = "walletscan.bin";
 const char     MINER_CONFIG_FILE_NAME[]                      = "miner_conf.json";
 } // parameters
 
@@ -84,6 +91,8 @@ const uint8_t  BLOCK_MINOR_VERSION_0                         =  0;
 const size_t   BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT        =  10000;  //by default, blocks ids count in synchronizing
 const size_t   BLOCKS_SYNCHRONIZING_DEFAULT_COUNT            =  200;    //by default, blocks count in blocks downloading
 const size_t   COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT         =  1000;
+const size_t   COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE           =  200;    //blocks whose lite and scan entries are kept for wallets polling the same tip
+const uint32_t COMMAND_RPC_WAIT_UPDATE_MAX_TIMEOUT           =  60;     //seconds, longest wait of a single update subscription request
 
 //TODO This port will be used by the daemon to establish connections with p2p network
 const int      P2P_DEFAULT_PORT                              = 19800;
@@ -95,6 +104,7 @@ const int      RPC_WALLET_PORT                              = 19888;
 
 const size_t   P2P_LOCAL_WHITE_PEERLIST_LIMIT                =  1000;
 const size_t   P2P_LOCAL_GRAY_PEERLIST_LIMIT                 =  5000;
+const size_t   P2P_LOCAL_PEERLIST_SUBNET_LIMIT               =  64;    // entries of one /16 subnet in each peer list
 
 const size_t   P2P_CONNECTION_MAX_WRITE_BUFFER_SIZE          = 16 * 1024 * 1024; // 16 MB
 const uint32_t P2P_DEFAULT_CONNECTIONS_COUNT                 = 8;
@@ -106,6 +116,23 @@ const uint32_t P2P_DEFAULT_CONNECTION_TIMEOUT                = 5000;          //
 const uint32_t P2P_DEFAULT_PING_CONNECTION_TIMEOUT           = 2000;          // 2 seconds
 const uint64_t P2P_DEFAULT_INVOKE_TIMEOUT                    = 60 * 2 * 1000; // 2 minutes
 const size_t   P2P_DEFAULT_HANDSHAKE_INVOKE_TIMEOUT          = 5000;          // 5 seconds
+const uint32_t P2P_TX_ANNOUNCEMENT_INTERVAL                  = 100;           // milliseconds
+const size_t   P2P_TX_KNOWN_LIMIT                            = 4096;          // transaction hashes remembered per connection, about 400 KB
+const uint32_t P2P_TX_REQUEST_TIMEOUT                        = 30;            // seconds before asking the next announcer
+const size_t   P2P_TX_INVENTORY_MAX_COUNT                    = 1000;          // transaction hashes in one announcement or request
+const size_t   P2P_TX_MAX_REQUESTS_IN_FLIGHT                 = 5000;          // transactions requested from one connection and not received yet
+const uint32_t P2P_COMPACT_BLOCK_TXS_TIMEOUT                 = 5;             // seconds before requesting the full block
+const size_t   P2P_COMPACT_BLOCK_MAX_PENDING                 = 16;            // compact blocks waiting for their transactions
+const uint32_t P2P_DEFAULT_DISPATCHER_THREADS                = 0;             // 0 - one per hardware thread
+const size_t   P2P_DISPATCHER_OFFLOAD_MIN_SIZE               = 16 * 1024;     // smaller messages are decoded in place
+const uint32_t P2P_SYNC_CHUNK_TIMEOUT                        = 30;            // seconds before requesting a chunk from another peer
+const uint32_t P2P_SYNC_STALL_TIMEOUT                        = 5;             // seconds the lowest chunk may hold back delivered ones
+const size_t   P2P_SYNC_MAX_REQUESTS_PER_PEER                = 4;             // chunks in flight to the fastest peer
+const size_t   P2P_SYNC_MIN_BATCH_BLOCKS                     = 10;
+const size_t   P2P_SYNC_MAX_BATCH_BLOCKS                     = 2000;
+const size_t   P2P_SYNC_BATCH_INCREMENT                      = 50;            // blocks added to a batch after a fast response
+const uint64_t P2P_SYNC_RESPONSE_SIZE_LIMIT                  = 4 * 1024 * 1024; // bytes of blocks requested at once
+const uint32_t P2P_SYNC_TARGET_RESPONSE_TIME                 = 2000;          // milliseconds, slower responses halve the batch
 const char     P2P_STAT_TRUSTED_PUB_KEY[]                    = "8f80f9a5a434a9f1510d13336228debfee9c918ce505efe225d8c94d045fa115";
 
 //TODO Add here your network seed nodes
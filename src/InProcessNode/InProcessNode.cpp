@@ -507,6 +507,73 @@ std::error_code InProcessNode::doQueryBlocksLite(std::vector<crypto::Hash>&& kno
 
 }
 
+void InProcessNode::queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks,
+  uint32_t& startHeight, const Callback& callback) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (state != INITIALIZED) {
+    lock.unlock();
+    callback(make_error_code(cryptonote::error::NOT_INITIALIZED));
+    return;
+  }
+
+  ioService.post(
+          std::bind(&InProcessNode::queryBlocksScanAsync,
+                  this,
+                  std::move(knownBlockIds),
+                  timestamp,
+                  std::ref(newBlocks),
+                  std::ref(startHeight),
+                  callback
+          )
+  );
+}
+
+void InProcessNode::queryBlocksScanAsync(std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight,
+                         const Callback& callback) {
+  std::error_code ec = doQueryBlocksScan(std::move(knownBlockIds), timestamp, newBlocks, startHeight);
+  callback(ec);
+}
+
+std::error_code InProcessNode::doQueryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight) {
+  uint32_t currentHeight, fullOffset;
+  std::vector<std::string> entries;
+
+  if (!core.queryBlocksScan(knownBlockIds, timestamp, startHeight, currentHeight, fullOffset, entries)) {
+    return make_error_code(cryptonote::error::INTERNAL_NODE_ERROR);
+  }
+
+  newBlocks.reserve(newBlocks.size() + entries.size());
+  for (const auto& entry: entries) {
+    BlockScanInfo info;
+    if (!fromBinaryArray(info, asBinaryArray(entry))) {
+      return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    newBlocks.push_back(std::move(info));
+  }
+
+  return std::error_code();
+}
+
+void InProcessNode::registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys,
+  uint32_t startHeight, uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) {
+  callback(make_error_code(cryptonote::error::REQUEST_ERROR));
+}
+
+void InProcessNode::unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) {
+  callback(make_error_code(cryptonote::error::REQUEST_ERROR));
+}
+
+void InProcessNode::watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken,
+  std::vector<crypto::KeyImage>&& keyImages, const Callback& callback) {
+  callback(make_error_code(cryptonote::error::REQUEST_ERROR));
+}
+
+void InProcessNode::getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence,
+  uint32_t maxCount, std::vector<WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) {
+  callback(make_error_code(cryptonote::error::REQUEST_ERROR));
+}
+
 void InProcessNode::getPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
         std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback) {
   std::unique_lock<std::mutex> lock(mutex);
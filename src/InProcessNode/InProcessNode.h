@@ -52,6 +52,16 @@ public:
   virtual void relayTransaction(const cryptonote::Transaction& transaction, const Callback& callback) override;
   virtual void queryBlocks(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
     uint32_t& startHeight, const Callback& callback) override;
+  // The wallet scan service runs in the daemon only, these calls fail with REQUEST_ERROR
+  virtual void registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys, uint32_t startHeight,
+    uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) override;
+  virtual void unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) override;
+  virtual void watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken, std::vector<crypto::KeyImage>&& keyImages,
+    const Callback& callback) override;
+  virtual void getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence, uint32_t maxCount,
+    std::vector<WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) override;
+  virtual void queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks,
+    uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback) override;
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) override;
@@ -89,6 +99,9 @@ private:
   void queryBlocksLiteAsync(std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight,
           const Callback& callback);
   std::error_code doQueryBlocksLite(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight);
+  void queryBlocksScanAsync(std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight,
+          const Callback& callback);
+  std::error_code doQueryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight);
 
   void getPoolSymmetricDifferenceAsync(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback);
@@ -15,6 +15,7 @@
 #include <system/Dispatcher.h>
 #include <system/Event.h>
 #include <system/EventLock.h>
+#include <system/InterruptedException.h>
 #include <system/Timer.h>
 #include <cryptonote/core/TransactionApi.h>
 
@@ -50,6 +51,7 @@ std::error_code interpretResponseStatus(const std::string& status) {
 NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort) :
     m_rpcTimeout(10000),
     m_pullInterval(5000),
+    m_waitUpdateTimeout(30),
     m_nodeHost(nodeHost),
     m_nodePort(nodePort),
     m_lastLocalBlockTimestamp(0),
@@ -71,6 +73,10 @@ void NodeRpcProxy::resetInternalState() {
   m_networkHeight.store(0, std::memory_order_relaxed);
   m_lastKnowHash = cryptonote::NULL_HASH;
   m_knownTxs.clear();
+  m_waitUpdateSupported = true;
+  m_queryBlocksScanSupported = true;
+  m_waitBlockHash = cryptonote::NULL_HASH;
+  m_poolVersion = 0;
 }
 
 void NodeRpcProxy::init(const INode::Callback& callback) {
@@ -105,6 +111,10 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    if (m_statusContextGroup != nullptr) {
+      m_statusContextGroup->interrupt();
+    }
+
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -128,6 +138,10 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     Event httpEvent(dispatcher);
     m_httpEvent = &httpEvent;
     m_httpEvent->set();
+    HttpClient notifyClient(dispatcher, m_nodeHost, m_nodePort);
+    m_notifyClient = &notifyClient;
+    ContextGroup statusContextGroup(dispatcher);
+    m_statusContextGroup = &statusContextGroup;
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -138,16 +152,20 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
-    contextGroup.spawn([this]() {
-      Timer pullTimer(*m_dispatcher);
-      while (!m_stop) {
-        updateNodeStatus();
-        if (!m_stop) {
-          pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+    statusContextGroup.spawn([this]() {
+      try {
+        Timer pullTimer(*m_dispatcher);
+        while (!m_stop) {
+          updateNodeStatus();
+          if (!m_stop && !waitNodeUpdate() && !m_stop) {
+            pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+          }
         }
+      } catch (InterruptedException&) {
       }
     });
 
+    statusContextGroup.wait();
     contextGroup.wait();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
@@ -158,6 +176,8 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
   m_context_group = nullptr;
   m_httpClient = nullptr;
   m_httpEvent = nullptr;
+  m_notifyClient = nullptr;
+  m_statusContextGroup = nullptr;
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
@@ -170,6 +190,50 @@ void NodeRpcProxy::updateNodeStatus() {
   }
 }
 
+// Waits until the node gets another top block or pool changes. Returns false if the node doesn't support
+// the subscription or the request failed, then the status is polled.
+bool NodeRpcProxy::waitNodeUpdate() {
+  if (!m_waitUpdateSupported) {
+    return false;
+  }
+
+  cryptonote::COMMAND_RPC_WAIT_UPDATE::request req = AUTO_VAL_INIT(req);
+  cryptonote::COMMAND_RPC_WAIT_UPDATE::response rsp = AUTO_VAL_INIT(rsp);
+  req.last_block_hash = podToHex(m_waitBlockHash);
+  req.pool_version = m_poolVersion;
+  req.watch_pool = true;
+  req.timeout = m_waitUpdateTimeout;
+
+  try {
+    HttpRequest httpReq;
+    HttpResponse httpRes;
+
+    httpReq.setUrl("/wait_update");
+    httpReq.setBody(storeToJson(req));
+    m_notifyClient->request(httpReq, httpRes);
+
+    if (httpRes.getStatus() == HttpResponse::STATUS_404) {
+      m_waitUpdateSupported = false;
+      return false;
+    }
+
+    if (httpRes.getStatus() != HttpResponse::STATUS_200 || !loadFromJson(rsp, httpRes.getBody()) || rsp.status != CORE_RPC_STATUS_OK) {
+      return false;
+    }
+  } catch (const InterruptedException&) {
+    throw;
+  } catch (const std::exception&) {
+    return false;
+  }
+
+  if (!podFromHex(rsp.block_hash, m_waitBlockHash)) {
+    return false;
+  }
+
+  m_poolVersion = rsp.pool_version;
+  return true;
+}
+
 bool NodeRpcProxy::updatePoolStatus() {
   std::vector<crypto::Hash> knownTxs = getKnownTxsVector();
   crypto::Hash tailBlock = m_lastKnowHash;
@@ -360,6 +424,63 @@ void NodeRpcProxy::queryBlocks(std::vector<crypto::Hash>&& knownBlockIds, uint64
           std::ref(newBlocks), std::ref(startHeight)), callback);
 }
 
+void NodeRpcProxy::queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks,
+  uint32_t& startHeight, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doQueryBlocksScan, this, std::move(knownBlockIds), timestamp,
+          std::ref(newBlocks), std::ref(startHeight)), callback);
+}
+
+void NodeRpcProxy::registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys,
+  uint32_t startHeight, uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doRegisterWalletScan, this, viewSecretKey, std::move(spendPublicKeys), startHeight,
+          std::ref(registrationId), std::ref(registrationToken)), callback);
+}
+
+void NodeRpcProxy::unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doUnregisterWalletScan, this, registrationId, registrationToken), callback);
+}
+
+void NodeRpcProxy::watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken,
+  std::vector<crypto::KeyImage>&& keyImages, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doWatchWalletScanKeyImages, this, registrationId, registrationToken, std::move(keyImages)), callback);
+}
+
+void NodeRpcProxy::getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence,
+  uint32_t maxCount, std::vector<WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doGetWalletScanEvents, this, registrationId, registrationToken, firstSequence, maxCount,
+          std::ref(events), std::ref(scannedHeight)), callback);
+}
+
 void NodeRpcProxy::getPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
         std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
@@ -556,6 +677,160 @@ std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<crypto::Hash>&
   return std::error_code();
 }
 
+std::error_code NodeRpcProxy::doQueryBlocksScan(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
+        std::vector<cryptonote::BlockScanInfo>& newBlocks, uint32_t& startHeight) {
+  if (!m_queryBlocksScanSupported) {
+    return doQueryBlocksScanLite(knownBlockIds, timestamp, newBlocks, startHeight);
+  }
+
+  cryptonote::COMMAND_RPC_QUERY_BLOCKS_SCAN::request req = AUTO_VAL_INIT(req);
+  cryptonote::COMMAND_RPC_QUERY_BLOCKS_SCAN::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.blockIds = knownBlockIds;
+  req.timestamp = timestamp;
+
+  std::error_code ec;
+  try {
+    EventLock eventLock(*m_httpEvent);
+
+    HttpRequest httpReq;
+    HttpResponse httpRes;
+
+    httpReq.setUrl("/queryblocksscan.bin");
+    httpReq.setBody(storeToBinaryKeyValue(req));
+    m_httpClient->request(httpReq, httpRes);
+
+    if (httpRes.getStatus() == HttpResponse::STATUS_404) {
+      m_queryBlocksScanSupported = false;
+    } else if (!loadFromBinaryKeyValue(rsp, httpRes.getBody())) {
+      ec = make_error_code(error::NETWORK_ERROR);
+    } else {
+      ec = interpretResponseStatus(rsp.status);
+    }
+  } catch (const ConnectException&) {
+    ec = make_error_code(error::CONNECT_ERROR);
+  } catch (const std::exception&) {
+    ec = make_error_code(error::NETWORK_ERROR);
+  }
+
+  if (!m_queryBlocksScanSupported) {
+    // the daemon is older than the endpoint, it is not asked again
+    return doQueryBlocksScanLite(knownBlockIds, timestamp, newBlocks, startHeight);
+  }
+
+  if (ec) {
+    return ec;
+  }
+
+  startHeight = static_cast<uint32_t>(rsp.startHeight);
+
+  newBlocks.reserve(newBlocks.size() + rsp.items.size());
+  for (const auto& item: rsp.items) {
+    BlockScanInfo info;
+    if (!fromBinaryArray(info, asBinaryArray(item))) {
+      return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    newBlocks.push_back(std::move(info));
+  }
+
+  return std::error_code();
+}
+
+std::error_code NodeRpcProxy::doRegisterWalletScan(const crypto::SecretKey& viewSecretKey, const std::vector<crypto::PublicKey>& spendPublicKeys,
+        uint32_t startHeight, uint64_t& registrationId, crypto::Hash& registrationToken) {
+  COMMAND_RPC_SCAN_REGISTER::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_SCAN_REGISTER::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.viewSecretKey = viewSecretKey;
+  req.spendPublicKeys = spendPublicKeys;
+  req.startHeight = startHeight;
+
+  std::error_code ec = binaryCommand("/scan_register.bin", req, rsp);
+  if (!ec) {
+    registrationId = rsp.registrationId;
+    registrationToken = rsp.registrationToken;
+  }
+
+  return ec;
+}
+
+std::error_code NodeRpcProxy::doUnregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken) {
+  COMMAND_RPC_SCAN_UNREGISTER::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_SCAN_UNREGISTER::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.registrationId = registrationId;
+  req.registrationToken = registrationToken;
+
+  return binaryCommand("/scan_unregister.bin", req, rsp);
+}
+
+std::error_code NodeRpcProxy::doWatchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken,
+        const std::vector<crypto::KeyImage>& keyImages) {
+  COMMAND_RPC_SCAN_WATCH_KEY_IMAGES::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_SCAN_WATCH_KEY_IMAGES::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.registrationId = registrationId;
+  req.registrationToken = registrationToken;
+  req.keyImages = keyImages;
+
+  return binaryCommand("/scan_watch_key_images.bin", req, rsp);
+}
+
+std::error_code NodeRpcProxy::doGetWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence,
+        uint32_t maxCount, std::vector<WalletScanEvent>& events, uint32_t& scannedHeight) {
+  COMMAND_RPC_SCAN_GET_EVENTS::request req = AUTO_VAL_INIT(req);
+  COMMAND_RPC_SCAN_GET_EVENTS::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.registrationId = registrationId;
+  req.registrationToken = registrationToken;
+  req.firstSequence = firstSequence;
+  req.maxCount = maxCount;
+
+  std::error_code ec = binaryCommand("/scan_get_events.bin", req, rsp);
+  if (!ec) {
+    events = std::move(rsp.events);
+    scannedHeight = rsp.scannedHeight;
+  }
+
+  return ec;
+}
+
+// Global indexes are left empty, wallets request them for the transactions paying them
+std::error_code NodeRpcProxy::doQueryBlocksScanLite(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
+        std::vector<cryptonote::BlockScanInfo>& newBlocks, uint32_t& startHeight) {
+  std::vector<BlockShortEntry> blocks;
+  std::error_code ec = doQueryBlocksLite(knownBlockIds, timestamp, blocks, startHeight);
+  if (ec) {
+    return ec;
+  }
+
+  newBlocks.reserve(newBlocks.size() + blocks.size());
+  for (auto& block : blocks) {
+    BlockScanInfo info = AUTO_VAL_INIT(info);
+    info.blockId = block.blockHash;
+    if (block.hasBlock) {
+      info.header = block.block;
+
+      TransactionScanInfo baseTransaction;
+      baseTransaction.txHash = getObjectHash(block.block.baseTransaction);
+      baseTransaction.txPrefix = std::move(block.block.baseTransaction);
+      info.transactions.push_back(std::move(baseTransaction));
+
+      for (auto& txShortInfo : block.txsShortInfo) {
+        TransactionScanInfo transaction;
+        transaction.txHash = txShortInfo.txId;
+        transaction.txPrefix = std::move(txShortInfo.txPrefix);
+        info.transactions.push_back(std::move(transaction));
+      }
+    }
+
+    newBlocks.push_back(std::move(info));
+  }
+
+  return std::error_code();
+}
+
 std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
         std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds) {
   cryptonote::COMMAND_RPC_GET_POOL_CHANGES_LITE::request req = AUTO_VAL_INIT(req);
@@ -56,6 +56,14 @@ public:
   virtual void getNewBlocks(std::vector<crypto::Hash>&& knownBlockIds, std::vector<cryptonote::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
+  virtual void queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
+  virtual void registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys, uint32_t startHeight,
+    uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) override;
+  virtual void unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) override;
+  virtual void watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken, std::vector<crypto::KeyImage>&& keyImages,
+    const Callback& callback) override;
+  virtual void getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence, uint32_t maxCount,
+    std::vector<WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback) override;
   virtual void getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) override;
@@ -69,6 +77,8 @@ public:
 
   unsigned int rpcTimeout() const { return m_rpcTimeout; }
   void rpcTimeout(unsigned int val) { m_rpcTimeout = val; }
+  uint64_t pullInterval() const { return m_pullInterval; }
+  void pullInterval(uint64_t val) { m_pullInterval = val; }
 
 private:
   void resetInternalState();
@@ -77,6 +87,7 @@ private:
   std::vector<crypto::Hash> getKnownTxsVector() const;
   void pullNodeStatusAndScheduleTheNext();
   void updateNodeStatus();
+  bool waitNodeUpdate();
   void updateBlockchainStatus();
   bool updatePoolStatus();
   void updatePeerCount(size_t peerCount);
@@ -91,6 +102,17 @@ private:
                                                     std::vector<uint32_t>& outsGlobalIndices);
   std::error_code doQueryBlocksLite(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
     std::vector<cryptonote::BlockShortEntry>& newBlocks, uint32_t& startHeight);
+  std::error_code doQueryBlocksScan(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
+    std::vector<cryptonote::BlockScanInfo>& newBlocks, uint32_t& startHeight);
+  std::error_code doQueryBlocksScanLite(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
+    std::vector<cryptonote::BlockScanInfo>& newBlocks, uint32_t& startHeight);
+  std::error_code doRegisterWalletScan(const crypto::SecretKey& viewSecretKey, const std::vector<crypto::PublicKey>& spendPublicKeys,
+    uint32_t startHeight, uint64_t& registrationId, crypto::Hash& registrationToken);
+  std::error_code doUnregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken);
+  std::error_code doWatchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken,
+    const std::vector<crypto::KeyImage>& keyImages);
+  std::error_code doGetWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence,
+    uint32_t maxCount, std::vector<WalletScanEvent>& events, uint32_t& scannedHeight);
   std::error_code doGetPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds);
 
@@ -123,8 +145,18 @@ private:
   unsigned int m_rpcTimeout;
   HttpClient* m_httpClient = nullptr;
   System::Event* m_httpEvent = nullptr;
+  // separate connection for update subscription, it is blocked until the node changes
+  HttpClient* m_notifyClient = nullptr;
+  System::ContextGroup* m_statusContextGroup = nullptr;
 
   uint64_t m_pullInterval;
+  uint32_t m_waitUpdateTimeout;
+  bool m_waitUpdateSupported;
+  // daemons without /queryblocksscan.bin are queried with /queryblockslite.bin
+  bool m_queryBlocksScanSupported;
+  // node state reported by the last subscription response
+  crypto::Hash m_waitBlockHash;
+  uint64_t m_poolVersion;
 
   // Internal state
   bool m_stop = false;
@@ -19,6 +19,8 @@ struct StorageFiles
   std::string blocks;
   std::string blocksCache;
   std::string blocksIndexes;
+  std::string rawBlocks;
+  std::string rawBlocksIndexes;
   std::string txPool;
   std::string blockchainIndexes;
 };
@@ -21,6 +21,7 @@ void MinerConfig::initOptions(boost::program_options::options_description &desc)
   add_arg(desc, arg_extra_messages);
   add_arg(desc, arg_start_mining);
   add_arg(desc, arg_mining_threads);
+  add_arg(desc, arg_mining_cpu_affinity);
 }
 
 void MinerConfig::init(const boost::program_options::variables_map &options)
@@ -39,6 +40,11 @@ void MinerConfig::init(const boost::program_options::variables_map &options)
   {
     miningThreads = get_arg(options, arg_mining_threads);
   }
+
+  if (has_arg(options, arg_mining_cpu_affinity))
+  {
+    miningCpuAffinity = get_arg(options, arg_mining_cpu_affinity);
+  }
 }
 
 } //namespace cryptonote
@@ -27,6 +27,7 @@ const arg_descriptor<std::vector<std::string> > arg_p2p_add_exclusive_node   = {
       " If this option is given the options add-priority-node and seed-node are ignored"};
 const arg_descriptor<std::vector<std::string> > arg_p2p_seed_node   = {"seed-node", "Connect to a node to retrieve peer addresses, and disconnect"};
 const arg_descriptor<bool> arg_p2p_hide_my_port   =    {"hide-my-port", "Do not announce yourself as peerlist candidate", false, true};
+const arg_descriptor<uint32_t> arg_p2p_dispatcher_threads = {"p2p-dispatcher-threads", "Number of threads decoding and verifying peer messages (0 - one per hardware thread)", P2P_DEFAULT_DISPATCHER_THREADS};
 
 bool parsePeerFromString(NetworkAddress& pe, const std::string& node_addr) {
   return Common::parseIpAddressAndPort(pe.ip, pe.port, node_addr);
@@ -60,6 +61,7 @@ void NetNodeConfig::initOptions(boost::program_options::options_description& des
   add_arg(desc, arg_p2p_add_exclusive_node);
   add_arg(desc, arg_p2p_seed_node);
   add_arg(desc, arg_p2p_hide_my_port);
+  add_arg(desc, arg_p2p_dispatcher_threads);
 }
 
 NetNodeConfig::NetNodeConfig() {
@@ -68,6 +70,7 @@ NetNodeConfig::NetNodeConfig() {
   externalPort = 0;
   allowLocalIp = false;
   hideMyPort = false;
+  dispatcherThreads = P2P_DEFAULT_DISPATCHER_THREADS;
   configFolder = os::appdata::path();
   testnet = false;
 }
@@ -128,6 +131,10 @@ bool NetNodeConfig::init(const boost::program_options::variables_map& vm)
     hideMyPort = true;
   }
 
+  if (vm.count(arg_p2p_dispatcher_threads.name) != 0 && !vm[arg_p2p_dispatcher_threads.name].defaulted()) {
+    dispatcherThreads = get_arg(vm, arg_p2p_dispatcher_threads);
+  }
+
   return true;
 }
 
@@ -183,6 +190,10 @@ bool NetNodeConfig::getHideMyPort() const {
   return hideMyPort;
 }
 
+uint32_t NetNodeConfig::getDispatcherThreads() const {
+  return dispatcherThreads;
+}
+
 std::string NetNodeConfig::getConfigFolder() const {
   return configFolder;
 }
@@ -227,6 +238,10 @@ void NetNodeConfig::setHideMyPort(bool hide) {
   hideMyPort = hide;
 }
 
+void NetNodeConfig::setDispatcherThreads(uint32_t threads) {
+  dispatcherThreads = threads;
+}
+
 void NetNodeConfig::setConfigFolder(const std::string& folder) {
   configFolder = folder;
 }
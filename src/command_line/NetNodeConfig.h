@@ -30,6 +30,7 @@ public:
   std::vector<NetworkAddress> getExclusiveNodes() const;
   std::vector<NetworkAddress> getSeedNodes() const;
   bool getHideMyPort() const;
+  uint32_t getDispatcherThreads() const;
   std::string getConfigFolder() const;
 
   void setP2pStateFilename(const std::string& filename);
@@ -43,6 +44,7 @@ public:
   void setExclusiveNodes(const std::vector<NetworkAddress>& addresses);
   void setSeedNodes(const std::vector<NetworkAddress>& addresses);
   void setHideMyPort(bool hide);
+  void setDispatcherThreads(uint32_t threads);
   void setConfigFolder(const std::string& folder);
 
 private:
@@ -55,6 +57,7 @@ private:
   std::vector<NetworkAddress> exclusiveNodes;
   std::vector<NetworkAddress> seedNodes;
   bool hideMyPort;
+  uint32_t dispatcherThreads;
   std::string configFolder;
   std::string p2pStateFilename;
   bool testnet;
@@ -91,6 +91,8 @@ void Daemon::init()
   addSetting(arg_console);
   addSetting(arg_testnet_on);
   addSetting(arg_print_genesis_tx);
+  addSetting(arg_io_uring);
+  addSetting(arg_enable_wallet_scan);
 }
 
 bool Daemon::checkVersion()
@@ -19,11 +19,17 @@ const arg_descriptor<bool> arg_testnet_on = {"testnet", "Used to deploy test net
                                                         "network id is changed. Use it with --data-dir flag. The wallet must be launched with --testnet flag.",
                                              false};
 const arg_descriptor<bool> arg_print_genesis_tx = {"print-genesis-tx", "Prints genesis' block tx hex to insert it to config and exits"};
+const arg_descriptor<bool> arg_io_uring = {"io-uring", "Use io_uring for network IO where the kernel supports it, Linux only"};
+const arg_descriptor<bool> arg_enable_wallet_scan = {"enable-wallet-scan", "Scan blocks for wallets registered over RPC with their view keys, "
+                                                                           "the scan requests are served to local clients only. The view keys are stored "
+                                                                           "unencrypted in the data directory"};
 
 
 const arg_descriptor<std::string> arg_extra_messages =  {"extra-messages-file", "Specify file for extra messages to include into coinbase transactions", "", true};
 const arg_descriptor<std::string> arg_start_mining =    {"start-mining", "Specify wallet address to mining for", "", true};
 const arg_descriptor<uint32_t>    arg_mining_threads =  {"mining-threads", "Specify mining threads count", 0, true};
+const arg_descriptor<std::string> arg_mining_cpu_affinity = {"mining-cpu-affinity", "Bind mining threads to processors, \"auto\" spreads "
+                                                             "them over NUMA nodes or a list like 0-3,8 names the processors", "", true};
 
 
 const std::string DEFAULT_RPC_IP = "127.0.0.1";
@@ -27,10 +27,17 @@ extern const arg_descriptor<bool> arg_console;
 // Test arguments
 extern const arg_descriptor<bool> arg_testnet_on;
 
+// Network IO arguments
+extern const arg_descriptor<bool> arg_io_uring;
+
+// Wallet scan service arguments
+extern const arg_descriptor<bool> arg_enable_wallet_scan;
+
 // Miner arguments
 extern const arg_descriptor<std::string> arg_extra_messages;
 extern const arg_descriptor<std::string> arg_start_mining;
 extern const arg_descriptor<uint32_t>    arg_mining_threads;
+extern const arg_descriptor<std::string> arg_mining_cpu_affinity;
 
 extern const std::string DEFAULT_RPC_IP;
 extern const uint16_t DEFAULT_RPC_PORT;
@@ -0,0 +1,199 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "CpuAffinity.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace Common {
+
+namespace {
+
+#ifdef __linux__
+const uint32_t MAX_NUMA_NODES = 64;
+#endif
+
+bool parseCpuNumber(const std::string& text, uint32_t& cpu) {
+  if (text.empty() || text.size() > 5) {
+    return false;
+  }
+
+  cpu = 0;
+  for (char character : text) {
+    if (character < '0' || character > '9') {
+      return false;
+    }
+
+    cpu = cpu * 10 + static_cast<uint32_t>(character - '0');
+  }
+
+  return true;
+}
+
+// Parses the list format of the Linux sysfs, "0-3,8"
+bool parseCpuList(const std::string& list, std::vector<uint32_t>& cpus) {
+  size_t position = 0;
+  while (position <= list.size()) {
+    size_t end = list.find(',', position);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+
+    std::string range = list.substr(position, end - position);
+    size_t dash = range.find('-');
+    uint32_t first;
+    uint32_t last;
+    if (dash == std::string::npos) {
+      if (!parseCpuNumber(range, first)) {
+        return false;
+      }
+
+      last = first;
+    } else if (!parseCpuNumber(range.substr(0, dash), first) || !parseCpuNumber(range.substr(dash + 1), last) || last < first) {
+      return false;
+    }
+
+    for (uint32_t cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+
+    position = end + 1;
+  }
+
+  return true;
+}
+
+}
+
+std::vector<CpuInfo> getAvailableCpus() {
+  std::vector<CpuInfo> cpus;
+
+#ifdef _WIN32
+  DWORD_PTR processMask;
+  DWORD_PTR systemMask;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+    for (uint32_t cpu = 0; cpu < sizeof(processMask) * 8; ++cpu) {
+      if ((processMask & (static_cast<DWORD_PTR>(1) << cpu)) != 0) {
+        UCHAR node;
+        if (!GetNumaProcessorNode(static_cast<UCHAR>(cpu), &node)) {
+          node = 0;
+        }
+
+        cpus.push_back({cpu, node});
+      }
+    }
+  }
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back({cpu, 0});
+      }
+    }
+  }
+
+  for (uint32_t node = 0; node < MAX_NUMA_NODES; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    std::vector<uint32_t> nodeCpus;
+    if (!file || !std::getline(file, list) || !parseCpuList(list, nodeCpus)) {
+      continue;
+    }
+
+    for (CpuInfo& info : cpus) {
+      if (std::find(nodeCpus.begin(), nodeCpus.end(), info.cpu) != nodeCpus.end()) {
+        info.node = node;
+      }
+    }
+  }
+#endif
+
+  if (cpus.empty()) {
+    for (uint32_t cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+      cpus.push_back({cpu, 0});
+    }
+  }
+
+  return cpus;
+}
+
+bool parseCpuAffinity(const std::string& affinity, size_t threadCount, std::vector<CpuInfo>& cpus) {
+  std::vector<CpuInfo> available = getAvailableCpus();
+  if (available.empty()) {
+    return false;
+  }
+
+  std::vector<CpuInfo> order;
+  if (affinity == "auto") {
+    // Threads on different nodes do not share a memory controller and a last level cache, so the nodes are taken in
+    // turn and the processors of a node in order
+    std::map<uint32_t, std::vector<CpuInfo>> nodes;
+    for (const CpuInfo& info : available) {
+      nodes[info.node].push_back(info);
+    }
+
+    for (size_t index = 0; order.size() < available.size(); ++index) {
+      for (auto& node : nodes) {
+        if (index < node.second.size()) {
+          order.push_back(node.second[index]);
+        }
+      }
+    }
+  } else {
+    std::vector<uint32_t> list;
+    if (!parseCpuList(affinity, list)) {
+      return false;
+    }
+
+    for (uint32_t cpu : list) {
+      auto it = std::find_if(available.begin(), available.end(), [cpu](const CpuInfo& info) { return info.cpu == cpu; });
+      if (it == available.end()) {
+        return false;
+      }
+
+      order.push_back(*it);
+    }
+  }
+
+  cpus.clear();
+  for (size_t thread = 0; thread < threadCount; ++thread) {
+    cpus.push_back(order[thread % order.size()]);
+  }
+
+  return true;
+}
+
+bool setThreadAffinity(uint32_t cpu) {
+#ifdef _WIN32
+  if (cpu >= sizeof(DWORD_PTR) * 8) {
+    return false;
+  }
+
+  return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+  if (cpu >= CPU_SETSIZE) {
+    return false;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Common {
+
+struct CpuInfo {
+  uint32_t cpu;
+  uint32_t node; // NUMA node of the processor, 0 when the system has no NUMA
+};
+
+std::vector<CpuInfo> getAvailableCpus(); // Returns the processors the process is allowed to run on, does not throw
+
+// Assigns a processor to each of 'threadCount' threads. 'affinity' is either "auto", spreading the threads over the
+// NUMA nodes, or a list of processors like "0-3,8" which is reused from the start when there are more threads than
+// processors. Returns false on a malformed list or a processor the process may not run on
+bool parseCpuAffinity(const std::string& affinity, size_t threadCount, std::vector<CpuInfo>& cpus);
+
+bool setThreadAffinity(uint32_t cpu); // Binds the calling thread to the processor, returns false if it is not supported or failed
+
+}
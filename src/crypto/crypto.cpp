@@ -79,6 +79,23 @@ namespace crypto {
     return true;
   }
 
+  bool crypto_ops::generate_key_derivations(const PublicKey &key1, const SecretKey *keys2, size_t count, KeyDerivation *derivations) {
+    ge_p3 point;
+    ge_p2 point2;
+    ge_p1p1 point3;
+    if (ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&key1)) != 0) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      assert(sc_check(reinterpret_cast<const unsigned char*>(&keys2[i])) == 0);
+      ge_scalarmult(&point2, reinterpret_cast<const unsigned char*>(&keys2[i]), &point);
+      ge_mul8(&point3, &point2);
+      ge_p1p1_to_p2(&point2, &point3);
+      ge_tobytes(reinterpret_cast<unsigned char*>(&derivations[i]), &point2);
+    }
+    return true;
+  }
+
   static void derivation_to_scalar(const KeyDerivation &derivation, size_t output_index, EllipticCurveScalar &res) {
     struct {
       KeyDerivation derivation;
@@ -224,6 +241,28 @@ namespace crypto {
   }
 
 
+  bool crypto_ops::underive_public_keys(const KeyDerivation *derivations, size_t count, size_t output_index,
+    const PublicKey &derived_key, PublicKey *bases) {
+    EllipticCurveScalar scalar;
+    ge_p3 point1;
+    ge_p3 point2;
+    ge_cached point3;
+    ge_p1p1 point4;
+    ge_p2 point5;
+    if (ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(&derived_key)) != 0) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      derivation_to_scalar(derivations[i], output_index, scalar);
+      ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      ge_p1p1_to_p2(&point5, &point4);
+      ge_tobytes(reinterpret_cast<unsigned char*>(&bases[i]), &point5);
+    }
+    return true;
+  }
+
   struct s_comm {
     Hash h;
     EllipticCurvePoint key;
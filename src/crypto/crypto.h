@@ -45,6 +45,8 @@ struct EllipticCurveScalar {
     friend bool secret_key_to_public_key(const SecretKey &, PublicKey &);
     static bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
     friend bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
+    static bool generate_key_derivations(const PublicKey &, const SecretKey *, size_t, KeyDerivation *);
+    friend bool generate_key_derivations(const PublicKey &, const SecretKey *, size_t, KeyDerivation *);
     static bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
@@ -63,6 +65,8 @@ struct EllipticCurveScalar {
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
+    static bool underive_public_keys(const KeyDerivation *, size_t, size_t, const PublicKey &, PublicKey *);
+    friend bool underive_public_keys(const KeyDerivation *, size_t, size_t, const PublicKey &, PublicKey *);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     friend void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     static bool check_signature(const Hash &, const PublicKey &, const Signature &);
@@ -148,6 +152,12 @@ struct EllipticCurveScalar {
     return crypto_ops::generate_key_derivation(key1, key2, derivation);
   }
 
+  /* Derivations of one transaction key with several "view" keys, the transaction key is decoded once.
+   */
+  inline bool generate_key_derivations(const PublicKey &key1, const SecretKey *keys2, size_t count, KeyDerivation *derivations) {
+    return crypto_ops::generate_key_derivations(key1, keys2, count, derivations);
+  }
+
   inline bool derive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &base, const uint8_t* prefix, size_t prefixLength, PublicKey &derived_key) {
     return crypto_ops::derive_public_key(derivation, output_index, base, prefix, prefixLength, derived_key);
@@ -187,6 +197,13 @@ struct EllipticCurveScalar {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* underive_public_key of one output for several derivations, the output key is decoded once.
+   */
+  inline bool underive_public_keys(const KeyDerivation *derivations, size_t count, size_t output_index,
+    const PublicKey &derived_key, PublicKey *bases) {
+    return crypto_ops::underive_public_keys(derivations, count, output_index, derived_key, bases);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
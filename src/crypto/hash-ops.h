@@ -53,6 +53,11 @@ enum {
 void cn_fast_hash(const void *data, size_t length, char *hash);
 
 void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int prehashed);
+// cn_slow_hash allocates the scratchpad of the calling thread on first use, hashing threads allocate it up front and
+// free it before they exit
+void slow_hash_allocate_state(void);
+void slow_hash_free_state(void);
+int slow_hash_huge_pages(void);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
@@ -328,6 +328,7 @@ union cn_slow_hash_state
 
 THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
+THREADV int hp_huge_pages = 0;
 
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
@@ -605,6 +606,12 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
  * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
  * during the random accesses to the scratch buffer.  This is one of the
  * important speed optimizations needed to make CryptoNight faster.
+ * Without reserved huge pages it asks for a transparent huge page on Linux
+ * and falls back to malloc if mapping fails.
+ *
+ * The pages are placed on the NUMA node of the thread that first writes them,
+ * so a thread pinned to a processor gets a scratch buffer local to it when it
+ * calls this after pinning.
  *
  * No parameters.  Updates a thread-local pointer, hp_state, to point to
  * the allocated buffer.
@@ -619,6 +626,7 @@ void slow_hash_allocate_state(void)
     SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
     hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
                                         MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    hp_huge_pages = hp_state != NULL;
 #else
 #if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
   defined(__DragonFly__) || defined(__NetBSD__)
@@ -627,6 +635,17 @@ void slow_hash_allocate_state(void)
 #else
     hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+    if(hp_state != MAP_FAILED)
+        hp_huge_pages = 1;
+    else
+    {
+        hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, 0, 0);
+#ifdef MADV_HUGEPAGE
+        if(hp_state != MAP_FAILED)
+            madvise(hp_state, MEMORY, MADV_HUGEPAGE);
+#endif
+    }
 #endif
     if(hp_state == MAP_FAILED)
         hp_state = NULL;
@@ -661,6 +680,16 @@ void slow_hash_free_state(void)
 
     hp_state = NULL;
     hp_allocated = 0;
+    hp_huge_pages = 0;
+}
+
+/**
+ *@brief returns 1 if the scratch buffer of the calling thread is on a reserved huge page
+ */
+
+int slow_hash_huge_pages(void)
+{
+    return hp_huge_pages;
 }
 
 /**
@@ -842,6 +871,11 @@ void slow_hash_free_state(void)
   return;
 }
 
+int slow_hash_huge_pages(void)
+{
+  return 0;
+}
+
 #if defined(__GNUC__)
 #define RDATA_ALIGN16 __attribute__ ((aligned(16)))
 #define STATIC static
@@ -1404,6 +1438,11 @@ void slow_hash_free_state(void)
   return;
 }
 
+int slow_hash_huge_pages(void)
+{
+  return 0;
+}
+
 static void (*const extra_hashes[4])(const void *, size_t, char *) = {
   hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
 };
@@ -31,6 +31,21 @@ namespace std {
 
 namespace cryptonote {
 
+namespace {
+
+// Number of outputs created below the given height; outputs of an amount are ordered by block.
+size_t countOutputsBelowHeight(const std::vector<std::pair<TransactionIndex, uint16_t>>& outputs, uint32_t height) {
+  return std::lower_bound(outputs.begin(), outputs.end(), height,
+    [](const std::pair<TransactionIndex, uint16_t>& output, uint32_t height) { return output.first.block < height; }) - outputs.begin();
+}
+
+size_t countOutputsBelowHeight(const std::vector<MultisignatureOutputUsage>& outputs, uint32_t height) {
+  return std::lower_bound(outputs.begin(), outputs.end(), height,
+    [](const MultisignatureOutputUsage& output, uint32_t height) { return output.transactionIndex.block < height; }) - outputs.begin();
+}
+
+}
+
 template<typename K, typename V, typename Hash>
 bool serialize(google::sparse_hash_map<K, V, Hash>& value, Common::StringView name, cryptonote::ISerializer& serializer) {
   return serializeMap(value, name, serializer, [&value](size_t size) { value.resize(size); });
@@ -161,6 +176,10 @@ bool Blockchain::init(bool load_existing) {
     return false;
   }
 
+  if (!m_rawBlocks.open(m_currency.rawBlocksFileName(), m_currency.rawBlockIndexesFileName(), 1024)) {
+    return false;
+  }
+
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
     BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
@@ -172,15 +191,21 @@ bool Blockchain::init(bool load_existing) {
     }
 
     loadBlockchainIndices();
+
+    if (m_rawBlocks.size() != m_blocks.size()) {
+      logger(WARNING, BRIGHT_YELLOW) << "Raw block storage is out of date, rebuilding...";
+      rebuildRawBlocks();
+    }
   } else {
     m_blocks.clear();
+    m_rawBlocks.clear();
   }
 
   if (m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
     BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
-    pushBlock(m_currency.genesisBlock(), bvc);
+    pushBlock(CachedBlock(m_currency.genesisBlock()), bvc);
     if (bvc.m_verifivation_failed) {
       logger(ERROR, BRIGHT_RED) << "Failed to add genesis block to blockchain";
       return false;
@@ -213,22 +238,26 @@ bool Blockchain::init(bool load_existing) {
 void Blockchain::rebuildCache() {
   std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
   m_blockIndex.clear();
+  m_blockTimestamps.clear();
   m_transactionMap.clear();
   m_spent_keys.clear();
   m_outputs.clear();
   m_multisignatureOutputs.clear();
+  m_blockTimestamps.reserve(m_blocks.size());
   for (uint32_t b = 0; b < m_blocks.size(); ++b) {
     if (b % 1000 == 0) {
       logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
     }
     const BlockEntry& block = m_blocks[b];
-    crypto::Hash blockHash = get_block_hash(block.bl);
-    m_blockIndex.push(blockHash);
+    CachedBlock cachedBlock(block.bl);
+    m_blockIndex.push(cachedBlock.getBlockHash());
+    m_blockTimestamps.push_back(block.bl.timestamp);
     for (uint16_t t = 0; t < block.transactions.size(); ++t) {
       const TransactionEntry& transaction = block.transactions[t];
-      crypto::Hash transactionHash = getObjectHash(transaction.tx);
+      const crypto::Hash& transactionHash = t == 0 ? cachedBlock.getMinerTransactionHash() : block.bl.transactionHashes[t - 1];
       TransactionIndex transactionIndex = { b, t };
-      m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
+      TransactionLocation location = { transactionIndex, static_cast<uint32_t>(getObjectBinarySize(transaction.tx)), transaction.m_global_output_indexes };
+      m_transactionMap.insert(std::make_pair(transactionHash, std::move(location)));
 
       // process inputs
       for (auto& i : transaction.tx.inputs) {
@@ -257,6 +286,28 @@ void Blockchain::rebuildCache() {
   logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
 }
 
+void Blockchain::rebuildRawBlocks() {
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  m_rawBlocks.clear();
+  for (uint32_t b = 0; b < m_blocks.size(); ++b) {
+    if (b % 1000 == 0) {
+      logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+    }
+    const BlockEntry& block = m_blocks[b];
+    RawBlock rawBlock;
+    rawBlock.block = asString(toBinaryArray(block.bl));
+    rawBlock.transactions.reserve(block.transactions.size() - 1);
+    for (size_t t = 1; t < block.transactions.size(); ++t) {
+      rawBlock.transactions.push_back(asString(toBinaryArray(block.transactions[t].tx)));
+    }
+
+    m_rawBlocks.push_back(rawBlock);
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding raw block storage took: " << duration.count();
+}
+
 bool Blockchain::storeCache() {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
@@ -280,7 +331,9 @@ bool Blockchain::deinit() {
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   m_blocks.clear();
+  m_rawBlocks.clear();
   m_blockIndex.clear();
+  m_blockTimestamps.clear();
   m_transactionMap.clear();
 
   m_spent_keys.clear();
@@ -414,14 +467,14 @@ bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain,
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   // remove failed subchain
   for (size_t i = m_blocks.size() - 1; i >= rollback_height; i--) {
-    popBlock(get_block_hash(m_blocks.back().bl));
+    popBlock(m_blockIndex.getTailId());
   }
 
-  // return back original chain
+  // return back original chain, its blocks were valid main chain blocks already
   for (auto &bl : original_chain) {
     BlockVerificationContext bvc =
       boost::value_initialized<BlockVerificationContext>();
-    bool r = pushBlock(bl, bvc);
+    bool r = pushBlock(CachedBlock(bl), bvc, true);
     if (!(r && bvc.m_added_to_main_chain)) {
       logger(ERROR, BRIGHT_RED) << "PANIC!!! failed to add (again) block while "
         "chain switching during the rollback!";
@@ -448,12 +501,28 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     return false;
   }
 
+  //validating new alternative chain on top of the main chain state, main chain is not touched yet
+  auto validationStart = std::chrono::steady_clock::now();
+  std::list<blocks_ext_by_hash::iterator>::const_iterator failedBlock = alt_chain.end();
+  if (!validateAlternativeChain(alt_chain, static_cast<uint32_t>(split_height), failedBlock)) {
+    logger(INFO, BRIGHT_WHITE) << "Failed to switch to alternative blockchain";
+    logger(INFO, BRIGHT_WHITE) << "The block was inserted as invalid while connecting new alternative chain,  block_id: " << (*failedBlock)->first;
+    for (auto alt_ch_to_orph_iter = failedBlock; alt_ch_to_orph_iter != alt_chain.end(); alt_ch_to_orph_iter++) {
+      m_orthanBlocksIndex.remove((*alt_ch_to_orph_iter)->second.bl);
+      m_alternative_chains.erase(*alt_ch_to_orph_iter);
+    }
+
+    return false;
+  }
+
+  auto validation_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - validationStart).count();
+  auto switchStart = std::chrono::steady_clock::now();
+
   //disconnecting old chain
   std::list<Block> disconnected_chain;
   for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
     Block b = m_blocks[i].bl;
-    popBlock(get_block_hash(b));
-    //if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to remove block on chain switching"; return false; }
+    popBlock(m_blockIndex.getTailId());
     disconnected_chain.push_front(b);
   }
 
@@ -461,12 +530,12 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
   for (auto alt_ch_iter = alt_chain.begin(); alt_ch_iter != alt_chain.end(); alt_ch_iter++) {
     auto ch_ent = *alt_ch_iter;
     BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
-    bool r = pushBlock(ch_ent->second.bl, bvc);
+    bool r = pushBlock(CachedBlock(ch_ent->second.bl), bvc, true);
     if (!r || !bvc.m_added_to_main_chain) {
       logger(INFO, BRIGHT_WHITE) << "Failed to switch to alternative blockchain";
       rollback_blockchain_switching(disconnected_chain, split_height);
       //add_block_as_invalid(ch_ent->second, get_block_hash(ch_ent->second.bl));
-      logger(INFO, BRIGHT_WHITE) << "The block was inserted as invalid while connecting new alternative chain,  block_id: " << get_block_hash(ch_ent->second.bl);
+      logger(INFO, BRIGHT_WHITE) << "The block was inserted as invalid while connecting new alternative chain,  block_id: " << ch_ent->first;
       m_orthanBlocksIndex.remove(ch_ent->second.bl);
       m_alternative_chains.erase(ch_ent);
 
@@ -481,6 +550,8 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
     }
   }
 
+  auto switch_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - switchStart).count();
+
   if (!discard_disconnected_chain) {
     //pushing old chain as alternative chain
     for (auto& old_ch_ent : disconnected_chain) {
@@ -500,14 +571,306 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
 
   //removing all_chain entries from alternative chain
   for (auto ch_ent : alt_chain) {
-    blocksFromCommonRoot.push_back(get_block_hash(ch_ent->second.bl));
+    blocksFromCommonRoot.push_back(ch_ent->first);
     m_orthanBlocksIndex.remove(ch_ent->second.bl);
     m_alternative_chains.erase(ch_ent);
   }
 
   sendMessage(BlockchainMessage(ChainSwitchMessage(std::move(blocksFromCommonRoot))));
 
-  logger(INFO, BRIGHT_GREEN) << "REORGANIZE SUCCESS! on height: " << split_height << ", new blockchain size: " << m_blocks.size();
+  logger(INFO, BRIGHT_GREEN) << "REORGANIZE SUCCESS! on height: " << split_height << ", new blockchain size: " << m_blocks.size()
+    << ", depth: " << disconnected_chain.size() << ", " << validation_time << "/" << switch_time << "ms";
+  return true;
+}
+
+// Precondition: m_blockchain_lock is locked.
+bool Blockchain::validateAlternativeChain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, uint32_t splitHeight,
+  std::list<blocks_ext_by_hash::iterator>::const_iterator& failedBlock) {
+  AlternativeChainState state;
+  state.splitHeight = splitHeight;
+  state.height = splitHeight;
+  state.alreadyGeneratedCoins = m_blocks[splitHeight - 1].already_generated_coins;
+
+  crypto::KeyImage nullImage = boost::value_initialized<decltype(nullImage)>();
+  state.releasedKeyImages.set_deleted_key(nullImage);
+  state.spentKeyImages.set_deleted_key(nullImage);
+
+  for (uint32_t height = splitHeight; height < m_blocks.size(); ++height) {
+    const BlockEntry& block = m_blocks[height];
+    for (const TransactionEntry& transaction : block.transactions) {
+      for (const auto& input : transaction.tx.inputs) {
+        if (input.type() == typeid(KeyInput)) {
+          state.releasedKeyImages.insert(::boost::get<KeyInput>(input).keyImage);
+        } else if (input.type() == typeid(MultisignatureInput)) {
+          const MultisignatureInput& multisignatureInput = ::boost::get<MultisignatureInput>(input);
+          state.releasedMultisignatureOutputs.insert(std::make_pair(multisignatureInput.amount, multisignatureInput.outputIndex));
+        }
+      }
+    }
+  }
+
+  for (auto it = alt_chain.begin(); it != alt_chain.end(); ++it) {
+    if (!validateAlternativeBlock(state, CachedBlock((*it)->second.bl))) {
+      failedBlock = it;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Mirrors the checks pushBlock does on transactions and the miner reward. Proof of work, timestamps and
+// miner transaction prevalidation are done by handle_alternative_block when the block enters the alternative chain.
+bool Blockchain::validateAlternativeBlock(AlternativeChainState& state, const CachedBlock& cachedBlock) {
+  const Block& block = cachedBlock.getBlock();
+  const crypto::Hash& blockHash = cachedBlock.getBlockHash();
+
+  if (!pushTransaction(state, block.baseTransaction)) {
+    logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
+    return false;
+  }
+
+  size_t cumulativeBlockSize = getObjectBinarySize(block.baseTransaction);
+  uint64_t feeSummary = 0;
+  for (const crypto::Hash& transactionHash : block.transactionHashes) {
+    Transaction transaction;
+    if (!getAlternativeChainTransaction(state, transactionHash, transaction)) {
+      logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has unknown transaction " << transactionHash;
+      return false;
+    }
+
+    CachedTransaction cachedTransaction(transaction, transactionHash);
+    if (!checkTransactionInputs(state, cachedTransaction)) {
+      logger(INFO, BRIGHT_WHITE) <<
+        "Block " << blockHash << " has at least one transaction with wrong inputs: " << transactionHash;
+      return false;
+    }
+
+    if (!pushTransaction(state, transaction)) {
+      logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has double spending transaction " << transactionHash;
+      return false;
+    }
+
+    cumulativeBlockSize += cachedTransaction.getTransactionBinarySize();
+    feeSummary += getInputAmount(transaction) - getOutputAmount(transaction);
+  }
+
+  if (!checkCumulativeBlockSize(blockHash, cumulativeBlockSize, state.height)) {
+    return false;
+  }
+
+  std::vector<size_t> lastBlocksSizes;
+  size_t branchCount = std::min(state.blockSizes.size(), m_currency.rewardBlocksWindow());
+  if (branchCount < m_currency.rewardBlocksWindow()) {
+    getBackwardBlocksSize(state.splitHeight - 1, lastBlocksSizes, m_currency.rewardBlocksWindow() - branchCount);
+  }
+
+  lastBlocksSizes.insert(lastBlocksSizes.end(), state.blockSizes.end() - branchCount, state.blockSizes.end());
+
+  uint64_t reward = 0;
+  int64_t emissionChange = 0;
+  if (!checkMinerTransactionReward(block, Common::medianValue(lastBlocksSizes), cumulativeBlockSize, state.alreadyGeneratedCoins, feeSummary, reward, emissionChange)) {
+    logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid miner transaction";
+    return false;
+  }
+
+  state.blockSizes.push_back(cumulativeBlockSize);
+  state.alreadyGeneratedCoins += emissionChange;
+  ++state.height;
+  return true;
+}
+
+// Alternative blocks take their transactions either from the pool or from the main chain blocks they replace.
+bool Blockchain::getAlternativeChainTransaction(const AlternativeChainState& state, const crypto::Hash& transactionHash, Transaction& transaction) {
+  auto it = m_transactionMap.find(transactionHash);
+  if (it != m_transactionMap.end()) {
+    if (it->second.index.block < state.splitHeight) {
+      return false;
+    }
+
+    transaction = transactionByIndex(it->second.index).tx;
+    return true;
+  }
+
+  std::vector<crypto::Hash> transactionHashes(1, transactionHash);
+  std::vector<Transaction> transactions;
+  std::vector<crypto::Hash> missedTransactions;
+  m_tx_pool.getTransactions(transactionHashes, transactions, missedTransactions);
+  if (transactions.empty()) {
+    return false;
+  }
+
+  transaction = std::move(transactions.front());
+  return true;
+}
+
+bool Blockchain::checkTransactionInputs(const AlternativeChainState& state, const CachedTransaction& transaction) {
+  const Transaction& tx = transaction.getTransaction();
+  const crypto::Hash& transactionPrefixHash = transaction.getTransactionPrefixHash();
+  const crypto::Hash& transactionHash = transaction.getTransactionHash();
+
+  size_t inputIndex = 0;
+  for (const auto& txin : tx.inputs) {
+    assert(inputIndex < tx.signatures.size());
+    if (txin.type() == typeid(KeyInput)) {
+      if (!checkKeyInput(state, ::boost::get<KeyInput>(txin), transactionPrefixHash, tx.signatures[inputIndex])) {
+        logger(INFO, BRIGHT_WHITE) <<
+          "Failed to check ring signature for tx " << transactionHash;
+        return false;
+      }
+    } else if (txin.type() == typeid(MultisignatureInput)) {
+      if (!validateInput(state, ::boost::get<MultisignatureInput>(txin), transactionHash, transactionPrefixHash, tx.signatures[inputIndex])) {
+        return false;
+      }
+    } else {
+      logger(INFO, BRIGHT_WHITE) <<
+        "Transaction << " << transactionHash << " contains input of unsupported type.";
+      return false;
+    }
+
+    ++inputIndex;
+  }
+
+  return true;
+}
+
+bool Blockchain::checkKeyInput(const AlternativeChainState& state, const KeyInput& input, const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& signatures) {
+  if (input.outputIndexes.empty()) {
+    logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction";
+    return false;
+  }
+
+  if ((m_spent_keys.count(input.keyImage) != 0 && state.releasedKeyImages.count(input.keyImage) == 0) || state.spentKeyImages.count(input.keyImage) != 0) {
+    logger(DEBUGGING) <<
+      "Key image already spent in alternative chain: " << Common::podToHex(input.keyImage);
+    return false;
+  }
+
+  auto mainOutputs = m_outputs.find(input.amount);
+  size_t mainOutputsCount = mainOutputs == m_outputs.end() ? 0 : countOutputsBelowHeight(mainOutputs->second, state.splitHeight);
+  auto branchOutputs = state.keyOutputs.find(input.amount);
+  size_t branchOutputsCount = branchOutputs == state.keyOutputs.end() ? 0 : branchOutputs->second.size();
+
+  std::vector<crypto::PublicKey> outputKeys;
+  outputKeys.reserve(input.outputIndexes.size());
+  for (uint32_t outputIndex : relative_output_offsets_to_absolute(input.outputIndexes)) {
+    uint64_t unlockTime;
+    if (outputIndex < mainOutputsCount) {
+      const std::pair<TransactionIndex, uint16_t>& outputReference = mainOutputs->second[outputIndex];
+      const Transaction& outputTransaction = transactionByIndex(outputReference.first).tx;
+      if (!(outputReference.second < outputTransaction.outputs.size()) || outputTransaction.outputs[outputReference.second].target.type() != typeid(KeyOutput)) {
+        logger(ERROR, BRIGHT_RED) << "Wrong index in transaction outputs: " << outputReference.second;
+        return false;
+      }
+
+      unlockTime = outputTransaction.unlockTime;
+      outputKeys.push_back(::boost::get<KeyOutput>(outputTransaction.outputs[outputReference.second].target).key);
+    } else if (outputIndex - mainOutputsCount < branchOutputsCount) {
+      const AlternativeKeyOutput& output = branchOutputs->second[outputIndex - mainOutputsCount];
+      unlockTime = output.unlockTime;
+      outputKeys.push_back(output.key);
+    } else {
+      logger(INFO) << "Wrong index in transaction inputs: " << outputIndex << ", expected maximum " << mainOutputsCount + branchOutputsCount - 1;
+      return false;
+    }
+
+    if (!is_tx_spendtime_unlocked(unlockTime, state.height)) {
+      logger(INFO, BRIGHT_WHITE) <<
+        "One of outputs for one of inputs have wrong tx.unlockTime = " << unlockTime;
+      return false;
+    }
+  }
+
+  if (!(signatures.size() == outputKeys.size())) { logger(ERROR, BRIGHT_RED) << "internal error: tx signatures count=" << signatures.size() << " mismatch with outputs keys count for inputs=" << outputKeys.size(); return false; }
+  if (m_is_in_checkpoint_zone) {
+    return true;
+  }
+
+  std::vector<const crypto::PublicKey*> outputKeyPointers;
+  outputKeyPointers.reserve(outputKeys.size());
+  for (const crypto::PublicKey& key : outputKeys) {
+    outputKeyPointers.push_back(&key);
+  }
+
+  return crypto::check_ring_signature(transactionPrefixHash, input.keyImage, outputKeyPointers, signatures.data());
+}
+
+bool Blockchain::validateInput(const AlternativeChainState& state, const MultisignatureInput& input, const crypto::Hash& transactionHash,
+  const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& transactionSignatures) {
+  auto mainOutputs = m_multisignatureOutputs.find(input.amount);
+  size_t mainOutputsCount = mainOutputs == m_multisignatureOutputs.end() ? 0 : countOutputsBelowHeight(mainOutputs->second, state.splitHeight);
+  auto branchOutputs = state.multisignatureOutputs.find(input.amount);
+  size_t branchOutputsCount = branchOutputs == state.multisignatureOutputs.end() ? 0 : branchOutputs->second.size();
+
+  bool isUsed;
+  uint64_t unlockTime;
+  MultisignatureOutput output;
+  if (input.outputIndex < mainOutputsCount) {
+    const MultisignatureOutputUsage& outputUsage = mainOutputs->second[input.outputIndex];
+    auto outputKey = std::make_pair(input.amount, input.outputIndex);
+    isUsed = (outputUsage.isUsed && state.releasedMultisignatureOutputs.count(outputKey) == 0) || state.usedMultisignatureOutputs.count(outputKey) != 0;
+
+    const Transaction& outputTransaction = transactionByIndex(outputUsage.transactionIndex).tx;
+    unlockTime = outputTransaction.unlockTime;
+    output = ::boost::get<MultisignatureOutput>(outputTransaction.outputs[outputUsage.outputIndex].target);
+  } else if (input.outputIndex - mainOutputsCount < branchOutputsCount) {
+    const AlternativeMultisignatureOutput& branchOutput = branchOutputs->second[input.outputIndex - mainOutputsCount];
+    isUsed = branchOutput.isUsed;
+    unlockTime = branchOutput.unlockTime;
+    output = branchOutput.output;
+  } else {
+    logger(DEBUGGING) <<
+      "Transaction << " << transactionHash << " contains multisignature input with invalid outputIndex.";
+    return false;
+  }
+
+  if (isUsed) {
+    logger(DEBUGGING) <<
+      "Transaction << " << transactionHash << " contains double spending multisignature input.";
+    return false;
+  }
+
+  if (!is_tx_spendtime_unlocked(unlockTime, state.height)) {
+    logger(DEBUGGING) <<
+      "Transaction << " << transactionHash << " contains multisignature input which points to a locked transaction.";
+    return false;
+  }
+
+  return checkMultisignatureSignatures(input, output, transactionHash, transactionPrefixHash, transactionSignatures);
+}
+
+bool Blockchain::pushTransaction(AlternativeChainState& state, const Transaction& transaction) {
+  if (!checkMultisignatureInputsDiff(transaction)) {
+    return false;
+  }
+
+  for (const auto& input : transaction.inputs) {
+    if (input.type() == typeid(KeyInput)) {
+      if (!state.spentKeyImages.insert(::boost::get<KeyInput>(input).keyImage).second) {
+        return false;
+      }
+    } else if (input.type() == typeid(MultisignatureInput)) {
+      const MultisignatureInput& multisignatureInput = ::boost::get<MultisignatureInput>(input);
+      auto mainOutputs = m_multisignatureOutputs.find(multisignatureInput.amount);
+      size_t mainOutputsCount = mainOutputs == m_multisignatureOutputs.end() ? 0 : countOutputsBelowHeight(mainOutputs->second, state.splitHeight);
+      if (multisignatureInput.outputIndex < mainOutputsCount) {
+        state.usedMultisignatureOutputs.insert(std::make_pair(multisignatureInput.amount, multisignatureInput.outputIndex));
+      } else {
+        state.multisignatureOutputs[multisignatureInput.amount][multisignatureInput.outputIndex - mainOutputsCount].isUsed = true;
+      }
+    }
+  }
+
+  for (const auto& output : transaction.outputs) {
+    if (output.target.type() == typeid(KeyOutput)) {
+      AlternativeKeyOutput keyOutput = { transaction.unlockTime, ::boost::get<KeyOutput>(output.target).key };
+      state.keyOutputs[output.amount].push_back(keyOutput);
+    } else if (output.target.type() == typeid(MultisignatureOutput)) {
+      AlternativeMultisignatureOutput multisignatureOutput = { transaction.unlockTime, ::boost::get<MultisignatureOutput>(output.target), false };
+      state.multisignatureOutputs[output.amount].push_back(multisignatureOutput);
+    }
+  }
+
   return true;
 }
 
@@ -591,6 +954,16 @@ bool Blockchain::prevalidate_miner_transaction(const Block& b, uint32_t height)
 }
 
 bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize,
+  uint64_t alreadyGeneratedCoins, uint64_t fee,
+  uint64_t& reward, int64_t& emissionChange) {
+  std::vector<size_t> lastBlocksSizes;
+  get_last_n_blocks_sizes(lastBlocksSizes, m_currency.rewardBlocksWindow());
+  size_t blocksSizeMedian = Common::medianValue(lastBlocksSizes);
+
+  return checkMinerTransactionReward(b, blocksSizeMedian, cumulativeBlockSize, alreadyGeneratedCoins, fee, reward, emissionChange);
+}
+
+bool Blockchain::checkMinerTransactionReward(const Block& b, size_t blocksSizeMedian, size_t cumulativeBlockSize,
   uint64_t alreadyGeneratedCoins, uint64_t fee,
   uint64_t& reward, int64_t& emissionChange) {
   uint64_t minerReward = 0;
@@ -598,10 +971,6 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
     minerReward += o.amount;
   }
 
-  std::vector<size_t> lastBlocksSizes;
-  get_last_n_blocks_sizes(lastBlocksSizes, m_currency.rewardBlocksWindow());
-  size_t blocksSizeMedian = Common::medianValue(lastBlocksSizes);
-
   if (!m_currency.getBlockReward(blocksSizeMedian, cumulativeBlockSize, alreadyGeneratedCoins, fee, reward, emissionChange)) {
     logger(INFO, BRIGHT_WHITE) << "block size " << cumulativeBlockSize << " is bigger than allowed for this blockchain";
     return false;
@@ -717,8 +1086,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const crypto::Hash& id
     if (alt_chain.size()) {
       //make sure that it has right connection to main chain
       if (!(m_blocks.size() > alt_chain.front()->second.height)) { logger(ERROR, BRIGHT_RED) << "main blockchain wrong height"; return false; }
-      crypto::Hash h = NULL_HASH;
-      get_block_hash(m_blocks[alt_chain.front()->second.height - 1].bl, h);
+      crypto::Hash h = m_blockIndex.getBlockId(alt_chain.front()->second.height - 1);
       if (!(h == alt_chain.front()->second.bl.previousBlockHash)) { logger(ERROR, BRIGHT_RED) << "alternative chain have wrong connection to main chain"; return false; }
       complete_timestamps_vector(alt_chain.front()->second.height - 1, timestamps);
     } else {
@@ -862,23 +1230,8 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with CryptoNoteProtocolHandler.
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
-  std::list<Block> blocks;
-  getBlocks(arg.blocks, blocks, rsp.missed_ids);
-
-  for (const auto& bl : blocks) {
-    std::list<crypto::Hash> missed_tx_id;
-    std::list<Transaction> txs;
-    getTransactions(bl.transactionHashes, txs, rsp.missed_ids);
-    if (!(!missed_tx_id.size())) { logger(ERROR, BRIGHT_RED) << "Internal error: have missed missed_tx_id.size()=" << missed_tx_id.size() << ENDL << "for block id = " << get_block_hash(bl); return false; } //WTF???
-    rsp.blocks.push_back(block_complete_entry());
-    block_complete_entry& e = rsp.blocks.back();
-    //pack block
-    e.block = asString(toBinaryArray(bl));
-    //pack transactions
-    for (Transaction& tx : txs) {
-      e.txs.push_back(asString(toBinaryArray(tx)));
-    }
-  }
+  //blocks are served from the raw storage as is
+  getRawBlocks(arg.blocks, rsp.blocks, rsp.missed_ids);
 
   //get another transactions, if need
   std::list<Transaction> txs;
@@ -891,6 +1244,41 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
   return true;
 }
 
+bool Blockchain::getRawBlocks(const std::vector<crypto::Hash>& blockIds, std::vector<block_complete_entry>& blocks, std::vector<crypto::Hash>& missedIds) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  for (const auto& blockId : blockIds) {
+    uint32_t height = 0;
+    if (!m_blockIndex.getBlockHeight(blockId, height)) {
+      missedIds.push_back(blockId);
+      continue;
+    }
+
+    assert(height < m_rawBlocks.size());
+    const RawBlock& rawBlock = m_rawBlocks[height];
+    blocks.push_back(block_complete_entry());
+    blocks.back().block = rawBlock.block;
+    blocks.back().txs = rawBlock.transactions;
+  }
+
+  return true;
+}
+
+bool Blockchain::getRawBlock(uint32_t height, RawBlock& block) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (height >= m_rawBlocks.size()) {
+    return false;
+  }
+
+  block = m_rawBlocks[height];
+  return true;
+}
+
+uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  assert(height < m_blockTimestamps.size());
+  return m_blockTimestamps[height];
+}
+
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   for (auto& alt_bl : m_alternative_chains) {
@@ -1083,12 +1471,9 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const crypto::Hash& tx_id, st
     return false;
   }
 
-  const TransactionEntry& tx = transactionByIndex(it->second);
-  if (!(tx.m_global_output_indexes.size())) { logger(ERROR, BRIGHT_RED) << "internal error: global indexes for transaction " << tx_id << " is empty"; return false; }
-  indexs.resize(tx.m_global_output_indexes.size());
-  for (size_t i = 0; i < tx.m_global_output_indexes.size(); ++i) {
-    indexs[i] = tx.m_global_output_indexes[i];
-  }
+  const TransactionLocation& location = it->second;
+  if (!(location.globalOutputIndexes.size())) { logger(ERROR, BRIGHT_RED) << "internal error: global indexes for transaction " << tx_id << " is empty"; return false; }
+  indexs = location.globalOutputIndexes;
 
   return true;
 }
@@ -1125,7 +1510,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
   bool res = checkTransactionInputs(tx, &max_used_block_height);
   if (!res) return false;
   if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  max_used_block_id = m_blockIndex.getBlockId(max_used_block_height);
   return true;
 }
 
@@ -1142,22 +1527,23 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
 }
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
-  crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
+  return checkTransactionInputs(CachedTransaction(tx), pmax_used_block_height);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const CachedTransaction& transaction, uint32_t* pmax_used_block_height) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
-  crypto::Hash transactionHash = getObjectHash(tx);
+  const Transaction& tx = transaction.getTransaction();
+  const crypto::Hash& tx_prefix_hash = transaction.getTransactionPrefixHash();
+  const crypto::Hash& transactionHash = transaction.getTransactionHash();
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
     if (txin.type() == typeid(KeyInput)) {
       const KeyInput& in_to_key = boost::get<KeyInput>(txin);
-      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << getObjectHash(tx); return false; }
+      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << transactionHash; return false; }
 
       if (have_tx_keyimg_as_spent(in_to_key.keyImage)) {
         logger(DEBUGGING) <<
@@ -1189,9 +1575,13 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const crypto::Has
 }
 
 bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
+  return is_tx_spendtime_unlocked(unlock_time, getCurrentBlockchainHeight());
+}
+
+bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t blockchainHeight) {
   if (unlock_time < m_currency.maxBlockHeight()) {
     //interpret as block index
-    if (getCurrentBlockchainHeight() - 1 + m_currency.lockedTxAllowedDeltaBlocks() >= unlock_time)
+    if (blockchainHeight - 1 + m_currency.lockedTxAllowedDeltaBlocks() >= unlock_time)
       return true;
     else
       return false;
@@ -1341,8 +1731,9 @@ bool Blockchain::update_next_comulative_size_limit() {
 bool Blockchain::addNewBlock(const Block& bl_, BlockVerificationContext& bvc) {
   //copy block here to let modify block.target
   Block bl = bl_;
-  crypto::Hash id;
-  if (!get_block_hash(bl, id)) {
+  CachedBlock cachedBlock(bl);
+  const crypto::Hash& id = cachedBlock.getBlockHash();
+  if (id == NULL_HASH) {
     logger(ERROR, BRIGHT_RED) <<
       "Failed to get block hash, possible block has invalid format";
     bvc.m_verifivation_failed = true;
@@ -1367,7 +1758,7 @@ bool Blockchain::addNewBlock(const Block& bl_, BlockVerificationContext& bvc) {
       bvc.m_added_to_main_chain = false;
       add_result = handle_alternative_block(bl, id, bvc);
     } else {
-      add_result = pushBlock(bl, bvc);
+      add_result = pushBlock(cachedBlock, bvc);
       if (add_result) {
         sendMessage(BlockchainMessage(NewBlockMessage(id)));
       }
@@ -1385,14 +1776,14 @@ const TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
   return m_blocks[index.block].transactions[index.transaction];
 }
 
-bool Blockchain::pushBlock(const Block& blockData, BlockVerificationContext& bvc) {
+bool Blockchain::pushBlock(const CachedBlock& cachedBlock, BlockVerificationContext& bvc, bool validated) {
   std::vector<Transaction> transactions;
-  if (!loadTransactions(blockData, transactions)) {
+  if (!loadTransactions(cachedBlock.getBlock(), transactions)) {
     bvc.m_verifivation_failed = true;
     return false;
   }
 
-  if (!pushBlock(blockData, transactions, bvc)) {
+  if (!pushBlock(cachedBlock, transactions, bvc, validated)) {
     saveTransactions(transactions);
     return false;
   }
@@ -1400,12 +1791,15 @@ bool Blockchain::pushBlock(const Block& blockData, BlockVerificationContext& bvc
   return true;
 }
 
-bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, BlockVerificationContext& bvc) {
+// validated: proof of work and transaction inputs were already checked against the state this block is pushed onto.
+bool Blockchain::pushBlock(const CachedBlock& cachedBlock, const std::vector<Transaction>& transactions, BlockVerificationContext& bvc, bool validated) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
+  uint64_t hashCountStart = getBinaryArrayHashCount();
 
-  crypto::Hash blockHash = get_block_hash(blockData);
+  const Block& blockData = cachedBlock.getBlock();
+  const crypto::Hash& blockHash = cachedBlock.getBlockHash();
 
   if (m_blockIndex.hasBlock(blockHash)) {
     logger(ERROR, BRIGHT_RED) <<
@@ -1447,7 +1841,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       bvc.m_verifivation_failed = true;
       return false;
     }
-  } else {
+  } else if (!validated) {
     if (!m_currency.checkProofOfWork(blockData, currentDifficulty, proof_of_work)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << ", has too weak proof of work: " << proof_of_work << ", expected difficulty: " << currentDifficulty;
@@ -1465,16 +1859,20 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     return false;
   }
 
-  crypto::Hash minerTransactionHash = getObjectHash(blockData.baseTransaction);
+  const crypto::Hash& minerTransactionHash = cachedBlock.getMinerTransactionHash();
+  size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
+
+  RawBlock rawBlock;
+  rawBlock.block = asString(toBinaryArray(blockData));
+  rawBlock.transactions.reserve(transactions.size());
 
   BlockEntry block;
   block.bl = blockData;
   block.transactions.resize(1);
   block.transactions[0].tx = blockData.baseTransaction;
   TransactionIndex transactionIndex = { static_cast<uint32_t>(m_blocks.size()), static_cast<uint16_t>(0) };
-  pushTransaction(block, minerTransactionHash, transactionIndex);
+  pushTransaction(block, minerTransactionHash, transactionIndex, coinbase_blob_size);
 
-  size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
   for (size_t i = 0; i < transactions.size(); ++i) {
@@ -1484,9 +1882,11 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     uint64_t fee = 0;
     block.transactions.back().tx = transactions[i];
 
-    blob_size = toBinaryArray(block.transactions.back().tx).size();
+    CachedTransaction cachedTransaction(block.transactions.back().tx, tx_id);
+    const BinaryArray& blob = cachedTransaction.getTransactionBinaryArray();
+    blob_size = blob.size();
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    if (!validated && !checkTransactionInputs(cachedTransaction)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verifivation_failed = true;
@@ -1497,7 +1897,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     }
 
     ++transactionIndex.transaction;
-    pushTransaction(block, tx_id, transactionIndex);
+    pushTransaction(block, tx_id, transactionIndex, blob_size);
+    rawBlock.transactions.push_back(asString(blob));
 
     cumulative_block_size += blob_size;
     fee_summary += fee;
@@ -1526,7 +1927,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
   }
 
-  pushBlock(block);
+  pushBlock(block, blockHash, rawBlock);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
@@ -1536,7 +1937,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     << ENDL << "HEIGHT " << block.height << ", difficulty:\t" << currentDifficulty
     << ENDL << "block reward: " << m_currency.formatAmount(reward) << ", fee = " << m_currency.formatAmount(fee_summary)
     << ", coinbase_blob_size: " << coinbase_blob_size << ", cumulative size: " << cumulative_block_size
-    << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms";
+    << ", " << block_processing_time << "(" << target_calculating_time << "/" << longhash_calculating_time << ")ms"
+    << ", hashes computed: " << getBinaryArrayHashCount() - hashCountStart;
 
   bvc.m_added_to_main_chain = true;
 
@@ -1545,17 +1947,18 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   return true;
 }
 
-bool Blockchain::pushBlock(BlockEntry& block) {
-  crypto::Hash blockHash = get_block_hash(block.bl);
-
+bool Blockchain::pushBlock(BlockEntry& block, const crypto::Hash& blockHash, const RawBlock& rawBlock) {
   m_blocks.push_back(block);
+  m_rawBlocks.push_back(rawBlock);
   m_blockIndex.push(blockHash);
+  m_blockTimestamps.push_back(block.bl.timestamp);
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
 
   assert(m_blockIndex.size() == m_blocks.size());
 
+  m_observerManager.notify(&IBlockchainStorageObserver::blockPushed, static_cast<uint32_t>(m_blocks.size() - 1), blockHash);
   return true;
 }
 
@@ -1579,13 +1982,18 @@ void Blockchain::popBlock(const crypto::Hash& blockHash) {
   m_generatedTransactionsIndex.remove(m_blocks.back().bl);
 
   m_blocks.pop_back();
+  m_rawBlocks.pop_back();
   m_blockIndex.pop();
+  m_blockTimestamps.pop_back();
 
   assert(m_blockIndex.size() == m_blocks.size());
+
+  m_observerManager.notify(&IBlockchainStorageObserver::blockPopped, static_cast<uint32_t>(m_blocks.size()), blockHash);
 }
 
-bool Blockchain::pushTransaction(BlockEntry& block, const crypto::Hash& transactionHash, TransactionIndex transactionIndex) {
-  auto result = m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
+bool Blockchain::pushTransaction(BlockEntry& block, const crypto::Hash& transactionHash, TransactionIndex transactionIndex, size_t blobSize) {
+  TransactionLocation location = { transactionIndex, static_cast<uint32_t>(blobSize) };
+  auto result = m_transactionMap.insert(std::make_pair(transactionHash, location));
   if (!result.second) {
     logger(ERROR, BRIGHT_RED) <<
       "Duplicate transaction was pushed to blockchain.";
@@ -1639,13 +2047,15 @@ bool Blockchain::pushTransaction(BlockEntry& block, const crypto::Hash& transact
     }
   }
 
+  result.first->second.globalOutputIndexes = transaction.m_global_output_indexes;
+
   m_paymentIdIndex.add(transaction.tx);
 
   return true;
 }
 
 void Blockchain::popTransaction(const Transaction& transaction, const crypto::Hash& transactionHash) {
-  TransactionIndex transactionIndex = m_transactionMap.at(transactionHash);
+  TransactionIndex transactionIndex = m_transactionMap.at(transactionHash).index;
   for (size_t outputIndex = 0; outputIndex < transaction.outputs.size(); ++outputIndex) {
     const TransactionOutput& output = transaction.outputs[transaction.outputs.size() - 1 - outputIndex];
     if (output.target.type() == typeid(KeyOutput)) {
@@ -1785,6 +2195,11 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const crypto::H
   assert(outputTransaction.outputs[outputIndex.outputIndex].amount == input.amount);
   assert(outputTransaction.outputs[outputIndex.outputIndex].target.type() == typeid(MultisignatureOutput));
   const MultisignatureOutput& output = ::boost::get<MultisignatureOutput>(outputTransaction.outputs[outputIndex.outputIndex].target);
+  return checkMultisignatureSignatures(input, output, transactionHash, transactionPrefixHash, transactionSignatures);
+}
+
+bool Blockchain::checkMultisignatureSignatures(const MultisignatureInput& input, const MultisignatureOutput& output, const crypto::Hash& transactionHash,
+  const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& transactionSignatures) {
   if (input.signatureCount != output.requiredSignatureCount) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input with invalid signature count.";
@@ -1815,14 +2230,13 @@ bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_
 
   assert(startOffset < m_blocks.size());
 
-  auto bound = std::lower_bound(m_blocks.begin() + startOffset, m_blocks.end(), timestamp - m_currency.blockFutureTimeLimit(),
-    [](const BlockEntry& b, uint64_t timestamp) { return b.bl.timestamp < timestamp; });
+  auto bound = std::lower_bound(m_blockTimestamps.begin() + startOffset, m_blockTimestamps.end(), timestamp - m_currency.blockFutureTimeLimit());
 
-  if (bound == m_blocks.end()) {
+  if (bound == m_blockTimestamps.end()) {
     return false;
   }
 
-  height = static_cast<uint32_t>(std::distance(m_blocks.begin(), bound));
+  height = static_cast<uint32_t>(std::distance(m_blockTimestamps.begin(), bound));
   return true;
 }
 
@@ -1837,8 +2251,8 @@ bool Blockchain::getBlockContainingTransaction(const crypto::Hash& txId, crypto:
   if (it == m_transactionMap.end()) {
     return false;
   } else {
-    blockHeight = m_blocks[it->second.block].height;
-    blockId = getBlockIdByHeight(blockHeight);
+    blockHeight = it->second.index.block;
+    blockId = m_blockIndex.getBlockId(blockHeight);
     return true;
   }
 }
@@ -1938,7 +2352,7 @@ bool Blockchain::loadBlockchainIndices() {
         logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
       }
       const BlockEntry& block = m_blocks[b];
-      m_timestampIndex.add(block.bl.timestamp, get_block_hash(block.bl));
+      m_timestampIndex.add(block.bl.timestamp, m_blockIndex.getBlockId(b));
       m_generatedTransactionsIndex.add(block.bl);
       for (uint16_t t = 0; t < block.transactions.size(); ++t) {
         const TransactionEntry& transaction = block.transactions[t];
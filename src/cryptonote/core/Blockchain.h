@@ -5,12 +5,14 @@
 #pragma once
 
 #include <atomic>
+#include <set>
 
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 
 #include "common/ObserverManager.h"
 #include "cryptonote/core/BlockIndex.h"
+#include "cryptonote/core/CachedBlock.h"
 #include "cryptonote/core/Checkpoints.h"
 #include "cryptonote/core/Currency.h"
 #include "cryptonote/core/blockchain/serializer/exports.h"
@@ -31,6 +33,7 @@
 
 namespace cryptonote {
   struct NOTIFY_REQUEST_GET_OBJECTS_request;
+  struct block_complete_entry;
   struct NOTIFY_RESPONSE_GET_OBJECTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response;
@@ -88,6 +91,9 @@ namespace cryptonote {
     std::vector<crypto::Hash> findBlockchainSupplement(const std::vector<crypto::Hash>& remoteBlockIds, size_t maxCount,
       uint32_t& totalBlockCount, uint32_t& startBlockIndex);
     bool handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp); //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+    bool getRawBlocks(const std::vector<crypto::Hash>& blockIds, std::vector<block_complete_entry>& blocks, std::vector<crypto::Hash>& missedIds);
+    bool getRawBlock(uint32_t height, RawBlock& block);
+    uint64_t getBlockTimestamp(uint32_t height);
     bool getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response& res);
     bool getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count);
     bool getTransactionOutputGlobalIndexes(const crypto::Hash& tx_id, std::vector<uint32_t>& indexs);
@@ -137,7 +143,7 @@ namespace cryptonote {
         if (it == m_transactionMap.end()) {
           missed_txs.push_back(tx_id);
         } else {
-          txs.push_back(transactionByIndex(it->second).tx);
+          txs.push_back(transactionByIndex(it->second.index).tx);
         }
       }
     }
@@ -169,6 +175,32 @@ namespace cryptonote {
     typedef google::sparse_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //crypto::Hash - tx hash, size_t - index of out in transaction
     typedef google::sparse_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
+    struct AlternativeKeyOutput {
+      uint64_t unlockTime;
+      crypto::PublicKey key;
+    };
+
+    struct AlternativeMultisignatureOutput {
+      uint64_t unlockTime;
+      MultisignatureOutput output;
+      bool isUsed;
+    };
+
+    // Main chain cut at splitHeight with an alternative branch applied on top of it.
+    // Main chain containers are only read, everything the branch spends, adds or releases is kept here.
+    struct AlternativeChainState {
+      uint32_t splitHeight;
+      uint32_t height;
+      uint64_t alreadyGeneratedCoins;
+      std::vector<size_t> blockSizes;
+      key_images_container releasedKeyImages; // spent by main chain blocks above splitHeight
+      key_images_container spentKeyImages;
+      std::set<std::pair<uint64_t, uint32_t>> releasedMultisignatureOutputs;
+      std::set<std::pair<uint64_t, uint32_t>> usedMultisignatureOutputs;
+      std::unordered_map<uint64_t, std::vector<AlternativeKeyOutput>> keyOutputs;
+      std::unordered_map<uint64_t, std::vector<AlternativeMultisignatureOutput>> multisignatureOutputs;
+    };
+
     const Currency& m_currency;
     TxMemoryPool& m_tx_pool;
     std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
@@ -183,14 +215,17 @@ namespace cryptonote {
     std::atomic<bool> m_is_in_checkpoint_zone;
 
     typedef SwappedVector<BlockEntry> Blocks;
+    typedef SwappedVector<RawBlock> RawBlocks;
     typedef std::unordered_map<crypto::Hash, uint32_t> BlockMap;
-    typedef std::unordered_map<crypto::Hash, TransactionIndex> TransactionMap;
+    typedef std::unordered_map<crypto::Hash, TransactionLocation> TransactionMap;
 
     friend class BlockCacheSerializer;
     friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
+    RawBlocks m_rawBlocks;
     cryptonote::BlockIndex m_blockIndex;
+    std::vector<uint64_t> m_blockTimestamps; // kept in memory so timestamp searches do not load blocks
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
 
@@ -204,16 +239,26 @@ namespace cryptonote {
     Logging::LoggerRef logger;
 
     void rebuildCache();
+    void rebuildRawBlocks();
     bool storeCache();
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
+    bool validateAlternativeChain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, uint32_t splitHeight, std::list<blocks_ext_by_hash::iterator>::const_iterator& failedBlock);
+    bool validateAlternativeBlock(AlternativeChainState& state, const CachedBlock& cachedBlock);
+    bool getAlternativeChainTransaction(const AlternativeChainState& state, const crypto::Hash& transactionHash, Transaction& transaction);
+    bool checkTransactionInputs(const AlternativeChainState& state, const CachedTransaction& transaction);
+    bool checkKeyInput(const AlternativeChainState& state, const KeyInput& input, const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& signatures);
+    bool validateInput(const AlternativeChainState& state, const MultisignatureInput& input, const crypto::Hash& transactionHash, const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& transactionSignatures);
+    bool pushTransaction(AlternativeChainState& state, const Transaction& transaction);
     bool handle_alternative_block(const Block& b, const crypto::Hash& id, BlockVerificationContext& bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei);
     bool prevalidate_miner_transaction(const Block& b, uint32_t height);
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
+    bool checkMinerTransactionReward(const Block& b, size_t blocksSizeMedian, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
     bool rollback_blockchain_switching(std::list<Block>& original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
     bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
+    bool is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t blockchainHeight);
     size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs);
     bool check_block_timestamp_main(const Block& b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block& b);
@@ -224,18 +269,19 @@ namespace cryptonote {
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_comulative_size_limit();
     bool check_tx_input(const KeyInput& txin, const crypto::Hash& tx_prefix_hash, const std::vector<crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
+    bool checkTransactionInputs(const CachedTransaction& transaction, uint32_t* pmax_used_block_height = NULL);
     bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
     bool have_tx_keyimg_as_spent(const crypto::KeyImage &key_im);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
-    bool pushBlock(const Block& blockData, BlockVerificationContext& bvc);
-    bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, BlockVerificationContext& bvc);
-    bool pushBlock(BlockEntry& block);
+    bool pushBlock(const CachedBlock& cachedBlock, BlockVerificationContext& bvc, bool validated = false);
+    bool pushBlock(const CachedBlock& cachedBlock, const std::vector<Transaction>& transactions, BlockVerificationContext& bvc, bool validated);
+    bool pushBlock(BlockEntry& block, const crypto::Hash& blockHash, const RawBlock& rawBlock);
     void popBlock(const crypto::Hash& blockHash);
-    bool pushTransaction(BlockEntry& block, const crypto::Hash& transactionHash, TransactionIndex transactionIndex);
+    bool pushTransaction(BlockEntry& block, const crypto::Hash& transactionHash, TransactionIndex transactionIndex, size_t blobSize);
     void popTransaction(const Transaction& transaction, const crypto::Hash& transactionHash);
     void popTransactions(const BlockEntry& block, const crypto::Hash& minerTransactionHash);
     bool validateInput(const MultisignatureInput& input, const crypto::Hash& transactionHash, const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& transactionSignatures);
+    bool checkMultisignatureSignatures(const MultisignatureInput& input, const MultisignatureOutput& output, const crypto::Hash& transactionHash, const crypto::Hash& transactionPrefixHash, const std::vector<crypto::Signature>& transactionSignatures);
 
     bool storeBlockchainIndices();
     bool loadBlockchainIndices();
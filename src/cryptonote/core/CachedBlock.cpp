@@ -0,0 +1,107 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "CachedBlock.h"
+
+#include "common/varint.h"
+#include "CryptoNoteTools.h"
+
+using namespace crypto;
+
+namespace cryptonote {
+
+CachedBlock::CachedBlock(const Block& block) : block(block) {
+}
+
+const Block& CachedBlock::getBlock() const {
+  return block;
+}
+
+const Hash& CachedBlock::getBlockHash() const {
+  if (!blockHash.is_initialized()) {
+    const BinaryArray& hashingBlob = getBlockHashingBinaryArray();
+    blockHash = hashingBlob.empty() ? NULL_HASH : getObjectHash(hashingBlob);
+  }
+
+  return blockHash.get();
+}
+
+const Hash& CachedBlock::getMinerTransactionHash() const {
+  if (!minerTransactionHash.is_initialized()) {
+    minerTransactionHash = getObjectHash(block.baseTransaction);
+  }
+
+  return minerTransactionHash.get();
+}
+
+const Hash& CachedBlock::getTransactionTreeHash() const {
+  if (!transactionTreeHash.is_initialized()) {
+    std::vector<Hash> transactionHashes;
+    transactionHashes.reserve(block.transactionHashes.size() + 1);
+    transactionHashes.push_back(getMinerTransactionHash());
+    transactionHashes.insert(transactionHashes.end(), block.transactionHashes.begin(), block.transactionHashes.end());
+    transactionTreeHash = get_tx_tree_hash(transactionHashes);
+  }
+
+  return transactionTreeHash.get();
+}
+
+const BinaryArray& CachedBlock::getBlockHashingBinaryArray() const {
+  if (!blockHashingBinaryArray.is_initialized()) {
+    BinaryArray hashingBlob;
+    if (toBinaryArray(static_cast<const BlockHeader&>(block), hashingBlob)) {
+      const Hash& treeRootHash = getTransactionTreeHash();
+      hashingBlob.insert(hashingBlob.end(), treeRootHash.data, treeRootHash.data + sizeof(treeRootHash.data));
+      auto transactionCount = Common::asBinaryArray(Tools::get_varint_data(block.transactionHashes.size() + 1));
+      hashingBlob.insert(hashingBlob.end(), transactionCount.begin(), transactionCount.end());
+    } else {
+      hashingBlob.clear();
+    }
+
+    blockHashingBinaryArray = std::move(hashingBlob);
+  }
+
+  return blockHashingBinaryArray.get();
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction) : transaction(transaction) {
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction, const Hash& transactionHash) :
+  transaction(transaction), transactionHash(transactionHash) {
+}
+
+const Transaction& CachedTransaction::getTransaction() const {
+  return transaction;
+}
+
+const Hash& CachedTransaction::getTransactionHash() const {
+  if (!transactionHash.is_initialized()) {
+    transactionHash = getBinaryArrayHash(getTransactionBinaryArray());
+  }
+
+  return transactionHash.get();
+}
+
+const Hash& CachedTransaction::getTransactionPrefixHash() const {
+  if (!transactionPrefixHash.is_initialized()) {
+    transactionPrefixHash = getObjectHash(static_cast<const TransactionPrefix&>(transaction));
+  }
+
+  return transactionPrefixHash.get();
+}
+
+const BinaryArray& CachedTransaction::getTransactionBinaryArray() const {
+  if (!transactionBinaryArray.is_initialized()) {
+    transactionBinaryArray = toBinaryArray(transaction);
+  }
+
+  return transactionBinaryArray.get();
+}
+
+size_t CachedTransaction::getTransactionBinarySize() const {
+  return getTransactionBinaryArray().size();
+}
+
+}
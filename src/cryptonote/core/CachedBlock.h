@@ -0,0 +1,52 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include "CryptoNoteFormatUtils.h"
+
+namespace cryptonote {
+
+// Wraps a block and computes its hashes and hashing blob at most once.
+// The wrapped block must outlive the wrapper and must not be modified.
+class CachedBlock {
+public:
+  explicit CachedBlock(const Block& block);
+
+  const Block& getBlock() const;
+  const crypto::Hash& getBlockHash() const;
+  const crypto::Hash& getMinerTransactionHash() const;
+  const crypto::Hash& getTransactionTreeHash() const;
+  const BinaryArray& getBlockHashingBinaryArray() const;
+
+private:
+  const Block& block;
+  mutable boost::optional<crypto::Hash> blockHash;
+  mutable boost::optional<crypto::Hash> minerTransactionHash;
+  mutable boost::optional<crypto::Hash> transactionTreeHash;
+  mutable boost::optional<BinaryArray> blockHashingBinaryArray;
+};
+
+// Wraps a transaction and computes its blob, hash and prefix hash at most once.
+class CachedTransaction {
+public:
+  explicit CachedTransaction(const Transaction& transaction);
+  CachedTransaction(const Transaction& transaction, const crypto::Hash& transactionHash);
+
+  const Transaction& getTransaction() const;
+  const crypto::Hash& getTransactionHash() const;
+  const crypto::Hash& getTransactionPrefixHash() const;
+  const BinaryArray& getTransactionBinaryArray() const;
+  size_t getTransactionBinarySize() const;
+
+private:
+  const Transaction& transaction;
+  mutable boost::optional<crypto::Hash> transactionHash;
+  mutable boost::optional<crypto::Hash> transactionPrefixHash;
+  mutable boost::optional<BinaryArray> transactionBinaryArray;
+};
+
+}
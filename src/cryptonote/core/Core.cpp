@@ -56,7 +56,12 @@ logger(logger, "core"),
 m_mempool(currency, m_blockchain, m_timeProvider, logger),
 m_blockchain(currency, m_mempool, logger),
 m_miner(new miner(currency, *this, logger)),
-m_starter_message_showed(false) {
+m_starter_message_showed(false),
+m_blockTemplateValid(false),
+m_minerTxValid(false),
+m_blockTemplateVersion(1),
+m_blockTemplatePoolChanged(false),
+m_blockTemplatePoolRefreshTime(0) {
   set_cryptonote_protocol(pprotocol);
   m_blockchain.addObserver(this);
     m_mempool.addObserver(this);
@@ -291,53 +296,102 @@ bool core::add_new_tx(const Transaction& tx, const crypto::Hash& tx_hash, size_t
 }
 
 bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) {
-  size_t median_size;
-  uint64_t already_generated_coins;
+  uint64_t version;
+  return getBlockTemplate(b, adr, diffic, height, ex_nonce, version);
+}
+
+bool core::getBlockTemplate(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce, uint64_t& version) {
+  std::lock_guard<std::mutex> lock(m_blockTemplateLock);
+
+  version = m_blockTemplateVersion.load();
+  // the tail check covers chain changes that are not notified yet
+  if (!m_blockTemplateValid || m_blockTemplate.version != version || m_blockTemplate.block.previousBlockHash != get_tail_id()) {
+    m_blockTemplateValid = false;
+    m_minerTxValid = false;
+    if (!fillBlockTemplate(m_blockTemplate)) {
+      return false;
+    }
+
+    m_blockTemplate.version = version;
+    m_blockTemplateValid = true;
+  }
+
+  b = m_blockTemplate.block;
+  b.timestamp = time(NULL);
+  diffic = m_blockTemplate.difficulty;
+  height = m_blockTemplate.height;
+
+  if (!ex_nonce.empty() && m_minerTxValid && m_minerTxVersion == version && m_minerTxExtraNonce == ex_nonce &&
+    m_minerTxAddress.spendPublicKey == adr.spendPublicKey && m_minerTxAddress.viewPublicKey == adr.viewPublicKey) {
+    b.baseTransaction = m_minerTx;
+    return true;
+  }
+
+  if (!constructBlockMinerTx(m_blockTemplate, adr, ex_nonce, b.baseTransaction)) {
+    return false;
+  }
+
+  m_minerTxValid = true;
+  m_minerTxVersion = version;
+  m_minerTxAddress = adr;
+  m_minerTxExtraNonce = ex_nonce;
+  m_minerTx = b.baseTransaction;
+  return true;
+}
 
+uint64_t core::getBlockTemplateVersion() const {
+  return m_blockTemplateVersion.load();
+}
+
+bool core::fillBlockTemplate(BlockTemplate& blockTemplate) {
   {
     LockedBlockchainStorage blockchainLock(m_blockchain);
-    height = m_blockchain.getCurrentBlockchainHeight();
-    diffic = m_blockchain.getDifficultyForNextBlock();
-    if (!(diffic)) {
+    blockTemplate.height = m_blockchain.getCurrentBlockchainHeight();
+    blockTemplate.difficulty = m_blockchain.getDifficultyForNextBlock();
+    if (!(blockTemplate.difficulty)) {
       logger(ERROR, BRIGHT_RED) << "difficulty overhead.";
       return false;
     }
 
-    b = boost::value_initialized<Block>();
-    b.majorVersion = BLOCK_MAJOR_VERSION_1;
-    b.minorVersion = BLOCK_MINOR_VERSION_0;
+    blockTemplate.block = boost::value_initialized<Block>();
+    blockTemplate.block.majorVersion = BLOCK_MAJOR_VERSION_1;
+    blockTemplate.block.minorVersion = BLOCK_MINOR_VERSION_0;
 
-    b.previousBlockHash = get_tail_id();
-    b.timestamp = time(NULL);
+    blockTemplate.block.previousBlockHash = get_tail_id();
+    blockTemplate.block.timestamp = time(NULL);
 
-    median_size = m_blockchain.getCurrentCumulativeBlocksizeLimit() / 2;
-    already_generated_coins = m_blockchain.getCoinsInCirculation();
+    blockTemplate.medianSize = m_blockchain.getCurrentCumulativeBlocksizeLimit() / 2;
+    blockTemplate.alreadyGeneratedCoins = m_blockchain.getCoinsInCirculation();
   }
 
-  size_t txs_size;
-  uint64_t fee;
-  if (!m_mempool.fill_block_template(b, median_size, m_currency.maxBlockCumulativeSize(height), already_generated_coins,
-    txs_size, fee)) {
-    return false;
-  }
+  return m_mempool.fill_block_template(blockTemplate.block, blockTemplate.medianSize, m_currency.maxBlockCumulativeSize(blockTemplate.height),
+    blockTemplate.alreadyGeneratedCoins, blockTemplate.transactionsSize, blockTemplate.fee);
+}
+
+bool core::constructBlockMinerTx(const BlockTemplate& blockTemplate, const AccountPublicAddress& adr, const BinaryArray& ex_nonce, Transaction& minerTx) {
+  uint32_t height = blockTemplate.height;
+  size_t median_size = blockTemplate.medianSize;
+  uint64_t already_generated_coins = blockTemplate.alreadyGeneratedCoins;
+  size_t txs_size = blockTemplate.transactionsSize;
+  uint64_t fee = blockTemplate.fee;
 
   /*
      two-phase miner transaction generation: we don't know exact block size until we prepare block, but we don't know reward until we know
      block size, so first miner transaction generated with fake amount of money, and with phase we know think we know expected block size
      */
   //make blocks coin-base tx looks close to real coinbase tx to get truthful blob size
-  bool r = m_currency.constructMinerTx(height, median_size, already_generated_coins, txs_size, fee, adr, b.baseTransaction, ex_nonce, 11);
+  bool r = m_currency.constructMinerTx(height, median_size, already_generated_coins, txs_size, fee, adr, minerTx, ex_nonce, 11);
   if (!r) { 
     logger(ERROR, BRIGHT_RED) << "Failed to construct miner tx, first chance"; 
     return false; 
   }
 
-  size_t cumulative_size = txs_size + getObjectBinarySize(b.baseTransaction);
+  size_t cumulative_size = txs_size + getObjectBinarySize(minerTx);
   for (size_t try_count = 0; try_count != 10; ++try_count) {
-    r = m_currency.constructMinerTx(height, median_size, already_generated_coins, cumulative_size, fee, adr, b.baseTransaction, ex_nonce, 11);
+    r = m_currency.constructMinerTx(height, median_size, already_generated_coins, cumulative_size, fee, adr, minerTx, ex_nonce, 11);
 
     if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to construct miner tx, second chance"; return false; }
-    size_t coinbase_blob_size = getObjectBinarySize(b.baseTransaction);
+    size_t coinbase_blob_size = getObjectBinarySize(minerTx);
     if (coinbase_blob_size > cumulative_size - txs_size) {
       cumulative_size = txs_size + coinbase_blob_size;
       continue;
@@ -345,12 +399,12 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
 
     if (coinbase_blob_size < cumulative_size - txs_size) {
       size_t delta = cumulative_size - txs_size - coinbase_blob_size;
-      b.baseTransaction.extra.insert(b.baseTransaction.extra.end(), delta, 0);
+      minerTx.extra.insert(minerTx.extra.end(), delta, 0);
       //here  could be 1 byte difference, because of extra field counter is varint, and it can become from 1-byte len to 2-bytes len.
-      if (cumulative_size != txs_size + getObjectBinarySize(b.baseTransaction)) {
-        if (!(cumulative_size + 1 == txs_size + getObjectBinarySize(b.baseTransaction))) { logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " + 1 is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << getObjectBinarySize(b.baseTransaction); return false; }
-        b.baseTransaction.extra.resize(b.baseTransaction.extra.size() - 1);
-        if (cumulative_size != txs_size + getObjectBinarySize(b.baseTransaction)) {
+      if (cumulative_size != txs_size + getObjectBinarySize(minerTx)) {
+        if (!(cumulative_size + 1 == txs_size + getObjectBinarySize(minerTx))) { logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " + 1 is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << getObjectBinarySize(minerTx); return false; }
+        minerTx.extra.resize(minerTx.extra.size() - 1);
+        if (cumulative_size != txs_size + getObjectBinarySize(minerTx)) {
           //fuck, not lucky, -1 makes varint-counter size smaller, in that case we continue to grow with cumulative_size
           logger(TRACE, BRIGHT_RED) <<
             "Miner tx creation have no luck with delta_extra size = " << delta << " and " << delta - 1;
@@ -358,10 +412,10 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
           continue;
         }
         logger(DEBUGGING, BRIGHT_GREEN) <<
-          "Setting extra for block: " << b.baseTransaction.extra.size() << ", try_count=" << try_count;
+          "Setting extra for block: " << minerTx.extra.size() << ", try_count=" << try_count;
       }
     }
-    if (!(cumulative_size == txs_size + getObjectBinarySize(b.baseTransaction))) { logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << getObjectBinarySize(b.baseTransaction); return false; }
+    if (!(cumulative_size == txs_size + getObjectBinarySize(minerTx))) { logger(ERROR, BRIGHT_RED) << "unexpected case: cumulative_size=" << cumulative_size << " is not equal txs_cumulative_size=" << txs_size << " + get_object_blobsize(b.baseTransaction)=" << getObjectBinarySize(minerTx); return false; }
     return true;
   }
 
@@ -529,6 +583,10 @@ bool core::have_block(const crypto::Hash& id) {
   return m_blockchain.haveBlock(id);
 }
 
+bool core::haveTransaction(const crypto::Hash& id) {
+  return m_mempool.have_tx(id) || m_blockchain.haveTransaction(id);
+}
+
 bool core::parse_tx_from_blob(Transaction& tx, crypto::Hash& tx_hash, crypto::Hash& tx_prefix_hash, const BinaryArray& blob) {
   return parseAndValidateTransactionFromBinaryArray(blob, tx, tx_hash, tx_prefix_hash);
 }
@@ -563,6 +621,10 @@ bool core::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_R
   return m_blockchain.handleGetObjects(arg, rsp);
 }
 
+bool core::getRawBlocks(const std::vector<crypto::Hash>& blockIds, std::vector<block_complete_entry>& blocks, std::vector<crypto::Hash>& missedIds) {
+  return m_blockchain.getRawBlocks(blockIds, blocks, missedIds);
+}
+
 crypto::Hash core::getBlockIdByHeight(uint32_t height) {
   LockedBlockchainStorage lbs(m_blockchain);
   if (height < m_blockchain.getCurrentBlockchainHeight()) {
@@ -609,6 +671,15 @@ bool core::on_idle() {
 
   m_miner->on_idle();
   m_mempool.on_idle();
+
+  time_t now = time(nullptr);
+  if (m_blockTemplatePoolChanged.load() && now - m_blockTemplatePoolRefreshTime >= static_cast<time_t>(parameters::CRYPTONOTE_BLOCK_TEMPLATE_POOL_REFRESH_INTERVAL)) {
+    m_blockTemplatePoolRefreshTime = now;
+    if (m_blockTemplatePoolChanged.exchange(false)) {
+      blockTemplateUpdated();
+    }
+  }
+
   return true;
 }
 
@@ -622,6 +693,17 @@ bool core::removeObserver(ICoreObserver* observer) {
 
 void core::blockchainUpdated() {
   m_observerManager.notify(&ICoreObserver::blockchainUpdated);
+  // the new template contains the current pool
+  m_blockTemplatePoolChanged = false;
+  blockTemplateUpdated();
+}
+
+void core::blockPushed(uint32_t height, const crypto::Hash& blockHash) {
+  m_observerManager.notify(&ICoreObserver::blockPushed, height, blockHash);
+}
+
+void core::blockPopped(uint32_t height, const crypto::Hash& blockHash) {
+  m_observerManager.notify(&ICoreObserver::blockPopped, height, blockHash);
 }
 
 void core::txDeletedFromPool() {
@@ -630,6 +712,12 @@ void core::txDeletedFromPool() {
 
 void core::poolUpdated() {
   m_observerManager.notify(&ICoreObserver::poolUpdated);
+  m_blockTemplatePoolChanged = true;
+}
+
+void core::blockTemplateUpdated() {
+  ++m_blockTemplateVersion;
+  m_observerManager.notify(&ICoreObserver::blockTemplateUpdated);
 }
 
 bool core::queryBlocks(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
@@ -663,26 +751,23 @@ bool core::queryBlocks(const std::vector<crypto::Hash>& knownBlockIds, uint64_t
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
-
-  for (auto& b : blocks) {
+  uint32_t blocksEnd = std::min(currentHeight, startFullOffset + blocksLeft);
+  for (uint32_t blockHeight = startFullOffset; blockHeight < blocksEnd; ++blockHeight) {
     BlockFullInfo item;
 
-    item.block_id = get_block_hash(b);
+    item.block_id = lbs->getBlockIdByHeight(blockHeight);
 
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+    if (lbs->getBlockTimestamp(blockHeight) >= timestamp) {
+      // serve stored blobs, no need to load and serialize the block again
+      RawBlock rawBlock;
+      if (!lbs->getRawBlock(blockHeight, rawBlock)) {
+        logger(ERROR, BRIGHT_RED) << "Failed to load block " << item.block_id << " at height " << blockHeight;
+        return false;
+      }
 
-      // fill data
       block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
-      }
+      completeEntry.block = std::move(rawBlock.block);
+      completeEntry.txs = std::move(rawBlock.transactions);
     }
 
     entries.push_back(std::move(item));
@@ -751,36 +836,212 @@ bool core::queryBlocksLite(const std::vector<crypto::Hash>& knownBlockIds, uint6
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(resFullOffset, blocksLeft, blocks);
+  uint32_t blocksEnd = std::min(resCurrentHeight, resFullOffset + blocksLeft);
+  for (uint32_t blockHeight = resFullOffset; blockHeight < blocksEnd; ++blockHeight) {
+    crypto::Hash blockId = lbs->getBlockIdByHeight(blockHeight);
 
-  for (auto& b : blocks) {
-    BlockShortInfo item;
+    if (lbs->getBlockTimestamp(blockHeight) >= timestamp) {
+      std::shared_ptr<const BlockShortInfo> item = getBlockShortInfo(blockHeight, blockId);
+      if (!item) {
+        logger(ERROR, BRIGHT_RED) << "Failed to load block " << blockId << " at height " << blockHeight;
+        return false;
+      }
 
-    item.blockId = get_block_hash(b);
+      entries.push_back(*item);
+    } else {
+      entries.push_back(BlockShortInfo());
+      entries.back().blockId = blockId;
+    }
+  }
 
-    if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
-      std::list<crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
+  return true;
+}
 
-      item.block = asString(toBinaryArray(b));
+// Entries are immutable per block id, so wallets polling at the same tip share them.
+std::shared_ptr<const BlockShortInfo> core::getBlockShortInfo(uint32_t height, const crypto::Hash& blockId) {
+  {
+    std::lock_guard<std::mutex> lock(m_blockShortInfoCacheLock);
+    auto it = m_blockShortInfoCache.find(blockId);
+    if (it != m_blockShortInfoCache.end()) {
+      return it->second;
+    }
+  }
 
-      for (const auto& tx: txs) {
-        TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
+  RawBlock rawBlock;
+  if (!m_blockchain.getRawBlock(height, rawBlock)) {
+    return nullptr;
+  }
 
-        item.txPrefixes.push_back(std::move(info));
-      }
+  Block block;
+  if (!fromBinaryArray(block, asBinaryArray(rawBlock.block)) || block.transactionHashes.size() != rawBlock.transactions.size()) {
+    return nullptr;
+  }
+
+  std::shared_ptr<BlockShortInfo> item = std::make_shared<BlockShortInfo>();
+  item->blockId = blockId;
+  item->block = std::move(rawBlock.block);
+  item->txPrefixes.reserve(rawBlock.transactions.size());
+  for (size_t i = 0; i < rawBlock.transactions.size(); ++i) {
+    Transaction transaction;
+    if (!fromBinaryArray(transaction, asBinaryArray(rawBlock.transactions[i]))) {
+      return nullptr;
     }
 
-    entries.push_back(std::move(item));
+    TransactionPrefixInfo info;
+    info.txPrefix = std::move(transaction);
+    info.txHash = block.transactionHashes[i];
+    item->txPrefixes.push_back(std::move(info));
+  }
+
+  std::lock_guard<std::mutex> lock(m_blockShortInfoCacheLock);
+  if (m_blockShortInfoCache.emplace(blockId, item).second) {
+    m_blockShortInfoCacheOrder.push_back(blockId);
+    if (m_blockShortInfoCacheOrder.size() > COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE) {
+      m_blockShortInfoCache.erase(m_blockShortInfoCacheOrder.front());
+      m_blockShortInfoCacheOrder.pop_front();
+    }
+  }
+
+  return item;
+}
+
+bool core::queryBlocksScan(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight,
+  uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<std::string>& entries) {
+  LockedBlockchainStorage lbs(m_blockchain);
+
+  resCurrentHeight = lbs->getCurrentBlockchainHeight();
+  resStartHeight = 0;
+  resFullOffset = 0;
+
+  if (!findStartAndFullOffsets(knownBlockIds, timestamp, resStartHeight, resFullOffset)) {
+    return false;
+  }
+
+  auto idOnly = [](const crypto::Hash& blockId) {
+    BlockScanInfo item;
+    item.blockId = blockId;
+    item.header = BlockHeader();
+    return Common::asString(toBinaryArray(item));
+  };
+
+  std::vector<crypto::Hash> blockIds = findIdsForShortBlocks(resStartHeight, resFullOffset);
+  entries.reserve(blockIds.size());
+
+  for (const auto& id : blockIds) {
+    entries.push_back(idOnly(id));
+  }
+
+  uint32_t blocksLeft = static_cast<uint32_t>(std::min(BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT - entries.size(), size_t(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)));
+
+  if (blocksLeft == 0) {
+    return true;
+  }
+
+  uint32_t blocksEnd = std::min(resCurrentHeight, resFullOffset + blocksLeft);
+  for (uint32_t blockHeight = resFullOffset; blockHeight < blocksEnd; ++blockHeight) {
+    crypto::Hash blockId = lbs->getBlockIdByHeight(blockHeight);
+
+    if (lbs->getBlockTimestamp(blockHeight) >= timestamp) {
+      std::shared_ptr<const std::string> item = getBlockScanInfo(blockHeight, blockId);
+      if (!item) {
+        logger(ERROR, BRIGHT_RED) << "Failed to load block " << blockId << " at height " << blockHeight;
+        return false;
+      }
+
+      entries.push_back(*item);
+    } else {
+      entries.push_back(idOnly(blockId));
+    }
   }
 
   return true;
 }
 
+bool core::getBlockScanInfo(uint32_t height, BlockScanInfo& block) {
+  std::shared_ptr<const std::string> item;
+  {
+    LockedBlockchainStorage lbs(m_blockchain);
+    if (height >= lbs->getCurrentBlockchainHeight()) {
+      return false;
+    }
+
+    item = getBlockScanInfo(height, lbs->getBlockIdByHeight(height));
+  }
+
+  return item && fromBinaryArray(block, asBinaryArray(*item));
+}
+
+// Global output indexes depend only on the chain up to the block, so entries are immutable per block id as well.
+std::shared_ptr<const std::string> core::getBlockScanInfo(uint32_t height, const crypto::Hash& blockId) {
+  {
+    std::lock_guard<std::mutex> lock(m_blockScanInfoCacheLock);
+    auto it = m_blockScanInfoCache.find(blockId);
+    if (it != m_blockScanInfoCache.end()) {
+      return it->second;
+    }
+  }
+
+  RawBlock rawBlock;
+  if (!m_blockchain.getRawBlock(height, rawBlock)) {
+    return nullptr;
+  }
+
+  Block block;
+  if (!fromBinaryArray(block, asBinaryArray(rawBlock.block)) || block.transactionHashes.size() != rawBlock.transactions.size()) {
+    return nullptr;
+  }
+
+  BlockScanInfo info;
+  info.blockId = blockId;
+  info.header = block;
+  info.transactions.reserve(rawBlock.transactions.size() + 1);
+
+  auto addTransaction = [&](TransactionPrefix&& prefix, const crypto::Hash& hash) {
+    TransactionScanInfo tx;
+    tx.txHash = hash;
+    tx.txPrefix = std::move(prefix);
+    for (auto& input : tx.txPrefix.inputs) {
+      if (input.type() == typeid(KeyInput)) {
+        // wallets only look for their key images
+        boost::get<KeyInput>(input).outputIndexes.clear();
+      }
+    }
+
+    if (!get_tx_outputs_gindexs(hash, tx.globalIndexes)) {
+      return false;
+    }
+
+    info.transactions.push_back(std::move(tx));
+    return true;
+  };
+
+  crypto::Hash baseTransactionHash = getObjectHash(block.baseTransaction);
+  if (!addTransaction(std::move(block.baseTransaction), baseTransactionHash)) {
+    return nullptr;
+  }
+
+  for (size_t i = 0; i < rawBlock.transactions.size(); ++i) {
+    Transaction transaction;
+    if (!fromBinaryArray(transaction, asBinaryArray(rawBlock.transactions[i])) ||
+      !addTransaction(std::move(transaction), block.transactionHashes[i])) {
+      return nullptr;
+    }
+  }
+
+  std::shared_ptr<const std::string> item = std::make_shared<std::string>(Common::asString(toBinaryArray(info)));
+
+  std::lock_guard<std::mutex> lock(m_blockScanInfoCacheLock);
+  if (m_blockScanInfoCache.emplace(blockId, item).second) {
+    m_blockScanInfoCacheOrder.push_back(blockId);
+    if (m_blockScanInfoCacheOrder.size() > COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE) {
+      m_blockScanInfoCache.erase(m_blockScanInfoCacheOrder.front());
+      m_blockScanInfoCacheOrder.pop_front();
+    }
+  }
+
+  return item;
+}
+
 bool core::getBackwardBlocksSizes(uint32_t fromHeight, std::vector<size_t>& sizes, size_t count) {
   return m_blockchain.getBackwardBlocksSize(fromHeight, sizes, count);
 }
@@ -908,7 +1169,7 @@ std::error_code core::executeLocked(const std::function<std::error_code()>& func
   return func();
 }
 
-uint64_t core::getNextBlockDifficulty() {
+difficulty_type core::getNextBlockDifficulty() {
   return m_blockchain.getDifficultyForNextBlock();
 }
 
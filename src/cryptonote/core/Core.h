@@ -20,6 +20,11 @@
 
 #include <logging/LoggerMessage.h>
 
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 namespace cryptonote {
   class LockedBlockchainStorage;
   struct CoreStateInfo;
@@ -40,6 +45,10 @@ namespace cryptonote {
      //-------------------- IMinerHandler -----------------------
      virtual bool handle_block_found(Block& b) override;
      virtual bool get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) override;
+     // version changes with the tip and, not more often than CRYPTONOTE_BLOCK_TEMPLATE_POOL_REFRESH_INTERVAL, with the pool.
+     // Calls with the same address and a non-empty extra nonce get the same miner transaction until it changes.
+     bool getBlockTemplate(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce, uint64_t& version);
+     uint64_t getBlockTemplateVersion() const;
 
      bool addObserver(ICoreObserver* observer) override;
      bool removeObserver(ICoreObserver* observer) override;
@@ -52,6 +61,7 @@ namespace cryptonote {
      // ICore
      virtual size_t addChain(const std::vector<const IBlock*>& chain) override;
      virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) override; //Deprecated. Should be removed with CryptoNoteProtocolHandler.
+     bool getRawBlocks(const std::vector<crypto::Hash>& blockIds, std::vector<block_complete_entry>& blocks, std::vector<crypto::Hash>& missedIds);
      virtual bool getBackwardBlocksSizes(uint32_t fromHeight, std::vector<size_t>& sizes, size_t count) override;
      virtual bool getBlockSize(const crypto::Hash& hash, size_t& size) override;
      virtual bool getAlreadyGeneratedCoins(const crypto::Hash& hash, uint64_t& generatedCoins) override;
@@ -76,6 +86,7 @@ namespace cryptonote {
 
      uint32_t get_current_blockchain_height();
      bool have_block(const crypto::Hash& id) override;
+     bool haveTransaction(const crypto::Hash& id) override;
      std::vector<crypto::Hash> buildSparseChain() override;
      std::vector<crypto::Hash> buildSparseChain(const crypto::Hash& startBlockId) override;
      void on_synchronized() override;
@@ -92,6 +103,9 @@ namespace cryptonote {
        uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) override;
     virtual bool queryBlocksLite(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
       uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) override;
+    virtual bool queryBlocksScan(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp,
+      uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<std::string>& entries) override;
+    virtual bool getBlockScanInfo(uint32_t height, BlockScanInfo& block) override;
     virtual crypto::Hash getBlockIdByHeight(uint32_t height) override;
      void getTransactions(const std::vector<crypto::Hash>& txs_ids, std::list<Transaction>& txs, std::list<crypto::Hash>& missed_txs, bool checkTxPool = false) override;
      virtual bool getBlockByHash(const crypto::Hash &h, Block &blk) override;
@@ -130,7 +144,7 @@ namespace cryptonote {
      virtual void getPoolChanges(const std::vector<crypto::Hash>& knownTxsIds, std::vector<Transaction>& addedTxs,
                                  std::vector<crypto::Hash>& deletedTxsIds) override;
 
-     uint64_t getNextBlockDifficulty();
+     virtual difficulty_type getNextBlockDifficulty() override;
      uint64_t getTotalGeneratedAmount();
 
    private:
@@ -152,11 +166,30 @@ namespace cryptonote {
      bool on_update_blocktemplate_interval();
      bool check_tx_inputs_keyimages_diff(const Transaction& tx);
      virtual void blockchainUpdated() override;
+     virtual void blockPushed(uint32_t height, const crypto::Hash& blockHash) override;
+     virtual void blockPopped(uint32_t height, const crypto::Hash& blockHash) override;
      virtual void txDeletedFromPool() override;
      void poolUpdated();
+     void blockTemplateUpdated();
 
      bool findStartAndFullOffsets(const std::vector<crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset);
      std::vector<crypto::Hash> findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset);
+     std::shared_ptr<const BlockShortInfo> getBlockShortInfo(uint32_t height, const crypto::Hash& blockId);
+     std::shared_ptr<const std::string> getBlockScanInfo(uint32_t height, const crypto::Hash& blockId);
+
+     struct BlockTemplate {
+       uint64_t version;
+       Block block; // without the miner transaction
+       difficulty_type difficulty;
+       uint32_t height;
+       size_t medianSize;
+       uint64_t alreadyGeneratedCoins;
+       size_t transactionsSize;
+       uint64_t fee;
+     };
+
+     bool fillBlockTemplate(BlockTemplate& blockTemplate);
+     bool constructBlockMinerTx(const BlockTemplate& blockTemplate, const AccountPublicAddress& adr, const BinaryArray& ex_nonce, Transaction& minerTx);
 
      const Currency& m_currency;
      Logging::LoggerRef logger;
@@ -170,5 +203,27 @@ namespace cryptonote {
      friend class tx_validate_inputs;
      std::atomic<bool> m_starter_message_showed;
      Tools::ObserverManager<ICoreObserver> m_observerManager;
+
+     std::mutex m_blockShortInfoCacheLock;
+     std::unordered_map<crypto::Hash, std::shared_ptr<const BlockShortInfo>> m_blockShortInfoCache;
+     std::deque<crypto::Hash> m_blockShortInfoCacheOrder;
+
+     // serialized BlockScanInfo of recently queried blocks
+     std::mutex m_blockScanInfoCacheLock;
+     std::unordered_map<crypto::Hash, std::shared_ptr<const std::string>> m_blockScanInfoCache;
+     std::deque<crypto::Hash> m_blockScanInfoCacheOrder;
+
+     // the block template is rebuilt on request after the version changes
+     std::mutex m_blockTemplateLock;
+     bool m_blockTemplateValid;
+     BlockTemplate m_blockTemplate;
+     bool m_minerTxValid;
+     uint64_t m_minerTxVersion;
+     AccountPublicAddress m_minerTxAddress;
+     BinaryArray m_minerTxExtraNonce;
+     Transaction m_minerTx;
+     std::atomic<uint64_t> m_blockTemplateVersion;
+     std::atomic<bool> m_blockTemplatePoolChanged;
+     time_t m_blockTemplatePoolRefreshTime; // on_idle only
    };
 }
@@ -5,7 +5,14 @@
 #include "CryptoNoteTools.h"
 #include "CryptoNoteFormatUtils.h"
 
+#include <atomic>
+
 namespace cryptonote {
+
+namespace {
+std::atomic<uint64_t> binaryArrayHashCount(0);
+}
+
 template<>
 bool toBinaryArray(const BinaryArray& object, BinaryArray& binaryArray) {
   try {
@@ -21,6 +28,7 @@ bool toBinaryArray(const BinaryArray& object, BinaryArray& binaryArray) {
 }
 
 void getBinaryArrayHash(const BinaryArray& binaryArray, crypto::Hash& hash) {
+  binaryArrayHashCount.fetch_add(1, std::memory_order_relaxed);
   cn_fast_hash(binaryArray.data(), binaryArray.size(), hash);
 }
 
@@ -30,6 +38,10 @@ crypto::Hash getBinaryArrayHash(const BinaryArray& binaryArray) {
   return hash;
 }
 
+uint64_t getBinaryArrayHashCount() {
+  return binaryArrayHashCount.load(std::memory_order_relaxed);
+}
+
 uint64_t getInputAmount(const Transaction& transaction) {
   uint64_t amount = 0;
   for (auto& input : transaction.inputs) {
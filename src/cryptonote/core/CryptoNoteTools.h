@@ -16,6 +16,8 @@ namespace cryptonote {
 
 void getBinaryArrayHash(const BinaryArray& binaryArray, crypto::Hash& hash);
 crypto::Hash getBinaryArrayHash(const BinaryArray& binaryArray);
+// Number of getBinaryArrayHash calls made by this process, for profiling hash work.
+uint64_t getBinaryArrayHashCount();
 
 template<class T>
 bool toBinaryArray(const T& object, BinaryArray& binaryArray) {
@@ -484,6 +484,8 @@ CurrencyBuilder::CurrencyBuilder(Logging::ILogger& log, std::string path) : m_cu
   files.blocks = parameters::CRYPTONOTE_BLOCKS_FILENAME;
   files.blocksCache = parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME;
   files.blocksIndexes = parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME;
+  files.rawBlocks = parameters::CRYPTONOTE_RAWBLOCKS_FILENAME;
+  files.rawBlocksIndexes = parameters::CRYPTONOTE_RAWBLOCKINDEXES_FILENAME;
   files.txPool = parameters::CRYPTONOTE_POOLDATA_FILENAME;
   files.blockchainIndexes = parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME;
   m_currency.setFiles(files);
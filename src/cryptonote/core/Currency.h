@@ -94,6 +94,12 @@ public:
   const std::string blockIndexesFileName(bool withoutPath = false) const { 
     return getFiles(m_files.blocksIndexes, withoutPath);
   }
+  const std::string rawBlocksFileName(bool withoutPath = false) const {
+    return getFiles(m_files.rawBlocks, withoutPath);
+  }
+  const std::string rawBlockIndexesFileName(bool withoutPath = false) const {
+    return getFiles(m_files.rawBlocksIndexes, withoutPath);
+  }
   const std::string txPoolFileName(bool withoutPath = false) const { 
     return getFiles(m_files.txPool, withoutPath);
   }
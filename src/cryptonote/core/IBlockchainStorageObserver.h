@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <cstdint>
+
+#include <crypto.h>
+
 namespace cryptonote {
   class IBlockchainStorageObserver {
   public:
@@ -11,5 +15,7 @@ namespace cryptonote {
     }
 
     virtual void blockchainUpdated() = 0;
+    virtual void blockPushed(uint32_t height, const crypto::Hash& blockHash) {}
+    virtual void blockPopped(uint32_t height, const crypto::Hash& blockHash) {}
   };
 }
@@ -29,6 +29,7 @@ class ICoreObserver;
 struct Block;
 struct BlockVerificationContext;
 struct BlockFullInfo;
+struct BlockScanInfo;
 struct BlockShortInfo;
 struct CoreStateInfo;
 struct ICryptonoteProtocol;
@@ -46,6 +47,7 @@ public:
   virtual bool removeObserver(ICoreObserver* observer) = 0;
 
   virtual bool have_block(const crypto::Hash& id) = 0;
+  virtual bool haveTransaction(const crypto::Hash& id) = 0;
   virtual std::vector<crypto::Hash> buildSparseChain() = 0;
   virtual std::vector<crypto::Hash> buildSparseChain(const crypto::Hash& startBlockId) = 0;
   virtual bool get_stat_info(cryptonote::CoreStateInfo& st_inf) = 0;
@@ -76,6 +78,11 @@ public:
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockFullInfo>& entries) = 0;
   virtual bool queryBlocksLite(const std::vector<crypto::Hash>& block_ids, uint64_t timestamp,
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<BlockShortInfo>& entries) = 0;
+  // Entries are serialized BlockScanInfo
+  virtual bool queryBlocksScan(const std::vector<crypto::Hash>& block_ids, uint64_t timestamp,
+    uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<std::string>& entries) = 0;
+  // Scan data of the main chain block at the height, false when there is no such block
+  virtual bool getBlockScanInfo(uint32_t height, BlockScanInfo& block) = 0;
 
   virtual crypto::Hash getBlockIdByHeight(uint32_t height) = 0;
   virtual bool getBlockByHash(const crypto::Hash &h, Block &blk) = 0;
@@ -88,6 +95,7 @@ public:
                               uint64_t& reward, int64_t& emissionChange) = 0;
   virtual bool scanOutputkeysForIndices(const KeyInput& txInToKey, std::list<std::pair<crypto::Hash, size_t>>& outputReferences) = 0;
   virtual bool getBlockDifficulty(uint32_t height, difficulty_type& difficulty) = 0;
+  virtual difficulty_type getNextBlockDifficulty() = 0;
   virtual bool getBlockContainingTx(const crypto::Hash& txId, crypto::Hash& blockId, uint32_t& blockHeight) = 0;
   virtual bool getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<crypto::Hash, size_t>& outputReference) = 0;
 
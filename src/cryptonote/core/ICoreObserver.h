@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <cstdint>
+
+#include <crypto.h>
+
 namespace cryptonote {
 
 class ICoreObserver {
@@ -11,6 +15,11 @@ public:
   virtual ~ICoreObserver() {};
   virtual void blockchainUpdated() {};
   virtual void poolUpdated() {};
+  // Called with the blockchain locked for every main chain block added or removed, including the ones of a chain switch
+  virtual void blockPushed(uint32_t height, const crypto::Hash& blockHash) {};
+  virtual void blockPopped(uint32_t height, const crypto::Hash& blockHash) {};
+  // The block template version changed
+  virtual void blockTemplateUpdated() {};
 };
 
 }
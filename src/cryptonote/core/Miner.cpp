@@ -5,6 +5,7 @@
 #include "Miner.h"
 
 #include <future>
+#include <map>
 #include <numeric>
 #include <sstream>
 #include <thread>
@@ -17,6 +18,7 @@
 #include <boost/utility/value_init.hpp>
 
 #include "crypto/crypto.h"
+#include "crypto/hash.h"
 #include "command_line/options.h"
 #include "common/StringTools.h"
 #include "serialization/SerializationTools.h"
@@ -30,25 +32,53 @@ using namespace Logging;
 namespace cryptonote
 {
 
+  const uint32_t miner::HASHRATE_WINDOWS[miner::HASHRATE_WINDOW_COUNT] = { 10, 60, 15 * 60 };
+
+  uint64_t millisecondsSinceEpoch() {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+  }
+
+  //-----------------------------------------------------------------------------------------------------
   miner::miner(const Currency& currency, IMinerHandler& handler, Logging::ILogger& log) :
     m_currency(currency),
     logger(log, "miner"),
     m_stop(true),
     m_template(boost::value_initialized<Block>()),
+    m_template_time(0),
     m_template_no(0),
     m_diffic(0),
     m_handler(handler),
     m_pausers_count(0),
     m_threads_total(0),
     m_starter_nonce(0),
-    m_last_hr_merge_time(0),
-    m_hashes(0),
+    m_blocks_found(0),
+    m_stale_templates(0),
+    m_template_refreshes(0),
+    m_template_refresh_last_us(0),
+    m_template_refresh_total_us(0),
+    m_submits(0),
+    m_template_to_submit_last_ms(0),
+    m_template_to_submit_total_ms(0),
     m_do_print_hashrate(false),
     m_do_mining(false),
     m_current_hash_rate(0),
     m_update_block_template_interval(5),
     m_update_merge_hr_interval(2)
   {
+    for (thread_counters& counters : m_thread_counters) {
+      counters.hashes = 0;
+      for (auto& hashrate : counters.hashrates) {
+        hashrate = 0;
+      }
+
+      counters.cpu = -1;
+      counters.node = 0;
+    }
+
+    for (auto& hashrate : m_hashrates) {
+      hashrate = 0;
+    }
   }
   //-----------------------------------------------------------------------------------------------------
   miner::~miner() {
@@ -59,6 +89,7 @@ namespace cryptonote
     std::lock_guard<decltype(m_template_lock)> lk(m_template_lock);
 
     m_template = bl;
+    m_template_time = millisecondsSinceEpoch();
     m_diffic = di;
     ++m_template_no;
     m_starter_nonce = crypto::rand<uint32_t>();
@@ -83,11 +114,17 @@ namespace cryptonote
       extra_nonce = m_extra_messages[m_config.current_extra_message_index];
     }
 
+    auto refresh_start = std::chrono::steady_clock::now();
     if(!m_handler.get_block_template(bl, m_mine_address, di, height, extra_nonce)) {
       logger(ERROR) << "Failed to get_block_template(), stopping mining";
       return false;
     }
 
+    uint64_t refresh_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - refresh_start).count();
+    m_template_refresh_last_us = refresh_us;
+    m_template_refresh_total_us += refresh_us;
+    ++m_template_refreshes;
+
     set_block_template(bl, di);
     return true;
   }
@@ -113,16 +150,96 @@ namespace cryptonote
     m_do_print_hashrate = do_hr;
   }
 
-  uint64_t millisecondsSinceEpoch() {
-    auto now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-  }
+  //-----------------------------------------------------------------------------------------------------
+  miner::mining_stats miner::get_stats() const
+  {
+    mining_stats stats;
+    stats.mining = !m_stop;
+    stats.hashes = 0;
+    for (const thread_counters& counters : m_thread_counters) {
+      stats.hashes += counters.hashes.load(std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i != HASHRATE_WINDOW_COUNT; ++i) {
+      stats.hashrates[i] = m_hashrates[i].load(std::memory_order_relaxed);
+    }
+
+    size_t threads = std::min<size_t>(m_threads_total, MAX_THREADS);
+    for (size_t i = 0; i != threads; ++i) {
+      const thread_counters& counters = m_thread_counters[i];
+      thread_stats thread;
+      thread.hashes = counters.hashes.load(std::memory_order_relaxed);
+      for (size_t j = 0; j != HASHRATE_WINDOW_COUNT; ++j) {
+        thread.hashrates[j] = counters.hashrates[j].load(std::memory_order_relaxed);
+      }
+
+      thread.cpu = counters.cpu.load(std::memory_order_relaxed);
+      thread.node = counters.node.load(std::memory_order_relaxed);
+      stats.threads.push_back(thread);
+    }
+
+    stats.blocks_found = m_blocks_found;
+    stats.stale_templates = m_stale_templates;
+    stats.template_updates = m_template_no;
+
+    uint64_t refreshes = m_template_refreshes;
+    stats.template_refresh_last_us = m_template_refresh_last_us;
+    stats.template_refresh_avg_us = refreshes != 0 ? m_template_refresh_total_us / refreshes : 0;
 
+    uint64_t submits = m_submits;
+    stats.template_to_submit_last_ms = m_template_to_submit_last_ms;
+    stats.template_to_submit_avg_ms = submits != 0 ? m_template_to_submit_total_ms / submits : 0;
+    return stats;
+  }
   //-----------------------------------------------------------------------------------------------------
   void miner::merge_hr()
   {
-    if(m_last_hr_merge_time && is_mining()) {
-      m_current_hash_rate = m_hashes * 1000 / (millisecondsSinceEpoch() - m_last_hr_merge_time + 1);
+    hashes_sample sample;
+    sample.time = millisecondsSinceEpoch();
+    size_t threads = std::min<size_t>(m_threads_total, MAX_THREADS);
+    for (size_t i = 0; i != threads; ++i) {
+      sample.hashes.push_back(m_thread_counters[i].hashes.load(std::memory_order_relaxed));
+    }
+
+    if (!m_hashes_samples.empty() && m_hashes_samples.back().hashes.size() != threads) {
+      // the thread count changed, the windows start again
+      m_hashes_samples.clear();
+    }
+
+    // one sample at most as old as the longest window is kept
+    while (m_hashes_samples.size() > 1 &&
+      sample.time - m_hashes_samples[1].time >= HASHRATE_WINDOWS[HASHRATE_WINDOW_COUNT - 1] * static_cast<uint64_t>(1000)) {
+      m_hashes_samples.pop_front();
+    }
+
+    for (size_t window = 0; window != HASHRATE_WINDOW_COUNT; ++window) {
+      // the oldest sample of the window, the whole history while the miner runs shorter than the window
+      auto start = std::find_if(m_hashes_samples.begin(), m_hashes_samples.end(), [&](const hashes_sample& start_sample) {
+        return sample.time - start_sample.time <= HASHRATE_WINDOWS[window] * static_cast<uint64_t>(1000);
+      });
+
+      uint64_t total_hashrate = 0;
+      for (size_t i = 0; i != threads; ++i) {
+        uint64_t hashrate = 0;
+        if (start != m_hashes_samples.end()) {
+          hashrate = (sample.hashes[i] - start->hashes[i]) * 1000 / (sample.time - start->time + 1);
+        }
+
+        m_thread_counters[i].hashrates[window].store(hashrate, std::memory_order_relaxed);
+        total_hashrate += hashrate;
+      }
+
+      m_hashrates[window].store(total_hashrate, std::memory_order_relaxed);
+    }
+
+    if(!m_hashes_samples.empty() && is_mining()) {
+      const hashes_sample& last_sample = m_hashes_samples.back();
+      uint64_t hashes = 0;
+      for (size_t i = 0; i != threads; ++i) {
+        hashes += sample.hashes[i] - last_sample.hashes[i];
+      }
+
+      m_current_hash_rate = hashes * 1000 / (sample.time - last_sample.time + 1);
       std::lock_guard<std::mutex> lk(m_last_hash_rates_lock);
       m_last_hash_rates.push_back(m_current_hash_rate);
       if(m_last_hash_rates.size() > 19)
@@ -132,11 +249,36 @@ namespace cryptonote
         uint64_t total_hr = std::accumulate(m_last_hash_rates.begin(), m_last_hash_rates.end(), static_cast<uint64_t>(0));
         float hr = static_cast<float>(total_hr)/static_cast<float>(m_last_hash_rates.size());
         std::cout << "hashrate: " << std::setprecision(4) << std::fixed << hr << ENDL;
+        print_thread_hashrates();
       }
     }
-    
-    m_last_hr_merge_time = millisecondsSinceEpoch();
-    m_hashes = 0;
+
+    m_hashes_samples.push_back(std::move(sample));
+  }
+  //-----------------------------------------------------------------------------------------------------
+  void miner::print_thread_hashrates()
+  {
+    mining_stats stats = get_stats();
+    std::map<uint32_t, uint64_t> node_hash_rates;
+    for (size_t i = 0; i != stats.threads.size(); ++i) {
+      const thread_stats& thread = stats.threads[i];
+      std::cout << "  thread " << i;
+      if (thread.cpu >= 0) {
+        std::cout << " (cpu " << thread.cpu << ", node " << thread.node << ")";
+        node_hash_rates[thread.node] += thread.hashrates[0];
+      }
+
+      std::cout << ": " << thread.hashrates[0] << ENDL;
+    }
+
+    if (node_hash_rates.size() > 1) {
+      for (const auto& node : node_hash_rates) {
+        std::cout << "  node " << node.first << ": " << node.second << ENDL;
+      }
+    }
+
+    std::cout << "  hashrate " << HASHRATE_WINDOWS[1] << " s: " << stats.hashrates[1] << ", " << HASHRATE_WINDOWS[2] / 60 << " min: " <<
+      stats.hashrates[2] << ENDL;
   }
 
   bool miner::init(const MinerConfig& config) {
@@ -176,10 +318,25 @@ namespace cryptonote
       m_threads_total = 1;
       m_do_mining = true;
       if(config.miningThreads > 0) {
+        if (config.miningThreads > MAX_THREADS) {
+          logger(ERROR) << "Mining threads " << config.miningThreads << " exceed the maximum of " << MAX_THREADS << ", starting daemon canceled";
+          return false;
+        }
+
         m_threads_total = config.miningThreads;
       }
     }
 
+    if (!config.miningCpuAffinity.empty()) {
+      std::vector<Common::CpuInfo> cpus;
+      if (!Common::parseCpuAffinity(config.miningCpuAffinity, 1, cpus)) {
+        logger(ERROR) << "Mining cpu affinity " << config.miningCpuAffinity << " has wrong format or names unavailable processors";
+        return false;
+      }
+
+      m_cpu_affinity = config.miningCpuAffinity;
+    }
+
     return true;
   }
   //-----------------------------------------------------------------------------------------------------
@@ -202,10 +359,21 @@ namespace cryptonote
       return false;
     }
 
+    if (threads_count > MAX_THREADS) {
+      logger(ERROR) << "Unable to start miner with more than " << MAX_THREADS << " threads";
+      return false;
+    }
+
     m_mine_address = adr;
     m_threads_total = static_cast<uint32_t>(threads_count);
     m_starter_nonce = crypto::rand<uint32_t>();
 
+    m_thread_cpus.clear();
+    if (!m_cpu_affinity.empty() && !Common::parseCpuAffinity(m_cpu_affinity, threads_count, m_thread_cpus)) {
+      logger(WARNING) << "Processors of mining cpu affinity " << m_cpu_affinity << " are not available, threads are not bound";
+      m_thread_cpus.clear();
+    }
+
     if (!m_template_no) {
       request_block_template(); //lets update block template
     }
@@ -337,10 +505,27 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------------
   bool miner::worker_thread(uint32_t th_local_index)
   {
-    logger(INFO) << "Miner thread was started ["<< th_local_index << "]";
+    thread_counters& counters = m_thread_counters[th_local_index];
+    counters.cpu = -1;
+    if (th_local_index < m_thread_cpus.size()) {
+      const Common::CpuInfo& cpu = m_thread_cpus[th_local_index];
+      if (Common::setThreadAffinity(cpu.cpu)) {
+        counters.cpu = static_cast<int32_t>(cpu.cpu);
+        counters.node = cpu.node;
+        logger(INFO) << "Miner thread [" << th_local_index << "] is bound to cpu " << cpu.cpu << ", NUMA node " << cpu.node;
+      } else {
+        logger(WARNING) << "Failed to bind miner thread [" << th_local_index << "] to cpu " << cpu.cpu;
+      }
+    }
+
+    // The scratchpad is allocated after binding, its pages are placed on the NUMA node of the thread touching them first
+    crypto::slow_hash_allocate_state();
+    logger(INFO) << "Miner thread was started ["<< th_local_index << "], scratchpad " <<
+      (crypto::slow_hash_huge_pages() ? "on a huge page" : "on regular pages");
     uint32_t nonce = m_starter_nonce + th_local_index;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
+    uint64_t local_template_time = 0;
     Block b;
 
     while(!m_stop)
@@ -355,6 +540,7 @@ namespace cryptonote
         std::unique_lock<std::mutex> lk(m_template_lock);
         b = m_template;
         local_diff = m_diffic;
+        local_template_time = m_template_time;
         lk.unlock();
 
         local_template_ver = m_template_no;
@@ -382,17 +568,30 @@ namespace cryptonote
 
         logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
 
+        uint64_t template_to_submit_ms = millisecondsSinceEpoch() - local_template_time;
+        m_template_to_submit_last_ms = template_to_submit_ms;
+        m_template_to_submit_total_ms += template_to_submit_ms;
+        ++m_submits;
+
         if(!m_handler.handle_block_found(b)) {
           --m_config.current_extra_message_index;
+
+          std::lock_guard<std::mutex> lk(m_template_lock);
+          if (b.previousBlockHash != m_template.previousBlockHash) {
+            ++m_stale_templates;
+          }
         } else {
+          ++m_blocks_found;
           //success update, lets update config
           Common::saveStringToFile(m_config_folder_path + "/" + cryptonote::parameters::MINER_CONFIG_FILE_NAME, storeToJson(m_config));
         }
       }
 
       nonce += m_threads_total;
-      ++m_hashes;
+      counters.hashes.fetch_add(1, std::memory_order_relaxed);
     }
+
+    crypto::slow_hash_free_state();
     logger(INFO) << "Miner thread stopped ["<< th_local_index << "]";
     return true;
   }
@@ -5,10 +5,13 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <list>
 #include <mutex>
 #include <thread>
+#include <vector>
 
+#include "common/CpuAffinity.h"
 #include "cryptonote/core/key.h"
 #include "cryptonote/core/Currency.h"
 #include "cryptonote/core/Difficulty.h"
@@ -23,6 +26,32 @@
 namespace cryptonote {
   class miner {
   public:
+    static const size_t MAX_THREADS = 256;
+    static const size_t HASHRATE_WINDOW_COUNT = 3;
+    static const uint32_t HASHRATE_WINDOWS[HASHRATE_WINDOW_COUNT]; // seconds
+
+    struct thread_stats {
+      uint64_t hashes;
+      uint64_t hashrates[HASHRATE_WINDOW_COUNT];
+      int32_t cpu; // -1 unless the thread is bound to a processor
+      uint32_t node;
+    };
+
+    // Hashrates are averaged over HASHRATE_WINDOWS and updated every 2 seconds
+    struct mining_stats {
+      bool mining;
+      uint64_t hashes;
+      uint64_t hashrates[HASHRATE_WINDOW_COUNT];
+      std::vector<thread_stats> threads;
+      uint64_t blocks_found;
+      uint64_t stale_templates; // found blocks rejected because a new block outdated their template
+      uint64_t template_updates;
+      uint64_t template_refresh_last_us;
+      uint64_t template_refresh_avg_us;
+      uint64_t template_to_submit_last_ms;
+      uint64_t template_to_submit_avg_ms;
+    };
+
     miner(const Currency& currency, IMinerHandler& handler, Logging::ILogger& log);
     ~miner();
 
@@ -41,11 +70,13 @@ namespace cryptonote {
     void pause();
     void resume();
     void do_print_hashrate(bool do_hr);
+    mining_stats get_stats() const; // does not lock, may be called from any thread
 
   private:
     bool worker_thread(uint32_t th_local_index);
     bool request_block_template();
     void  merge_hr();
+    void print_thread_hashrates();
 
     struct miner_config
     {
@@ -61,6 +92,7 @@ namespace cryptonote {
     std::atomic<bool> m_stop;
     std::mutex m_template_lock;
     Block m_template;
+    uint64_t m_template_time;
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
     difficulty_type m_diffic;
@@ -79,8 +111,36 @@ namespace cryptonote {
     std::vector<BinaryArray> m_extra_messages;
     miner_config m_config;
     std::string m_config_folder_path;
-    std::atomic<uint64_t> m_last_hr_merge_time;
-    std::atomic<uint64_t> m_hashes;
+
+    // Every thread counts its hashes in its own cache line, a shared counter would bounce between the processors.
+    // The slots live as long as the miner, so get_stats reads them without locking out start and stop
+    struct thread_counters {
+      std::atomic<uint64_t> hashes; // the only member written while the thread hashes
+      std::atomic<uint64_t> hashrates[HASHRATE_WINDOW_COUNT];
+      std::atomic<int32_t> cpu;
+      std::atomic<uint32_t> node;
+      char padding[64 - (HASHRATE_WINDOW_COUNT + 2) * sizeof(uint64_t)];
+    };
+
+    struct hashes_sample {
+      uint64_t time;
+      std::vector<uint64_t> hashes;
+    };
+
+    thread_counters m_thread_counters[MAX_THREADS];
+    std::deque<hashes_sample> m_hashes_samples; // used by merge_hr only
+    std::atomic<uint64_t> m_hashrates[HASHRATE_WINDOW_COUNT];
+    std::atomic<uint64_t> m_blocks_found;
+    std::atomic<uint64_t> m_stale_templates;
+    std::atomic<uint64_t> m_template_refreshes;
+    std::atomic<uint64_t> m_template_refresh_last_us;
+    std::atomic<uint64_t> m_template_refresh_total_us;
+    std::atomic<uint64_t> m_submits;
+    std::atomic<uint64_t> m_template_to_submit_last_ms;
+    std::atomic<uint64_t> m_template_to_submit_total_ms;
+
+    std::string m_cpu_affinity;
+    std::vector<Common::CpuInfo> m_thread_cpus;
     std::atomic<uint64_t> m_current_hash_rate;
     std::mutex m_last_hash_rates_lock;
     std::list<uint64_t> m_last_hash_rates;
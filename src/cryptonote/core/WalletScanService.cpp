@@ -0,0 +1,444 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "WalletScanService.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/filesystem.hpp>
+
+#include "cryptonote/core/TransactionExtra.h"
+#include "serialization/BinarySerializationTools.h"
+#include "serialization/SerializationOverloads.h"
+
+using namespace Logging;
+
+namespace cryptonote {
+
+namespace {
+
+// a state of version 1 has no registration tokens and is not loaded, its wallets register again
+const uint8_t WALLET_SCAN_SERVICE_STATE_VERSION = 2;
+
+// how long the worker waits before retrying a block it failed to load
+const std::chrono::milliseconds LOAD_RETRY_INTERVAL(100);
+
+// constant time, so the time of a failed comparison tells nothing about the secret
+template <typename T>
+bool sameSecret(const T& a, const T& b) {
+  const volatile uint8_t* left = reinterpret_cast<const volatile uint8_t*>(&a);
+  const volatile uint8_t* right = reinterpret_cast<const volatile uint8_t*>(&b);
+  uint8_t difference = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    difference |= left[i] ^ right[i];
+  }
+
+  return difference == 0;
+}
+
+}
+
+WalletScanService::WalletScanService(ICore& core, Logging::ILogger& logger, const std::string& fileName, size_t maxPendingEvents,
+  size_t maxRegistrations, uint32_t maxRescanDepth) :
+  m_core(core), logger(logger, "WalletScanService"), m_fileName(fileName), m_maxPendingEvents(maxPendingEvents),
+  m_maxRegistrations(maxRegistrations), m_maxRescanDepth(maxRescanDepth), m_nextRegistrationId(1),
+  m_chainHeight(0), m_chainVersion(0), m_stopped(true) {
+}
+
+WalletScanService::~WalletScanService() {
+  deinit();
+}
+
+bool WalletScanService::init() {
+  if (boost::filesystem::exists(m_fileName) && !loadFromBinaryFile(*this, m_fileName)) {
+    logger(WARNING) << "Failed to load wallet scan service state from " << m_fileName << ", starting without registrations";
+    m_registrations.clear();
+    m_nextRegistrationId = 1;
+  }
+
+  // subscribed first, so no block is missed between reading the top and the worker start
+  m_core.addObserver(this);
+
+  uint32_t topHeight;
+  crypto::Hash topId;
+  m_core.get_blockchain_top(topHeight, topId);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chainHeight = topHeight + 1;
+    for (auto& registration : m_registrations) {
+      if (registration.second.scannedHeight > m_chainHeight) {
+        detach(registration.second, m_chainHeight);
+      }
+    }
+
+    m_stopped = false;
+  }
+
+  m_worker = std::thread(&WalletScanService::workerProc, this);
+
+  logger(INFO) << "Wallet scan service started with " << m_registrations.size() << " registrations";
+  logger(WARNING) << "View keys of registered wallets are stored unencrypted in " << m_fileName;
+  return true;
+}
+
+void WalletScanService::deinit() {
+  if (!m_worker.joinable()) {
+    return;
+  }
+
+  m_core.removeObserver(this);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+
+  m_updated.notify_all();
+  m_worker.join();
+
+  if (!storeToBinaryFile(*this, m_fileName)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to store wallet scan service state to " << m_fileName;
+    return;
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::permissions(m_fileName, boost::filesystem::owner_read | boost::filesystem::owner_write, ec);
+  if (ec) {
+    logger(WARNING) << "Failed to restrict access to " << m_fileName << ": " << ec.message();
+  }
+}
+
+bool WalletScanService::addRegistration(const crypto::SecretKey& viewSecretKey, const std::vector<crypto::PublicKey>& spendPublicKeys,
+  uint32_t startHeight, uint64_t& id, crypto::Hash& token) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto& registration : m_registrations) {
+    if (sameSecret(registration.second.keys->viewSecretKey, viewSecretKey)) {
+      std::shared_ptr<ScanKeys> keys = std::make_shared<ScanKeys>(*registration.second.keys);
+      keys->spendPublicKeys.insert(spendPublicKeys.begin(), spendPublicKeys.end());
+      registration.second.keys = std::move(keys);
+      id = registration.first;
+      token = registration.second.token;
+      return true;
+    }
+  }
+
+  if (m_registrations.size() >= m_maxRegistrations) {
+    logger(DEBUGGING) << "Registration rejected, " << m_registrations.size() << " wallets are registered already";
+    return false;
+  }
+
+  if (m_chainHeight > m_maxRescanDepth && startHeight < m_chainHeight - m_maxRescanDepth) {
+    logger(DEBUGGING) << "Registration rejected, start height " << startHeight << " is too far below the top " << m_chainHeight;
+    return false;
+  }
+
+  std::shared_ptr<ScanKeys> keys = std::make_shared<ScanKeys>();
+  keys->viewSecretKey = viewSecretKey;
+  keys->spendPublicKeys.insert(spendPublicKeys.begin(), spendPublicKeys.end());
+
+  id = m_nextRegistrationId++;
+  Registration& registration = m_registrations[id];
+  registration.token = crypto::rand<crypto::Hash>();
+  registration.keys = std::move(keys);
+  registration.scannedHeight = std::min(startHeight, m_chainHeight);
+  registration.nextSequence = 0;
+
+  token = registration.token;
+  m_updated.notify_all();
+  return true;
+}
+
+bool WalletScanService::removeRegistration(uint64_t id, const crypto::Hash& token) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (findRegistration(id, token) == nullptr) {
+    return false;
+  }
+
+  m_registrations.erase(id);
+  return true;
+}
+
+bool WalletScanService::addKeyImages(uint64_t id, const crypto::Hash& token, const std::vector<crypto::KeyImage>& keyImages) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Registration* registration = findRegistration(id, token);
+  if (registration == nullptr) {
+    return false;
+  }
+
+  std::shared_ptr<ScanKeys> keys = std::make_shared<ScanKeys>(*registration->keys);
+  keys->keyImages.insert(keyImages.begin(), keyImages.end());
+  registration->keys = std::move(keys);
+  return true;
+}
+
+bool WalletScanService::getEvents(uint64_t id, const crypto::Hash& token, uint64_t firstSequence, size_t maxCount,
+  std::vector<WalletScanEvent>& events, uint32_t& scannedHeight) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Registration* registration = findRegistration(id, token);
+  if (registration == nullptr) {
+    return false;
+  }
+
+  bool paused = isScanPaused(*registration);
+  while (!registration->events.empty() && registration->events.front().sequence < firstSequence) {
+    registration->events.pop_front();
+  }
+
+  size_t count = std::min(maxCount, registration->events.size());
+  events.assign(registration->events.begin(), registration->events.begin() + count);
+  scannedHeight = registration->scannedHeight;
+  if (paused && !isScanPaused(*registration)) {
+    lock.unlock();
+    m_updated.notify_all();
+  }
+
+  return true;
+}
+
+void WalletScanService::blockPushed(uint32_t height, const crypto::Hash& blockHash) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chainHeight = height + 1;
+  }
+
+  m_updated.notify_all();
+}
+
+void WalletScanService::blockPopped(uint32_t height, const crypto::Hash& blockHash) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_chainHeight = height;
+  ++m_chainVersion;
+  for (auto& registration : m_registrations) {
+    if (registration.second.scannedHeight > height) {
+      detach(registration.second, height);
+    }
+  }
+}
+
+// Precondition: m_mutex is locked.
+WalletScanService::Registration* WalletScanService::findRegistration(uint64_t id, const crypto::Hash& token) {
+  auto it = m_registrations.find(id);
+  if (it == m_registrations.end() || !sameSecret(it->second.token, token)) {
+    return nullptr;
+  }
+
+  return &it->second;
+}
+
+// Precondition: m_mutex is locked.
+bool WalletScanService::isScanPaused(const Registration& registration) const {
+  return registration.events.size() >= m_maxPendingEvents;
+}
+
+void WalletScanService::workerProc() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopped) {
+    // lagging registrations are scanned first and join the others once they reach the same height
+    uint32_t height = m_chainHeight;
+    for (const auto& registration : m_registrations) {
+      if (!isScanPaused(registration.second)) {
+        height = std::min(height, registration.second.scannedHeight);
+      }
+    }
+
+    if (height >= m_chainHeight) {
+      m_updated.wait(lock);
+      continue;
+    }
+
+    std::vector<uint64_t> ids;
+    std::vector<std::shared_ptr<const ScanKeys>> keys;
+    for (const auto& registration : m_registrations) {
+      if (registration.second.scannedHeight == height && !isScanPaused(registration.second)) {
+        ids.push_back(registration.first);
+        keys.push_back(registration.second.keys);
+      }
+    }
+
+    uint64_t chainVersion = m_chainVersion;
+    lock.unlock();
+
+    BlockScanInfo block;
+    bool loaded = m_core.getBlockScanInfo(height, block);
+    std::vector<std::vector<WalletScanEvent>> events(keys.size());
+    if (loaded) {
+      scanBlock(block, height, keys, events);
+    }
+
+    lock.lock();
+    if (chainVersion != m_chainVersion) {
+      continue;
+    }
+
+    if (!loaded) {
+      // the block may be removed with the notification still on its way
+      logger(DEBUGGING) << "Failed to load block " << height << " for scanning, retrying";
+      m_updated.wait_for(lock, LOAD_RETRY_INTERVAL);
+      continue;
+    }
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+      auto it = m_registrations.find(ids[i]);
+      // registrations changed meanwhile scan the block again with their new keys
+      if (it == m_registrations.end() || it->second.scannedHeight != height || it->second.keys != keys[i]) {
+        continue;
+      }
+
+      for (auto& event : events[i]) {
+        addEvent(it->second, std::move(event));
+      }
+
+      it->second.scannedHeight = height + 1;
+    }
+  }
+}
+
+void WalletScanService::scanBlock(const BlockScanInfo& block, uint32_t height, const std::vector<std::shared_ptr<const ScanKeys>>& keys,
+  std::vector<std::vector<WalletScanEvent>>& events) const {
+  std::vector<crypto::SecretKey> viewSecretKeys;
+  viewSecretKeys.reserve(keys.size());
+  for (const auto& registrationKeys : keys) {
+    viewSecretKeys.push_back(registrationKeys->viewSecretKey);
+  }
+
+  std::vector<crypto::KeyDerivation> derivations(keys.size());
+  std::vector<crypto::PublicKey> spendKeys(keys.size());
+  std::vector<std::vector<uint32_t>> outputs(keys.size());
+  std::vector<std::vector<uint32_t>> inputs(keys.size());
+
+  auto checkKey = [&](const crypto::PublicKey& key, size_t keyIndex, size_t outputIndex) {
+    if (!crypto::underive_public_keys(derivations.data(), derivations.size(), keyIndex, key, spendKeys.data())) {
+      return;
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i]->spendPublicKeys.count(spendKeys[i]) != 0 &&
+        (outputs[i].empty() || outputs[i].back() != static_cast<uint32_t>(outputIndex))) {
+        outputs[i].push_back(static_cast<uint32_t>(outputIndex));
+      }
+    }
+  };
+
+  for (const auto& transaction : block.transactions) {
+    const TransactionPrefix& prefix = transaction.txPrefix;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+      outputs[i].clear();
+      inputs[i].clear();
+    }
+
+    for (size_t inputIndex = 0; inputIndex < prefix.inputs.size(); ++inputIndex) {
+      if (prefix.inputs[inputIndex].type() != typeid(KeyInput)) {
+        continue;
+      }
+
+      const crypto::KeyImage& keyImage = boost::get<KeyInput>(prefix.inputs[inputIndex]).keyImage;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i]->keyImages.count(keyImage) != 0) {
+          inputs[i].push_back(static_cast<uint32_t>(inputIndex));
+        }
+      }
+    }
+
+    // the transaction key is decoded once for all view keys, each output key once for all derivations
+    crypto::PublicKey transactionPublicKey = getTransactionPublicKeyFromExtra(prefix.extra);
+    if (crypto::generate_key_derivations(transactionPublicKey, viewSecretKeys.data(), viewSecretKeys.size(), derivations.data())) {
+      // key indexes follow TransfersConsumer
+      size_t keyIndex = 0;
+      for (size_t outputIndex = 0; outputIndex < prefix.outputs.size(); ++outputIndex) {
+        const TransactionOutputTarget& target = prefix.outputs[outputIndex].target;
+        if (target.type() == typeid(KeyOutput)) {
+          checkKey(boost::get<KeyOutput>(target).key, keyIndex, outputIndex);
+          ++keyIndex;
+        } else if (target.type() == typeid(MultisignatureOutput)) {
+          for (const auto& key : boost::get<MultisignatureOutput>(target).keys) {
+            checkKey(key, outputIndex, outputIndex);
+            ++keyIndex;
+          }
+        }
+      }
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (outputs[i].empty() && inputs[i].empty()) {
+        continue;
+      }
+
+      WalletScanEvent event;
+      event.sequence = 0;
+      event.detach = false;
+      event.height = height;
+      event.blockId = block.blockId;
+      event.timestamp = block.header.timestamp;
+      event.transaction = transaction;
+      event.outputs = std::move(outputs[i]);
+      event.inputs = std::move(inputs[i]);
+      events[i].push_back(std::move(event));
+    }
+  }
+}
+
+// Precondition: m_mutex is locked.
+void WalletScanService::detach(Registration& registration, uint32_t height) {
+  registration.scannedHeight = height;
+
+  // a chain switch removes blocks one by one, the wallet needs only the lowest height
+  if (!registration.events.empty() && registration.events.back().detach) {
+    registration.events.back().height = std::min(registration.events.back().height, height);
+    return;
+  }
+
+  WalletScanEvent event;
+  event.detach = true;
+  event.height = height;
+  event.blockId = NULL_HASH;
+  event.timestamp = 0;
+  event.transaction.txHash = NULL_HASH;
+  addEvent(registration, std::move(event));
+}
+
+// Precondition: m_mutex is locked.
+void WalletScanService::addEvent(Registration& registration, WalletScanEvent&& event) {
+  event.sequence = registration.nextSequence++;
+  registration.events.push_back(std::move(event));
+}
+
+void WalletScanService::Registration::serialize(ISerializer& s) {
+  KV_MEMBER(token);
+
+  ScanKeys loadedKeys;
+  ScanKeys& scanKeys = s.type() == ISerializer::INPUT ? loadedKeys : const_cast<ScanKeys&>(*keys);
+  s(scanKeys.viewSecretKey, "viewSecretKey");
+  s(scanKeys.spendPublicKeys, "spendPublicKeys");
+  s(scanKeys.keyImages, "keyImages");
+  if (s.type() == ISerializer::INPUT) {
+    keys = std::make_shared<ScanKeys>(std::move(loadedKeys));
+  }
+
+  KV_MEMBER(scannedHeight);
+  KV_MEMBER(nextSequence);
+
+  std::vector<WalletScanEvent> pendingEvents(events.begin(), events.end());
+  s(pendingEvents, "events");
+  if (s.type() == ISerializer::INPUT) {
+    events.assign(pendingEvents.begin(), pendingEvents.end());
+  }
+}
+
+void WalletScanService::serialize(ISerializer& s) {
+  uint8_t version = WALLET_SCAN_SERVICE_STATE_VERSION;
+  s(version, "version");
+  if (version != WALLET_SCAN_SERVICE_STATE_VERSION) {
+    throw std::runtime_error("Unsupported wallet scan service state version");
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  KV_MEMBER(m_nextRegistrationId);
+  s(m_registrations, "registrations");
+}
+
+}
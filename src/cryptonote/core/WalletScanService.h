@@ -0,0 +1,106 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "CryptoNoteConfig.h"
+#include "cryptonote/core/ICore.h"
+#include "cryptonote/core/ICoreObserver.h"
+#include "cryptonote/protocol/definitions.h"
+#include "logging/LoggerRef.h"
+
+namespace cryptonote {
+
+// Scans main chain blocks with the view keys of wallets running next to the daemon, so they get only their own
+// transactions instead of downloading every block. A block is loaded and scanned once for all registrations that
+// reached it. Found transactions and detaches are kept as events until the wallet acknowledges them, a registration
+// with too many pending events is not scanned further until they are acknowledged.
+// Every call on a registration needs its random access token, ids alone are guessable.
+// Registrations and pending events are stored in a file on deinit. The file holds the view secret keys unencrypted,
+// it is made readable by its owner only.
+class WalletScanService : public ICoreObserver {
+public:
+  WalletScanService(ICore& core, Logging::ILogger& logger, const std::string& fileName,
+    size_t maxPendingEvents = parameters::CRYPTONOTE_WALLET_SCAN_MAX_PENDING_EVENTS,
+    size_t maxRegistrations = parameters::CRYPTONOTE_WALLET_SCAN_MAX_REGISTRATIONS,
+    uint32_t maxRescanDepth = parameters::CRYPTONOTE_WALLET_SCAN_MAX_RESCAN_DEPTH);
+  virtual ~WalletScanService();
+
+  bool init();
+  void deinit();
+
+  // Registering a view key again adds the spend keys to the existing registration and keeps its progress.
+  // Assigns the id of the registration and its access token. Fails when the registrations limit is reached
+  // or startHeight is more than maxRescanDepth blocks below the top.
+  bool addRegistration(const crypto::SecretKey& viewSecretKey, const std::vector<crypto::PublicKey>& spendPublicKeys, uint32_t startHeight,
+    uint64_t& id, crypto::Hash& token);
+  // Calls on a registration return false if the registration does not exist or the token does not match
+  bool removeRegistration(uint64_t id, const crypto::Hash& token);
+  // Transactions spending these key images are reported as well
+  bool addKeyImages(uint64_t id, const crypto::Hash& token, const std::vector<crypto::KeyImage>& keyImages);
+  // Events before firstSequence are acknowledged and dropped, up to maxCount following ones are returned.
+  // scannedHeight is the number of blocks the registration is scanned for.
+  bool getEvents(uint64_t id, const crypto::Hash& token, uint64_t firstSequence, size_t maxCount, std::vector<WalletScanEvent>& events,
+    uint32_t& scannedHeight);
+
+  void serialize(ISerializer& s);
+
+  // ICoreObserver
+  virtual void blockPushed(uint32_t height, const crypto::Hash& blockHash) override;
+  virtual void blockPopped(uint32_t height, const crypto::Hash& blockHash) override;
+
+private:
+  struct ScanKeys {
+    crypto::SecretKey viewSecretKey;
+    std::unordered_set<crypto::PublicKey> spendPublicKeys;
+    std::unordered_set<crypto::KeyImage> keyImages;
+  };
+
+  struct Registration {
+    crypto::Hash token;
+    std::shared_ptr<const ScanKeys> keys; // replaced on change, the worker scans with a copy of the pointer
+    uint32_t scannedHeight;
+    uint64_t nextSequence;
+    std::deque<WalletScanEvent> events;
+
+    void serialize(ISerializer& s);
+  };
+
+  Registration* findRegistration(uint64_t id, const crypto::Hash& token);
+  bool isScanPaused(const Registration& registration) const;
+  void workerProc();
+  void scanBlock(const BlockScanInfo& block, uint32_t height, const std::vector<std::shared_ptr<const ScanKeys>>& keys,
+    std::vector<std::vector<WalletScanEvent>>& events) const;
+  void detach(Registration& registration, uint32_t height);
+  void addEvent(Registration& registration, WalletScanEvent&& event);
+
+  ICore& m_core;
+  Logging::LoggerRef logger;
+  const std::string m_fileName;
+  const size_t m_maxPendingEvents;
+  const size_t m_maxRegistrations;
+  const uint32_t m_maxRescanDepth;
+
+  std::mutex m_mutex;
+  std::condition_variable m_updated;
+  std::map<uint64_t, Registration> m_registrations;
+  uint64_t m_nextRegistrationId;
+  uint32_t m_chainHeight;
+  uint64_t m_chainVersion; // changed on every block removal, scan results of removed blocks are dropped
+  bool m_stopped;
+  std::thread m_worker;
+};
+
+}
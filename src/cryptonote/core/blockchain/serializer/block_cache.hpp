@@ -102,6 +102,9 @@ public:
     logger(INFO) << operation << "block index...";
     s(m_bs.m_blockIndex, "block_index");
 
+    logger(INFO) << operation << "block timestamps...";
+    s(m_bs.m_blockTimestamps, "block_timestamps");
+
     logger(INFO) << operation << "transaction map...";
     s(m_bs.m_transactionMap, "transactions");
 
@@ -1,2 +1,4 @@
 #include "block_entry.hpp"
-#include "multisignature_output_usage.hpp"
\ No newline at end of file
+#include "multisignature_output_usage.hpp"
+#include "raw_block.hpp"
+#include "transaction_location.hpp"
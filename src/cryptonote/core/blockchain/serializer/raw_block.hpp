@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <serialization/ISerializer.h>
+#include <serialization/SerializationOverloads.h>
+
+namespace cryptonote
+{
+// Canonical wire blobs of a main chain block, stored next to its BlockEntry so
+// that peers and RPC clients can be served without re-serialization.
+struct RawBlock
+{
+    std::string block;
+    std::vector<std::string> transactions; // without the miner transaction
+
+    void serialize(ISerializer &s)
+    {
+        s(block, "block");
+        s(transactions, "txs");
+    }
+};
+
+} // namespace cryptonote
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include "transaction_index.h"
+#include <serialization/ISerializer.h>
+#include <serialization/SerializationOverloads.h>
+
+namespace cryptonote
+{
+// Compact per-transaction record kept in the transaction map, so lookups that
+// only need the location or the output indexes do not load the block entry.
+struct TransactionLocation
+{
+    TransactionIndex index;
+    uint32_t blobSize;
+    std::vector<uint32_t> globalOutputIndexes;
+
+    void serialize(ISerializer &s)
+    {
+        s(index, "index");
+        s(blobSize, "size");
+        s(globalOutputIndexes, "indexes");
+    }
+};
+
+} // namespace cryptonote
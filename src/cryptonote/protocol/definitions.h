@@ -65,6 +65,56 @@ namespace cryptonote
     }
   };
 
+  // What wallets scan a transaction for: key inputs come without ring members, outputs with their global indexes
+  struct TransactionScanInfo {
+    crypto::Hash txHash;
+    TransactionPrefix txPrefix;
+    std::vector<uint32_t> globalIndexes;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(txHash);
+      KV_MEMBER(txPrefix);
+      KV_MEMBER(globalIndexes);
+    }
+  };
+
+  // Sent to wallets in binary form, one per block. Blocks the wallet does not scan come without transactions,
+  // otherwise the base transaction is the first one.
+  struct BlockScanInfo {
+    crypto::Hash blockId;
+    BlockHeader header;
+    std::vector<TransactionScanInfo> transactions;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(blockId);
+      KV_MEMBER(header);
+      KV_MEMBER(transactions);
+    }
+  };
+
+  // Transaction found for a wallet registered with the daemon side scanner, or a detach of the blocks from height on
+  struct WalletScanEvent {
+    uint64_t sequence;
+    bool detach;
+    uint32_t height;
+    crypto::Hash blockId;
+    uint64_t timestamp;
+    TransactionScanInfo transaction;
+    std::vector<uint32_t> outputs; // paying the wallet
+    std::vector<uint32_t> inputs; // spending the key images the wallet watches
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(sequence);
+      KV_MEMBER(detach);
+      KV_MEMBER(height);
+      KV_MEMBER(blockId);
+      KV_MEMBER(timestamp);
+      KV_MEMBER(transaction);
+      KV_MEMBER(outputs);
+      KV_MEMBER(inputs);
+    }
+  };
+
   /************************************************************************/
   /*                                                                      */
   /************************************************************************/
@@ -196,4 +246,72 @@ namespace cryptonote
     const static int ID = CN_COMMANDS_POOL_BASE + 8;
     typedef NOTIFY_REQUEST_TX_POOL_request request;
   };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  struct NOTIFY_NEW_COMPACT_BLOCK_request {
+    std::string block; // header, miner transaction and transaction hashes, without transaction bodies
+    uint32_t current_blockchain_height;
+    uint32_t hop;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block)
+      KV_MEMBER(current_blockchain_height)
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_NEW_COMPACT_BLOCK {
+    const static int ID = CN_COMMANDS_POOL_BASE + 9;
+    typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+  };
+
+  // answered with NOTIFY_NEW_BLOCK carrying only the requested transactions
+  struct NOTIFY_REQUEST_COMPACT_BLOCK_TXS_request {
+    crypto::Hash block_id;
+    std::vector<crypto::Hash> txs;
+    uint32_t hop;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block_id)
+      serializeAsBinary(txs, "txs", s);
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_REQUEST_COMPACT_BLOCK_TXS {
+    const static int ID = CN_COMMANDS_POOL_BASE + 10;
+    typedef NOTIFY_REQUEST_COMPACT_BLOCK_TXS_request request;
+  };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  struct NOTIFY_TX_INVENTORY_request {
+    std::vector<crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_TX_INVENTORY {
+    const static int ID = CN_COMMANDS_POOL_BASE + 11;
+    typedef NOTIFY_TX_INVENTORY_request request;
+  };
+
+  // answered with NOTIFY_NEW_TRANSACTIONS
+  struct NOTIFY_REQUEST_TXS_request {
+    std::vector<crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_TXS {
+    const static int ID = CN_COMMANDS_POOL_BASE + 12;
+    typedef NOTIFY_REQUEST_TXS_request request;
+  };
 }
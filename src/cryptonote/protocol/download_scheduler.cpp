@@ -0,0 +1,345 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "download_scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace cryptonote {
+
+BlockDownloadScheduler::BlockDownloadScheduler(std::chrono::milliseconds chunkTimeout, std::chrono::milliseconds stallTimeout, size_t maxRequestsPerPeer) :
+  BlockDownloadScheduler(chunkTimeout, stallTimeout, maxRequestsPerPeer,
+    { 1, std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), 0, 0, chunkTimeout }) {
+}
+
+BlockDownloadScheduler::BlockDownloadScheduler(std::chrono::milliseconds chunkTimeout, std::chrono::milliseconds stallTimeout, size_t maxRequestsPerPeer,
+  const BatchLimits& batchLimits) :
+  m_chunkTimeout(chunkTimeout),
+  m_stallTimeout(stallTimeout),
+  m_maxRequestsPerPeer(std::max<size_t>(maxRequestsPerPeer, 1)),
+  m_batchLimits(batchLimits),
+  m_baseHeight(0) {
+}
+
+bool BlockDownloadScheduler::addBlocks(uint32_t startHeight, const std::vector<crypto::Hash>& ids) {
+  size_t skip = 0;
+  if (m_ids.empty()) {
+    m_baseHeight = startHeight;
+  } else {
+    uint32_t endHeight = getEndHeight();
+    if (startHeight > endHeight) {
+      return false;
+    }
+
+    // the last overlapping id still in the queue has to match, ids are chained by previous block hashes
+    skip = endHeight - startHeight;
+    size_t last = std::min(skip, ids.size());
+    if (last > 0 && startHeight + last - 1 >= m_baseHeight && ids[last - 1] != m_ids[startHeight + last - 1 - m_baseHeight]) {
+      return false;
+    }
+  }
+
+  for (size_t i = skip; i < ids.size(); ++i) {
+    if (!m_heights.emplace(ids[i], getEndHeight()).second) {
+      return false;
+    }
+
+    m_ids.push_back(ids[i]);
+  }
+
+  return true;
+}
+
+bool BlockDownloadScheduler::empty() const {
+  return m_ids.empty();
+}
+
+bool BlockDownloadScheduler::hasUnassigned() const {
+  uint32_t height = m_baseHeight;
+  for (auto& entry : m_chunks) {
+    if (height < entry.first || (!entry.second.assigned && !entry.second.delivered)) {
+      return true;
+    }
+
+    height = entry.first + entry.second.count;
+  }
+
+  return height < getEndHeight();
+}
+
+uint32_t BlockDownloadScheduler::getEndHeight() const {
+  return m_baseHeight + static_cast<uint32_t>(m_ids.size());
+}
+
+std::vector<crypto::Hash> BlockDownloadScheduler::assign(const PeerId& peerId, uint32_t peerHeight, size_t maxBlocks, Clock::time_point now) {
+  Peer& peer = getPeer(peerId);
+  peer.height = peerHeight;
+  maxBlocks = std::min(maxBlocks, getBatchSize(peer));
+  if (maxBlocks == 0 || peer.requests.size() - peer.expiredRequests >= getRequestLimit(peer)) {
+    return {};
+  }
+
+  uint32_t height = m_baseHeight;
+  auto it = m_chunks.begin();
+  for (;;) {
+    uint32_t next = it == m_chunks.end() ? getEndHeight() : it->first;
+    if (height < next) {
+      if (height >= peerHeight) {
+        return {};
+      }
+
+      Chunk chunk;
+      chunk.count = static_cast<uint32_t>(std::min<size_t>(maxBlocks, std::min(next, peerHeight) - height));
+      chunk.delivered = false;
+      it = m_chunks.emplace_hint(it, height, std::move(chunk));
+      break;
+    }
+
+    if (it == m_chunks.end()) {
+      return {};
+    }
+
+    Chunk& chunk = it->second;
+    if (!chunk.assigned && !chunk.delivered && (std::find(chunk.requestedFrom.begin(), chunk.requestedFrom.end(), peerId) == chunk.requestedFrom.end() ||
+      !canRequestFromOtherPeer(it->first, chunk, peerId))) {
+      if (it->first >= peerHeight) {
+        return {};
+      }
+
+      uint32_t count = static_cast<uint32_t>(std::min<size_t>(maxBlocks, std::min(chunk.count, peerHeight - it->first)));
+      if (count < chunk.count) {
+        Chunk rest;
+        rest.count = chunk.count - count;
+        rest.assigned = false;
+        rest.delivered = false;
+        rest.requestedFrom = chunk.requestedFrom;
+        m_chunks.emplace(it->first + count, std::move(rest));
+        chunk.count = count;
+      }
+
+      break;
+    }
+
+    height = it->first + chunk.count;
+    ++it;
+  }
+
+  Chunk& chunk = it->second;
+  chunk.assigned = true;
+  chunk.peer = peerId;
+  chunk.requested = now;
+  chunk.requestedFrom.push_back(peerId);
+  peer.requests.push_back({ now, false });
+
+  auto first = m_ids.begin() + (it->first - m_baseHeight);
+  return std::vector<crypto::Hash>(first, first + chunk.count);
+}
+
+BlockDownloadScheduler::Delivery BlockDownloadScheduler::deliver(const PeerId& peerId, const std::vector<crypto::Hash>& ids,
+  std::vector<block_complete_entry>&& blocks, size_t size, Clock::time_point now) {
+  assert(ids.size() == blocks.size());
+  auto peerIt = m_peers.find(peerId);
+  if (peerIt == m_peers.end() || peerIt->second.requests.empty()) {
+    return Delivery::INVALID;
+  }
+
+  // Peer answers requests in order, transfer of a response starts when the previous one is received
+  Peer& peer = peerIt->second;
+  Clock::time_point start = std::max(peer.requests.front().time, peer.lastResponse);
+  bool expired = peer.requests.front().expired;
+  if (expired) {
+    --peer.expiredRequests;
+  }
+
+  peer.requests.pop_front();
+  peer.lastResponse = now;
+  peer.receivedBytes += size;
+  uint64_t elapsed = std::max<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - start).count(), 1);
+  uint64_t sample = static_cast<uint64_t>(size) * 1000000 / elapsed;
+  peer.throughput = peer.throughput == 0 ? sample : (peer.throughput * 3 + sample) / 4;
+  uint64_t responseTime = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+  peer.responseTime = peer.responseTime == 0 ? responseTime : (peer.responseTime * 3 + responseTime) / 4;
+
+  if (ids.empty()) {
+    return Delivery::INVALID;
+  }
+
+  uint64_t blockSize = size / ids.size();
+  peer.blockSize = peer.blockSize == 0 ? blockSize : (peer.blockSize * 3 + blockSize) / 4;
+  if (now - start <= m_batchLimits.targetResponseTime) {
+    peer.window = std::min(m_batchLimits.maxBlocks, peer.window + std::min(m_batchLimits.increment, m_batchLimits.maxBlocks - peer.window));
+  } else {
+    peer.window = std::max(m_batchLimits.minBlocks, peer.window / 2);
+  }
+
+  auto heightIt = m_heights.find(ids.front());
+  if (heightIt == m_heights.end()) {
+    return Delivery::IGNORED;
+  }
+
+  auto it = m_chunks.find(heightIt->second);
+  if (it == m_chunks.end() || it->second.delivered) {
+    return Delivery::IGNORED;
+  }
+
+  Chunk& chunk = it->second;
+  if (std::find(chunk.requestedFrom.begin(), chunk.requestedFrom.end(), peerId) == chunk.requestedFrom.end()) {
+    return Delivery::INVALID;
+  }
+
+  // chunk could be split after it was requested from the peer, a timed out request may be repeated with fewer blocks
+  if (ids.size() != chunk.count) {
+    return chunk.assigned && chunk.peer == peerId && !expired ? Delivery::INVALID : Delivery::IGNORED;
+  }
+
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (m_ids[it->first - m_baseHeight + i] != ids[i]) {
+      return Delivery::INVALID;
+    }
+  }
+
+  chunk.assigned = false;
+  chunk.delivered = true;
+  chunk.peer = peerId;
+  chunk.blocks = std::move(blocks);
+  return Delivery::ACCEPTED;
+}
+
+bool BlockDownloadScheduler::popReady(std::vector<block_complete_entry>& blocks, PeerId& source) {
+  auto it = m_chunks.begin();
+  if (it == m_chunks.end() || it->first != m_baseHeight || !it->second.delivered) {
+    return false;
+  }
+
+  blocks = std::move(it->second.blocks);
+  source = it->second.peer;
+  for (uint32_t i = 0; i < it->second.count; ++i) {
+    m_heights.erase(m_ids.front());
+    m_ids.pop_front();
+  }
+
+  m_baseHeight += it->second.count;
+  m_chunks.erase(it);
+  return true;
+}
+
+size_t BlockDownloadScheduler::expire(Clock::time_point now) {
+  size_t expired = 0;
+  for (auto& entry : m_chunks) {
+    if (entry.second.assigned && now - entry.second.requested >= m_chunkTimeout) {
+      unassign(entry.second);
+      ++expired;
+    }
+  }
+
+  auto first = m_chunks.begin();
+  if (first != m_chunks.end() && first->first == m_baseHeight && first->second.assigned && now - first->second.requested >= m_stallTimeout) {
+    if (std::any_of(std::next(first), m_chunks.end(), [](const std::pair<const uint32_t, Chunk>& entry) { return entry.second.delivered; })) {
+      unassign(first->second);
+      ++expired;
+    }
+  }
+
+  return expired;
+}
+
+void BlockDownloadScheduler::removePeer(const PeerId& peer) {
+  for (auto& entry : m_chunks) {
+    if (entry.second.assigned && entry.second.peer == peer) {
+      entry.second.assigned = false;
+    }
+  }
+
+  m_peers.erase(peer);
+}
+
+void BlockDownloadScheduler::clear() {
+  m_ids.clear();
+  m_heights.clear();
+  m_chunks.clear();
+}
+
+bool BlockDownloadScheduler::getPeerStats(const PeerId& peerId, PeerStats& stats) const {
+  auto it = m_peers.find(peerId);
+  if (it == m_peers.end()) {
+    return false;
+  }
+
+  stats.throughput = it->second.throughput;
+  stats.pendingRequests = it->second.requests.size();
+  stats.receivedBytes = it->second.receivedBytes;
+  stats.timeouts = it->second.timeouts;
+  stats.batchSize = getBatchSize(it->second);
+  stats.responseTime = it->second.responseTime;
+  stats.blockSize = it->second.blockSize;
+  return true;
+}
+
+BlockDownloadScheduler::Peer& BlockDownloadScheduler::getPeer(const PeerId& peerId) {
+  auto it = m_peers.find(peerId);
+  if (it == m_peers.end()) {
+    Peer peer = Peer();
+    peer.window = m_batchLimits.initialBlocks;
+    it = m_peers.emplace(peerId, std::move(peer)).first;
+  }
+
+  return it->second;
+}
+
+void BlockDownloadScheduler::unassign(Chunk& chunk) {
+  auto it = m_peers.find(chunk.peer);
+  if (it != m_peers.end()) {
+    Peer& peer = it->second;
+    ++peer.timeouts;
+    peer.throughput /= 2;
+    peer.window = std::max(m_batchLimits.minBlocks, peer.window / 2);
+
+    // the oldest request is the most overdue one, it no longer counts against the request limit of the peer
+    auto request = std::find_if(peer.requests.begin(), peer.requests.end(), [](const Request& request) { return !request.expired; });
+    if (request != peer.requests.end()) {
+      request->expired = true;
+      ++peer.expiredRequests;
+    }
+  }
+
+  chunk.assigned = false;
+}
+
+bool BlockDownloadScheduler::canRequestFromOtherPeer(uint32_t height, const Chunk& chunk, const PeerId& peerId) const {
+  for (auto& entry : m_peers) {
+    if (entry.first != peerId && entry.second.height > height &&
+      std::find(chunk.requestedFrom.begin(), chunk.requestedFrom.end(), entry.first) == chunk.requestedFrom.end()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t BlockDownloadScheduler::getRequestLimit(const Peer& peer) const {
+  if (peer.throughput == 0) {
+    return 1;
+  }
+
+  uint64_t best = 0;
+  for (auto& entry : m_peers) {
+    best = std::max(best, entry.second.throughput);
+  }
+
+  return 1 + static_cast<size_t>((m_maxRequestsPerPeer - 1) * peer.throughput / best);
+}
+
+size_t BlockDownloadScheduler::getBatchSize(const Peer& peer) const {
+  if (m_batchLimits.maxResponseSize == 0 || peer.blockSize == 0) {
+    return peer.window;
+  }
+
+  // keep responses within the budget for blocks of the size seen so far
+  uint64_t fitting = std::max<uint64_t>(m_batchLimits.maxResponseSize / peer.blockSize, m_batchLimits.minBlocks);
+  return static_cast<size_t>(std::min<uint64_t>(peer.window, fitting));
+}
+
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "crypto/hash.h"
+#include "cryptonote/protocol/definitions.h"
+
+namespace cryptonote {
+
+// Blocks needed during synchronization are downloaded in chunks from several peers at once. Peers with higher measured
+// throughput get more chunks in flight, chunks a peer does not deliver in time are requested from another one, or again
+// from the same peer when no other one has them.
+// Delivered chunks are handed out in height order. Chunk size is adapted per peer: it grows additively while responses
+// arrive within the target time, halves on slow responses and timeouts, and is capped by a response size budget derived
+// from the sizes of delivered blocks. Used on the protocol dispatcher only.
+class BlockDownloadScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef boost::uuids::uuid PeerId;
+
+  enum class Delivery {
+    ACCEPTED,
+    IGNORED, // chunk was already delivered by another peer or dropped
+    INVALID  // blocks were not requested from the peer
+  };
+
+  struct PeerStats {
+    uint64_t throughput; // bytes per second, 0 until the first delivery
+    size_t pendingRequests; // timed out ones included, their responses may still arrive
+    uint64_t receivedBytes;
+    size_t timeouts;
+    size_t batchSize; // blocks the next request may ask for
+    uint64_t responseTime; // milliseconds
+    uint64_t blockSize; // average size of delivered blocks in bytes
+  };
+
+  struct BatchLimits {
+    size_t minBlocks;
+    size_t maxBlocks;
+    size_t initialBlocks;
+    size_t increment;
+    uint64_t maxResponseSize;
+    std::chrono::milliseconds targetResponseTime;
+  };
+
+  // Without batch limits requests are as large as 'maxBlocks' passed to assign()
+  BlockDownloadScheduler(std::chrono::milliseconds chunkTimeout, std::chrono::milliseconds stallTimeout, size_t maxRequestsPerPeer);
+  BlockDownloadScheduler(std::chrono::milliseconds chunkTimeout, std::chrono::milliseconds stallTimeout, size_t maxRequestsPerPeer,
+    const BatchLimits& batchLimits);
+
+  // Queues ids of consecutive blocks starting at 'startHeight', ids overlapping the queue are skipped.
+  // Returns false if the ids do not continue the queued chain.
+  bool addBlocks(uint32_t startHeight, const std::vector<crypto::Hash>& ids);
+  // Nothing is queued, in flight or waiting for reassembly
+  bool empty() const;
+  bool hasUnassigned() const;
+  // Height of the block after the last queued one
+  uint32_t getEndHeight() const;
+
+  // Assigns up to 'maxBlocks' of the lowest unassigned blocks the peer has, 'peerHeight' being its block count.
+  // The chunk is limited to the current batch size of the peer as well.
+  // Returns ids to request, empty when nothing fits or the peer has as many requests in flight as its throughput allows.
+  std::vector<crypto::Hash> assign(const PeerId& peer, uint32_t peerHeight, size_t maxBlocks, Clock::time_point now);
+  // Takes the response to the oldest request of the peer, 'blocks' are ordered as 'ids'
+  Delivery deliver(const PeerId& peer, const std::vector<crypto::Hash>& ids, std::vector<block_complete_entry>&& blocks,
+    size_t size, Clock::time_point now);
+  // Takes the next delivered chunk in height order, if it is available
+  bool popReady(std::vector<block_complete_entry>& blocks, PeerId& source);
+
+  // Returns to the queue chunks that timed out, and the lowest chunk if it holds back delivered ones for too long.
+  // Returns the number of chunks returned.
+  size_t expire(Clock::time_point now);
+  void removePeer(const PeerId& peer);
+  // Drops all queued and delivered blocks, responses to requests in flight are ignored
+  void clear();
+  bool getPeerStats(const PeerId& peer, PeerStats& stats) const;
+
+private:
+  struct Chunk {
+    uint32_t count;
+    bool assigned;
+    bool delivered;
+    PeerId peer; // assigned or delivering peer
+    Clock::time_point requested;
+    std::vector<PeerId> requestedFrom;
+    std::vector<block_complete_entry> blocks;
+  };
+
+  struct Request {
+    Clock::time_point time;
+    bool expired;
+  };
+
+  struct Peer {
+    // Responses arrive in request order, timed out requests stay until their response arrives
+    std::deque<Request> requests;
+    size_t expiredRequests;
+    uint32_t height;
+    Clock::time_point lastResponse;
+    uint64_t throughput;
+    uint64_t receivedBytes;
+    size_t timeouts;
+    size_t window;
+    uint64_t responseTime;
+    uint64_t blockSize;
+  };
+
+  Peer& getPeer(const PeerId& peerId);
+  void unassign(Chunk& chunk);
+  bool canRequestFromOtherPeer(uint32_t height, const Chunk& chunk, const PeerId& peerId) const;
+  size_t getRequestLimit(const Peer& peer) const;
+  size_t getBatchSize(const Peer& peer) const;
+
+  const std::chrono::milliseconds m_chunkTimeout;
+  const std::chrono::milliseconds m_stallTimeout;
+  const size_t m_maxRequestsPerPeer;
+  const BatchLimits m_batchLimits;
+
+  // Queued ids, the first one is at 'm_baseHeight'
+  std::deque<crypto::Hash> m_ids;
+  uint32_t m_baseHeight;
+  std::unordered_map<crypto::Hash, uint32_t> m_heights;
+  // Chunks by start height, queued blocks not covered by any chunk are unassigned
+  std::map<uint32_t, Chunk> m_chunks;
+  std::unordered_map<PeerId, Peer, boost::hash<PeerId>> m_peers;
+};
+
+}
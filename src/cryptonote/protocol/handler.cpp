@@ -4,10 +4,14 @@
 
 #include "handler.h"
 
+#include <algorithm>
 #include <future>
+#include <unordered_set>
 #include <boost/scope_exit.hpp>
+#include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <system/Dispatcher.h>
+#include <system/DispatcherPool.h>
 
 #include "cryptonote/core/CryptoNoteFormatUtils.h"
 #include "cryptonote/core/CryptoNoteTools.h"
@@ -27,15 +31,26 @@ bool post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const Cry
   return p2p.invoke_notify_to_peer(t_parametr::ID, LevinProtocol::encode(arg), context);
 }
 
-template<class t_parametr>
-void relay_post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const net_connection_id* excludeConnection = nullptr) {
-  p2p.relay_notify_to_all(t_parametr::ID, LevinProtocol::encode(arg), excludeConnection);
+// returns false if the transaction was already known to the peer
+bool addKnownTransaction(CryptoNoteConnectionContext& context, const crypto::Hash& txHash) {
+  if (!context.m_known_txs.insert(txHash).second) {
+    return false;
+  }
+
+  context.m_known_txs_order.push_back(txHash);
+  if (context.m_known_txs_order.size() > P2P_TX_KNOWN_LIMIT) {
+    context.m_known_txs.erase(context.m_known_txs_order.front());
+    context.m_known_txs_order.pop_front();
+  }
+
+  return true;
 }
 
 }
 
 CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& rcore, IP2pEndpoint* p_net_layout, Logging::ILogger& log) :
   m_dispatcher(dispatcher),
+  m_dispatcherPool(nullptr),
   m_currency(currency),
   m_core(rcore),
   m_p2p(p_net_layout),
@@ -43,6 +58,10 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, S
   m_stop(false),
   m_observedHeight(0),
   m_peersCount(0),
+  m_downloads(std::chrono::seconds(P2P_SYNC_CHUNK_TIMEOUT), std::chrono::seconds(P2P_SYNC_STALL_TIMEOUT), P2P_SYNC_MAX_REQUESTS_PER_PEER,
+    { P2P_SYNC_MIN_BATCH_BLOCKS, P2P_SYNC_MAX_BATCH_BLOCKS, BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, P2P_SYNC_BATCH_INCREMENT,
+      P2P_SYNC_RESPONSE_SIZE_LIMIT, std::chrono::milliseconds(P2P_SYNC_TARGET_RESPONSE_TIME) }),
+  m_applyingBlocks(false),
   logger(log, "protocol") {
   
   if (!m_p2p) {
@@ -61,10 +80,27 @@ void CryptoNoteProtocolHandler::set_p2p_endpoint(IP2pEndpoint* p2p) {
     m_p2p = &m_p2p_stub;
 }
 
+void CryptoNoteProtocolHandler::setDispatcherPool(System::DispatcherPool* pool) {
+  m_dispatcherPool = pool;
+}
+
+template <typename T>
+T CryptoNoteProtocolHandler::runOnShard(const CryptoNoteConnectionContext& context, std::function<T()>&& operation) {
+  if (m_dispatcherPool == nullptr) {
+    return operation();
+  }
+
+  return m_dispatcherPool->run<T>(m_dispatcher, boost::uuids::hash_value(context.m_connection_id), std::move(operation));
+}
+
 void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext& context) {
 }
 
 void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext& context) {
+  m_downloads.removePeer(context.m_connection_id);
+  m_chainRequests.erase(context.m_connection_id);
+  m_txRequestsInFlight.erase(context.m_connection_id);
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -94,13 +130,7 @@ bool CryptoNoteProtocolHandler::start_sync(CryptoNoteConnectionContext& context)
   logger(Logging::TRACE) << context << "Starting synchronization";
 
   if (context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
-    assert(context.m_needed_objects.empty());
-    assert(context.m_requested_objects.empty());
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return true;
@@ -117,7 +147,8 @@ void CryptoNoteProtocolHandler::log_connections() {
     << std::setw(20) << "Peer id"
     << std::setw(25) << "Recv/Sent (inactive,sec)"
     << std::setw(25) << "State"
-    << std::setw(20) << "Lifetime(seconds)" << ENDL;
+    << std::setw(20) << "Lifetime(seconds)"
+    << std::setw(40) << "Sync(KiB/s, batch, response ms)" << ENDL;
 
   m_p2p->for_each_connection([&](const CryptoNoteConnectionContext& cntxt, PeerIdType peer_id) {
     ss << std::setw(25) << std::left << std::string(cntxt.m_is_income ? "[INC]" : "[OUT]") +
@@ -125,7 +156,15 @@ void CryptoNoteProtocolHandler::log_connections() {
       << std::setw(20) << std::hex << peer_id
       // << std::setw(25) << std::to_string(cntxt.m_recv_cnt) + "(" + std::to_string(time(NULL) - cntxt.m_last_recv) + ")" + "/" + std::to_string(cntxt.m_send_cnt) + "(" + std::to_string(time(NULL) - cntxt.m_last_send) + ")"
       << std::setw(25) << get_protocol_state_string(cntxt.m_state)
-      << std::setw(20) << std::to_string(time(NULL) - cntxt.m_started) << ENDL;
+      << std::setw(20) << std::to_string(time(NULL) - cntxt.m_started);
+
+    BlockDownloadScheduler::PeerStats stats;
+    if (m_downloads.getPeerStats(cntxt.m_connection_id, stats)) {
+      ss << std::setw(40) << std::to_string(stats.throughput / 1024) + ", " + std::to_string(stats.batchSize) + ", " +
+        std::to_string(stats.responseTime) + " (" + std::to_string(stats.pendingRequests) + " pending)";
+    }
+
+    ss << ENDL;
   });
   logger(INFO) << "Connections: " << ENDL << ss.str();
 }
@@ -184,13 +223,15 @@ bool CryptoNoteProtocolHandler::get_payload_sync_data(CORE_SYNC_DATA& hshd) {
 
 
 template <typename Command, typename Handler>
-int notifyAdaptor(const BinaryArray& reqBuf, CryptoNoteConnectionContext& ctx, Handler handler) {
+int CryptoNoteProtocolHandler::notifyAdaptor(const BinaryArray& reqBuf, CryptoNoteConnectionContext& ctx, Handler handler) {
 
   typedef typename Command::request Request;
   int command = Command::ID;
 
   Request req = boost::value_initialized<Request>();
-  if (!LevinProtocol::decode(reqBuf, req)) {
+  bool decoded = reqBuf.size() < P2P_DISPATCHER_OFFLOAD_MIN_SIZE ? LevinProtocol::decode(reqBuf, req) :
+    runOnShard<bool>(ctx, [&] { return LevinProtocol::decode(reqBuf, req); });
+  if (!decoded) {
     throw std::runtime_error("Failed to load_from_binary in command " + std::to_string(command));
   }
 
@@ -211,6 +252,10 @@ int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const
     HANDLE_NOTIFY(NOTIFY_REQUEST_CHAIN, &CryptoNoteProtocolHandler::handle_request_chain)
     HANDLE_NOTIFY(NOTIFY_RESPONSE_CHAIN_ENTRY, &CryptoNoteProtocolHandler::handle_response_chain_entry)
     HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, &CryptoNoteProtocolHandler::handleRequestTxPool)
+    HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, &CryptoNoteProtocolHandler::handleNotifyNewCompactBlock)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_COMPACT_BLOCK_TXS, &CryptoNoteProtocolHandler::handleRequestCompactBlockTxs)
+    HANDLE_NOTIFY(NOTIFY_TX_INVENTORY, &CryptoNoteProtocolHandler::handleTxInventory)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_TXS, &CryptoNoteProtocolHandler::handleRequestTxs)
 
   default:
     handled = false;
@@ -232,18 +277,26 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
     return 1;
   }
 
-  for (auto tx_blob_it = arg.b.txs.begin(); tx_blob_it != arg.b.txs.end(); tx_blob_it++) {
-    cryptonote::TxVerificationContext tvc = boost::value_initialized<decltype(tvc)>();
-    m_core.handle_incoming_tx(asBinaryArray(*tx_blob_it), tvc, true);
-    if (tvc.m_verifivation_failed) {
-      logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
+  BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
+  bool txsVerified = runOnShard<bool>(context, [&] {
+    for (auto tx_blob_it = arg.b.txs.begin(); tx_blob_it != arg.b.txs.end(); tx_blob_it++) {
+      cryptonote::TxVerificationContext tvc = boost::value_initialized<decltype(tvc)>();
+      m_core.handle_incoming_tx(asBinaryArray(*tx_blob_it), tvc, true);
+      if (tvc.m_verifivation_failed) {
+        return false;
+      }
     }
+
+    m_core.handle_incoming_block_blob(asBinaryArray(arg.b.block), bvc, true, false);
+    return true;
+  });
+
+  if (!txsVerified) {
+    logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
   }
 
-  BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
-  m_core.handle_incoming_block_blob(asBinaryArray(arg.b.block), bvc, true, false);
   if (bvc.m_verifivation_failed) {
     logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
@@ -251,9 +304,7 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
   }
   if (bvc.m_added_to_main_chain) {
     ++arg.hop;
-    //TODO: Add here announce protocol usage
-    relay_post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-    // relay_block(arg, context);
+    relayNewBlock(arg, &context.m_connection_id);
 
     if (bvc.m_switched_to_alt_chain) {
       requestMissingPoolTransactions(context);
@@ -274,9 +325,25 @@ int CryptoNoteProtocolHandler::handle_notify_new_transactions(int command, NOTIF
   if (context.m_state != CryptoNoteConnectionContext::state_normal)
     return 1;
 
-  for (auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();) {
-    cryptonote::TxVerificationContext tvc = boost::value_initialized<decltype(tvc)>();
-    m_core.handle_incoming_tx(asBinaryArray(*tx_blob_it), tvc, false);
+  std::vector<crypto::Hash> txHashes(arg.txs.size());
+  std::vector<TxVerificationContext> verifications(arg.txs.size(), boost::value_initialized<TxVerificationContext>());
+  runOnShard<void>(context, [&] {
+    for (size_t i = 0; i < arg.txs.size(); ++i) {
+      txHashes[i] = getBinaryArrayHash(asBinaryArray(arg.txs[i]));
+      m_core.handle_incoming_tx(asBinaryArray(arg.txs[i]), verifications[i], false);
+    }
+  });
+
+  size_t txIndex = 0;
+  for (auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end(); ++txIndex) {
+    addKnownTransaction(context, txHashes[txIndex]);
+    auto requestIt = m_requestedTxs.find(txHashes[txIndex]);
+    if (requestIt != m_requestedTxs.end()) {
+      releaseTxRequest(requestIt->second);
+      m_requestedTxs.erase(requestIt);
+    }
+
+    const TxVerificationContext& tvc = verifications[txIndex];
     if (tvc.m_verifivation_failed) {
       logger(Logging::INFO) << context << "Tx verification failed";
     }
@@ -288,8 +355,7 @@ int CryptoNoteProtocolHandler::handle_notify_new_transactions(int command, NOTIF
   }
 
   if (arg.txs.size()) {
-    //TODO: add announce usage here
-    relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, arg, &context.m_connection_id);
+    relayNewTransactions(arg, &context.m_connection_id);
   }
 
   return true;
@@ -298,7 +364,7 @@ int CryptoNoteProtocolHandler::handle_notify_new_transactions(int command, NOTIF
 int CryptoNoteProtocolHandler::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, CryptoNoteConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_GET_OBJECTS";
   NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
-  if (!m_core.handle_get_objects(arg, rsp)) {
+  if (!runOnShard<bool>(context, [&] { return m_core.handle_get_objects(arg, rsp); })) {
     logger(Logging::ERROR) << context << "failed to handle request NOTIFY_REQUEST_GET_OBJECTS, dropping connection";
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
   }
@@ -322,9 +388,10 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-  size_t count = 0;
+  std::vector<crypto::Hash> blockHashes;
+  blockHashes.reserve(arg.blocks.size());
+  size_t size = 0;
   for (const block_complete_entry& block_entry : arg.blocks) {
-    ++count;
     Block b;
     if (!fromBinaryArray(b, asBinaryArray(block_entry.block))) {
       logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
@@ -333,25 +400,7 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
       return 1;
     }
 
-    //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    if (count == 2) {
-      if (m_core.have_block(get_block_hash(b))) {
-        context.m_state = CryptoNoteConnectionContext::state_idle;
-        context.m_needed_objects.clear();
-        context.m_requested_objects.clear();
-        logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-        return 1;
-      }
-    }
-
     auto blockHash = get_block_hash(b);
-    auto req_it = context.m_requested_objects.find(blockHash);
-    if (req_it == context.m_requested_objects.end()) {
-      logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << " wasn't requested, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    }
     if (b.transactionHashes.size() != block_entry.txs.size()) {
       logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
         << ", transactionHashes.size()=" << b.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size() << ", dropping connection";
@@ -359,77 +408,118 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
       return 1;
     }
 
-    context.m_requested_objects.erase(req_it);
+    blockHashes.push_back(blockHash);
+    size += block_entry.block.size();
+    for (const auto& tx : block_entry.txs) {
+      size += tx.size();
+    }
   }
 
-  if (context.m_requested_objects.size()) {
-    logger(Logging::ERROR, Logging::BRIGHT_RED) << context <<
-      "returned not all requested objects (context.m_requested_objects.size()="
-      << context.m_requested_objects.size() << "), dropping connection";
+  switch (m_downloads.deliver(context.m_connection_id, blockHashes, std::move(arg.blocks), size, std::chrono::steady_clock::now())) {
+  case BlockDownloadScheduler::Delivery::INVALID:
+    logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: blocks.size()=" << blockHashes.size()
+      << " weren't requested or not all requested blocks returned, dropping connection";
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
     return 1;
+  case BlockDownloadScheduler::Delivery::IGNORED:
+    logger(Logging::DEBUGGING) << context << "Blocks were already received from another connection";
+    break;
+  case BlockDownloadScheduler::Delivery::ACCEPTED:
+    break;
   }
 
-  {
-    m_core.pause_mining();
-
-    BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+  applyDownloadedBlocks(context);
 
-    int result = processObjects(context, arg.blocks);
-    if (result != 0) {
-      return result;
-    }
+  if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
+    request_missing_objects(context);
   }
 
-  uint32_t height;
-  crypto::Hash top;
-  m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  return 1;
+}
 
-  if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
-    request_missing_objects(context, true);
+void CryptoNoteProtocolHandler::applyDownloadedBlocks(CryptoNoteConnectionContext& context) {
+  // Blocks delivered while another connection adds blocks to the core are picked up by it
+  if (m_applyingBlocks) {
+    return;
   }
 
-  return 1;
+  m_applyingBlocks = true;
+  bool miningPaused = false;
+  BOOST_SCOPE_EXIT_ALL(this, &miningPaused) {
+    m_applyingBlocks = false;
+    if (miningPaused) {
+      m_core.update_block_template_and_resume_mining();
+    }
+  };
+
+  std::vector<block_complete_entry> blocks;
+  BlockDownloadScheduler::PeerId source;
+  while (!m_stop && m_downloads.popReady(blocks, source)) {
+    if (!miningPaused) {
+      m_core.pause_mining();
+      miningPaused = true;
+    }
+
+    if (processObjects(context, blocks) != 0) {
+      // Queued blocks depend on the rejected ones, connections request their chains again
+      m_downloads.clear();
+      m_p2p->for_each_connection([&](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+        if (ctx.m_connection_id == source) {
+          logger(Logging::INFO) << ctx << "delivered blocks failed verification, dropping connection";
+          ctx.m_state = CryptoNoteConnectionContext::state_shutdown;
+        }
+
+        ctx.m_last_response_height = 0;
+      });
+
+      return;
+    }
+
+    uint32_t height;
+    crypto::Hash top;
+    m_core.get_blockchain_top(height, top);
+    logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  }
 }
 
-int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks) {
+int CryptoNoteProtocolHandler::processObjects(const CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks) {
 
   for (const block_complete_entry& block_entry : blocks) {
     if (m_stop) {
       break;
     }
 
-    //process transactions
-    for (auto& tx_blob : block_entry.txs) {
-      TxVerificationContext tvc = boost::value_initialized<decltype(tvc)>();
-      m_core.handle_incoming_tx(asBinaryArray(tx_blob), tvc, true);
-      if (tvc.m_verifivation_failed) {
-        logger(Logging::ERROR) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(getBinaryArrayHash(asBinaryArray(tx_blob))) << ", dropping connection";
-        context.m_state = CryptoNoteConnectionContext::state_shutdown;
-        return 1;
+    // process transactions and block, the connection context must not be touched off the protocol dispatcher
+    const std::string* failedTx = nullptr;
+    BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
+    runOnShard<void>(context, [&] {
+      for (auto& tx_blob : block_entry.txs) {
+        TxVerificationContext tvc = boost::value_initialized<decltype(tvc)>();
+        m_core.handle_incoming_tx(asBinaryArray(tx_blob), tvc, true);
+        if (tvc.m_verifivation_failed) {
+          failedTx = &tx_blob;
+          return;
+        }
       }
-    }
 
-    // process block
-    BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
-    m_core.handle_incoming_block_blob(asBinaryArray(block_entry.block), bvc, false, false);
+      m_core.handle_incoming_block_blob(asBinaryArray(block_entry.block), bvc, false, false);
+    });
+
+    if (failedTx != nullptr) {
+      logger(Logging::ERROR) << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+        << Common::podToHex(getBinaryArrayHash(asBinaryArray(*failedTx)));
+      return 1;
+    }
 
     if (bvc.m_verifivation_failed) {
-      logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      logger(Logging::DEBUGGING) << "Block verification failed";
       return 1;
     } else if (bvc.m_marked_as_orphaned) {
-      logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection";
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      logger(Logging::INFO) << "Block received at sync phase was marked as orphaned";
       return 1;
     } else if (bvc.m_already_exists) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = CryptoNoteConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+      // the block was relayed while it was being downloaded
+      logger(Logging::DEBUGGING) << "Block already exists";
     }
 
     m_dispatcher.yield();
@@ -441,6 +531,25 @@ int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& conte
 
 
 bool CryptoNoteProtocolHandler::on_idle() {
+  auto now = std::chrono::steady_clock::now();
+  size_t expired = m_downloads.expire(now);
+  if (expired != 0) {
+    logger(Logging::DEBUGGING) << expired << " block requests timed out, requesting from other connections or again if no other one has the blocks";
+  }
+
+  expireCompactBlockRequests(now);
+
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    auto it = m_chainRequests.find(ctx.m_connection_id);
+    if (it != m_chainRequests.end() && now - it->second >= std::chrono::seconds(P2P_SYNC_CHUNK_TIMEOUT)) {
+      logger(Logging::DEBUGGING) << ctx << "NOTIFY_REQUEST_CHAIN timed out, dropping connection";
+      ctx.m_state = CryptoNoteConnectionContext::state_shutdown;
+      m_chainRequests.erase(it);
+    } else if (!m_stop && ctx.m_state == CryptoNoteConnectionContext::state_synchronizing) {
+      request_missing_objects(ctx);
+    }
+  });
+
   return m_core.on_idle();
 }
 
@@ -467,53 +576,52 @@ int CryptoNoteProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_
   return 1;
 }
 
-bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionContext& context, bool check_having_blocks) {
-  if (context.m_needed_objects.size()) {
-    //we know objects that we need, request this objects
+bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionContext& context) {
+  // request as many chunks of the blocks known to the peer as its throughput allows
+  auto now = std::chrono::steady_clock::now();
+  bool requested = false;
+  for (;;) {
     NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
-
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(check_having_blocks && m_core.have_block(*it))) {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
-      }
-      it = context.m_needed_objects.erase(it);
+    req.blocks = m_downloads.assign(context.m_connection_id, context.m_last_response_height + 1, P2P_SYNC_MAX_BATCH_BLOCKS, now);
+    if (req.blocks.empty()) {
+      break;
     }
+
     logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
     post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
-  } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
+    requested = true;
+  }
 
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
-  } else {
-    if (!(context.m_last_response_height ==
-      context.m_remote_blockchain_height - 1 &&
-      !context.m_needed_objects.size() &&
-      !context.m_requested_objects.size())) {
-      logger(Logging::ERROR, Logging::BRIGHT_RED)
-        << "request_missing_blocks final condition failed!"
-        << "\r\nm_last_response_height=" << context.m_last_response_height
-        << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-        << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
-        << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size() 
-        << "\r\non connection [" << context << "]";
-      return false;
-    }
+  BlockDownloadScheduler::PeerStats stats;
+  if (requested || m_chainRequests.count(context.m_connection_id) != 0 ||
+    (m_downloads.getPeerStats(context.m_connection_id, stats) && stats.pendingRequests != 0)) {
+    return true;
+  }
 
+  if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {
+    // ids start at the local top, a long queue would not be extended
+    if (m_downloads.empty() || m_downloads.getEndHeight() < get_current_blockchain_height() + BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT / 2) {
+      requestChain(context);
+    }
+  } else if (m_downloads.empty() && !m_applyingBlocks) {
     requestMissingPoolTransactions(context);
 
     context.m_state = CryptoNoteConnectionContext::state_normal;
     logger(Logging::INFO, Logging::BRIGHT_GREEN) << context << "SYNCHRONIZED OK";
     on_connection_synchronized();
   }
+
   return true;
 }
 
+void CryptoNoteProtocolHandler::requestChain(CryptoNoteConnectionContext& context) {
+  NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+  r.block_ids = m_core.buildSparseChain();
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+  post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+  m_chainRequests[context.m_connection_id] = std::chrono::steady_clock::now();
+}
+
 bool CryptoNoteProtocolHandler::on_connection_synchronized() {
   bool val_expected = false;
   if (m_synchronized.compare_exchange_strong(val_expected, true)) {
@@ -564,14 +672,20 @@ int CryptoNoteProtocolHandler::handle_response_chain_entry(int command, NOTIFY_R
       << arg.total_height << "\r\nm_start_height=" << arg.start_height
       << "\r\nm_block_ids.size()=" << arg.m_block_ids.size();
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
   }
 
-  for (auto& bl_id : arg.m_block_ids) {
-    if (!m_core.have_block(bl_id))
-      context.m_needed_objects.push_back(bl_id);
+  m_chainRequests.erase(context.m_connection_id);
+
+  auto firstUnknown = std::find_if(arg.m_block_ids.begin(), arg.m_block_ids.end(), [this](const crypto::Hash& id) { return !m_core.have_block(id); });
+  uint32_t startHeight = arg.start_height + static_cast<uint32_t>(firstUnknown - arg.m_block_ids.begin());
+  if (!m_downloads.addBlocks(startHeight, std::vector<crypto::Hash>(firstUnknown, arg.m_block_ids.end()))) {
+    logger(Logging::DEBUGGING) << context << "Chain entry doesn't continue blocks being downloaded, switching to idle state";
+    context.m_state = CryptoNoteConnectionContext::state_idle;
+    return 1;
   }
 
-  request_missing_objects(context, false);
+  request_missing_objects(context);
   return 1;
 }
 
@@ -598,15 +712,443 @@ int CryptoNoteProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_T
   return 1;
 }
 
+int CryptoNoteProtocolHandler::handleNotifyNewCompactBlock(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")";
+
+  updateObservedHeight(arg.current_blockchain_height, context);
+
+  context.m_remote_blockchain_height = arg.current_blockchain_height;
+
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
+
+  Block b;
+  if (!fromBinaryArray(b, asBinaryArray(arg.block))) {
+    logger(Logging::DEBUGGING) << context << "Failed to parse compact block, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  // transactions are usually in our pool already, fetch only the ones we don't have
+  std::list<Transaction> txs;
+  std::list<crypto::Hash> missedTxs;
+  m_core.getTransactions(b.transactionHashes, txs, missedTxs, true);
+
+  if (!missedTxs.empty()) {
+    NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request req;
+    req.block_id = get_block_hash(b);
+
+    // the block is requested from one announcer at a time, the others are asked if it times out
+    auto it = m_pendingCompactBlocks.find(req.block_id);
+    if (it != m_pendingCompactBlocks.end()) {
+      auto& announcers = it->second.announcers;
+      if (it->second.peer != context.m_connection_id &&
+        std::find(announcers.begin(), announcers.end(), context.m_connection_id) == announcers.end()) {
+        announcers.push_back(context.m_connection_id);
+      }
+
+      return 1;
+    }
+
+    // don't spend requests on blocks that can't be accepted, the header alone proves the work
+    uint32_t topHeight;
+    crypto::Hash topId;
+    m_core.get_blockchain_top(topHeight, topId);
+    if (b.previousBlockHash != topId) {
+      if (!m_core.have_block(b.previousBlockHash)) {
+        logger(Logging::DEBUGGING) << context << "Compact block " << req.block_id << " has unknown previous block, synchronizing";
+        context.m_state = CryptoNoteConnectionContext::state_synchronizing;
+        requestChain(context);
+      } else {
+        logger(Logging::DEBUGGING) << context << "Compact block " << req.block_id << " doesn't extend the main chain, ignoring";
+      }
+
+      return 1;
+    }
+
+    crypto::Hash proofOfWork;
+    if (!m_currency.checkProofOfWork(b, m_core.getNextBlockDifficulty(), proofOfWork)) {
+      logger(Logging::DEBUGGING) << context << "Compact block " << req.block_id << " has insufficient proof of work, dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
+
+    if (m_pendingCompactBlocks.size() >= P2P_COMPACT_BLOCK_MAX_PENDING) {
+      logger(Logging::DEBUGGING) << context << "Too many compact blocks are waiting for transactions, ignoring " << req.block_id;
+      return 1;
+    }
+
+    PendingCompactBlock& pending = m_pendingCompactBlocks[req.block_id];
+    pending.time = std::chrono::steady_clock::now();
+    pending.peer = context.m_connection_id;
+    pending.txs = b.transactionHashes;
+    pending.hop = arg.hop;
+    pending.fullBlockRequested = false;
+
+    req.txs.assign(missedTxs.begin(), missedTxs.end());
+    req.hop = arg.hop;
+    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_COMPACT_BLOCK_TXS: txs.size()=" << req.txs.size() << " of " << b.transactionHashes.size();
+    post_notify<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(*m_p2p, req, context);
+    return 1;
+  }
+
+  NOTIFY_NEW_BLOCK::request fullBlock;
+  fullBlock.b.block = std::move(arg.block);
+  fullBlock.current_blockchain_height = arg.current_blockchain_height;
+  fullBlock.hop = arg.hop;
+  return handle_notify_new_block(command, fullBlock, context);
+}
+
+int CryptoNoteProtocolHandler::handleRequestCompactBlockTxs(int command, NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_COMPACT_BLOCK_TXS: txs.size()=" << arg.txs.size();
+
+  Block b;
+  if (!m_core.getBlockByHash(arg.block_id, b)) {
+    // block was reorganized away in the meantime, the peer will catch up with regular sync
+    logger(Logging::DEBUGGING) << context << "Requested transactions of unknown block " << arg.block_id;
+    return 1;
+  }
+
+  std::unordered_set<crypto::Hash> blockTxs(b.transactionHashes.begin(), b.transactionHashes.end());
+  for (const auto& txHash : arg.txs) {
+    if (blockTxs.count(txHash) == 0) {
+      logger(Logging::ERROR) << context << "sent wrong NOTIFY_REQUEST_COMPACT_BLOCK_TXS: transaction " << txHash
+        << " is not in block " << arg.block_id << ", dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return 1;
+    }
+  }
+
+  std::list<Transaction> txs;
+  std::list<crypto::Hash> missedTxs;
+  m_core.getTransactions(arg.txs, txs, missedTxs);
+  if (!missedTxs.empty()) {
+    logger(Logging::ERROR, Logging::BRIGHT_RED) << context << "can't find " << missedTxs.size() << " transactions of block " << arg.block_id;
+    return 1;
+  }
+
+  NOTIFY_NEW_BLOCK::request rsp;
+  rsp.b.block = asString(toBinaryArray(b));
+  for (const auto& tx : txs) {
+    rsp.b.txs.push_back(asString(toBinaryArray(tx)));
+  }
+  rsp.current_blockchain_height = get_current_blockchain_height() + 1;
+  rsp.hop = arg.hop;
+
+  logger(Logging::TRACE) << context << "-->>NOTIFY_NEW_BLOCK: txs.size()=" << rsp.b.txs.size();
+  post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, rsp, context);
+  return 1;
+}
+
+void CryptoNoteProtocolHandler::expireCompactBlockRequests(std::chrono::steady_clock::time_point now) {
+  std::unordered_map<net_connection_id, std::vector<NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request>, boost::hash<net_connection_id>> retries;
+  for (auto it = m_pendingCompactBlocks.begin(); it != m_pendingCompactBlocks.end();) {
+    PendingCompactBlock& pending = it->second;
+    if (m_core.have_block(it->first)) {
+      it = m_pendingCompactBlocks.erase(it);
+      continue;
+    }
+
+    if (now - pending.time < std::chrono::seconds(P2P_COMPACT_BLOCK_TXS_TIMEOUT)) {
+      ++it;
+      continue;
+    }
+
+    if (pending.announcers.empty() && pending.fullBlockRequested) {
+      // nobody answered, the block comes with regular sync
+      logger(Logging::DEBUGGING) << "Transactions of compact block " << it->first << " were not received";
+      it = m_pendingCompactBlocks.erase(it);
+      continue;
+    }
+
+    if (!pending.announcers.empty()) {
+      pending.peer = pending.announcers.front();
+      pending.announcers.pop_front();
+    }
+
+    pending.time = now;
+    pending.fullBlockRequested = true;
+
+    // asking for every transaction gets the full block back
+    NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request req;
+    req.block_id = it->first;
+    req.txs = pending.txs;
+    req.hop = pending.hop;
+    retries[pending.peer].push_back(std::move(req));
+    ++it;
+  }
+
+  if (retries.empty()) {
+    return;
+  }
+
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    auto it = retries.find(ctx.m_connection_id);
+    if (it == retries.end() || ctx.m_state != CryptoNoteConnectionContext::state_normal) {
+      return;
+    }
+
+    for (auto& req : it->second) {
+      logger(Logging::DEBUGGING) << ctx << "Compact block transactions timed out, requesting the full block " << req.block_id;
+      post_notify<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(*m_p2p, req, ctx);
+    }
+  });
+}
+
+void CryptoNoteProtocolHandler::relayNewBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection) {
+  NOTIFY_NEW_COMPACT_BLOCK::request compactBlock;
+  compactBlock.block = arg.b.block;
+  compactBlock.current_blockchain_height = arg.current_blockchain_height;
+  compactBlock.hop = arg.hop;
+  m_p2p->relay_notify_to_peers(NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(compactBlock), excludeConnection,
+    [](const CryptoNoteConnectionContext& ctx) { return ctx.version >= P2PProtocolVersion::V2; });
+
+  bool hasLegacyPeers = false;
+  m_p2p->for_each_connection([&](const CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    hasLegacyPeers = hasLegacyPeers || ctx.version < P2PProtocolVersion::V2;
+  });
+
+  if (!hasLegacyPeers) {
+    return;
+  }
+
+  // a block received in compact form carries only the transactions we were missing
+  Block b;
+  if (!fromBinaryArray(b, asBinaryArray(arg.b.block))) {
+    logger(Logging::ERROR, Logging::BRIGHT_RED) << "Failed to parse block for relay";
+    return;
+  }
+
+  if (arg.b.txs.size() != b.transactionHashes.size()) {
+    std::list<Transaction> txs;
+    std::list<crypto::Hash> missedTxs;
+    m_core.getTransactions(b.transactionHashes, txs, missedTxs);
+    if (!missedTxs.empty()) {
+      logger(Logging::ERROR, Logging::BRIGHT_RED) << "can't find " << missedTxs.size() << " transactions of block " << get_block_hash(b) << ", block is not relayed to legacy peers";
+      return;
+    }
+
+    arg.b.txs.clear();
+    for (const auto& tx : txs) {
+      arg.b.txs.push_back(asString(toBinaryArray(tx)));
+    }
+  }
+
+  m_p2p->relay_notify_to_peers(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(arg), excludeConnection,
+    [](const CryptoNoteConnectionContext& ctx) { return ctx.version < P2PProtocolVersion::V2; });
+}
 
 void CryptoNoteProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_BLOCK::ID, buf);
+  // may be called from the miner or rpc threads
+  m_dispatcher.remoteSpawn([this, arg]() mutable {
+    relayNewBlock(arg, nullptr);
+  });
 }
 
 void CryptoNoteProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buf);
+  // may be called from the rpc threads
+  m_dispatcher.remoteSpawn([this, arg]() mutable {
+    relayNewTransactions(arg, nullptr);
+  });
+}
+
+int CryptoNoteProtocolHandler::handleTxInventory(int command, NOTIFY_TX_INVENTORY::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_TX_INVENTORY: txs.size()=" << arg.txs.size();
+
+  if (context.m_state != CryptoNoteConnectionContext::state_normal) {
+    return 1;
+  }
+
+  if (arg.txs.size() > P2P_TX_INVENTORY_MAX_COUNT) {
+    logger(Logging::DEBUGGING) << context << "NOTIFY_TX_INVENTORY with " << arg.txs.size() << " transactions exceeds the limit, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  NOTIFY_REQUEST_TXS::request req;
+  size_t& inFlight = m_txRequestsInFlight[context.m_connection_id];
+  for (const auto& txHash : arg.txs) {
+    addKnownTransaction(context, txHash);
+    if (m_core.haveTransaction(txHash)) {
+      continue;
+    }
+
+    // ask only one announcer at a time, the others are remembered and asked in turn if the request times out
+    auto it = m_requestedTxs.find(txHash);
+    if (it != m_requestedTxs.end()) {
+      auto& announcers = it->second.announcers;
+      if (std::find(announcers.begin(), announcers.end(), context.m_connection_id) == announcers.end()) {
+        announcers.push_back(context.m_connection_id);
+      }
+
+      continue;
+    }
+
+    if (inFlight >= P2P_TX_MAX_REQUESTS_IN_FLIGHT) {
+      logger(Logging::DEBUGGING) << context << "Too many announced transactions are not delivered, dropping connection";
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      break;
+    }
+
+    RequestedTransaction& request = m_requestedTxs[txHash];
+    request.time = now;
+    request.peer = context.m_connection_id;
+    ++inFlight;
+    req.txs.push_back(txHash);
+  }
+
+  if (!req.txs.empty() && context.m_state == CryptoNoteConnectionContext::state_normal) {
+    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_TXS: txs.size()=" << req.txs.size();
+    post_notify<NOTIFY_REQUEST_TXS>(*m_p2p, req, context);
+  }
+
+  return 1;
+}
+
+int CryptoNoteProtocolHandler::handleRequestTxs(int command, NOTIFY_REQUEST_TXS::request& arg, CryptoNoteConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TXS: txs.size()=" << arg.txs.size();
+
+  if (arg.txs.size() > P2P_TX_INVENTORY_MAX_COUNT) {
+    logger(Logging::DEBUGGING) << context << "NOTIFY_REQUEST_TXS with " << arg.txs.size() << " transactions exceeds the limit, dropping connection";
+    context.m_state = CryptoNoteConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  std::list<Transaction> txs;
+  std::list<crypto::Hash> missedTxs;
+  m_core.getTransactions(arg.txs, txs, missedTxs, true);
+
+  if (!txs.empty()) {
+    NOTIFY_NEW_TRANSACTIONS::request rsp;
+    for (const auto& tx : txs) {
+      rsp.txs.push_back(asString(toBinaryArray(tx)));
+    }
+
+    post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, rsp, context);
+  }
+
+  return 1;
+}
+
+void CryptoNoteProtocolHandler::releaseTxRequest(const RequestedTransaction& request) {
+  auto it = m_txRequestsInFlight.find(request.peer);
+  if (it != m_txRequestsInFlight.end() && --it->second == 0) {
+    m_txRequestsInFlight.erase(it);
+  }
+}
+
+void CryptoNoteProtocolHandler::relayNewTransactions(NOTIFY_NEW_TRANSACTIONS::request& arg, const net_connection_id* excludeConnection) {
+  std::vector<crypto::Hash> txHashes;
+  txHashes.reserve(arg.txs.size());
+  for (const auto& txBlob : arg.txs) {
+    txHashes.push_back(getBinaryArrayHash(asBinaryArray(txBlob)));
+  }
+
+  // announcements are batched per connection and sent by flushTransactionAnnouncements()
+  bool hasLegacyPeers = false;
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    if (!peerId) {
+      return;
+    }
+
+    if (ctx.version < P2PProtocolVersion::V3) {
+      hasLegacyPeers = true;
+      return;
+    }
+
+    if (excludeConnection != nullptr && ctx.m_connection_id == *excludeConnection) {
+      return;
+    }
+
+    for (const auto& txHash : txHashes) {
+      if (addKnownTransaction(ctx, txHash)) {
+        ctx.m_pending_tx_announcements.push_back(txHash);
+      }
+    }
+  });
+
+  if (hasLegacyPeers) {
+    m_p2p->relay_notify_to_peers(NOTIFY_NEW_TRANSACTIONS::ID, LevinProtocol::encode(arg), excludeConnection,
+      [](const CryptoNoteConnectionContext& ctx) { return ctx.version < P2PProtocolVersion::V3; });
+  }
+}
+
+void CryptoNoteProtocolHandler::flushTransactionAnnouncements() {
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    if (ctx.m_pending_tx_announcements.empty()) {
+      return;
+    }
+
+    std::vector<crypto::Hash> txs;
+    txs.swap(ctx.m_pending_tx_announcements);
+    if (ctx.m_state != CryptoNoteConnectionContext::state_normal && ctx.m_state != CryptoNoteConnectionContext::state_synchronizing) {
+      return;
+    }
+
+    for (size_t offset = 0; offset < txs.size(); offset += P2P_TX_INVENTORY_MAX_COUNT) {
+      NOTIFY_TX_INVENTORY::request notification;
+      auto end = txs.begin() + std::min(txs.size(), offset + P2P_TX_INVENTORY_MAX_COUNT);
+      notification.txs.assign(txs.begin() + offset, end);
+      post_notify<NOTIFY_TX_INVENTORY>(*m_p2p, notification, ctx);
+    }
+  });
+
+  auto now = std::chrono::steady_clock::now();
+  std::unordered_map<net_connection_id, std::vector<crypto::Hash>, boost::hash<net_connection_id>> retries;
+  for (auto it = m_requestedTxs.begin(); it != m_requestedTxs.end();) {
+    RequestedTransaction& request = it->second;
+    if (now - request.time < std::chrono::seconds(P2P_TX_REQUEST_TIMEOUT)) {
+      ++it;
+      continue;
+    }
+
+    releaseTxRequest(request);
+    if (request.announcers.empty() || m_core.haveTransaction(it->first)) {
+      it = m_requestedTxs.erase(it);
+      continue;
+    }
+
+    request.time = now;
+    request.peer = request.announcers.front();
+    retries[request.peer].push_back(it->first);
+    request.announcers.pop_front();
+    ++it;
+  }
+
+  if (retries.empty()) {
+    return;
+  }
+
+  m_p2p->for_each_connection([&](CryptoNoteConnectionContext& ctx, PeerIdType peerId) {
+    auto it = retries.find(ctx.m_connection_id);
+    if (it == retries.end()) {
+      return;
+    }
+
+    if (ctx.m_state == CryptoNoteConnectionContext::state_normal) {
+      const std::vector<crypto::Hash>& txs = it->second;
+      logger(Logging::TRACE) << ctx << "-->>NOTIFY_REQUEST_TXS: txs.size()=" << txs.size() << ", request timed out at another peer";
+      for (size_t offset = 0; offset < txs.size(); offset += P2P_TX_INVENTORY_MAX_COUNT) {
+        NOTIFY_REQUEST_TXS::request req;
+        req.txs.assign(txs.begin() + offset, txs.begin() + std::min(txs.size(), offset + P2P_TX_INVENTORY_MAX_COUNT));
+        post_notify<NOTIFY_REQUEST_TXS>(*m_p2p, req, ctx);
+      }
+
+      m_txRequestsInFlight[ctx.m_connection_id] += txs.size();
+      retries.erase(it);
+    }
+  });
+
+  // announcers gone meanwhile are skipped, their transactions go to the next announcer on the following flush
+  for (const auto& retry : retries) {
+    for (const auto& txHash : retry.second) {
+      RequestedTransaction& request = m_requestedTxs[txHash];
+      request.time = now - std::chrono::seconds(P2P_TX_REQUEST_TIMEOUT);
+      request.peer = boost::uuids::nil_uuid();
+    }
+  }
 }
 
 void CryptoNoteProtocolHandler::requestMissingPoolTransactions(const CryptoNoteConnectionContext& context) {
@@ -5,12 +5,17 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <unordered_map>
 
 #include <common/ObserverManager.h>
 
 #include "cryptonote/core/ICore.h"
 
 #include "cryptonote/protocol/definitions.h"
+#include "cryptonote/protocol/download_scheduler.h"
 #include "cryptonote/protocol/handler_common.h"
 #include "cryptonote/protocol/i_observer.h"
 #include "cryptonote/protocol/i_query.h"
@@ -23,6 +28,7 @@
 
 namespace System {
   class Dispatcher;
+  class DispatcherPool;
 }
 
 namespace cryptonote
@@ -42,6 +48,9 @@ namespace cryptonote
     virtual bool removeObserver(ICryptoNoteProtocolObserver* observer) override;
 
     void set_p2p_endpoint(IP2pEndpoint* p2p);
+    // Decoding and verification of peer messages is executed on the pool, each connection is bound to one of its dispatchers.
+    // Without a pool everything is handled on the protocol dispatcher.
+    void setDispatcherPool(System::DispatcherPool* pool);
     // ICore& get_core() { return m_core; }
     virtual bool isSynchronized() const override { return m_synchronized; }
     void log_connections();
@@ -59,8 +68,29 @@ namespace cryptonote
     virtual size_t getPeerCount() const override;
     virtual uint32_t getObservedHeight() const override;
     void requestMissingPoolTransactions(const CryptoNoteConnectionContext& context);
+    // Sends the queued announcements and asks the next announcer for transactions whose request timed out
+    void flushTransactionAnnouncements();
+    // Asks for the full block when the missing transactions of a compact block don't arrive in time, called from on_idle
+    void expireCompactBlockRequests(std::chrono::steady_clock::time_point now);
 
   private:
+    struct RequestedTransaction {
+      std::chrono::steady_clock::time_point time;
+      net_connection_id peer; // the announcer asked last
+      std::deque<net_connection_id> announcers; // asked in turn while the transaction does not arrive
+    };
+
+    // A compact block whose missing transactions were requested. If they don't arrive in time, the whole
+    // block is requested from the other announcers and at last from the first one again.
+    struct PendingCompactBlock {
+      std::chrono::steady_clock::time_point time;
+      net_connection_id peer;
+      std::vector<crypto::Hash> txs; // all transactions of the block
+      uint32_t hop;
+      bool fullBlockRequested;
+      std::deque<net_connection_id> announcers;
+    };
+
     //----------------- commands handlers ----------------------------------------------
     int handle_notify_new_block(int command, NOTIFY_NEW_BLOCK::request& arg, CryptoNoteConnectionContext& context);
     int handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, CryptoNoteConnectionContext& context);
@@ -69,23 +99,38 @@ namespace cryptonote
     int handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, CryptoNoteConnectionContext& context);
     int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, CryptoNoteConnectionContext& context);
     int handleRequestTxPool(int command, NOTIFY_REQUEST_TX_POOL::request& arg, CryptoNoteConnectionContext& context);
+    int handleNotifyNewCompactBlock(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, CryptoNoteConnectionContext& context);
+    int handleRequestCompactBlockTxs(int command, NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request& arg, CryptoNoteConnectionContext& context);
+    int handleTxInventory(int command, NOTIFY_TX_INVENTORY::request& arg, CryptoNoteConnectionContext& context);
+    int handleRequestTxs(int command, NOTIFY_REQUEST_TXS::request& arg, CryptoNoteConnectionContext& context);
+    void releaseTxRequest(const RequestedTransaction& request);
 
     //----------------- ICryptonoteProtocol ----------------------------------
     virtual void relay_block(NOTIFY_NEW_BLOCK::request& arg) override;
     virtual void relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg) override;
 
     //----------------------------------------------------------------------------------
+    template <typename Command, typename Handler>
+    int notifyAdaptor(const BinaryArray& reqBuf, CryptoNoteConnectionContext& ctx, Handler handler);
+    template <typename T>
+    T runOnShard(const CryptoNoteConnectionContext& context, std::function<T()>&& operation);
+
     uint32_t get_current_blockchain_height();
-    bool request_missing_objects(CryptoNoteConnectionContext& context, bool check_having_blocks);
+    bool request_missing_objects(CryptoNoteConnectionContext& context);
+    void requestChain(CryptoNoteConnectionContext& context);
+    void applyDownloadedBlocks(CryptoNoteConnectionContext& context);
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext& context);
     void recalculateMaxObservedHeight(const CryptoNoteConnectionContext& context);
-    int processObjects(CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks);
+    int processObjects(const CryptoNoteConnectionContext& context, const std::vector<block_complete_entry>& blocks);
+    void relayNewBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection);
+    void relayNewTransactions(NOTIFY_NEW_TRANSACTIONS::request& arg, const net_connection_id* excludeConnection);
     Logging::LoggerRef logger;
 
   private:
 
     System::Dispatcher& m_dispatcher;
+    System::DispatcherPool* m_dispatcherPool;
     ICore& m_core;
     const Currency& m_currency;
 
@@ -98,6 +143,14 @@ namespace cryptonote
     uint32_t m_observedHeight;
 
     std::atomic<size_t> m_peersCount;
+    std::unordered_map<crypto::Hash, RequestedTransaction> m_requestedTxs;
+    std::unordered_map<net_connection_id, size_t, boost::hash<net_connection_id>> m_txRequestsInFlight;
+    std::unordered_map<crypto::Hash, PendingCompactBlock> m_pendingCompactBlocks;
+
+    // Blocks are downloaded from all synchronizing connections and added to the core in height order
+    BlockDownloadScheduler m_downloads;
+    std::unordered_map<net_connection_id, std::chrono::steady_clock::time_point, boost::hash<net_connection_id>> m_chainRequests;
+    bool m_applyingBlocks;
     Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
   };
 }
@@ -16,6 +16,7 @@
 #include "command_line/CoreConfig.h"
 #include "cryptonote/core/CryptoNoteTools.h"
 #include "cryptonote/core/Currency.h"
+#include "cryptonote/core/WalletScanService.h"
 #include "command_line/MinerConfig.h"
 #include "cryptonote/protocol/handler.h"
 #include "p2p/NetNode.h"
@@ -151,6 +152,10 @@ int main(int argc, char* argv[])
     coreConfig.checkDataDir();
     cli.parseConfigFile();
 
+#ifdef __linux__
+    System::Dispatcher::setIoUringEnabled(get_arg(vm, arg_io_uring));
+#endif
+
     System::Dispatcher dispatcher;
 
     cryptonote::CryptoNoteProtocolHandler cprotocol(currency, dispatcher, ccore, nullptr, logManager);
@@ -184,6 +189,18 @@ int main(int argc, char* argv[])
     }
     logger(INFO) << "Core initialized OK";
 
+    std::unique_ptr<WalletScanService> walletScanService;
+    if (get_arg(vm, arg_enable_wallet_scan)) {
+      std::string walletScanFile = (fs::path(coreConfig.configFolder) / parameters::CRYPTONOTE_WALLET_SCAN_FILENAME).string();
+      walletScanService.reset(new WalletScanService(ccore, logManager, walletScanFile));
+      if (!walletScanService->init()) {
+        logger(ERROR, BRIGHT_RED) << "Failed to initialize wallet scan service";
+        return 1;
+      }
+
+      rpcServer.setWalletScanService(walletScanService.get());
+    }
+
     // start components
     if (!has_arg(vm, arg_console)) {
       dch.start_handling();
@@ -208,6 +225,11 @@ int main(int argc, char* argv[])
     logger(INFO) << "Stopping core rpc server...";
     rpcServer.stop();
 
+    if (walletScanService) {
+      logger(INFO) << "Stopping wallet scan service...";
+      walletScanService->deinit();
+    }
+
     //deinitialize components
     logger(INFO) << "Deinitializing core...";
     ccore.deinit();
@@ -26,6 +26,7 @@ namespace cryptonote {
 
 HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::string& status) {
   if (status == "200 OK" || status == "200 Ok") return cryptonote::HttpResponse::STATUS_200;
+  else if (status == "403 Forbidden") return cryptonote::HttpResponse::STATUS_403;
   else if (status == "404 Not Found") return cryptonote::HttpResponse::STATUS_404;
   else if (status == "500 Internal Server Error") return cryptonote::HttpResponse::STATUS_500;
   else throw std::system_error(make_error_code(cryptonote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL),
@@ -12,6 +12,8 @@ const char* getStatusString(cryptonote::HttpResponse::HTTP_STATUS status) {
   switch (status) {
   case cryptonote::HttpResponse::STATUS_200:
     return "200 OK";
+  case cryptonote::HttpResponse::STATUS_403:
+    return "403 Forbidden";
   case cryptonote::HttpResponse::STATUS_404:
     return "404 Not Found";
   case cryptonote::HttpResponse::STATUS_500:
@@ -25,6 +27,8 @@ const char* getStatusString(cryptonote::HttpResponse::HTTP_STATUS status) {
 
 const char* getErrorBody(cryptonote::HttpResponse::HTTP_STATUS status) {
   switch (status) {
+  case cryptonote::HttpResponse::STATUS_403:
+    return "Requested url is not available to this client\n";
   case cryptonote::HttpResponse::STATUS_404:
     return "Requested url is not found\n";
   case cryptonote::HttpResponse::STATUS_500:
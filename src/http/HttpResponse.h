@@ -14,6 +14,7 @@ namespace cryptonote {
   public:
     enum HTTP_STATUS {
       STATUS_200,
+      STATUS_403,
       STATUS_404,
       STATUS_500
     };
@@ -10,6 +10,7 @@
 #include <system/Timer.h>
 #include <system/InterruptedException.h>
 
+#include "CryptoNoteConfig.h"
 #include "rpc/CoreRpcServerCommandsDefinitions.h"
 #include "rpc/JsonRpc.h"
 #include "rpc/HttpClient.h"
@@ -20,6 +21,7 @@ BlockchainMonitor::BlockchainMonitor(System::Dispatcher& dispatcher, const std::
   m_daemonPort(daemonPort),
   m_pollingInterval(pollingInterval),
   m_stopped(false),
+  m_waitUpdateSupported(true),
   m_httpEvent(dispatcher),
   m_sleepingContext(dispatcher),
   m_logger(logger, "BlockchainMonitor") {
@@ -34,14 +36,26 @@ void BlockchainMonitor::waitBlockchainUpdate() {
   crypto::Hash lastBlockHash = requestLastBlockHash();
 
   while(!m_stopped) {
-    m_sleepingContext.spawn([this] () {
-      System::Timer timer(m_dispatcher);
-      timer.sleep(std::chrono::seconds(m_pollingInterval));
+    crypto::Hash blockHash;
+    bool waited = false;
+    m_sleepingContext.spawn([this, &lastBlockHash, &blockHash, &waited] () {
+      waited = waitLastBlockHash(lastBlockHash, blockHash);
+      if (!waited) {
+        System::Timer timer(m_dispatcher);
+        timer.sleep(std::chrono::seconds(m_pollingInterval));
+      }
     });
 
     m_sleepingContext.wait();
+    if (m_stopped) {
+      break;
+    }
 
-    if (lastBlockHash != requestLastBlockHash()) {
+    if (!waited) {
+      blockHash = requestLastBlockHash();
+    }
+
+    if (lastBlockHash != blockHash) {
       m_logger(Logging::DEBUGGING) << "Blockchain has been updated";
       break;
     }
@@ -61,6 +75,56 @@ void BlockchainMonitor::stop() {
   m_sleepingContext.wait();
 }
 
+// Long polls the daemon until its top block differs from lastBlockHash. Returns false if the daemon doesn't
+// support it or the request failed, the caller polls the last block hash then.
+bool BlockchainMonitor::waitLastBlockHash(const crypto::Hash& lastBlockHash, crypto::Hash& blockHash) {
+  if (!m_waitUpdateSupported) {
+    return false;
+  }
+
+  try {
+    cryptonote::HttpClient client(m_dispatcher, m_daemonHost, m_daemonPort);
+
+    cryptonote::COMMAND_RPC_WAIT_UPDATE::request request;
+    request.last_block_hash = Common::podToHex(lastBlockHash);
+    request.pool_version = 0;
+    request.watch_pool = false;
+    request.timeout = cryptonote::COMMAND_RPC_WAIT_UPDATE_MAX_TIMEOUT;
+
+    cryptonote::HttpRequest httpRequest;
+    cryptonote::HttpResponse httpResponse;
+    httpRequest.setUrl("/wait_update");
+    httpRequest.setBody(cryptonote::storeToJson(request));
+    client.request(httpRequest, httpResponse);
+
+    if (httpResponse.getStatus() == cryptonote::HttpResponse::STATUS_404) {
+      m_logger(Logging::INFO) << "Daemon doesn't support update subscription, polling it every " << m_pollingInterval << " seconds";
+      m_waitUpdateSupported = false;
+      return false;
+    }
+
+    cryptonote::COMMAND_RPC_WAIT_UPDATE::response response;
+    if (httpResponse.getStatus() != cryptonote::HttpResponse::STATUS_200 || !cryptonote::loadFromJson(response, httpResponse.getBody())) {
+      throw std::runtime_error("Wrong response");
+    }
+
+    if (response.status != CORE_RPC_STATUS_OK) {
+      throw std::runtime_error("Core responded with wrong status: " + response.status);
+    }
+
+    if (!Common::podFromHex(response.block_hash, blockHash)) {
+      throw std::runtime_error("Couldn't parse block hash: " + response.block_hash);
+    }
+
+    return true;
+  } catch (System::InterruptedException&) {
+    throw;
+  } catch (std::exception& e) {
+    m_logger(Logging::WARNING) << "Failed to wait for blockchain update: " << e.what();
+    return false;
+  }
+}
+
 crypto::Hash BlockchainMonitor::requestLastBlockHash() {
   m_logger(Logging::DEBUGGING) << "Requesting last block hash";
 
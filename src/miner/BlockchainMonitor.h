@@ -24,10 +24,12 @@ private:
   uint16_t m_daemonPort;
   size_t m_pollingInterval;
   bool m_stopped;
+  bool m_waitUpdateSupported;
   System::Event m_httpEvent;
   System::ContextGroup m_sleepingContext;
 
   Logging::LoggerRef m_logger;
 
   crypto::Hash requestLastBlockHash();
+  bool waitLastBlockHash(const crypto::Hash& lastBlockHash, crypto::Hash& blockHash);
 };
@@ -6,7 +6,9 @@
 
 #include <functional>
 
+#include "common/ScopeExit.h"
 #include "crypto/crypto.h"
+#include "crypto/hash.h"
 #include "cryptonote/core/CryptoNoteFormatUtils.h"
 
 #include <system/InterruptedException.h>
@@ -17,6 +19,7 @@ Miner::Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
   m_dispatcher(dispatcher),
   m_miningStopped(dispatcher),
   m_state(MiningState::MINING_STOPPED),
+  m_threadHashesCount(0),
   m_logger(logger, "Miner") {
 }
 
@@ -24,7 +27,7 @@ Miner::~Miner() {
   assert(m_state != MiningState::MINING_IN_PROGRESS);
 }
 
-Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount) {
+bool Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount, Block& block) {
   if (threadCount == 0) {
     throw std::runtime_error("Miner requires at least one thread");
   }
@@ -33,6 +36,11 @@ Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t thr
     throw std::runtime_error("Mining is already in progress");
   }
 
+  if (threadCount != m_threadHashesCount) {
+    m_threadHashes.reset(new ThreadHashes[threadCount]());
+    m_threadHashesCount = threadCount;
+  }
+
   m_state = MiningState::MINING_IN_PROGRESS;
   m_miningStopped.clear();
 
@@ -44,8 +52,14 @@ Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t thr
     throw System::InterruptedException();
   }
 
+  if (m_state == MiningState::NONCES_EXHAUSTED) {
+    m_logger(Logging::DEBUGGING) << "Nonce range has been exhausted";
+    return false;
+  }
+
   assert(m_state == MiningState::BLOCK_FOUND);
-  return m_block;
+  block = m_block;
+  return true;
 }
 
 void Miner::stop() {
@@ -57,17 +71,42 @@ void Miner::stop() {
   }
 }
 
+void Miner::setThreadCpus(const std::vector<Common::CpuInfo>& cpus) {
+  m_threadCpus = cpus;
+}
+
+std::vector<uint64_t> Miner::getThreadHashes() const {
+  std::vector<uint64_t> hashes;
+  for (size_t i = 0; i < m_threadHashesCount; ++i) {
+    hashes.push_back(m_threadHashes[i].hashes.load(std::memory_order_relaxed));
+  }
+
+  return hashes;
+}
+
 void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount) {
   assert(threadCount > 0);
 
   m_logger(Logging::INFO) << "Starting mining for difficulty " << blockMiningParameters.difficulty;
 
   try {
-    blockMiningParameters.blockTemplate.nonce = crypto::rand<uint32_t>();
+    if (blockMiningParameters.nonceCount == 0) {
+      blockMiningParameters.blockTemplate.nonce = crypto::rand<uint32_t>();
+    }
 
     for (size_t i = 0; i < threadCount; ++i) {
+      uint32_t nonceCount = 0;
+      if (blockMiningParameters.nonceCount != 0) {
+        if (i >= blockMiningParameters.nonceCount) {
+          break;
+        }
+
+        // every thread tries each threadCount-th nonce of the range
+        nonceCount = static_cast<uint32_t>((static_cast<uint64_t>(blockMiningParameters.nonceCount) - i + threadCount - 1) / threadCount);
+      }
+
       m_workers.emplace_back(std::unique_ptr<System::RemoteContext<void>> (
-        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, blockMiningParameters.difficulty, threadCount)))
+        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, i, blockMiningParameters.blockTemplate, blockMiningParameters.difficulty, threadCount, nonceCount)))
       );
 
       blockMiningParameters.blockTemplate.nonce++;
@@ -75,6 +114,9 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
 
     m_workers.clear();
 
+    MiningState state = MiningState::MINING_IN_PROGRESS;
+    m_state.compare_exchange_strong(state, MiningState::NONCES_EXHAUSTED);
+
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Error occured during mining: " << e.what();
     m_state = MiningState::MINING_STOPPED;
@@ -83,9 +125,19 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
   m_miningStopped.set();
 }
 
-void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep) {
+void Miner::workerFunc(size_t threadIndex, const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep, uint32_t nonceCount) {
+  if (threadIndex < m_threadCpus.size() && !Common::setThreadAffinity(m_threadCpus[threadIndex].cpu)) {
+    m_logger(Logging::WARNING) << "Failed to bind mining thread " << threadIndex << " to cpu " << m_threadCpus[threadIndex].cpu;
+  }
+
+  // Every run gets a new thread, its scratchpad is allocated after binding to be placed on the NUMA node of the thread
+  crypto::slow_hash_allocate_state();
+  Tools::ScopeExit freeState([] { crypto::slow_hash_free_state(); });
+  m_logger(Logging::DEBUGGING) << "Mining thread " << threadIndex << " scratchpad is " << (crypto::slow_hash_huge_pages() ? "on a huge page" : "on regular pages");
+
   try {
     Block block = blockTemplate;
+    uint32_t noncesLeft = nonceCount;
 
     while (m_state == MiningState::MINING_IN_PROGRESS) {
       crypto::Hash hash;
@@ -96,8 +148,11 @@ void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, u
         return;
       }
 
+      m_threadHashes[threadIndex].hashes.fetch_add(1, std::memory_order_relaxed);
+
       if (check_hash(hash, difficulty)) {
-        m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+        // in job mode every share is found this way, the server logs the blocks
+        m_logger(nonceCount != 0 ? Logging::DEBUGGING : Logging::INFO) << "Found block for difficulty " << difficulty;
 
         if (!setStateBlockFound()) {
           m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
@@ -108,6 +163,10 @@ void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, u
         return;
       }
 
+      if (nonceCount != 0 && --noncesLeft == 0) {
+        return;
+      }
+
       block.nonce += nonceStep;
     }
   } catch (std::exception& e) {
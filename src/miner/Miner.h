@@ -5,12 +5,15 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include <system/Dispatcher.h>
 #include <system/Event.h>
 #include <system/RemoteContext.h>
 
+#include "common/CpuAffinity.h"
 #include "cryptonote.h"
 #include "cryptonote/core/Difficulty.h"
 
@@ -21,6 +24,8 @@ namespace cryptonote {
 struct BlockMiningParameters {
   Block blockTemplate;
   difficulty_type difficulty;
+  // nonces from blockTemplate.nonce to blockTemplate.nonce + nonceCount - 1 are tried, 0 means all nonces from a random one
+  uint32_t nonceCount;
 };
 
 class Miner {
@@ -28,26 +33,42 @@ public:
   Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger);
   ~Miner();
 
-  Block mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount);
+  // Returns false if no nonce of the range gives a hash of the difficulty, throws InterruptedException if stopped
+  bool mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount, Block& block);
 
   //NOTE! this is blocking method
   void stop();
 
+  // The i-th thread is bound to the i-th processor, threads without a processor are not bound
+  void setThreadCpus(const std::vector<Common::CpuInfo>& cpus);
+  // Hashes computed by each thread since the thread count changed last time, may be called while mining
+  std::vector<uint64_t> getThreadHashes() const;
+
 private:
   System::Dispatcher& m_dispatcher;
   System::Event m_miningStopped;
 
-  enum class MiningState : uint8_t { MINING_STOPPED, BLOCK_FOUND, MINING_IN_PROGRESS};
+  enum class MiningState : uint8_t { MINING_STOPPED, BLOCK_FOUND, MINING_IN_PROGRESS, NONCES_EXHAUSTED };
   std::atomic<MiningState> m_state;
 
   std::vector<std::unique_ptr<System::RemoteContext<void>>>  m_workers;
+  std::vector<Common::CpuInfo> m_threadCpus;
+
+  // Every thread counts its hashes in its own cache line, a shared counter would bounce between the processors
+  struct ThreadHashes {
+    std::atomic<uint64_t> hashes;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  std::unique_ptr<ThreadHashes[]> m_threadHashes;
+  size_t m_threadHashesCount;
 
   Block m_block;
 
   Logging::LoggerRef m_logger;
 
   void runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount);
-  void workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep);
+  void workerFunc(size_t threadIndex, const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep, uint32_t nonceCount);
   bool setStateBlockFound();
 };
 
@@ -4,8 +4,17 @@
 
 #include "MinerManager.h"
 
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include <boost/utility/value_init.hpp>
+
 #include <system/EventLock.h>
 #include <system/InterruptedException.h>
+#include <system/Ipv4Resolver.h>
+#include <system/Ipv4Address.h>
+#include <system/TcpConnector.h>
 #include <system/Timer.h>
 
 #include "common/StringTools.h"
@@ -46,9 +55,14 @@ MinerManager::MinerManager(System::Dispatcher& dispatcher, const cryptonote::Min
   m_blockchainMonitor(dispatcher, m_config.daemonHost, m_config.daemonPort, m_config.scanPeriod, logger),
   m_eventOccurred(dispatcher),
   m_httpEvent(dispatcher),
-  m_lastBlockTimestamp(0) {
+  m_lastBlockTimestamp(0),
+  m_jobServerConnected(false),
+  m_jobServerEvent(dispatcher),
+  m_jobSequence(0) {
 
   m_httpEvent.set();
+  m_jobServerEvent.set();
+  m_miner.setThreadCpus(m_config.threadCpus);
 }
 
 MinerManager::~MinerManager() {
@@ -57,6 +71,17 @@ MinerManager::~MinerManager() {
 void MinerManager::start() {
   m_logger(Logging::DEBUGGING) << "starting";
 
+  for (size_t i = 0; i < m_config.threadCpus.size(); ++i) {
+    m_logger(Logging::INFO) << "Mining thread " << i << " is bound to cpu " << m_config.threadCpus[i].cpu << ", NUMA node " << m_config.threadCpus[i].node;
+  }
+
+  startHashrateReporting();
+
+  if (!m_config.jobServerHost.empty()) {
+    receiveJobs();
+    return;
+  }
+
   BlockMiningParameters params;
   for (;;) {
     m_logger(Logging::INFO) << "requesting mining parameters";
@@ -148,8 +173,9 @@ void MinerManager::pushEvent(MinerEvent&& event) {
 void MinerManager::startMining(const cryptonote::BlockMiningParameters& params) {
   m_contextGroup.spawn([this, params] () {
     try {
-      m_minedBlock = m_miner.mine(params, m_config.threadCount);
-      pushEvent(BlockMinedEvent());
+      if (m_miner.mine(params, m_config.threadCount, m_minedBlock)) {
+        pushEvent(BlockMinedEvent());
+      }
     } catch (System::InterruptedException&) {
     } catch (std::exception& e) {
       m_logger(Logging::ERROR) << "Miner context unexpectedly finished: " << e.what();
@@ -177,6 +203,63 @@ void MinerManager::stopBlockchainMonitoring() {
   m_blockchainMonitor.stop();
 }
 
+void MinerManager::startHashrateReporting() {
+  if (m_config.hashrateInterval == 0) {
+    return;
+  }
+
+  m_contextGroup.spawn([this] () {
+    try {
+      std::vector<uint64_t> lastHashes = m_miner.getThreadHashes();
+      auto lastTime = std::chrono::steady_clock::now();
+      for (;;) {
+        System::Timer timer(m_dispatcher);
+        timer.sleep(std::chrono::seconds(m_config.hashrateInterval));
+
+        std::vector<uint64_t> hashes = m_miner.getThreadHashes();
+        auto now = std::chrono::steady_clock::now();
+        reportHashrate(lastHashes, hashes, std::chrono::duration_cast<std::chrono::milliseconds>(now - lastTime).count());
+        lastHashes = std::move(hashes);
+        lastTime = now;
+      }
+    } catch (System::InterruptedException&) {
+    } catch (std::exception& e) {
+      m_logger(Logging::ERROR) << "Hashrate reporting context unexpectedly finished: " << e.what();
+    }
+  });
+}
+
+void MinerManager::reportHashrate(const std::vector<uint64_t>& lastHashes, const std::vector<uint64_t>& hashes, uint64_t milliseconds) {
+  if (lastHashes.size() != hashes.size() || milliseconds == 0) {
+    // the counters were recreated for another thread count
+    return;
+  }
+
+  double totalHashrate = 0;
+  std::map<uint32_t, double> nodeHashrates;
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    double hashrate = static_cast<double>(hashes[i] - lastHashes[i]) * 1000 / milliseconds;
+    totalHashrate += hashrate;
+
+    if (i < m_config.threadCpus.size()) {
+      nodeHashrates[m_config.threadCpus[i].node] += hashrate;
+      m_logger(Logging::DEBUGGING) << "Thread " << i << " on cpu " << m_config.threadCpus[i].cpu << ": " << std::fixed << std::setprecision(2) << hashrate << " H/s";
+    } else {
+      m_logger(Logging::DEBUGGING) << "Thread " << i << ": " << std::fixed << std::setprecision(2) << hashrate << " H/s";
+    }
+  }
+
+  std::ostringstream report;
+  report << "Hashrate " << std::fixed << std::setprecision(2) << totalHashrate << " H/s";
+  if (nodeHashrates.size() > 1) {
+    for (const auto& node : nodeHashrates) {
+      report << ", node " << node.first << ": " << node.second << " H/s";
+    }
+  }
+
+  m_logger(Logging::INFO) << report.str();
+}
+
 bool MinerManager::submitBlock(const Block& minedBlock, const std::string& daemonHost, uint16_t daemonPort) {
   try {
     HttpClient client(m_dispatcher, daemonHost, daemonPort);
@@ -216,6 +299,7 @@ BlockMiningParameters MinerManager::requestMiningParameters(System::Dispatcher&
 
     BlockMiningParameters params;
     params.difficulty = response.difficulty;
+    params.nonceCount = 0;
 
     if(!fromBinaryArray(params.blockTemplate, Common::fromHex(response.blocktemplate_blob))) {
       throw std::runtime_error("Couldn't deserialize block template");
@@ -243,4 +327,142 @@ void MinerManager::adjustBlockTemplate(cryptonote::Block& blockTemplate) const {
   }
 }
 
+void MinerManager::receiveJobs() {
+  for (;;) {
+    try {
+      m_logger(Logging::INFO) << "connecting to job server " << m_config.jobServerHost << ":" << m_config.jobServerPort;
+
+      auto address = System::Ipv4Resolver(m_dispatcher).resolve(m_config.jobServerHost);
+      m_jobServerConnection = System::TcpConnector(m_dispatcher).connect(address, m_config.jobServerPort);
+      m_jobServerConnected = true;
+
+      MiningConnection connection(m_jobServerConnection);
+      for (;;) {
+        JsonRpc::JsonRpcRequest message;
+        if (!connection.readMessage(message)) {
+          m_logger(Logging::WARNING) << "Job server closed connection";
+          break;
+        }
+
+        processJobServerMessage(message);
+      }
+    } catch (System::InterruptedException&) {
+      throw;
+    } catch (std::exception& e) {
+      m_logger(Logging::WARNING) << "Job server connection error: " << e.what();
+    }
+
+    {
+      System::EventLock lk(m_jobServerEvent);
+      m_jobServerConnected = false;
+      m_jobServerConnection = System::TcpConnection();
+    }
+
+    // the server sends a new job on reconnect
+    ++m_jobSequence;
+    stopMining();
+
+    System::Timer timer(m_dispatcher);
+    timer.sleep(std::chrono::seconds(m_config.scanPeriod));
+  }
+}
+
+void MinerManager::processJobServerMessage(const JsonRpc::JsonRpcRequest& message) {
+  if (message.getMethod() == MINING_METHOD_JOB) {
+    MiningJob job = boost::value_initialized<MiningJob>();
+    message.loadParams(job);
+
+    BlockMiningParameters params;
+    if (!fromBinaryArray(params.blockTemplate, Common::fromHex(job.blob))) {
+      throw std::runtime_error("Couldn't deserialize job blob");
+    }
+
+    params.blockTemplate.nonce = job.nonce_start;
+    params.difficulty = job.difficulty;
+    params.nonceCount = job.nonce_count;
+
+    m_logger(Logging::DEBUGGING) << "Got job " << job.job_id << " for height " << job.height << ", nonces " << job.nonce_start <<
+      ".." << static_cast<uint64_t>(job.nonce_start) + job.nonce_count - 1;
+
+    stopMining();
+    startJobMining(job.job_id, ++m_jobSequence, params);
+  } else if (message.getMethod() == MINING_METHOD_RESULT) {
+    MiningShareResult result = boost::value_initialized<MiningShareResult>();
+    message.loadParams(result);
+
+    if (result.status == MINING_SHARE_STATUS_OUTDATED_JOB) {
+      // the top block changed while the share was sent
+      m_logger(Logging::DEBUGGING) << "Share has been rejected: " << result.status;
+    } else if (result.status != MINING_SHARE_STATUS_OK) {
+      m_logger(Logging::WARNING) << "Share has been rejected: " << result.status;
+    } else if (result.block) {
+      m_logger(Logging::INFO) << "Share has been submitted as block by job server";
+    } else {
+      m_logger(Logging::DEBUGGING) << "Share has been accepted";
+    }
+  } else {
+    m_logger(Logging::WARNING) << "Unknown job server message: " << message.getMethod();
+  }
+}
+
+void MinerManager::startJobMining(uint64_t jobId, uint64_t jobSequence, const BlockMiningParameters& params) {
+  m_contextGroup.spawn([this, jobId, jobSequence, params] () {
+    try {
+      BlockMiningParameters rangeParams = params;
+      Block block;
+      // another job may come before the context starts or while a share is sent
+      while (jobSequence == m_jobSequence && m_miner.mine(rangeParams, m_config.threadCount, block)) {
+        submitShare(jobId, block);
+
+        // go on after the found nonce
+        uint32_t tried = block.nonce - rangeParams.blockTemplate.nonce + 1;
+        if (tried >= rangeParams.nonceCount) {
+          break;
+        }
+
+        rangeParams.blockTemplate.nonce = block.nonce + 1;
+        rangeParams.nonceCount -= tried;
+      }
+
+      if (jobSequence == m_jobSequence) {
+        MiningGetJob request;
+        request.job_id = jobId;
+        sendToJobServer(makeMiningMessage(MINING_METHOD_GET_JOB, request));
+      }
+    } catch (System::InterruptedException&) {
+    } catch (std::exception& e) {
+      m_logger(Logging::ERROR) << "Miner context unexpectedly finished: " << e.what();
+    }
+  });
+}
+
+void MinerManager::submitShare(uint64_t jobId, const Block& block) {
+  crypto::Hash hash;
+  if (!get_block_longhash(block, hash)) {
+    m_logger(Logging::ERROR) << "Couldn't calculate share hash";
+    return;
+  }
+
+  MiningShare share;
+  share.job_id = jobId;
+  share.nonce = block.nonce;
+  share.hash = Common::podToHex(hash);
+  sendToJobServer(makeMiningMessage(MINING_METHOD_SUBMIT, share));
+}
+
+void MinerManager::sendToJobServer(const std::string& message) {
+  if (!m_jobServerConnected) {
+    return;
+  }
+
+  try {
+    System::EventLock lk(m_jobServerEvent);
+    MiningConnection(m_jobServerConnection).writeMessage(message);
+  } catch (System::InterruptedException&) {
+    throw;
+  } catch (std::exception& e) {
+    m_logger(Logging::WARNING) << "Couldn't send to job server: " << e.what();
+  }
+}
+
 } //namespace Miner
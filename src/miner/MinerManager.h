@@ -8,12 +8,14 @@
 
 #include <system/ContextGroup.h>
 #include <system/Event.h>
+#include <system/TcpConnection.h>
 
 #include "BlockchainMonitor.h"
 #include "logging/LoggerRef.h"
 #include "Miner.h"
 #include "MinerEvent.h"
 #include "MiningConfig.h"
+#include "MiningProtocol.h"
 
 namespace System {
 class Dispatcher;
@@ -44,6 +46,11 @@ private:
 
   uint64_t m_lastBlockTimestamp;
 
+  System::TcpConnection m_jobServerConnection;
+  bool m_jobServerConnected;
+  System::Event m_jobServerEvent;
+  uint64_t m_jobSequence; // changed on every received job, mining contexts of older ones quit
+
   void eventLoop();
   MinerEvent waitEvent();
   void pushEvent(MinerEvent&& event);
@@ -54,10 +61,20 @@ private:
   void startBlockchainMonitoring();
   void stopBlockchainMonitoring();
 
+  void startHashrateReporting();
+  void reportHashrate(const std::vector<uint64_t>& lastHashes, const std::vector<uint64_t>& hashes, uint64_t milliseconds);
+
   bool submitBlock(const cryptonote::Block& minedBlock, const std::string& daemonHost, uint16_t daemonPort);
   cryptonote::BlockMiningParameters requestMiningParameters(System::Dispatcher& dispatcher, const std::string& daemonHost, uint16_t daemonPort, const std::string& miningAddress);
 
   void adjustBlockTemplate(cryptonote::Block& blockTemplate) const;
+
+  // Mines the jobs of a job server instead of the block templates of the daemon
+  void receiveJobs();
+  void processJobServerMessage(const cryptonote::JsonRpc::JsonRpcRequest& message);
+  void startJobMining(uint64_t jobId, uint64_t jobSequence, const cryptonote::BlockMiningParameters& params);
+  void submitShare(uint64_t jobId, const cryptonote::Block& block);
+  void sendToJobServer(const std::string& message);
 };
 
 } //namespace Miner
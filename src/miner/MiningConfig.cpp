@@ -22,35 +22,37 @@ namespace cryptonote {
 namespace {
 
 const size_t DEFAULT_SCANT_PERIOD = 30;
+const size_t DEFAULT_HASHRATE_INTERVAL = 60;
 const char* DEFAULT_DAEMON_HOST = "127.0.0.1";
+const char* DEFAULT_JOB_SERVER_BIND_IP = "0.0.0.0";
 const size_t CONCURRENCY_LEVEL = std::thread::hardware_concurrency();
 
 po::options_description cmdOptions;
 
-void parseDaemonAddress(const std::string& daemonAddress, std::string& daemonHost, uint16_t& daemonPort) {
+void parseAddress(const std::string& address, const std::string& addressName, std::string& host, uint16_t& port) {
   std::vector<std::string> splittedAddress;
-  boost::algorithm::split(splittedAddress, daemonAddress, boost::algorithm::is_any_of(":"));
+  boost::algorithm::split(splittedAddress, address, boost::algorithm::is_any_of(":"));
 
   if (splittedAddress.size() != 2) {
-    throw std::runtime_error("Wrong daemon address format");
+    throw std::runtime_error("Wrong " + addressName + " address format");
   }
 
   if (splittedAddress[0].empty() || splittedAddress[1].empty()) {
-    throw std::runtime_error("Wrong daemon address format");
+    throw std::runtime_error("Wrong " + addressName + " address format");
   }
 
-  daemonHost = splittedAddress[0];
+  host = splittedAddress[0];
 
   try {
-    daemonPort = boost::lexical_cast<uint16_t>(splittedAddress[1]);
+    port = boost::lexical_cast<uint16_t>(splittedAddress[1]);
   } catch (std::exception&) {
-    throw std::runtime_error("Wrong daemon address format");
+    throw std::runtime_error("Wrong " + addressName + " address format");
   }
 }
 
 }
 
-MiningConfig::MiningConfig(): help(false) {
+MiningConfig::MiningConfig(): jobServerBindPort(0), jobServerPort(0), shareDifficulty(0), help(false) {
   cmdOptions.add_options()
       ("help,h", "produce this help message and exit")
       ("address", po::value<std::string>(), "Valid cryptonote miner's address")
@@ -58,12 +60,19 @@ MiningConfig::MiningConfig(): help(false) {
       ("daemon-rpc-port", po::value<uint16_t>()->default_value(static_cast<uint16_t>(RPC_DEFAULT_PORT)), "Daemon's RPC port")
       ("daemon-address", po::value<std::string>(), "Daemon host:port. If you use this option you must not use --daemon-host and --daemon-port options")
       ("threads", po::value<size_t>()->default_value(CONCURRENCY_LEVEL), "Mining threads count. Must not be greater than you concurrency level. Default value is your hardware concurrency level")
+      ("cpu-affinity", po::value<std::string>(), "Bind mining threads to processors. \"auto\" spreads them over NUMA nodes, a list like 0-3,8 names the processors")
+      ("hashrate-interval", po::value<size_t>()->default_value(DEFAULT_HASHRATE_INTERVAL), "Hashrate report interval (seconds). 0 disables the reports")
       ("scan-time", po::value<size_t>()->default_value(DEFAULT_SCANT_PERIOD), "Blockchain polling interval (seconds). How often miner will check blockchain for updates")
       ("log-level", po::value<int>()->default_value(1), "Log level. Must be 0..5")
       ("limit", po::value<size_t>()->default_value(0), "Mine exact quantity of blocks. 0 means no limit")
       ("first-block-timestamp", po::value<uint64_t>()->default_value(0), "Set timestamp to the first mined block. 0 means leave timestamp unchanged")
       ("block-timestamp-interval", po::value<int64_t>()->default_value(0), "Timestamp step for each subsequent block. May be set only if --first-block-timestamp has been set."
-                                                         " If not set blocks' timestamps remain unchanged");
+                                                         " If not set blocks' timestamps remain unchanged")
+      ("job-server-bind-ip", po::value<std::string>()->default_value(DEFAULT_JOB_SERVER_BIND_IP), "Interface for the job server")
+      ("job-server-bind-port", po::value<uint16_t>()->default_value(0), "Serve block templates of the daemon to miners connecting to this port instead of mining. 0 means mine")
+      ("share-difficulty", po::value<uint64_t>()->default_value(0), "Difficulty of the shares the job server accepts. 0 or a value above the block difficulty means only blocks")
+      ("job-server", po::value<std::string>(), "Job server host:port. Mine the jobs of this server instead of the daemon's block templates."
+                                               " --address, daemon and block options are ignored");
 }
 
 void MiningConfig::parse(int argc, char** argv) {
@@ -76,18 +85,28 @@ void MiningConfig::parse(int argc, char** argv) {
     return;
   }
 
-  if (options.count("address") == 0) {
+  jobServerBindIp = options["job-server-bind-ip"].as<std::string>();
+  jobServerBindPort = options["job-server-bind-port"].as<uint16_t>();
+  shareDifficulty = options["share-difficulty"].as<uint64_t>();
+
+  if (!options["job-server"].empty()) {
+    if (jobServerBindPort != 0) {
+      throw std::runtime_error("You must not specify both --job-server and --job-server-bind-port");
+    }
+
+    parseAddress(options["job-server"].as<std::string>(), "job server", jobServerHost, jobServerPort);
+  } else if (options.count("address") == 0) {
     throw std::runtime_error("Specify --address option");
+  } else {
+    miningAddress = options["address"].as<std::string>();
   }
 
-  miningAddress = options["address"].as<std::string>();
-
   if (!options["daemon-address"].empty()) {
     if (!options["daemon-host"].defaulted() || !options["daemon-rpc-port"].defaulted()) {
       throw std::runtime_error("Either --daemon-host or --daemon-rpc-port is already specified. You must not specify --daemon-address");
     }
 
-    parseDaemonAddress(options["daemon-address"].as<std::string>(), daemonHost, daemonPort);
+    parseAddress(options["daemon-address"].as<std::string>(), "daemon", daemonHost, daemonPort);
   } else {
     daemonHost = options["daemon-host"].as<std::string>();
     daemonPort = options["daemon-rpc-port"].as<uint16_t>();
@@ -98,6 +117,12 @@ void MiningConfig::parse(int argc, char** argv) {
     throw std::runtime_error("--threads option must be 1.." + std::to_string(CONCURRENCY_LEVEL));
   }
 
+  if (!options["cpu-affinity"].empty() && !Common::parseCpuAffinity(options["cpu-affinity"].as<std::string>(), threadCount, threadCpus)) {
+    throw std::runtime_error("--cpu-affinity must be auto or a list of available processors like 0-3,8");
+  }
+
+  hashrateInterval = options["hashrate-interval"].as<size_t>();
+
   scanPeriod = options["scan-time"].as<size_t>();
   if (scanPeriod == 0) {
     throw std::runtime_error("--scan-time must not be zero");
@@ -6,6 +6,9 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+
+#include "common/CpuAffinity.h"
 
 namespace cryptonote {
 
@@ -19,11 +22,18 @@ struct MiningConfig {
   std::string daemonHost;
   uint16_t daemonPort;
   size_t threadCount;
+  std::vector<Common::CpuInfo> threadCpus; // empty unless threads are bound to processors
+  size_t hashrateInterval;
   size_t scanPeriod;
   uint8_t logLevel;
   size_t blocksLimit;
   uint64_t firstBlockTimestamp;
   int64_t blockTimestampInterval;
+  std::string jobServerBindIp;
+  uint16_t jobServerBindPort; // 0 unless the miner serves jobs instead of mining
+  std::string jobServerHost; // empty unless the miner mines jobs of a job server
+  uint16_t jobServerPort;
+  uint64_t shareDifficulty;
   bool help;
 };
 
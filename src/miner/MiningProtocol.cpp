@@ -0,0 +1,50 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "MiningProtocol.h"
+
+namespace Miner {
+
+namespace {
+
+const size_t MAX_MESSAGE_SIZE = 64 * 1024;
+
+}
+
+MiningConnection::MiningConnection(System::TcpConnection& connection) : m_connection(connection) {
+}
+
+bool MiningConnection::readMessage(cryptonote::JsonRpc::JsonRpcRequest& message) {
+  size_t lineEnd;
+  while ((lineEnd = m_buffer.find('\n')) == std::string::npos) {
+    if (m_buffer.size() > MAX_MESSAGE_SIZE) {
+      throw std::runtime_error("Message is too big");
+    }
+
+    uint8_t data[4096];
+    size_t size = m_connection.read(data, sizeof(data));
+    if (size == 0) {
+      return false;
+    }
+
+    m_buffer.append(reinterpret_cast<const char*>(data), size);
+  }
+
+  std::string line = m_buffer.substr(0, lineEnd);
+  m_buffer.erase(0, lineEnd + 1);
+  message.parseRequest(line);
+  return true;
+}
+
+void MiningConnection::writeMessage(const std::string& message) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(message.data());
+  size_t size = message.size();
+  while (size != 0) {
+    size_t written = m_connection.write(data, size);
+    data += written;
+    size -= written;
+  }
+}
+
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <string>
+
+#include <system/TcpConnection.h>
+
+#include "rpc/JsonRpc.h"
+#include "serialization/ISerializer.h"
+
+// Job protocol between the miner job server and the miners connected to it. Every message is a JSON RPC
+// notification on its own line: {"jsonrpc":"2.0","method":...,"params":{...}}
+namespace Miner {
+
+// server -> miner, sent on connect, on every block template change and as an answer to getjob
+const char MINING_METHOD_JOB[] = "job";
+// miner -> server, the assigned nonce range of the job is exhausted
+const char MINING_METHOD_GET_JOB[] = "getjob";
+// miner -> server, a nonce giving a hash of the job difficulty
+const char MINING_METHOD_SUBMIT[] = "submit";
+// server -> miner, the answer to submit
+const char MINING_METHOD_RESULT[] = "result";
+
+const char MINING_SHARE_STATUS_OK[] = "OK";
+const char MINING_SHARE_STATUS_OUTDATED_JOB[] = "OUTDATED_JOB";
+const char MINING_SHARE_STATUS_WRONG_HASH[] = "WRONG_HASH";
+
+struct MiningJob {
+  uint64_t job_id;
+  std::string blob; // block template without transactions
+  uint64_t difficulty; // shares must reach it, may be lower than the block difficulty
+  uint32_t height;
+  uint32_t nonce_start;
+  uint32_t nonce_count;
+
+  void serialize(cryptonote::ISerializer& s) {
+    KV_MEMBER(job_id)
+    KV_MEMBER(blob)
+    KV_MEMBER(difficulty)
+    KV_MEMBER(height)
+    KV_MEMBER(nonce_start)
+    KV_MEMBER(nonce_count)
+  }
+};
+
+struct MiningGetJob {
+  uint64_t job_id;
+
+  void serialize(cryptonote::ISerializer& s) {
+    KV_MEMBER(job_id)
+  }
+};
+
+struct MiningShare {
+  uint64_t job_id;
+  uint32_t nonce;
+  std::string hash;
+
+  void serialize(cryptonote::ISerializer& s) {
+    KV_MEMBER(job_id)
+    KV_MEMBER(nonce)
+    KV_MEMBER(hash)
+  }
+};
+
+struct MiningShareResult {
+  uint64_t job_id;
+  uint32_t nonce;
+  bool block; // the share reached the block difficulty and was submitted to the daemon
+  std::string status; // OK or the reason of rejection: OUTDATED_JOB, WRONG_NONCE, WRONG_HASH_FORMAT, LOW_DIFFICULTY, DUPLICATE,
+                      // WRONG_HASH
+
+  void serialize(cryptonote::ISerializer& s) {
+    KV_MEMBER(job_id)
+    KV_MEMBER(nonce)
+    KV_MEMBER(block)
+    KV_MEMBER(status)
+  }
+};
+
+template <typename Params>
+std::string makeMiningMessage(const std::string& method, const Params& params) {
+  cryptonote::JsonRpc::JsonRpcRequest message;
+  message.setMethod(method);
+  message.setParams(params);
+  return message.getBody() + '\n';
+}
+
+// Splits the stream of a connection into messages
+class MiningConnection {
+public:
+  explicit MiningConnection(System::TcpConnection& connection);
+
+  // Returns false when the peer closed the connection
+  bool readMessage(cryptonote::JsonRpc::JsonRpcRequest& message);
+  void writeMessage(const std::string& message);
+
+private:
+  System::TcpConnection& m_connection;
+  std::string m_buffer;
+};
+
+}
@@ -0,0 +1,431 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "MiningServer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <boost/scope_exit.hpp>
+#include <boost/utility/value_init.hpp>
+
+#include <system/InterruptedException.h>
+#include <system/Ipv4Address.h>
+#include <system/RemoteContext.h>
+#include <system/Timer.h>
+
+#include "common/StringTools.h"
+#include "CryptoNoteConfig.h"
+#include "crypto/crypto.h"
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "rpc/HttpClient.h"
+#include "rpc/JsonRpc.h"
+
+using namespace cryptonote;
+
+namespace Miner {
+
+namespace {
+
+const uint64_t NONCE_SPACE_SIZE = static_cast<uint64_t>(UINT32_MAX) + 1;
+const uint32_t NONCE_RANGE_SIZE = 1 << 24; // given to a miner at once
+const size_t MAX_JOB_COUNT = 16; // jobs on the current top block kept for late shares
+const std::chrono::minutes WRONG_HASH_BAN_TIME(10);
+const size_t MAX_QUEUED_MESSAGES = 64; // per miner
+
+}
+
+MiningServer::Worker::Worker(System::Dispatcher& dispatcher, System::TcpConnection& connection) :
+  connection(connection),
+  ip(0),
+  messagesQueued(dispatcher),
+  messagesDropped(false),
+  jobId(0),
+  acceptedShares(0),
+  rejectedShares(0) {
+}
+
+MiningServer::MiningServer(System::Dispatcher& dispatcher, const cryptonote::MiningConfig& config, Logging::ILogger& logger) :
+  m_dispatcher(dispatcher),
+  m_logger(logger, "MiningServer"),
+  m_config(config),
+  m_contextGroup(dispatcher),
+  m_reservedOffset(0),
+  m_templateDifficulty(0),
+  m_templateHeight(0),
+  m_lastJobId(0),
+  m_stopped(false) {
+}
+
+MiningServer::~MiningServer() {
+  m_stopped = true;
+  m_contextGroup.interrupt();
+  m_contextGroup.wait();
+}
+
+void MiningServer::start() {
+  m_logger(Logging::INFO) << "Serving jobs on " << m_config.jobServerBindIp << ":" << m_config.jobServerBindPort;
+
+  m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(m_config.jobServerBindIp), m_config.jobServerBindPort);
+  m_contextGroup.spawn(std::bind(&MiningServer::acceptLoop, this));
+  m_contextGroup.spawn(std::bind(&MiningServer::templateLoop, this));
+  m_contextGroup.wait();
+}
+
+void MiningServer::templateLoop() {
+  try {
+    uint64_t templateVersion = 0;
+    while (!m_stopped) {
+      COMMAND_RPC_GETBLOCKTEMPLATE::response response = boost::value_initialized<COMMAND_RPC_GETBLOCKTEMPLATE::response>();
+      bool received = requestTemplate(templateVersion, response);
+      if (m_stopped) {
+        break;
+      }
+
+      if (received && (response.template_version == 0 || response.template_version != templateVersion)) {
+        addJob(response);
+        templateVersion = response.template_version;
+      }
+
+      // the daemon failed or doesn't support waiting for template changes
+      if (!received || response.template_version == 0) {
+        System::Timer timer(m_dispatcher);
+        timer.sleep(std::chrono::seconds(m_config.scanPeriod));
+      }
+    }
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    m_logger(Logging::ERROR) << "Template context unexpectedly finished: " << e.what();
+  }
+}
+
+bool MiningServer::requestTemplate(uint64_t templateVersion, COMMAND_RPC_GETBLOCKTEMPLATE::response& response) {
+  try {
+    HttpClient client(m_dispatcher, m_config.daemonHost, m_config.daemonPort);
+
+    COMMAND_RPC_GETBLOCKTEMPLATE::request request;
+    request.wallet_address = m_config.miningAddress;
+    request.reserve_size = sizeof(uint64_t);
+    request.template_version = templateVersion;
+    request.wait_timeout = templateVersion == 0 ? 0 : COMMAND_RPC_WAIT_UPDATE_MAX_TIMEOUT;
+
+    JsonRpc::invokeJsonRpcCommand(client, "getblocktemplate", request, response);
+
+    if (response.status != CORE_RPC_STATUS_OK) {
+      throw std::runtime_error("Core responded with wrong status: " + response.status);
+    }
+
+    return true;
+  } catch (System::InterruptedException&) {
+    throw;
+  } catch (std::exception& e) {
+    if (!m_stopped) {
+      m_logger(Logging::WARNING) << "Couldn't get block template: " << e.what();
+    }
+
+    return false;
+  }
+}
+
+void MiningServer::addJob(const COMMAND_RPC_GETBLOCKTEMPLATE::response& response) {
+  BinaryArray blob;
+  Block block;
+  if (!Common::fromHex(response.blocktemplate_blob, blob) || response.reserved_offset + sizeof(uint64_t) > blob.size() ||
+    !fromBinaryArray(block, blob)) {
+    m_logger(Logging::ERROR) << "Couldn't parse block template";
+    return;
+  }
+
+  // shares of jobs on another block can't give a block anymore
+  if (!m_jobs.empty() && m_jobs.rbegin()->second.block.previousBlockHash != block.previousBlockHash) {
+    m_jobs.clear();
+  }
+
+  m_templateBlob = std::move(blob);
+  m_reservedOffset = response.reserved_offset;
+  m_templateDifficulty = response.difficulty;
+  m_templateHeight = response.height;
+
+  Job& job = createJob();
+  m_logger(Logging::INFO) << "New job " << job.id << " for height " << job.height << ", difficulty " << job.difficulty <<
+    ", miners " << m_workers.size();
+
+  for (Worker* worker : m_workers) {
+    sendJob(*worker);
+  }
+}
+
+MiningServer::Job& MiningServer::createJob() {
+  // a random extra nonce in the reserved bytes makes the miner transaction and so the nonce space of every job unique
+  BinaryArray blob = m_templateBlob;
+  uint64_t extraNonce = crypto::rand<uint64_t>();
+  memcpy(blob.data() + m_reservedOffset, &extraNonce, sizeof(extraNonce));
+
+  Job& job = m_jobs[++m_lastJobId];
+  if (!fromBinaryArray(job.block, blob)) {
+    m_jobs.erase(m_lastJobId);
+    throw std::runtime_error("Couldn't parse block template");
+  }
+
+  job.id = m_lastJobId;
+  job.blob = Common::toHex(blob);
+  job.difficulty = m_templateDifficulty;
+  job.shareDifficulty = m_config.shareDifficulty == 0 ? m_templateDifficulty : std::min(m_config.shareDifficulty, m_templateDifficulty);
+  job.height = m_templateHeight;
+  job.nextNonce = 0;
+
+  while (m_jobs.size() > MAX_JOB_COUNT) {
+    m_jobs.erase(m_jobs.begin());
+  }
+
+  return job;
+}
+
+void MiningServer::acceptLoop() {
+  try {
+    System::TcpConnection connection;
+    bool accepted = false;
+
+    while (!accepted) {
+      try {
+        connection = m_listener.accept();
+        accepted = true;
+      } catch (System::InterruptedException&) {
+        throw;
+      } catch (std::exception&) {
+        // try again
+      }
+    }
+
+    m_contextGroup.spawn(std::bind(&MiningServer::acceptLoop, this));
+
+    Worker worker(m_dispatcher, connection);
+    auto addr = connection.getPeerAddressAndPort();
+    worker.ip = addr.first.getValue();
+    worker.address = addr.first.toDottedDecimal() + ":" + std::to_string(addr.second);
+
+    auto ban = m_bannedIps.find(worker.ip);
+    if (ban != m_bannedIps.end()) {
+      if (std::chrono::steady_clock::now() < ban->second) {
+        m_logger(Logging::DEBUGGING) << "Miner " << worker.address << " is banned, connection closed";
+        return;
+      }
+
+      m_bannedIps.erase(ban);
+    }
+
+    m_workers.insert(&worker);
+    BOOST_SCOPE_EXIT_ALL(this, &worker) {
+      m_workers.erase(&worker); };
+
+    m_logger(Logging::INFO) << "Miner " << worker.address << " connected, total " << m_workers.size();
+
+    System::ContextGroup sendingContext(m_dispatcher);
+    sendingContext.spawn(std::bind(&MiningServer::sendLoop, this, std::ref(worker)));
+
+    sendJob(worker);
+    receiveLoop(worker);
+
+    m_logger(Logging::INFO) << "Miner " << worker.address << " disconnected, shares accepted " << worker.acceptedShares <<
+      ", rejected " << worker.rejectedShares;
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    m_logger(Logging::WARNING) << "Miner connection error: " << e.what();
+  }
+}
+
+void MiningServer::receiveLoop(Worker& worker) {
+  MiningConnection connection(worker.connection);
+
+  for (;;) {
+    JsonRpc::JsonRpcRequest message;
+    if (!connection.readMessage(message)) {
+      break;
+    }
+
+    if (worker.messagesDropped) {
+      m_logger(Logging::WARNING) << "Miner " << worker.address << " doesn't read its messages, disconnecting";
+      break;
+    }
+
+    if (message.getMethod() == MINING_METHOD_GET_JOB) {
+      MiningGetJob request = boost::value_initialized<MiningGetJob>();
+      message.loadParams(request);
+
+      // a newer job is already on the way otherwise
+      if (request.job_id == worker.jobId) {
+        sendJob(worker);
+      }
+    } else if (message.getMethod() == MINING_METHOD_SUBMIT) {
+      MiningShare share = boost::value_initialized<MiningShare>();
+      message.loadParams(share);
+
+      MiningShareResult result;
+      processShare(worker, share, result);
+      queueMessage(worker, makeMiningMessage(MINING_METHOD_RESULT, result));
+
+      // the hash passed the difficulty check, so it was forged to make the server calculate slow hashes
+      if (result.status == MINING_SHARE_STATUS_WRONG_HASH) {
+        m_logger(Logging::WARNING) << "Miner " << worker.address << " sent a share with a wrong hash, disconnecting and banning for " <<
+          WRONG_HASH_BAN_TIME.count() << " minutes";
+        banIp(worker.ip);
+        break;
+      }
+    } else {
+      throw std::runtime_error("Unknown method: " + message.getMethod());
+    }
+  }
+}
+
+void MiningServer::sendLoop(Worker& worker) {
+  try {
+    MiningConnection connection(worker.connection);
+
+    for (;;) {
+      while (worker.messages.empty()) {
+        worker.messagesQueued.wait();
+        worker.messagesQueued.clear();
+      }
+
+      std::string message = std::move(worker.messages.front());
+      worker.messages.pop_front();
+      connection.writeMessage(message);
+    }
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    m_logger(Logging::DEBUGGING) << "Couldn't send to miner " << worker.address << ": " << e.what();
+  }
+}
+
+void MiningServer::queueMessage(Worker& worker, std::string&& message) {
+  // the miner is disconnected when it sends its next message
+  if (worker.messages.size() >= MAX_QUEUED_MESSAGES) {
+    worker.messagesDropped = true;
+    return;
+  }
+
+  worker.messages.push_back(std::move(message));
+  worker.messagesQueued.set();
+}
+
+void MiningServer::sendJob(Worker& worker) {
+  if (m_jobs.empty()) {
+    return;
+  }
+
+  Job* job = &m_jobs.rbegin()->second;
+  if (job->nextNonce == NONCE_SPACE_SIZE) {
+    job = &createJob();
+  }
+
+  MiningJob message;
+  message.job_id = job->id;
+  message.blob = job->blob;
+  message.difficulty = job->shareDifficulty;
+  message.height = job->height;
+  message.nonce_start = static_cast<uint32_t>(job->nextNonce);
+  message.nonce_count = static_cast<uint32_t>(std::min<uint64_t>(NONCE_RANGE_SIZE, NONCE_SPACE_SIZE - job->nextNonce));
+  job->nextNonce += message.nonce_count;
+
+  for (auto it = worker.nonceRanges.begin(); it != worker.nonceRanges.end();) {
+    it = m_jobs.count(it->first) == 0 ? worker.nonceRanges.erase(it) : std::next(it);
+  }
+
+  worker.nonceRanges[job->id].push_back({ message.nonce_start, message.nonce_count });
+  worker.jobId = job->id;
+  queueMessage(worker, makeMiningMessage(MINING_METHOD_JOB, message));
+}
+
+void MiningServer::processShare(Worker& worker, const MiningShare& share, MiningShareResult& result) {
+  result.job_id = share.job_id;
+  result.nonce = share.nonce;
+  result.block = false;
+
+  auto it = m_jobs.find(share.job_id);
+  crypto::Hash hash;
+  if (it == m_jobs.end()) {
+    result.status = MINING_SHARE_STATUS_OUTDATED_JOB;
+  } else if (!isNonceAssigned(worker, share.job_id, share.nonce)) {
+    // other miners search that range, the share would be a duplicate of theirs
+    result.status = "WRONG_NONCE";
+  } else if (!Common::podFromHex(share.hash, hash)) {
+    result.status = "WRONG_HASH_FORMAT";
+  } else if (!check_hash(hash, it->second.shareDifficulty)) {
+    // rejected without calculating the slow hash
+    result.status = "LOW_DIFFICULTY";
+  } else if (!it->second.submittedNonces.insert(share.nonce).second) {
+    result.status = "DUPLICATE";
+  } else {
+    // the job may be dropped while the hash is calculated
+    Block block = it->second.block;
+    block.nonce = share.nonce;
+    difficulty_type difficulty = it->second.difficulty;
+
+    System::RemoteContext<bool> verification(m_dispatcher, [&block, &hash] () {
+      crypto::Hash longHash;
+      return get_block_longhash(block, longHash) && longHash == hash;
+    });
+
+    if (!verification.get()) {
+      result.status = MINING_SHARE_STATUS_WRONG_HASH;
+    } else {
+      result.status = MINING_SHARE_STATUS_OK;
+      if (check_hash(hash, difficulty)) {
+        m_logger(Logging::INFO) << "Miner " << worker.address << " found block for difficulty " << difficulty;
+        result.block = submitBlock(block);
+      }
+    }
+  }
+
+  if (result.status == MINING_SHARE_STATUS_OK) {
+    ++worker.acceptedShares;
+  } else {
+    ++worker.rejectedShares;
+    m_logger(Logging::DEBUGGING) << "Share of miner " << worker.address << " rejected: " << result.status;
+  }
+}
+
+bool MiningServer::isNonceAssigned(const Worker& worker, uint64_t jobId, uint32_t nonce) const {
+  auto ranges = worker.nonceRanges.find(jobId);
+  if (ranges == worker.nonceRanges.end()) {
+    return false;
+  }
+
+  return std::any_of(ranges->second.begin(), ranges->second.end(), [nonce](const NonceRange& range) {
+    return nonce - range.start < range.count;
+  });
+}
+
+void MiningServer::banIp(uint32_t ip) {
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = m_bannedIps.begin(); it != m_bannedIps.end();) {
+    it = it->second <= now ? m_bannedIps.erase(it) : std::next(it);
+  }
+
+  m_bannedIps[ip] = now + WRONG_HASH_BAN_TIME;
+}
+
+bool MiningServer::submitBlock(const Block& block) {
+  try {
+    HttpClient client(m_dispatcher, m_config.daemonHost, m_config.daemonPort);
+
+    COMMAND_RPC_SUBMITBLOCK::request request;
+    request.emplace_back(Common::toHex(toBinaryArray(block)));
+
+    COMMAND_RPC_SUBMITBLOCK::response response;
+    JsonRpc::invokeJsonRpcCommand(client, "submitblock", request, response);
+
+    m_logger(Logging::INFO) << "Block has been successfully submitted. Block hash: " << Common::podToHex(get_block_hash(block));
+    return true;
+  } catch (System::InterruptedException&) {
+    throw;
+  } catch (std::exception& e) {
+    m_logger(Logging::WARNING) << "Couldn't submit block: " << Common::podToHex(get_block_hash(block)) << ", reason: " << e.what();
+    return false;
+  }
+}
+
+}
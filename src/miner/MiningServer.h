@@ -0,0 +1,106 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <system/ContextGroup.h>
+#include <system/Dispatcher.h>
+#include <system/Event.h>
+#include <system/TcpConnection.h>
+#include <system/TcpListener.h>
+
+#include "cryptonote.h"
+#include "cryptonote/core/Difficulty.h"
+#include "logging/LoggerRef.h"
+#include "MiningConfig.h"
+#include "MiningProtocol.h"
+#include "rpc/CoreRpcServerCommandsDefinitions.h"
+
+namespace Miner {
+
+// Serves block templates of the daemon to the miners of a farm over persistent connections. The server alone long
+// polls the daemon, pushes a job to every miner when the template changes and gives each miner its own nonce range
+// of the job. Shares must have a nonce of the ranges of their miner and pass the share difficulty check before their
+// hash is verified, blocks are submitted to the daemon. The difficulty check trusts the hash sent by the miner, so it
+// only screens shares of honest miners, a miner whose hash turns out to be wrong is disconnected and its address
+// banned for a while.
+class MiningServer {
+public:
+  MiningServer(System::Dispatcher& dispatcher, const cryptonote::MiningConfig& config, Logging::ILogger& logger);
+  ~MiningServer();
+
+  void start();
+
+private:
+  struct Job {
+    uint64_t id;
+    cryptonote::Block block;
+    std::string blob;
+    cryptonote::difficulty_type difficulty;
+    cryptonote::difficulty_type shareDifficulty;
+    uint32_t height;
+    uint64_t nextNonce; // nonces before it are given to miners
+    std::unordered_set<uint32_t> submittedNonces;
+  };
+
+  struct NonceRange {
+    uint32_t start;
+    uint32_t count;
+  };
+
+  struct Worker {
+    Worker(System::Dispatcher& dispatcher, System::TcpConnection& connection);
+
+    System::TcpConnection& connection;
+    uint32_t ip;
+    std::string address;
+    System::Event messagesQueued;
+    std::deque<std::string> messages;
+    bool messagesDropped; // the miner doesn't read its messages
+    uint64_t jobId; // the last job sent
+    std::map<uint64_t, std::vector<NonceRange>> nonceRanges; // of the jobs still kept
+    uint64_t acceptedShares;
+    uint64_t rejectedShares;
+  };
+
+  void templateLoop();
+  bool requestTemplate(uint64_t templateVersion, cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response& response);
+  void addJob(const cryptonote::COMMAND_RPC_GETBLOCKTEMPLATE::response& response);
+  Job& createJob();
+
+  void acceptLoop();
+  void receiveLoop(Worker& worker);
+  void sendLoop(Worker& worker);
+  void queueMessage(Worker& worker, std::string&& message);
+  void sendJob(Worker& worker);
+  void processShare(Worker& worker, const MiningShare& share, MiningShareResult& result);
+  bool isNonceAssigned(const Worker& worker, uint64_t jobId, uint32_t nonce) const;
+  void banIp(uint32_t ip);
+  bool submitBlock(const cryptonote::Block& block);
+
+  System::Dispatcher& m_dispatcher;
+  Logging::LoggerRef m_logger;
+  const cryptonote::MiningConfig m_config;
+  System::ContextGroup m_contextGroup;
+  System::TcpListener m_listener;
+  std::unordered_set<Worker*> m_workers;
+  std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> m_bannedIps; // until when
+
+  cryptonote::BinaryArray m_templateBlob;
+  uint64_t m_reservedOffset;
+  cryptonote::difficulty_type m_templateDifficulty;
+  uint32_t m_templateHeight;
+  std::map<uint64_t, Job> m_jobs;
+  uint64_t m_lastJobId;
+  bool m_stopped;
+};
+
+}
@@ -9,6 +9,7 @@
 #include "logging/LoggerRef.h"
 
 #include "MinerManager.h"
+#include "MiningServer.h"
 
 #include <system/Dispatcher.h>
 
@@ -27,9 +28,13 @@ int main(int argc, char** argv) {
     loggerGroup.addLogger(consoleLogger);
 
     System::Dispatcher dispatcher;
-    Miner::MinerManager app(dispatcher, config, loggerGroup);
-
-    app.start();
+    if (config.jobServerBindPort != 0) {
+      Miner::MiningServer server(dispatcher, config, loggerGroup);
+      server.start();
+    } else {
+      Miner::MinerManager app(dispatcher, config, loggerGroup);
+      app.start();
+    }
   } catch (std::exception& e) {
     std::cerr << "Fatal: " << e.what() << std::endl;
     return 1;
@@ -4,9 +4,11 @@
 
 #pragma once
 
+#include <deque>
 #include <list>
 #include <ostream>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/uuid/uuid.hpp>
 #include "common/StringTools.h"
@@ -15,7 +17,7 @@
 namespace cryptonote {
 
 struct CryptoNoteConnectionContext {
-  uint8_t version;
+  uint8_t version = 0;
   boost::uuids::uuid m_connection_id;
   uint32_t m_remote_ip = 0;
   uint32_t m_remote_port = 0;
@@ -33,10 +35,11 @@ struct CryptoNoteConnectionContext {
   };
 
   state m_state = state_befor_handshake;
-  std::list<crypto::Hash> m_needed_objects;
-  std::unordered_set<crypto::Hash> m_requested_objects;
   uint32_t m_remote_blockchain_height = 0;
   uint32_t m_last_response_height = 0;
+  std::unordered_set<crypto::Hash> m_known_txs; // sent to or received from the peer
+  std::deque<crypto::Hash> m_known_txs_order;
+  std::vector<crypto::Hash> m_pending_tx_announcements;
 };
 
 inline std::string get_protocol_state_string(CryptoNoteConnectionContext::state s) {
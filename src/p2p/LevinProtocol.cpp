@@ -15,20 +15,6 @@ const uint32_t LEVIN_PACKET_RESPONSE = 0x00000002;
 const uint32_t LEVIN_DEFAULT_MAX_PACKET_SIZE = 100000000;      //100MB by default
 const uint32_t LEVIN_PROTOCOL_VER_1 = 1;
 
-#pragma pack(push)
-#pragma pack(1)
-struct bucket_head2
-{
-  uint64_t m_signature;
-  uint64_t m_cb;
-  bool     m_have_to_return_data;
-  uint32_t m_command;
-  int32_t  m_return_code;
-  uint32_t m_flags;
-  uint32_t m_protocol_version;
-};
-#pragma pack(pop)
-
 }
 
 bool LevinProtocol::Command::needReply() const {
@@ -47,15 +33,8 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  // write header and body in one operation, without copying the body
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -100,14 +79,7 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
 void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
@@ -117,6 +89,16 @@ void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
   }
 }
 
+void LevinProtocol::writeStrict(const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize) {
+  size_t offset = 0;
+  while (offset < headSize) {
+    offset += m_conn.write(head + offset, headSize - offset, body, bodySize);
+  }
+
+  // header is out, finish whatever part of the body was not sent with it
+  writeStrict(body + (offset - headSize), headSize + bodySize - offset);
+}
+
 bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
   size_t offset = 0;
   while (offset < size) {
@@ -29,6 +29,21 @@ enum class LevinError: int32_t {
 
 const int32_t LEVIN_PROTOCOL_RETCODE_SUCCESS = 1;
 
+// header sent in front of every message body
+#pragma pack(push)
+#pragma pack(1)
+struct bucket_head2
+{
+  uint64_t m_signature;
+  uint64_t m_cb;
+  bool     m_have_to_return_data;
+  uint32_t m_command;
+  int32_t  m_return_code;
+  uint32_t m_flags;
+  uint32_t m_protocol_version;
+};
+#pragma pack(pop)
+
 class LevinProtocol {
 public:
 
@@ -94,6 +109,7 @@ private:
 
   bool readStrict(uint8_t* ptr, size_t size);
   void writeStrict(const uint8_t* ptr, size_t size);
+  void writeStrict(const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize);
   System::TcpConnection& m_conn;
 };
 
@@ -45,13 +45,8 @@ using namespace cryptonote;
 
 namespace {
 
-size_t get_random_index_with_fixed_probability(size_t max_index) {
-  //divide by zero workaround
-  if (!max_index)
-    return 0;
-  size_t x = crypto::rand<size_t>() % (max_index + 1);
-  return (x*x*x) / (max_index*max_index); //parabola \/
-}
+// random peer list picks made to choose a peer to connect to, repeated picks are skipped
+const size_t RANDOM_PEER_PICK_COUNT = 60;
 
 
 void addPortMapping(Logging::LoggerRef& logger, uint32_t port) {
@@ -193,11 +188,14 @@ namespace cryptonote
     m_payload_handler(payload_handler),
     m_allow_local_ip(false),
     m_hide_my_port(false),
+    m_dispatcher_threads(cryptonote::P2P_DEFAULT_DISPATCHER_THREADS),
     m_network_id(CRYPTONOTE_NETWORK),
     logger(log, "node_server"),
     m_stopEvent(m_dispatcher),
     m_idleTimer(m_dispatcher),
     m_timedSyncTimer(m_dispatcher),
+    m_txAnnouncementTimer(m_dispatcher),
+    m_bytesSent(0),
     m_timeoutTimer(m_dispatcher),
     m_stop(false),
     // intervals
@@ -390,6 +388,7 @@ namespace cryptonote
     std::copy(seedNodes.begin(), seedNodes.end(), std::back_inserter(m_seed_nodes));
 
     m_hide_my_port = config.getHideMyPort();
+    m_dispatcher_threads = config.getDispatcherThreads();
     return true;
   }
 
@@ -486,10 +485,16 @@ namespace cryptonote
   bool NodeServer::run() {
     logger(INFO) << "Starting node_server";
 
+    size_t dispatcherThreads = m_dispatcher_threads != 0 ? m_dispatcher_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    m_dispatcherPool.reset(new System::DispatcherPool(dispatcherThreads));
+    m_payload_handler.setDispatcherPool(m_dispatcherPool.get());
+    logger(INFO) << "Peer messages are handled by " << dispatcherThreads << " dispatcher threads";
+
     m_workingContextGroup.spawn(std::bind(&NodeServer::acceptLoop, this));
     m_workingContextGroup.spawn(std::bind(&NodeServer::onIdle, this));
     m_workingContextGroup.spawn(std::bind(&NodeServer::timedSyncLoop, this));
     m_workingContextGroup.spawn(std::bind(&NodeServer::timeoutLoop, this));
+    m_workingContextGroup.spawn(std::bind(&NodeServer::txAnnouncementLoop, this));
 
     m_stopEvent.wait();
 
@@ -497,6 +502,9 @@ namespace cryptonote
     m_workingContextGroup.interrupt();
     m_workingContextGroup.wait();
 
+    m_payload_handler.setDispatcherPool(nullptr);
+    m_dispatcherPool.reset();
+
     logger(INFO) << "NodeServer loop stopped";
     return true;
   }
@@ -605,7 +613,7 @@ namespace cryptonote
   bool NodeServer::timedSync() {
     COMMAND_TIMED_SYNC::request arg = boost::value_initialized<COMMAND_TIMED_SYNC::request>();
     m_payload_handler.get_payload_sync_data(arg.payload_data);
-    auto cmdBuf = LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg);
+    auto cmdBuf = std::make_shared<const BinaryArray>(LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg));
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && 
@@ -778,25 +786,19 @@ namespace cryptonote
     if(!local_peers_count)
       return false;//no peers
 
-    size_t max_random_index = std::min<uint64_t>(local_peers_count -1, 20);
-
-    std::set<size_t> tried_peers;
+    std::set<NetworkAddress> tried_peers;
 
     size_t try_count = 0;
     size_t rand_count = 0;
-    while(rand_count < (max_random_index+1)*3 &&  try_count < 10 && !m_stop) {
+    while(rand_count < RANDOM_PEER_PICK_COUNT && try_count < 10 && !m_stop) {
       ++rand_count;
-      size_t random_index = get_random_index_with_fixed_probability(max_random_index);
-      if (!(random_index < local_peers_count)) { logger(ERROR, BRIGHT_RED) << "random_starter_index < peers_local.size() failed!!"; return false; }
-
-      if(tried_peers.count(random_index))
-        continue;
-
-      tried_peers.insert(random_index);
       PeerlistEntry pe = boost::value_initialized<PeerlistEntry>();
-      bool r = use_white_list ? m_peerlist.get_white_peer_by_index(pe, random_index):m_peerlist.get_gray_peer_by_index(pe, random_index);
+      bool r = use_white_list ? m_peerlist.get_random_white_peer(pe) : m_peerlist.get_random_gray_peer(pe);
       if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to get random peer from peerlist(white:" << use_white_list << ")"; return false; }
 
+      if(!tried_peers.insert(pe.adr).second)
+        continue;
+
       ++try_count;
 
       if(is_peer_used(pe))
@@ -1040,13 +1042,20 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------
   
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
+    relay_notify_to_peers(command, data_buff, excludeConnection, [](const CryptoNoteConnectionContext&) { return true; });
+  }
+
+  //-----------------------------------------------------------------------------------
+  void NodeServer::relay_notify_to_peers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+    const std::function<bool(const CryptoNoteConnectionContext&)>& filter) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    auto payload = std::make_shared<const BinaryArray>(data_buff);
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && conn.m_connection_id != excludeId &&
           (conn.m_state == CryptoNoteConnectionContext::state_normal ||
-           conn.m_state == CryptoNoteConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+           conn.m_state == CryptoNoteConnectionContext::state_synchronizing) && filter(conn)) {
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, payload));
       }
     });
   }
@@ -1353,6 +1362,21 @@ namespace cryptonote
     logger(DEBUGGING) << "timedSyncLoop finished";
   }
 
+  void NodeServer::txAnnouncementLoop() {
+    try {
+      for (;;) {
+        m_txAnnouncementTimer.sleep(std::chrono::milliseconds(P2P_TX_ANNOUNCEMENT_INTERVAL));
+        m_payload_handler.flushTransactionAnnouncements();
+      }
+    } catch (System::InterruptedException&) {
+      logger(DEBUGGING) << "txAnnouncementLoop() is interrupted";
+    } catch (std::exception& e) {
+      logger(WARNING) << "Exception in txAnnouncementLoop: " << e.what();
+    }
+
+    logger(DEBUGGING) << "txAnnouncementLoop finished";
+  }
+
   void NodeServer::connectionHandler(const boost::uuids::uuid& connectionId, P2pConnectionContext& ctx) {
     // This inner context is necessary in order to stop connection handler at any moment
     System::Context<> context(m_dispatcher, [this, &connectionId, &ctx] {
@@ -1432,15 +1456,16 @@ namespace cryptonote
 
         for (const auto& msg : msgs) {
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
+          m_bytesSent += msg.size();
           switch (msg.type) {
           case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
+            proto.sendMessage(msg.command, *msg.buffer, true);
             break;
           case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
+            proto.sendMessage(msg.command, *msg.buffer, false);
             break;
           case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
+            proto.sendReply(msg.command, *msg.buffer, msg.returnCode);
             break;
           default:
             assert(false);
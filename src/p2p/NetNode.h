@@ -5,6 +5,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
@@ -12,6 +13,7 @@
 #include <system/Context.h>
 #include <system/ContextGroup.h>
 #include <system/Dispatcher.h>
+#include <system/DispatcherPool.h>
 #include <system/Event.h>
 #include <system/Timer.h>
 #include <system/TcpConnection.h>
@@ -47,20 +49,25 @@ namespace cryptonote
     };
 
     P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
-      type(type), command(command), buffer(buffer), returnCode(returnCode) {
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(buffer)), returnCode(returnCode) {
     }
 
-    P2pMessage(P2pMessage&& msg) :
-      type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
+    P2pMessage(Type type, uint32_t command, BinaryArray&& buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(std::move(buffer))), returnCode(returnCode) {
     }
 
-    size_t size() {
-      return buffer.size();
+    // payload is immutable, so one buffer can be queued to any number of connections
+    P2pMessage(Type type, uint32_t command, std::shared_ptr<const BinaryArray> buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::move(buffer)), returnCode(returnCode) {
+    }
+
+    size_t size() const {
+      return buffer->size();
     }
 
     Type type;
     uint32_t command;
-    const BinaryArray buffer;
+    std::shared_ptr<const BinaryArray> buffer;
     int32_t returnCode;
   };
 
@@ -130,6 +137,7 @@ namespace cryptonote
     bool log_connections();
     virtual uint64_t get_connections_count() override;
     size_t get_outgoing_connections_count();
+    uint64_t getBytesSent() const { return m_bytesSent; }
 
     cryptonote::PeerlistManager& getPeerlistManager() { return m_peerlist; }
 
@@ -163,6 +171,8 @@ namespace cryptonote
 
     //----------------- i_p2p_endpoint -------------------------------------------------------------
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
+    virtual void relay_notify_to_peers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+      const std::function<bool(const CryptoNoteConnectionContext&)>& filter) override;
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const CryptoNoteConnectionContext& context) override;
     virtual void for_each_connection(std::function<void(cryptonote::CryptoNoteConnectionContext&, PeerIdType)> f) override;
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff) override;
@@ -205,6 +215,7 @@ namespace cryptonote
     void onIdle();
     void timedSyncLoop();
     void timeoutLoop();
+    void txAnnouncementLoop();
 
     struct config
     {
@@ -227,9 +238,11 @@ namespace cryptonote
     uint32_t m_ip_address;
     bool m_allow_local_ip;
     bool m_hide_my_port;
+    uint32_t m_dispatcher_threads;
     std::string m_p2p_state_filename;
 
     System::Dispatcher& m_dispatcher;
+    std::unique_ptr<System::DispatcherPool> m_dispatcherPool;
     System::ContextGroup m_workingContextGroup;
     System::Event m_stopEvent;
     System::Timer m_idleTimer;
@@ -245,6 +258,8 @@ namespace cryptonote
     OnceInInterval m_connections_maker_interval;
     OnceInInterval m_peerlist_store_interval;
     System::Timer m_timedSyncTimer;
+    System::Timer m_txAnnouncementTimer;
+    std::atomic<uint64_t> m_bytesSent;
 
     std::string m_bind_ip;
     std::string m_port;
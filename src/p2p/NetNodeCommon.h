@@ -14,6 +14,8 @@ namespace cryptonote {
 
   struct IP2pEndpoint {
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) = 0;
+    virtual void relay_notify_to_peers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+      const std::function<bool(const cryptonote::CryptoNoteConnectionContext&)>& filter) = 0;
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const cryptonote::CryptoNoteConnectionContext& context) = 0;
     virtual uint64_t get_connections_count()=0;
     virtual void for_each_connection(std::function<void(cryptonote::CryptoNoteConnectionContext&, PeerIdType)> f) = 0;
@@ -23,6 +25,8 @@ namespace cryptonote {
 
   struct p2p_endpoint_stub: public IP2pEndpoint {
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override {}
+    virtual void relay_notify_to_peers(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection,
+      const std::function<bool(const cryptonote::CryptoNoteConnectionContext&)>& filter) override {}
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const cryptonote::CryptoNoteConnectionContext& context) override { return true; }
     virtual void for_each_connection(std::function<void(cryptonote::CryptoNoteConnectionContext&, PeerIdType)> f) override {}
     virtual uint64_t get_connections_count() override { return 0; }   
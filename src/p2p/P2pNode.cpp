@@ -32,45 +32,6 @@ namespace cryptonote {
 
 namespace {
 
-class PeerIndexGenerator {
-public:
-
-  PeerIndexGenerator(size_t maxIndex)
-    : maxIndex(maxIndex), randCount(0) {
-    assert(maxIndex > 0);
-  }
-
-  bool generate(size_t& num) {
-    while (randCount < (maxIndex + 1) * 3) {
-      ++randCount;
-      auto idx = getRandomIndex();
-      if (visited.count(idx) == 0) {
-        visited.insert(idx);
-        num = idx;
-        return true;
-      }
-    }
-
-    return false;
-  }
-
-private:
-
-  size_t getRandomIndex() {
-    //divide by zero workaround
-    if (maxIndex == 0) {
-      return 0;
-    }
-
-    size_t x = crypto::rand<size_t>() % (maxIndex + 1);
-    return (x * x * x) / (maxIndex * maxIndex);
-  }
-
-  const size_t maxIndex;
-  size_t randCount;
-  std::set<size_t> visited;
-};
-
 NetworkAddress getRemoteAddress(const TcpConnection& connection) {
   auto addressAndPort = connection.getPeerAddressAndPort();
   NetworkAddress remoteAddress;
@@ -268,16 +229,24 @@ void P2pNode::makeExpectedConnectionsCount(const PeerlistManager::Peerlist& peer
 }
 
 bool P2pNode::makeNewConnectionFromPeerlist(const PeerlistManager::Peerlist& peerlist) {
-  size_t peerIndex;
-  PeerIndexGenerator idxGen(std::min<uint64_t>(peerlist.count() - 1, m_cfg.getPeerListConnectRange()));
+  // repeated random picks are skipped, recently seen peers are picked more often
+  std::set<NetworkAddress> triedPeers;
+  size_t pickCount = (std::min<uint64_t>(peerlist.count() - 1, m_cfg.getPeerListConnectRange()) + 1) * 3;
+  size_t tryCount = 0;
 
-  for (size_t tryCount = 0; idxGen.generate(peerIndex) && tryCount < m_cfg.getPeerListGetTryCount(); ++tryCount) {
+  for (size_t pick = 0; pick < pickCount && tryCount < m_cfg.getPeerListGetTryCount(); ++pick) {
     PeerlistEntry peer;
-    if (!peerlist.get(peer, peerIndex)) {
-      logger(WARNING) << "Failed to get peer from list, idx = " << peerIndex;
+    if (!peerlist.getRandom(peer)) {
+      logger(WARNING) << "Failed to get peer from list";
+      return false;
+    }
+
+    if (!triedPeers.insert(peer.adr).second) {
       continue;
     }
 
+    ++tryCount;
+
     if (isPeerUsed(peer)) {
       continue;
     }
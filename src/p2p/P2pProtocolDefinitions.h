@@ -42,7 +42,9 @@ namespace cryptonote
   enum P2PProtocolVersion : uint8_t {
     V0 = 0,
     V1 = 1,
-    CURRENT = V1
+    V2 = 2, // compact block relay
+    V3 = 3, // transaction inventory announcements
+    CURRENT = V3
   };
 
   struct basic_node_data
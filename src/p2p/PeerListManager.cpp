@@ -5,25 +5,16 @@
 #include "PeerListManager.h"
 
 #include <time.h>
-#include <boost/foreach.hpp>
+#include <algorithm>
+#include <iterator>
 #include <system/Ipv4Address.h>
 
+#include "crypto/crypto.h"
 #include "serialization/SerializationOverloads.h"
 
 using namespace cryptonote;
 
 namespace cryptonote {
-  template <typename T, typename Indexes>
-  bool serialize(boost::multi_index_container<T, Indexes>& value, Common::StringView name, ISerializer& s) {
-    if (s.type() == ISerializer::INPUT) {
-      readSequence<T>(std::inserter(value, value.end()), name, s);
-    } else {
-      writeSequence<T>(value.begin(), value.end(), name, s);
-    }
-
-    return true;
-  }
-
   void serialize(NetworkAddress& na, ISerializer& s) {
     s(na.ip, "ip");
     s(na.port, "port");
@@ -35,10 +26,37 @@ namespace cryptonote {
     s(pe.last_seen, "last_seen");
   }
 
+  bool serialize(PeerlistManager::Peerlist& value, Common::StringView name, ISerializer& s) {
+    if (s.type() == ISerializer::INPUT) {
+      std::vector<PeerlistEntry> entries;
+      readSequence<PeerlistEntry>(std::back_inserter(entries), name, s);
+      value.clear();
+      for (const auto& entry : entries) {
+        value.insert(entry);
+      }
+    } else {
+      std::vector<PeerlistEntry> entries(value.count());
+      for (size_t i = 0; i < entries.size(); ++i) {
+        value.get(entries[i], i);
+      }
+
+      writeSequence<PeerlistEntry>(entries.begin(), entries.end(), name, s);
+    }
+
+    return true;
+  }
+
+}
+
+namespace {
+
+// Entries compared when choosing one to evict from a full list
+const size_t EVICTION_SAMPLE_SIZE = 4;
+
 }
 
-PeerlistManager::Peerlist::Peerlist(peers_indexed& peers, size_t maxSize) :
-  m_peers(peers), m_maxSize(maxSize) {
+PeerlistManager::Peerlist::Peerlist(size_t maxSize, size_t maxBucketSize) :
+  m_maxSize(maxSize), m_maxBucketSize(std::max<size_t>(maxBucketSize, 1)), m_random(crypto::rand<uint64_t>()) {
 }
 
 void PeerlistManager::serialize(ISerializer& s) {
@@ -51,37 +69,150 @@ void PeerlistManager::serialize(ISerializer& s) {
     return;
   }
 
-  s(m_peers_white, "whitelist");
-  s(m_peers_gray, "graylist");
+  s(m_whitePeerlist, "whitelist");
+  s(m_grayPeerlist, "graylist");
 }
 
 size_t PeerlistManager::Peerlist::count() const {
-  return m_peers.size();
+  return m_entries.size();
 }
 
 bool PeerlistManager::Peerlist::get(PeerlistEntry& entry, size_t i) const {
-  if (i >= m_peers.size())
+  if (i >= m_entries.size())
     return false;
 
-  peers_indexed::index<by_time>::type& by_time_index = m_peers.get<by_time>();
+  entry = m_entries[i];
+  return true;
+}
+
+bool PeerlistManager::Peerlist::getRandom(PeerlistEntry& entry) const {
+  if (m_entries.empty()) {
+    return false;
+  }
+
+  // the more recently seen of two random entries
+  const PeerlistEntry& first = m_entries[getRandomIndex()];
+  const PeerlistEntry& second = m_entries[getRandomIndex()];
+  entry = first.last_seen >= second.last_seen ? first : second;
+  return true;
+}
+
+bool PeerlistManager::Peerlist::contains(const NetworkAddress& address) const {
+  return m_indexes.count(address) != 0;
+}
+
+void PeerlistManager::Peerlist::insert(const PeerlistEntry& entry) {
+  auto it = m_indexes.find(entry.adr);
+  if (it != m_indexes.end()) {
+    m_entries[it->second] = entry;
+    return;
+  }
+
+  uint32_t bucketId = getBucket(entry.adr);
+  auto bucket = m_buckets.find(bucketId);
+  if (bucket != m_buckets.end() && bucket->second.size() >= m_maxBucketSize) {
+    auto oldest = std::min_element(bucket->second.begin(), bucket->second.end(), [this](const NetworkAddress& a, const NetworkAddress& b) {
+      return m_entries[m_indexes.at(a)].last_seen < m_entries[m_indexes.at(b)].last_seen;
+    });
+
+    size_t oldestIndex = m_indexes.at(*oldest);
+    if (m_entries[oldestIndex].last_seen > entry.last_seen) {
+      return;
+    }
+
+    removeAt(oldestIndex);
+  }
+
+  m_indexes.emplace(entry.adr, m_entries.size());
+  m_entries.push_back(entry);
+  m_buckets[bucketId].push_back(entry.adr);
+  trim();
+}
 
-  auto it = by_time_index.rbegin();
-  std::advance(it, i);
-  entry = *it;
+bool PeerlistManager::Peerlist::remove(const NetworkAddress& address) {
+  auto it = m_indexes.find(address);
+  if (it == m_indexes.end()) {
+    return false;
+  }
 
+  removeAt(it->second);
   return true;
 }
 
+void PeerlistManager::Peerlist::getNewest(std::list<PeerlistEntry>& entries, size_t count, bool seenOnly) const {
+  std::vector<const PeerlistEntry*> newest;
+  newest.reserve(m_entries.size());
+  for (const auto& entry : m_entries) {
+    if (!seenOnly || entry.last_seen != 0) {
+      newest.push_back(&entry);
+    }
+  }
+
+  count = std::min(count, newest.size());
+  std::partial_sort(newest.begin(), newest.begin() + count, newest.end(), [](const PeerlistEntry* a, const PeerlistEntry* b) {
+    return a->last_seen > b->last_seen;
+  });
+
+  for (size_t i = 0; i < count; ++i) {
+    entries.push_back(*newest[i]);
+  }
+}
+
 void PeerlistManager::Peerlist::trim() {
-  peers_indexed::index<by_time>::type& sorted_index = m_peers.get<by_time>();
-  while (m_peers.size() > m_maxSize) {
-    sorted_index.erase(sorted_index.begin());
+  while (m_entries.size() > m_maxSize) {
+    size_t evicted = getRandomIndex();
+    for (size_t i = 1; i < EVICTION_SAMPLE_SIZE; ++i) {
+      size_t index = getRandomIndex();
+      if (m_entries[index].last_seen < m_entries[evicted].last_seen) {
+        evicted = index;
+      }
+    }
+
+    removeAt(evicted);
+  }
+}
+
+void PeerlistManager::Peerlist::clear() {
+  m_entries.clear();
+  m_indexes.clear();
+  m_buckets.clear();
+}
+
+size_t PeerlistManager::Peerlist::AddressHash::operator()(const NetworkAddress& address) const {
+  return (static_cast<size_t>(address.ip) << 16) ^ address.port;
+}
+
+uint32_t PeerlistManager::Peerlist::getBucket(const NetworkAddress& address) {
+  return networkToHost(address.ip) >> 16;
+}
+
+size_t PeerlistManager::Peerlist::getRandomIndex() const {
+  return static_cast<size_t>(m_random() % m_entries.size());
+}
+
+void PeerlistManager::Peerlist::removeAt(size_t index) {
+  NetworkAddress address = m_entries[index].adr;
+  auto bucket = m_buckets.find(getBucket(address));
+  auto& addresses = bucket->second;
+  auto it = std::find(addresses.begin(), addresses.end(), address);
+  *it = addresses.back();
+  addresses.pop_back();
+  if (addresses.empty()) {
+    m_buckets.erase(bucket);
+  }
+
+  m_indexes.erase(address);
+  if (index + 1 != m_entries.size()) {
+    m_entries[index] = m_entries.back();
+    m_indexes[m_entries[index].adr] = index;
   }
+
+  m_entries.pop_back();
 }
 
 PeerlistManager::PeerlistManager() : 
-  m_whitePeerlist(m_peers_white, cryptonote::P2P_LOCAL_WHITE_PEERLIST_LIMIT),
-  m_grayPeerlist(m_peers_gray, cryptonote::P2P_LOCAL_GRAY_PEERLIST_LIMIT) {}
+  m_whitePeerlist(cryptonote::P2P_LOCAL_WHITE_PEERLIST_LIMIT, cryptonote::P2P_LOCAL_PEERLIST_SUBNET_LIMIT),
+  m_grayPeerlist(cryptonote::P2P_LOCAL_GRAY_PEERLIST_LIMIT, cryptonote::P2P_LOCAL_PEERLIST_SUBNET_LIMIT) {}
 
 //--------------------------------------------------------------------------------------------------
 bool PeerlistManager::init(bool allow_local_ip)
@@ -112,14 +243,14 @@ bool PeerlistManager::merge_peerlist(const std::list<PeerlistEntry>& outer_bs)
 }
 //--------------------------------------------------------------------------------------------------
 
-bool PeerlistManager::get_white_peer_by_index(PeerlistEntry& p, size_t i) const {
-  return m_whitePeerlist.get(p, i);
+bool PeerlistManager::get_random_white_peer(PeerlistEntry& p) const {
+  return m_whitePeerlist.getRandom(p);
 }
 
 //--------------------------------------------------------------------------------------------------
 
-bool PeerlistManager::get_gray_peer_by_index(PeerlistEntry& p, size_t i) const {
-  return m_grayPeerlist.get(p, i);
+bool PeerlistManager::get_random_gray_peer(PeerlistEntry& p) const {
+  return m_grayPeerlist.getRandom(p);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -143,29 +274,15 @@ bool PeerlistManager::is_ip_allowed(uint32_t ip) const
 
 bool PeerlistManager::get_peerlist_head(std::list<PeerlistEntry>& bs_head, uint32_t depth) const
 {
-  const peers_indexed::index<by_time>::type& by_time_index = m_peers_white.get<by_time>();
-  uint32_t cnt = 0;
-
-  BOOST_REVERSE_FOREACH(const peers_indexed::value_type& vl, by_time_index)
-  {
-    if (!vl.last_seen)
-      continue;
-    bs_head.push_back(vl);
-    if (cnt++ > depth)
-      break;
-  }
+  m_whitePeerlist.getNewest(bs_head, depth, true);
   return true;
 }
 //--------------------------------------------------------------------------------------------------
 
 bool PeerlistManager::get_peerlist_full(std::list<PeerlistEntry>& pl_gray, std::list<PeerlistEntry>& pl_white) const
 {
-  const peers_indexed::index<by_time>::type& by_time_index_gr = m_peers_gray.get<by_time>();
-  const peers_indexed::index<by_time>::type& by_time_index_wt = m_peers_white.get<by_time>();
-
-  std::copy(by_time_index_gr.rbegin(), by_time_index_gr.rend(), std::back_inserter(pl_gray));
-  std::copy(by_time_index_wt.rbegin(), by_time_index_wt.rend(), std::back_inserter(pl_white));
-
+  m_grayPeerlist.getNewest(pl_gray, m_grayPeerlist.count(), false);
+  m_whitePeerlist.getNewest(pl_white, m_whitePeerlist.count(), false);
   return true;
 }
 //--------------------------------------------------------------------------------------------------
@@ -201,21 +318,10 @@ bool PeerlistManager::append_with_peer_white(const PeerlistEntry& ple)
     if (!is_ip_allowed(ple.adr.ip))
       return true;
 
-    //find in white list
-    auto by_addr_it_wt = m_peers_white.get<by_addr>().find(ple.adr);
-    if (by_addr_it_wt == m_peers_white.get<by_addr>().end()) {
-      //put new record into white list
-      m_peers_white.insert(ple);
-      trim_white_peerlist();
-    } else {
-      //update record in white list 
-      m_peers_white.replace(by_addr_it_wt, ple);
-    }
+    //put new record into white list or update it
+    m_whitePeerlist.insert(ple);
     //remove from gray list, if need
-    auto by_addr_it_gr = m_peers_gray.get<by_addr>().find(ple.adr);
-    if (by_addr_it_gr != m_peers_gray.get<by_addr>().end()) {
-      m_peers_gray.erase(by_addr_it_gr);
-    }
+    m_grayPeerlist.remove(ple.adr);
     return true;
   } catch (std::exception&) {
   }
@@ -230,22 +336,11 @@ bool PeerlistManager::append_with_peer_gray(const PeerlistEntry& ple)
       return true;
 
     //find in white list
-    auto by_addr_it_wt = m_peers_white.get<by_addr>().find(ple.adr);
-    if (by_addr_it_wt != m_peers_white.get<by_addr>().end())
+    if (m_whitePeerlist.contains(ple.adr))
       return true;
 
-    //update gray list
-    auto by_addr_it_gr = m_peers_gray.get<by_addr>().find(ple.adr);
-    if (by_addr_it_gr == m_peers_gray.get<by_addr>().end())
-    {
-      //put new record into white list
-      m_peers_gray.insert(ple);
-      trim_gray_peerlist();
-    } else
-    {
-      //update record in white list 
-      m_peers_gray.replace(by_addr_it_gr, ple);
-    }
+    //put new record into gray list or update it
+    m_grayPeerlist.insert(ple);
     return true;
   } catch (std::exception&) {
   }
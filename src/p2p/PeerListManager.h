@@ -5,11 +5,9 @@
 #pragma once
 
 #include <list>
-
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
+#include <random>
+#include <unordered_map>
+#include <vector>
 
 #include "P2pProtocolTypes.h"
 #include "CryptoNoteConfig.h"
@@ -21,44 +19,55 @@ class ISerializer;
 /*                                                                      */
 /************************************************************************/
 class PeerlistManager {
-  struct by_time{};
-  struct by_id{};
-  struct by_addr{};
-
-  typedef boost::multi_index_container<
-    PeerlistEntry,
-    boost::multi_index::indexed_by<
-    // access by peerlist_entry::net_adress
-    boost::multi_index::ordered_unique<boost::multi_index::tag<by_addr>, boost::multi_index::member<PeerlistEntry, NetworkAddress, &PeerlistEntry::adr> >,
-    // sort by peerlist_entry::last_seen<
-    boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_time>, boost::multi_index::member<PeerlistEntry, uint64_t, &PeerlistEntry::last_seen> >
-    >
-  > peers_indexed;
-
 public:
 
+  // Entries are kept in a flat table, so a random one is picked in constant time. Addresses are grouped in buckets
+  // by /16 subnet, a full bucket replaces its least recently seen entry. A full list evicts the least recently seen
+  // of a few randomly sampled entries, so neither insertion nor eviction depends on the list size.
   class Peerlist {
   public:
-    Peerlist(peers_indexed& peers, size_t maxSize);
+    Peerlist(size_t maxSize, size_t maxBucketSize);
     size_t count() const;
+    // Entries are not ordered, 'index' is a position in the table
     bool get(PeerlistEntry& entry, size_t index) const;
+    // Picks a random entry, recently seen entries are more likely to be picked
+    bool getRandom(PeerlistEntry& entry) const;
+    bool contains(const NetworkAddress& address) const;
+    // Adds the entry or updates the one with the same address
+    void insert(const PeerlistEntry& entry);
+    bool remove(const NetworkAddress& address);
+    // Appends up to 'count' most recently seen entries, newest first
+    void getNewest(std::list<PeerlistEntry>& entries, size_t count, bool seenOnly) const;
     void trim();
+    void clear();
 
   private:
-    peers_indexed& m_peers;
+    struct AddressHash {
+      size_t operator()(const NetworkAddress& address) const;
+    };
+
+    static uint32_t getBucket(const NetworkAddress& address);
+    size_t getRandomIndex() const;
+    void removeAt(size_t index);
+
     const size_t m_maxSize;
+    const size_t m_maxBucketSize;
+    std::vector<PeerlistEntry> m_entries;
+    std::unordered_map<NetworkAddress, size_t, AddressHash> m_indexes;
+    std::unordered_map<uint32_t, std::vector<NetworkAddress>> m_buckets;
+    mutable std::mt19937_64 m_random;
   };
 
   PeerlistManager();
 
   bool init(bool allow_local_ip);
-  size_t get_white_peers_count() const { return m_peers_white.size(); }
-  size_t get_gray_peers_count() const { return m_peers_gray.size(); }
+  size_t get_white_peers_count() const { return m_whitePeerlist.count(); }
+  size_t get_gray_peers_count() const { return m_grayPeerlist.count(); }
   bool merge_peerlist(const std::list<PeerlistEntry>& outer_bs);
   bool get_peerlist_head(std::list<PeerlistEntry>& bs_head, uint32_t depth = cryptonote::P2P_DEFAULT_PEERS_IN_HANDSHAKE) const;
   bool get_peerlist_full(std::list<PeerlistEntry>& pl_gray, std::list<PeerlistEntry>& pl_white) const;
-  bool get_white_peer_by_index(PeerlistEntry& p, size_t i) const;
-  bool get_gray_peer_by_index(PeerlistEntry& p, size_t i) const;
+  bool get_random_white_peer(PeerlistEntry& p) const;
+  bool get_random_gray_peer(PeerlistEntry& p) const;
   bool append_with_peer_white(const PeerlistEntry& pr);
   bool append_with_peer_gray(const PeerlistEntry& pr);
   bool set_peer_just_seen(PeerIdType peer, uint32_t ip, uint32_t port);
@@ -76,8 +85,6 @@ public:
 private:
   std::string m_config_folder;
   bool m_allow_local_ip;
-  peers_indexed m_peers_gray;
-  peers_indexed m_peers_white;
   Peerlist m_whitePeerlist;
   Peerlist m_grayPeerlist;
 };
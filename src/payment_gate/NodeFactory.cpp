@@ -42,6 +42,32 @@ public:
     callback(std::error_code());
   };
 
+  virtual void queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<cryptonote::BlockScanInfo>& newBlocks,
+    uint32_t& startHeight, const Callback& callback) override {
+    startHeight = 0;
+    callback(std::error_code());
+  };
+
+  virtual void registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys, uint32_t startHeight,
+    uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) override {
+    callback(std::error_code());
+  }
+
+  virtual void unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) override {
+    callback(std::error_code());
+  }
+
+  virtual void watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken, std::vector<crypto::KeyImage>&& keyImages,
+    const Callback& callback) override {
+    callback(std::error_code());
+  }
+
+  virtual void getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence, uint32_t maxCount,
+    std::vector<cryptonote::WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) override {
+    scannedHeight = 0;
+    callback(std::error_code());
+  }
+
   virtual void getPoolSymmetricDifference(std::vector<crypto::Hash>&& knownPoolTxIds, crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<cryptonote::ITransactionReader>>& newTxs, std::vector<crypto::Hash>& deletedTxIds, const Callback& callback) override {
     isBcActual = true;
@@ -0,0 +1,47 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdint.h>
+#include <string.h>
+#include "Context.h"
+
+#ifdef NATIVE_CONTEXT_SWITCH
+
+/* Entry point of a new context, calls procedure with argument restored by swapstack (see asm.S) */
+extern void startstack(void);
+
+#if defined(__x86_64__)
+
+/* Frame popped by swapstack: mxcsr and x87 control word, r15, r14, r13, r12, rbx, rbp, return address */
+#define FRAME_SIZE 80
+
+void* makestack(void* stack, size_t size, void (*procedure)(void*), void* argument) {
+  uintptr_t top = ((uintptr_t)stack + size) & ~(uintptr_t)15;
+  uint64_t* sp = (uint64_t*)(top - FRAME_SIZE);
+  memset(sp, 0, FRAME_SIZE);
+  sp[0] = ((uint64_t)0x037F << 32) | 0x1F80; /* default x87 control word and mxcsr */
+  sp[3] = (uint64_t)(uintptr_t)argument;      /* r13 */
+  sp[4] = (uint64_t)(uintptr_t)procedure;     /* r12 */
+  sp[7] = (uint64_t)(uintptr_t)startstack;    /* return address */
+  return sp;
+}
+
+#elif defined(__aarch64__)
+
+/* Frame popped by swapstack: x19-x28, x29, x30, d8-d15, padding */
+#define FRAME_SIZE 176
+
+void* makestack(void* stack, size_t size, void (*procedure)(void*), void* argument) {
+  uintptr_t top = ((uintptr_t)stack + size) & ~(uintptr_t)15;
+  uint64_t* sp = (uint64_t*)(top - FRAME_SIZE);
+  memset(sp, 0, FRAME_SIZE);
+  sp[0] = (uint64_t)(uintptr_t)procedure;     /* x19 */
+  sp[1] = (uint64_t)(uintptr_t)argument;      /* x20 */
+  sp[11] = (uint64_t)(uintptr_t)startstack;   /* x30 */
+  return sp;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define NATIVE_CONTEXT_SWITCH 1
+#endif
+
+#ifdef NATIVE_CONTEXT_SWITCH
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Context of a suspended coroutine is its stack pointer, callee-saved registers are kept on the stack.
+ * Unlike swapcontext, switching does not touch the signal mask and makes no system calls.
+ */
+
+/* Saves current context to *from and resumes context 'to'. */
+extern void swapstack(void** from, void* to);
+
+/* Prepares stack [stack, stack + size) so that resuming the returned context calls procedure(argument). Procedure must not return. */
+extern void* makestack(void* stack, size_t size, void (*procedure)(void*), void* argument);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
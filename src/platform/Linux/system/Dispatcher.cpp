@@ -3,16 +3,23 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "Dispatcher.h"
+#include <atomic>
 #include <cassert>
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <sys/timerfd.h>
 #include <fcntl.h>
+#include <linux/io_uring.h>
 #include <string.h>
+#include <time.h>
 #include <ucontext.h>
 #include <unistd.h>
+#include "Context.h"
 #include "ErrorMessage.h"
+#include "Ring.h"
+#include "StackPool.h"
+#include <system/InterruptedException.h>
 
 namespace System {
 
@@ -42,18 +49,84 @@ private:
 
 static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
 
-const size_t STACK_SIZE = 64 * 1024;
+const int MAX_EPOLL_EVENTS = 64;
+const uint64_t NANOSECONDS_PER_TICK = 1000000;
+const unsigned RING_ENTRIES = 256;
 
+std::atomic<bool> ioUringEnabled(false);
+
+struct ContextOperation : public RingOperation {
+  Dispatcher* dispatcher;
+  NativeContext* context;
+  int32_t result;
+  bool interrupted;
 };
 
-Dispatcher::Dispatcher() {
+void completeContextOperation(RingOperation* operation, int32_t result, uint32_t) {
+  ContextOperation* contextOperation = static_cast<ContextOperation*>(operation);
+  contextOperation->result = result;
+  contextOperation->context->interruptProcedure = nullptr;
+  contextOperation->dispatcher->pushContext(contextOperation->context);
+}
+
+uint64_t monotonicTime() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+#ifdef NATIVE_CONTEXT_SWITCH
+
+// Stack pointer of a running context is stored when it switches away
+bool createMainContext(void*& context) {
+  context = nullptr;
+  return true;
+}
+
+void destroyContext(void*) {
+}
+
+void switchContext(void*& from, void* to) {
+  swapstack(&from, to);
+}
+
+#else
+
+bool createMainContext(void*& context) {
+  ucontext_t* mainContext = new ucontext_t;
+  if (getcontext(mainContext) == -1) {
+    delete mainContext;
+    return false;
+  }
+
+  context = mainContext;
+  return true;
+}
+
+void destroyContext(void* context) {
+  delete static_cast<ucontext_t*>(context);
+}
+
+void switchContext(void*& from, void* to) {
+  if (swapcontext(static_cast<ucontext_t*>(from), static_cast<ucontext_t*>(to)) == -1) {
+    throw std::runtime_error("Dispatcher, swapcontext failed, " + lastErrorMessage());
+  }
+}
+
+#endif
+
+};
+
+Dispatcher::Dispatcher() : Dispatcher(DEFAULT_STACK_SIZE) {
+}
+
+Dispatcher::Dispatcher(size_t stackSize) : stackSize(stackSize) {
   std::string message;
   epoll = ::epoll_create1(0);
   if (epoll == -1) {
     message = "epoll_create1 failed, " + lastErrorMessage();
   } else {
-    mainContext.ucontext = new ucontext_t;
-    if (getcontext(reinterpret_cast<ucontext_t*>(mainContext.ucontext)) == -1) {
+    if (!createMainContext(mainContext.ucontext)) {
       message = "getcontext failed, " + lastErrorMessage();
     } else {
       remoteSpawnEvent = eventfd(0, O_NONBLOCK);
@@ -70,26 +143,67 @@ Dispatcher::Dispatcher() {
         if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
           message = "epoll_ctl failed, " + lastErrorMessage();
         } else {
-          *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
-
-          mainContext.interrupted = false;
-          mainContext.group = &contextGroup;
-          mainContext.groupPrev = nullptr;
-          mainContext.groupNext = nullptr;
-          contextGroup.firstContext = nullptr;
-          contextGroup.lastContext = nullptr;
-          contextGroup.firstWaiter = nullptr;
-          contextGroup.lastWaiter = nullptr;
-          currentContext = &mainContext;
-          firstResumingContext = nullptr;
-          firstReusableContext = nullptr;
-          runningContextCount = 0;
-          return;
+          timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+          if (timer == -1) {
+            message = "timerfd_create failed, " + lastErrorMessage();
+          } else {
+            timerEventContext.writeContext = nullptr;
+            timerEventContext.readContext = nullptr;
+
+            epoll_event timerEpollEvent;
+            timerEpollEvent.events = EPOLLIN;
+            timerEpollEvent.data.ptr = &timerEventContext;
+
+            if (epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &timerEpollEvent) == -1) {
+              message = "epoll_ctl failed, " + lastErrorMessage();
+            } else {
+              if (ioUringEnabled) {
+                ring = Ring::create(RING_ENTRIES);
+              }
+
+              ringEventContext.writeContext = nullptr;
+              ringEventContext.readContext = nullptr;
+
+              epoll_event ringEpollEvent;
+              ringEpollEvent.events = EPOLLIN;
+              ringEpollEvent.data.ptr = &ringEventContext;
+
+              if (ring != nullptr && epoll_ctl(epoll, EPOLL_CTL_ADD, ring->getFd(), &ringEpollEvent) == -1) {
+                message = "epoll_ctl failed, " + lastErrorMessage();
+              } else {
+                *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
+
+                mainContext.interrupted = false;
+                mainContext.group = &contextGroup;
+                mainContext.groupPrev = nullptr;
+                mainContext.groupNext = nullptr;
+                contextGroup.firstContext = nullptr;
+                contextGroup.lastContext = nullptr;
+                contextGroup.firstWaiter = nullptr;
+                contextGroup.lastWaiter = nullptr;
+                currentContext = &mainContext;
+                firstResumingContext = nullptr;
+                firstReusableContext = nullptr;
+                runningContextCount = 0;
+                timerArmed = false;
+                armedTick = 0;
+                cancelledOperationCount = 0;
+                return;
+              }
+
+              ring.reset();
+            }
+
+            auto result = close(timer);
+            assert(result == 0);
+          }
         }
 
         auto result = close(remoteSpawnEvent);
         assert(result == 0);
       }
+
+      destroyContext(mainContext.ucontext);
     }
 
     auto result = close(epoll);
@@ -105,25 +219,31 @@ Dispatcher::~Dispatcher() {
   }
 
   yield();
+
+  // Interrupted ring operations complete asynchronously
+  while (ring != nullptr && (contextGroup.firstContext != nullptr || cancelledOperationCount > 0)) {
+    ring->submit(true);
+    processCompletions();
+    yield();
+  }
+
   assert(contextGroup.firstContext == nullptr);
   assert(contextGroup.firstWaiter == nullptr);
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    auto ucontext = firstReusableContext->ucontext;
+    auto stackPtr = firstReusableContext->stackPtr;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
-  while (!timers.empty()) {
-    int result = ::close(timers.top());
-    assert(result == 0);
-    timers.pop();
+    StackPool::release(stackPtr, stackSize);
+    destroyContext(ucontext);
   }
 
-  auto result = close(epoll);
+  destroyContext(mainContext.ucontext);
+  ring.reset();
+  auto result = close(timer);
+  assert(result == 0);
+  result = close(epoll);
   assert(result == 0);
   result = close(remoteSpawnEvent);
   assert(result == 0);
@@ -133,20 +253,11 @@ Dispatcher::~Dispatcher() {
 
 void Dispatcher::clear() {
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    auto ucontext = firstReusableContext->ucontext;
+    auto stackPtr = firstReusableContext->stackPtr;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
-  while (!timers.empty()) {
-    int result = ::close(timers.top());
-    if (result == -1) {
-      throw std::runtime_error("Dispatcher::clear, close failed, "  + lastErrorMessage());
-    }
-
-    timers.pop();
+    StackPool::release(stackPtr, stackSize);
+    destroyContext(ucontext);
   }
 }
 
@@ -159,51 +270,31 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
-
-        continue;
-      }
-
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
+    // Operations queued by contexts are submitted in one call before waiting
+    if (ring != nullptr) {
+      ring->submit(false);
+      processCompletions();
+      if (firstResumingContext != nullptr) {
         continue;
       }
+    }
 
-      assert(context != nullptr);
-      break;
+    epoll_event events[MAX_EPOLL_EVENTS];
+    int count = epoll_wait(epoll, events, MAX_EPOLL_EVENTS, -1);
+    if (count > 0) {
+      processEvents(events, count);
+      continue;
     }
 
-    if (errno != EINTR) {
+    if (count == -1 && errno != EINTR) {
       throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, "  + lastErrorMessage());
     }
   }
 
   if (context != currentContext) {
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
+    NativeContext* oldContext = currentContext;
     currentContext = context;
-    if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
-      throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
-    }
+    switchContext(oldContext->ucontext, context->ucontext);
   }
 }
 
@@ -282,43 +373,22 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
 }
 
 void Dispatcher::yield() {
+  if (ring != nullptr) {
+    ring->submit(false);
+    processCompletions();
+  }
+
   for(;;){
-    epoll_event events[16];
-    int count = epoll_wait(epoll, events, 16, 0);
+    epoll_event events[MAX_EPOLL_EVENTS];
+    int count = epoll_wait(epoll, events, MAX_EPOLL_EVENTS, 0);
     if (count == 0) {
       break;
     }
 
     if(count > 0) {
-      for(int i = 0; i < count; ++i) {
-        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          contextPair->writeContext->context->interruptProcedure = nullptr;
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          contextPair->readContext->context->interruptProcedure = nullptr;
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else {
-          continue;
-        }
+      processEvents(events, count);
+      if (count < MAX_EPOLL_EVENTS) {
+        break;
       }
     } else {
       if (errno != EINTR) {
@@ -339,25 +409,30 @@ int Dispatcher::getEpoll() const {
 
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
+    void* stackPointer = StackPool::allocate(stackSize);
+    ContextMakingData makingContextData {this, nullptr};
+#ifdef NATIVE_CONTEXT_SWITCH
+    void* newlyCreatedContext = makestack(stackPointer, stackSize, contextProcedureStatic, &makingContextData);
+#else
     ucontext_t* newlyCreatedContext = new ucontext_t;
     if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
+      delete newlyCreatedContext;
+      StackPool::release(stackPointer, stackSize);
       throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
     }
 
-    auto stackPointer = new uint8_t[STACK_SIZE];
     newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
-
-    ContextMakingData makingContextData {this, newlyCreatedContext};
+    newlyCreatedContext->uc_stack.ss_size = stackSize;
+    makingContextData.ucontext = newlyCreatedContext;
     makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
+#endif
 
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
-    if (swapcontext(oldContext, newlyCreatedContext) == -1) {
-      throw std::runtime_error("Dispatcher::getReusableContext, swapcontext failed, " + lastErrorMessage());
-    }
+    switchContext(currentContext->ucontext, newlyCreatedContext);
 
     assert(firstReusableContext != nullptr);
+#ifndef NATIVE_CONTEXT_SWITCH
     assert(firstReusableContext->ucontext == newlyCreatedContext);
+#endif
     firstReusableContext->stackPtr = stackPointer;
   };
 
@@ -372,27 +447,186 @@ void Dispatcher::pushReusableContext(NativeContext& context) {
   --runningContextCount;
 }
 
-int Dispatcher::getTimer() {
-  int timer;
-  if (timers.empty()) {
-    timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-    epoll_event timerEvent;
-    timerEvent.events = 0;
-    timerEvent.data.ptr = nullptr;
+void Dispatcher::addTimer(TimerWheel::Entry& timer, std::chrono::nanoseconds duration) {
+  uint64_t expires = (monotonicTime() + static_cast<uint64_t>(duration.count()) + NANOSECONDS_PER_TICK - 1) / NANOSECONDS_PER_TICK;
+  timer.expires = expires;
+  timer.context = currentContext;
+  timers.insert(timer);
+  if (!timerArmed || timer.expires < armedTick) {
+    armTimer(timer.expires);
+  }
+}
+
+void Dispatcher::removeTimer(TimerWheel::Entry& timer) {
+  // timerfd stays armed, an early wake-up only advances the wheel
+  timers.remove(timer);
+}
+
+void Dispatcher::setIoUringEnabled(bool enabled) {
+  ioUringEnabled = enabled;
+}
+
+bool Dispatcher::isIoUringEnabled() {
+  return ioUringEnabled;
+}
+
+Ring* Dispatcher::getRing() const {
+  return ring.get();
+}
 
-    if (epoll_ctl(getEpoll(), EPOLL_CTL_ADD, timer, &timerEvent) == -1) {
-      throw std::runtime_error("Dispatcher::getTimer, epoll_ctl failed, "  + lastErrorMessage());
+io_uring_sqe* Dispatcher::getSqe() {
+  assert(ring != nullptr);
+  return ring->getSqe();
+}
+
+int32_t Dispatcher::submitAndWait(io_uring_sqe* sqe) {
+  ContextOperation operation;
+  operation.complete = completeContextOperation;
+  operation.dispatcher = this;
+  operation.context = currentContext;
+  operation.interrupted = false;
+  submit(sqe, operation);
+
+  // Operation may still be writing to its buffers, context is resumed by the completion
+  currentContext->interruptProcedure = [&]() {
+    operation.interrupted = true;
+    cancel(operation);
+  };
+
+  dispatch();
+  assert(operation.context == currentContext);
+  currentContext->interruptProcedure = nullptr;
+  if (operation.interrupted) {
+    // Failure of an interrupted operation is usually its cancellation
+    if (operation.result < 0) {
+      throw InterruptedException();
+    }
+
+    // Operation completed before it was cancelled, interrupt applies to the next one
+    currentContext->interrupted = true;
+  }
+
+  return operation.result;
+}
+
+void Dispatcher::submit(io_uring_sqe* sqe, RingOperation& operation) {
+  assert(ring != nullptr);
+  operation.cancelled = false;
+  sqe->user_data = reinterpret_cast<uint64_t>(&operation);
+}
+
+void Dispatcher::cancel(RingOperation& operation) {
+  assert(ring != nullptr);
+  if (!operation.cancelled) {
+    io_uring_sqe* sqe = ring->getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&operation);
+    sqe->user_data = 0;
+    operation.cancelled = true;
+    ++cancelledOperationCount;
+  }
+}
+
+void Dispatcher::processEvents(const epoll_event* events, int count) {
+  for (int i = 0; i < count; ++i) {
+    ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
+    if (contextPair == &timerEventContext) {
+      expireTimers();
+      continue;
+    }
+
+    if (contextPair == &ringEventContext) {
+      ring->submit(false);
+      processCompletions();
+      continue;
+    }
+
+    if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
+      uint64_t buf;
+      auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+      if(transferred == -1) {
+        throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+      }
+
+      MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+      while (!remoteSpawningProcedures.empty()) {
+        spawn(std::move(remoteSpawningProcedures.front()));
+        remoteSpawningProcedures.pop();
+      }
+
+      continue;
+    }
+
+    // Context is resumed later, it must not be resumed once more by its interrupt procedure
+    if ((events[i].events & EPOLLOUT) != 0) {
+      contextPair->writeContext->context->interruptProcedure = nullptr;
+      pushContext(contextPair->writeContext->context);
+      contextPair->writeContext->events = events[i].events;
+    } else if ((events[i].events & EPOLLIN) != 0) {
+      contextPair->readContext->context->interruptProcedure = nullptr;
+      pushContext(contextPair->readContext->context);
+      contextPair->readContext->events = events[i].events;
     }
-  } else {
-    timer = timers.top();
-    timers.pop();
   }
+}
+
+void Dispatcher::processCompletions() {
+  for (;;) {
+    io_uring_cqe* completion = ring->peekCompletion();
+    if (completion == nullptr) {
+      break;
+    }
 
-  return timer;
+    RingOperation* operation = reinterpret_cast<RingOperation*>(completion->user_data);
+    int32_t result = completion->res;
+    uint32_t flags = completion->flags;
+    ring->popCompletion();
+
+    // Cancellation requests carry no operation
+    if (operation != nullptr) {
+      if ((flags & IORING_CQE_F_MORE) == 0 && operation->cancelled) {
+        assert(cancelledOperationCount > 0);
+        --cancelledOperationCount;
+      }
+
+      operation->complete(operation, result, flags);
+    }
+  }
 }
 
-void Dispatcher::pushTimer(int timer) {
-  timers.push(timer);
+void Dispatcher::expireTimers() {
+  uint64_t value;
+  if (read(timer, &value, sizeof value) == -1 && errno != EAGAIN) {
+    throw std::runtime_error("Dispatcher::expireTimers, read failed, " + lastErrorMessage());
+  }
+
+  timerArmed = false;
+  TimerWheel::Entry* expired = timers.advance(monotonicTime() / NANOSECONDS_PER_TICK);
+  while (expired != nullptr) {
+    NativeContext* context = static_cast<NativeContext*>(expired->context);
+    expired = expired->next;
+    context->interruptProcedure = nullptr;
+    pushContext(context);
+  }
+
+  if (!timers.empty()) {
+    armTimer(timers.getNextTick());
+  }
+}
+
+void Dispatcher::armTimer(uint64_t tick) {
+  uint64_t nanoseconds = tick * NANOSECONDS_PER_TICK;
+  itimerspec expires;
+  expires.it_interval.tv_nsec = expires.it_interval.tv_sec = 0;
+  expires.it_value.tv_sec = nanoseconds / 1000000000;
+  expires.it_value.tv_nsec = nanoseconds % 1000000000;
+  if (timerfd_settime(timer, TFD_TIMER_ABSTIME, &expires, NULL) == -1) {
+    throw std::runtime_error("Dispatcher::armTimer, timerfd_settime failed, " + lastErrorMessage());
+  }
+
+  timerArmed = true;
+  armedTick = tick;
 }
 
 void Dispatcher::contextProcedure(void* ucontext) {
@@ -402,10 +636,7 @@ void Dispatcher::contextProcedure(void* ucontext) {
   context.interrupted = false;
   context.next = nullptr;
   firstReusableContext = &context;
-  ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
-  if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
-    throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
-  }
+  switchContext(context.ucontext, currentContext->ucontext);
 
   for (;;) {
     ++runningContextCount;
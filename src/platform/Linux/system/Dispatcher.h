@@ -4,17 +4,23 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <queue>
-#include <stack>
+
+#include <system/TimerWheel.h>
+
+struct epoll_event;
+struct io_uring_sqe;
 
 namespace System {
 
 struct NativeContextGroup;
 
 struct NativeContext {
-  void* ucontext;
+  void* ucontext; // saved machine context, see Context.h
   void* stackPtr;
   bool interrupted;
   NativeContext* next;
@@ -43,9 +49,24 @@ struct ContextPair {
   OperationContext *writeContext;
 };
 
+// Operation submitted to io_uring, 'complete' is called for each of its completions
+struct RingOperation {
+  void (*complete)(RingOperation* operation, int32_t result, uint32_t flags);
+  bool cancelled;
+};
+
+class Ring;
+
 class Dispatcher {
 public:
+  static const size_t DEFAULT_STACK_SIZE = 64 * 1024;
+
   Dispatcher();
+  // Each context gets a stack of 'stackSize' bytes, not counting the guard page
+  explicit Dispatcher(size_t stackSize);
+  // Socket IO of dispatchers created afterwards goes through io_uring where the kernel supports it, through epoll otherwise
+  static void setIoUringEnabled(bool enabled);
+  static bool isIoUringEnabled();
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -63,8 +84,19 @@ public:
   int getEpoll() const;
   NativeContext& getReusableContext();
   void pushReusableContext(NativeContext&);
-  int getTimer();
-  void pushTimer(int timer);
+  // Current context is resumed when the timer expires, unless the timer is removed before.
+  void addTimer(TimerWheel::Entry& timer, std::chrono::nanoseconds duration);
+  void removeTimer(TimerWheel::Entry& timer);
+  // nullptr when socket IO goes through epoll
+  Ring* getRing() const;
+  // Submission entry for an operation of the current context, see 'submitAndWait'
+  io_uring_sqe* getSqe();
+  // Submits 'sqe' and resumes current context once it completes, returns its result.
+  // If the context is interrupted, the operation is cancelled and InterruptedException is thrown unless it succeeded.
+  int32_t submitAndWait(io_uring_sqe* sqe);
+  // Submits 'sqe' for an operation not tied to a context, it must stay alive until its last completion
+  void submit(io_uring_sqe* sqe, RingOperation& operation);
+  void cancel(RingOperation& operation);
 
 #ifdef __x86_64__
 # if __WORDSIZE == 64
@@ -78,12 +110,27 @@ public:
 
 private:
   void spawn(std::function<void()>&& procedure);
+  void processEvents(const epoll_event* events, int count);
+  void processCompletions();
+  void expireTimers();
+  void armTimer(uint64_t tick);
+  size_t stackSize;
   int epoll;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
   ContextPair remoteSpawnEventContext;
   std::queue<std::function<void()>> remoteSpawningProcedures;
-  std::stack<int> timers;
+
+  // All timers share one timerfd, armed for the earliest tick the wheel has to be advanced to
+  int timer;
+  ContextPair timerEventContext;
+  TimerWheel timers;
+  bool timerArmed;
+  uint64_t armedTick;
+
+  std::unique_ptr<Ring> ring;
+  ContextPair ringEventContext;
+  size_t cancelledOperationCount;
 
   NativeContext mainContext;
   NativeContextGroup contextGroup;
@@ -0,0 +1,183 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "Ring.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ErrorMessage.h"
+
+namespace System {
+
+namespace {
+
+const unsigned REQUIRED_OPERATIONS[] = { IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_ACCEPT, IORING_OP_CONNECT, IORING_OP_ASYNC_CANCEL };
+
+int ringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ringEnter(int ring, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+bool supportsOperations(int ring) {
+  std::vector<uint8_t> buffer(sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op));
+  io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+  if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == -1) {
+    return false;
+  }
+
+  for (unsigned operation : REQUIRED_OPERATIONS) {
+    if (operation > probe->last_op || (probe->ops[operation].flags & IO_URING_OP_SUPPORTED) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template<class T> T* at(void* map, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<uint8_t*>(map) + offset);
+}
+
+}
+
+std::unique_ptr<Ring> Ring::create(unsigned entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof params);
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+  int ring = ringSetup(entries, &params);
+  if (ring == -1) {
+    return nullptr;
+  }
+
+  // Single mapping for both queues and non-dropping completion queue are 5.4 and 5.5 features
+  const uint32_t requiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP;
+  if ((params.features & requiredFeatures) == requiredFeatures && supportsOperations(ring)) {
+    size_t ringMapSize = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void* ringMap = mmap(nullptr, ringMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    if (ringMap != MAP_FAILED) {
+      size_t sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+      void* sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+      if (sqes != MAP_FAILED) {
+        std::unique_ptr<Ring> result(new Ring);
+        result->ring = ring;
+        result->ringMap = ringMap;
+        result->ringMapSize = ringMapSize;
+        result->sqes = static_cast<io_uring_sqe*>(sqes);
+        result->sqesSize = sqesSize;
+        result->sqHead = at<unsigned>(ringMap, params.sq_off.head);
+        result->sqTail = at<unsigned>(ringMap, params.sq_off.tail);
+        result->sqFlags = at<unsigned>(ringMap, params.sq_off.flags);
+        result->sqArray = at<unsigned>(ringMap, params.sq_off.array);
+        result->sqMask = *at<unsigned>(ringMap, params.sq_off.ring_mask);
+        result->sqEntries = params.sq_entries;
+        result->sqeTail = *result->sqTail;
+        result->cqHead = at<unsigned>(ringMap, params.cq_off.head);
+        result->cqTail = at<unsigned>(ringMap, params.cq_off.tail);
+        result->cqMask = *at<unsigned>(ringMap, params.cq_off.ring_mask);
+        result->cqes = at<io_uring_cqe>(ringMap, params.cq_off.cqes);
+        return result;
+      }
+
+      auto result = munmap(ringMap, ringMapSize);
+      assert(result == 0);
+    }
+  }
+
+  auto result = close(ring);
+  assert(result == 0);
+  return nullptr;
+}
+
+Ring::Ring() : multishotAccept(true) {
+}
+
+Ring::~Ring() {
+  auto result = munmap(sqes, sqesSize);
+  assert(result == 0);
+  result = munmap(ringMap, ringMapSize);
+  assert(result == 0);
+  result = close(ring);
+  assert(result == 0);
+}
+
+int Ring::getFd() const {
+  return ring;
+}
+
+io_uring_sqe* Ring::getSqe() {
+  if (sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+    submit(false);
+    if (sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+      throw std::runtime_error("Ring::getSqe, submission queue is full");
+    }
+  }
+
+  unsigned index = sqeTail & sqMask;
+  io_uring_sqe* sqe = &sqes[index];
+  memset(sqe, 0, sizeof *sqe);
+  sqArray[index] = index;
+  ++sqeTail;
+  return sqe;
+}
+
+bool Ring::hasUnsubmitted() const {
+  return sqeTail != __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+}
+
+void Ring::submit(bool wait) {
+  __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+  unsigned toSubmit = sqeTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+  // Completions that did not fit into the queue are flushed into it by entering with GETEVENTS
+  bool getEvents = wait || (__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) != 0;
+  if (toSubmit == 0 && !getEvents) {
+    return;
+  }
+
+  while (ringEnter(ring, toSubmit, wait ? 1 : 0, getEvents ? IORING_ENTER_GETEVENTS : 0) == -1) {
+    // Kernel is short of memory or completion queue is overflown, entries are submitted on the next call
+    if (errno == EAGAIN || errno == EBUSY) {
+      break;
+    }
+
+    if (errno != EINTR) {
+      throw std::runtime_error("Ring::submit, io_uring_enter failed, " + lastErrorMessage());
+    }
+  }
+}
+
+io_uring_cqe* Ring::peekCompletion() {
+  unsigned head = *cqHead;
+  if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+    return nullptr;
+  }
+
+  return &cqes[head & cqMask];
+}
+
+void Ring::popCompletion() {
+  __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+}
+
+bool Ring::supportsMultishotAccept() const {
+  return multishotAccept;
+}
+
+void Ring::disableMultishotAccept() {
+  multishotAccept = false;
+}
+
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace System {
+
+// Minimal io_uring submission and completion queue pair, driven by raw syscalls.
+// Ring fd becomes readable when completions are available, so it can be waited for with epoll.
+class Ring {
+public:
+  // Returns nullptr when io_uring or one of the socket operations is not supported by the kernel
+  static std::unique_ptr<Ring> create(unsigned entries);
+
+  Ring(const Ring&) = delete;
+  ~Ring();
+  Ring& operator=(const Ring&) = delete;
+
+  int getFd() const;
+  // Submits queued entries first when the submission queue is full
+  io_uring_sqe* getSqe();
+  bool hasUnsubmitted() const;
+  // Passes queued entries to the kernel, with 'wait' blocks until at least one completion is available
+  void submit(bool wait);
+  // Returns the oldest available completion, or nullptr
+  io_uring_cqe* peekCompletion();
+  void popCompletion();
+
+  bool supportsMultishotAccept() const;
+  void disableMultishotAccept();
+
+private:
+  Ring();
+
+  int ring;
+  void* ringMap;
+  size_t ringMapSize;
+  io_uring_sqe* sqes;
+  size_t sqesSize;
+  unsigned* sqHead;
+  unsigned* sqTail;
+  unsigned* sqFlags;
+  unsigned* sqArray;
+  unsigned sqMask;
+  unsigned sqEntries;
+  unsigned sqeTail;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned cqMask;
+  io_uring_cqe* cqes;
+  bool multishotAccept;
+};
+
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "StackPool.h"
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ErrorMessage.h"
+
+namespace System {
+
+namespace {
+
+const size_t MAX_CACHED_STACKS = 256;
+
+// Every guard page splits its mapping in two, keep well below the default limit of 65530 mappings per process.
+// Unguarded stacks have uniform protection, so the kernel merges adjacent ones.
+const size_t MAX_GUARDED_STACKS = 16384;
+
+size_t guardedStackCount = 0;
+
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+size_t roundToPages(size_t size) {
+  return (size + pageSize() - 1) / pageSize() * pageSize();
+}
+
+std::mutex& poolMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Cached stacks by usable size
+std::map<size_t, std::vector<void*>>& freeStacks() {
+  static std::map<size_t, std::vector<void*>> stacks;
+  return stacks;
+}
+
+std::unordered_set<void*>& unguardedStacks() {
+  static std::unordered_set<void*> stacks;
+  return stacks;
+}
+
+}
+
+void* StackPool::allocate(size_t size) {
+  size = roundToPages(size);
+  {
+    std::lock_guard<std::mutex> lock(poolMutex());
+    auto& stacks = freeStacks()[size];
+    if (!stacks.empty()) {
+      void* stack = stacks.back();
+      stacks.pop_back();
+      return stack;
+    }
+  }
+
+  void* mapping = mmap(nullptr, size + pageSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("StackPool::allocate, mmap failed, " + lastErrorMessage());
+  }
+
+  void* stack = static_cast<uint8_t*>(mapping) + pageSize();
+  std::lock_guard<std::mutex> lock(poolMutex());
+  if (guardedStackCount >= MAX_GUARDED_STACKS) {
+    unguardedStacks().insert(stack);
+    return stack;
+  }
+
+  if (mprotect(mapping, pageSize(), PROT_NONE) == -1) {
+    std::string message = "StackPool::allocate, mprotect failed, " + lastErrorMessage();
+    munmap(mapping, size + pageSize());
+    throw std::runtime_error(message);
+  }
+
+  ++guardedStackCount;
+  return stack;
+}
+
+void StackPool::release(void* stack, size_t size) {
+  size = roundToPages(size);
+  {
+    std::lock_guard<std::mutex> lock(poolMutex());
+    auto& stacks = freeStacks()[size];
+    if (stacks.size() < MAX_CACHED_STACKS) {
+      stacks.push_back(stack);
+      return;
+    }
+
+    if (unguardedStacks().erase(stack) == 0) {
+      assert(guardedStackCount > 0);
+      --guardedStackCount;
+    }
+  }
+
+  auto result = munmap(static_cast<uint8_t*>(stack) - pageSize(), size + pageSize());
+  assert(result == 0);
+}
+
+}
@@ -0,0 +1,21 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+
+namespace System {
+
+// Coroutine stacks are mapped with an inaccessible guard page below them, so overflow faults instead of
+// corrupting the heap. Stacks mapped past the guarded stack limit go without guard page.
+// Released stacks are cached and shared by all dispatchers of the process.
+class StackPool {
+public:
+  // Returns lowest usable address of a stack of at least 'size' bytes
+  static void* allocate(size_t size);
+  static void release(void* stack, size_t size);
+};
+
+}
@@ -5,13 +5,19 @@
 #include "TcpConnection.h"
 
 #include <arpa/inet.h>
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <linux/io_uring.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <system/ErrorMessage.h>
 #include <system/InterruptedException.h>
 #include <system/Ipv4Address.h>
+#include "Ring.h"
 
 namespace System {
 
@@ -65,6 +71,20 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
+  if (dispatcher->getRing() != nullptr) {
+    io_uring_sqe* sqe = dispatcher->getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = connection;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(std::min<size_t>(size, std::numeric_limits<uint32_t>::max()));
+    int32_t result = dispatcher->submitAndWait(sqe);
+    if (result < 0) {
+      throw std::runtime_error("TcpConnection::read, recv failed, " + errorMessage(-result));
+    }
+
+    return result;
+  }
+
   std::string message;
   ssize_t transferred = ::recv(connection, (void *)data, size, 0);
   if (transferred == -1) {
@@ -154,7 +174,6 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  std::string message;
   if(size == 0) {
     if(shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -163,11 +182,48 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
+  return write(nullptr, 0, data, size);
+}
+
+std::size_t TcpConnection::write(const uint8_t* header, std::size_t headerSize, const uint8_t* data, std::size_t dataSize) {
+  assert(dispatcher != nullptr);
+  assert(contextPair.writeContext == nullptr);
+  assert(headerSize + dataSize > 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  std::string message;
+  iovec buffers[2];
+  buffers[0].iov_base = const_cast<uint8_t*>(header);
+  buffers[0].iov_len = headerSize;
+  buffers[1].iov_base = const_cast<uint8_t*>(data);
+  buffers[1].iov_len = dataSize;
+  msghdr messageHeader = {};
+  messageHeader.msg_iov = buffers;
+  messageHeader.msg_iovlen = 2;
+  std::size_t size = headerSize + dataSize;
+  if (dispatcher->getRing() != nullptr) {
+    io_uring_sqe* sqe = dispatcher->getSqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = connection;
+    sqe->addr = reinterpret_cast<uint64_t>(&messageHeader);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    int32_t result = dispatcher->submitAndWait(sqe);
+    if (result < 0) {
+      throw std::runtime_error("TcpConnection::write, sendmsg failed, " + errorMessage(-result));
+    }
+
+    assert(static_cast<size_t>(result) <= size);
+    return result;
+  }
+
+  ssize_t transferred = ::sendmsg(connection, &messageHeader, MSG_NOSIGNAL);
   if (transferred == -1) {
         bool noError = errno != EAGAIN ? errno != EWOULDBLOCK : false;
     if (noError) {
-      message = "send failed, " + lastErrorMessage();
+      message = "sendmsg failed, " + lastErrorMessage();
     } else {
       epoll_event connectionEvent;
       OperationContext operationContext;
@@ -227,9 +283,9 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &messageHeader, MSG_NOSIGNAL);
         if (transferred == -1) {
-          message = "send failed, "  + lastErrorMessage();
+          message = "sendmsg failed, "  + lastErrorMessage();
         } else {
           assert(transferred <= static_cast<ssize_t>(size));
           return transferred;
@@ -258,6 +314,10 @@ std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
 TcpConnection::TcpConnection(Dispatcher& dispatcher, int socket) : dispatcher(&dispatcher), connection(socket) {
   contextPair.readContext = nullptr;
   contextPair.writeContext = nullptr;
+  if (dispatcher.getRing() != nullptr) {
+    return;
+  }
+
   epoll_event connectionEvent;
   connectionEvent.events = EPOLLONESHOT;
   connectionEvent.data.ptr = nullptr;
@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include <fcntl.h>
+#include <linux/io_uring.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <sys/epoll.h>
@@ -15,6 +16,7 @@
 #include <system/Ipv4Address.h>
 #include "Dispatcher.h"
 #include "ErrorMessage.h"
+#include "Ring.h"
 #include "TcpConnection.h"
 
 namespace System {
@@ -73,6 +75,31 @@ TcpConnection TcpConnector::connect(const Ipv4Address& address, uint16_t port) {
     bindAddress.sin_addr.s_addr = INADDR_ANY;
     if (bind(connection, reinterpret_cast<sockaddr*>(&bindAddress), sizeof bindAddress) != 0) {
       message = "bind failed, " + lastErrorMessage();
+    } else if (dispatcher->getRing() != nullptr) {
+      // Socket stays blocking, io_uring polls it internally
+      sockaddr_in addressData;
+      addressData.sin_family = AF_INET;
+      addressData.sin_port = htons(port);
+      addressData.sin_addr.s_addr = htonl(address.getValue());
+      io_uring_sqe* sqe = dispatcher->getSqe();
+      sqe->opcode = IORING_OP_CONNECT;
+      sqe->fd = connection;
+      sqe->addr = reinterpret_cast<uint64_t>(&addressData);
+      sqe->off = sizeof addressData;
+      int32_t result;
+      try {
+        result = dispatcher->submitAndWait(sqe);
+      } catch (InterruptedException&) {
+        int result = close(connection);
+        assert(result != -1);
+        throw;
+      }
+
+      if (result == 0) {
+        return TcpConnection(*dispatcher, connection);
+      }
+
+      message = "connect failed, " + errorMessage(-result);
     } else {
       int flags = fcntl(connection, F_GETFL, 0);
       if (flags == -1 || fcntl(connection, F_SETFL, flags | O_NONBLOCK) == -1) {
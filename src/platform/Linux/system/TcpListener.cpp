@@ -4,15 +4,18 @@
 
 #include "TcpListener.h"
 #include <cassert>
+#include <deque>
 #include <stdexcept>
 
 #include <fcntl.h>
+#include <linux/io_uring.h>
 #include <netdb.h>
 #include <sys/epoll.h>
 #include <unistd.h>
 #include <string.h>
 
 #include "Dispatcher.h"
+#include "Ring.h"
 #include "TcpConnection.h"
 #include <system/ErrorMessage.h>
 #include <system/InterruptedException.h>
@@ -20,6 +23,52 @@
 
 namespace System {
 
+// Connections accepted by the kernel are queued until 'accept' takes them. Once the listener is closed, the acceptor
+// is orphaned and deletes itself on the last completion of its cancelled operation.
+struct RingAcceptor : public RingOperation {
+  Dispatcher* dispatcher;
+  std::deque<int> connections;
+  int error;
+  bool submitted;
+  bool orphaned;
+  NativeContext* waiter;
+};
+
+namespace {
+
+void completeAccept(RingOperation* operation, int32_t result, uint32_t flags) {
+  RingAcceptor* acceptor = static_cast<RingAcceptor*>(operation);
+  if ((flags & IORING_CQE_F_MORE) == 0) {
+    acceptor->submitted = false;
+  }
+
+  if (result >= 0) {
+    acceptor->connections.push_back(result);
+  } else if (result == -EINVAL && acceptor->dispatcher->getRing()->supportsMultishotAccept()) {
+    // Kernels before 5.19 reject multishot accept, it is submitted again as a single shot one
+    acceptor->dispatcher->getRing()->disableMultishotAccept();
+  } else if (result != -ECANCELED) {
+    acceptor->error = -result;
+  }
+
+  if (acceptor->orphaned) {
+    if (!acceptor->submitted) {
+      for (int connection : acceptor->connections) {
+        int result = close(connection);
+        assert(result != -1);
+      }
+
+      delete acceptor;
+    }
+  } else if (acceptor->waiter != nullptr) {
+    acceptor->waiter->interruptProcedure = nullptr;
+    acceptor->dispatcher->pushContext(acceptor->waiter);
+    acceptor->waiter = nullptr;
+  }
+}
+
+}
+
 TcpListener::TcpListener() : dispatcher(nullptr) {
 }
 
@@ -46,6 +95,19 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
         } else if (listen(listener, SOMAXCONN) != 0) {
           message = "listen failed, " + lastErrorMessage();
         } else {
+          if (dispatcher.getRing() != nullptr) {
+            context = nullptr;
+            acceptor = new RingAcceptor;
+            acceptor->complete = completeAccept;
+            acceptor->cancelled = false;
+            acceptor->dispatcher = &dispatcher;
+            acceptor->error = 0;
+            acceptor->submitted = false;
+            acceptor->orphaned = false;
+            acceptor->waiter = nullptr;
+            return;
+          }
+
           epoll_event listenEvent;
           listenEvent.events = 0;
           listenEvent.data.ptr = nullptr;
@@ -54,6 +116,7 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
             message = "epoll_ctl failed, " + lastErrorMessage();
           } else {
             context = nullptr;
+            acceptor = nullptr;
             return;
           }
         }
@@ -71,6 +134,7 @@ TcpListener::TcpListener(TcpListener&& other) : dispatcher(other.dispatcher) {
   if (other.dispatcher != nullptr) {
     assert(other.context == nullptr);
     listener = other.listener;
+    acceptor = other.acceptor;
     context = nullptr;
     other.dispatcher = nullptr;
   }
@@ -79,6 +143,7 @@ TcpListener::TcpListener(TcpListener&& other) : dispatcher(other.dispatcher) {
 TcpListener::~TcpListener() {
   if (dispatcher != nullptr) {
     assert(context == nullptr);
+    releaseAcceptor();
     int result = close(listener);
     assert(result != -1);
   }
@@ -87,6 +152,7 @@ TcpListener::~TcpListener() {
 TcpListener& TcpListener::operator=(TcpListener&& other) {
   if (dispatcher != nullptr) {
     assert(context == nullptr);
+    releaseAcceptor();
     if (close(listener) == -1) {
       throw std::runtime_error("TcpListener::operator=, close failed, " + lastErrorMessage());
     }
@@ -96,6 +162,7 @@ TcpListener& TcpListener::operator=(TcpListener&& other) {
   if (other.dispatcher != nullptr) {
     assert(other.context == nullptr);
     listener = other.listener;
+    acceptor = other.acceptor;
     context = nullptr;
     other.dispatcher = nullptr;
   }
@@ -110,6 +177,10 @@ TcpConnection TcpListener::accept() {
     throw InterruptedException();
   }
 
+  if (acceptor != nullptr) {
+    return acceptFromRing();
+  }
+
   ContextPair contextPair;
   OperationContext listenerContext;
   listenerContext.interrupted = false;
@@ -181,4 +252,67 @@ TcpConnection TcpListener::accept() {
   throw std::runtime_error("TcpListener::accept, " + message);
 }
 
+TcpConnection TcpListener::acceptFromRing() {
+  while (acceptor->connections.empty()) {
+    if (acceptor->error != 0) {
+      int error = acceptor->error;
+      acceptor->error = 0;
+      throw std::runtime_error("TcpListener::accept, accept failed, " + errorMessage(error));
+    }
+
+    if (!acceptor->submitted) {
+      io_uring_sqe* sqe = dispatcher->getSqe();
+      sqe->opcode = IORING_OP_ACCEPT;
+      sqe->fd = listener;
+      if (dispatcher->getRing()->supportsMultishotAccept()) {
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      }
+
+      dispatcher->submit(sqe, *acceptor);
+      acceptor->submitted = true;
+    }
+
+    // Accept stays submitted when interrupted, connections it accepts meanwhile are taken by the next call
+    bool interrupted = false;
+    acceptor->waiter = dispatcher->getCurrentContext();
+    context = acceptor;
+    dispatcher->getCurrentContext()->interruptProcedure = [&]() {
+      assert(acceptor->waiter != nullptr);
+      interrupted = true;
+      dispatcher->pushContext(acceptor->waiter);
+      acceptor->waiter = nullptr;
+    };
+
+    dispatcher->dispatch();
+    dispatcher->getCurrentContext()->interruptProcedure = nullptr;
+    context = nullptr;
+    if (interrupted) {
+      throw InterruptedException();
+    }
+  }
+
+  int connection = acceptor->connections.front();
+  acceptor->connections.pop_front();
+  return TcpConnection(*dispatcher, connection);
+}
+
+void TcpListener::releaseAcceptor() {
+  if (acceptor != nullptr) {
+    assert(acceptor->waiter == nullptr);
+    if (acceptor->submitted) {
+      acceptor->orphaned = true;
+      dispatcher->cancel(*acceptor);
+    } else {
+      for (int connection : acceptor->connections) {
+        int result = close(connection);
+        assert(result != -1);
+      }
+
+      delete acceptor;
+    }
+
+    acceptor = nullptr;
+  }
+}
+
 }
@@ -12,6 +12,7 @@ namespace System {
 class Dispatcher;
 class Ipv4Address;
 class TcpConnection;
+struct RingAcceptor;
 
 class TcpListener {
 public:
@@ -25,9 +26,14 @@ public:
   TcpConnection accept();
 
 private:
+  TcpConnection acceptFromRing();
+  void releaseAcceptor();
+
   Dispatcher* dispatcher;
   void* context;
   int listener;
+  // Keeps a multishot accept submitted when IO goes through io_uring
+  RingAcceptor* acceptor;
 };
 
 }
@@ -24,7 +24,6 @@ public:
 private:
   Dispatcher* dispatcher;
   void* context;
-  int timer;
 };
 
 }
@@ -9,6 +9,7 @@
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -137,7 +138,6 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  std::string message;
   if (size == 0) {
     if (shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -146,10 +146,32 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, 0);
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t dataSize) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  assert(headerSize + dataSize > 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  std::string message;
+  iovec buffers[2];
+  buffers[0].iov_base = const_cast<uint8_t*>(header);
+  buffers[0].iov_len = headerSize;
+  buffers[1].iov_base = const_cast<uint8_t*>(data);
+  buffers[1].iov_len = dataSize;
+  msghdr messageHeader = {};
+  messageHeader.msg_iov = buffers;
+  messageHeader.msg_iovlen = 2;
+  size_t size = headerSize + dataSize;
+
+  ssize_t transferred = ::sendmsg(connection, &messageHeader, 0);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
-      message = "send failed, " + lastErrorMessage();
+      message = "sendmsg failed, " + lastErrorMessage();
     } else {
       OperationContext context;
       context.context = dispatcher->getCurrentContext();
@@ -188,9 +210,9 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw InterruptedException();
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &messageHeader, 0);
         if (transferred == -1) {
-          message = "send failed, " + lastErrorMessage();
+          message = "sendmsg failed, " + lastErrorMessage();
         } else {
           assert(transferred <= static_cast<ssize_t>(size));
           return transferred;
@@ -23,6 +23,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // gathers header and data into one send, returns the number of bytes written from both
+  std::size_t write(const uint8_t* header, std::size_t headerSize, const uint8_t* data, std::size_t dataSize);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -147,10 +147,25 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t dataSize) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  assert(headerSize + dataSize > 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  WSABUF buffers[2] = {
+    {static_cast<ULONG>(headerSize), reinterpret_cast<char*>(const_cast<uint8_t*>(header))},
+    {static_cast<ULONG>(dataSize), reinterpret_cast<char*>(const_cast<uint8_t*>(data))}
+  };
+  size_t size = headerSize + dataSize;
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, buffers, 2, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
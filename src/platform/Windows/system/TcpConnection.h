@@ -22,6 +22,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // gathers header and data into one send, returns the number of bytes written from both
+  size_t write(const uint8_t* header, size_t headerSize, const uint8_t* data, size_t dataSize);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
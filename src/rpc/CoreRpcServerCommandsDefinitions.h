@@ -282,12 +282,103 @@ struct COMMAND_RPC_GET_INFO {
   };
 };
 
+//-----------------------------------------------
+// Long poll: the response is sent when the top block differs from last_block_hash, the pool version differs from
+// pool_version (if watch_pool is set) or timeout seconds passed
+struct COMMAND_RPC_WAIT_UPDATE {
+  struct request {
+    std::string last_block_hash;
+    uint64_t pool_version;
+    bool watch_pool;
+    uint32_t timeout;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(last_block_hash)
+      KV_MEMBER(pool_version)
+      KV_MEMBER(watch_pool)
+      KV_MEMBER(timeout)
+    }
+  };
+
+  struct response {
+    std::string status;
+    uint64_t height;
+    std::string block_hash;
+    uint64_t pool_version;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(height)
+      KV_MEMBER(block_hash)
+      KV_MEMBER(pool_version)
+    }
+  };
+};
+
 //-----------------------------------------------
 struct COMMAND_RPC_STOP_MINING {
   typedef EMPTY_STRUCT request;
   typedef STATUS_STRUCT response;
 };
 
+//-----------------------------------------------
+struct mining_thread_stats_entry {
+  int32_t cpu; // -1 unless the thread is bound to a processor
+  uint32_t node;
+  uint64_t hashes;
+  uint64_t hashrate_10s;
+  uint64_t hashrate_60s;
+  uint64_t hashrate_15m;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(cpu)
+    KV_MEMBER(node)
+    KV_MEMBER(hashes)
+    KV_MEMBER(hashrate_10s)
+    KV_MEMBER(hashrate_60s)
+    KV_MEMBER(hashrate_15m)
+  }
+};
+
+// Counters of the miner built into the daemon, hashrates are updated every 2 seconds
+struct COMMAND_RPC_GET_MINING_STATS {
+  typedef EMPTY_STRUCT request;
+
+  struct response {
+    std::string status;
+    bool mining;
+    uint64_t hashes;
+    uint64_t hashrate_10s;
+    uint64_t hashrate_60s;
+    uint64_t hashrate_15m;
+    std::vector<mining_thread_stats_entry> threads;
+    uint64_t blocks_found;
+    uint64_t stale_templates; // found blocks rejected because a new block outdated their template
+    uint64_t template_updates;
+    uint64_t template_refresh_last_us;
+    uint64_t template_refresh_avg_us;
+    uint64_t template_to_submit_last_ms;
+    uint64_t template_to_submit_avg_ms;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(mining)
+      KV_MEMBER(hashes)
+      KV_MEMBER(hashrate_10s)
+      KV_MEMBER(hashrate_60s)
+      KV_MEMBER(hashrate_15m)
+      KV_MEMBER(threads)
+      KV_MEMBER(blocks_found)
+      KV_MEMBER(stale_templates)
+      KV_MEMBER(template_updates)
+      KV_MEMBER(template_refresh_last_us)
+      KV_MEMBER(template_refresh_avg_us)
+      KV_MEMBER(template_to_submit_last_ms)
+      KV_MEMBER(template_to_submit_avg_ms)
+    }
+  };
+};
+
 //-----------------------------------------------
 struct COMMAND_RPC_STOP_DAEMON {
   typedef EMPTY_STRUCT request;
@@ -314,14 +405,21 @@ struct COMMAND_RPC_GETBLOCKHASH {
   typedef std::string response;
 };
 
+// With reserve_size set the miner transaction is shared until template_version changes, callers mining in parallel
+// make their blobs unique with the reserved bytes. With wait_timeout set the response is delayed until the version
+// differs from template_version or wait_timeout seconds passed.
 struct COMMAND_RPC_GETBLOCKTEMPLATE {
   struct request {
     uint64_t reserve_size; //max 255 bytes
     std::string wallet_address;
+    uint64_t template_version;
+    uint32_t wait_timeout;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(reserve_size)
       KV_MEMBER(wallet_address)
+      KV_MEMBER(template_version)
+      KV_MEMBER(wait_timeout)
     }
   };
 
@@ -330,6 +428,7 @@ struct COMMAND_RPC_GETBLOCKTEMPLATE {
     uint32_t height;
     uint64_t reserved_offset;
     std::string blocktemplate_blob;
+    uint64_t template_version;
     std::string status;
 
     void serialize(ISerializer &s) {
@@ -337,6 +436,7 @@ struct COMMAND_RPC_GETBLOCKTEMPLATE {
       KV_MEMBER(height)
       KV_MEMBER(reserved_offset)
       KV_MEMBER(blocktemplate_blob)
+      KV_MEMBER(template_version)
       KV_MEMBER(status)
     }
   };
@@ -483,4 +583,110 @@ struct COMMAND_RPC_QUERY_BLOCKS_LITE {
   };
 };
 
+struct COMMAND_RPC_QUERY_BLOCKS_SCAN {
+  typedef COMMAND_RPC_QUERY_BLOCKS_LITE::request request;
+
+  struct response {
+    std::string status;
+    uint64_t startHeight;
+    uint64_t currentHeight;
+    uint64_t fullOffset;
+    // binary serialized BlockScanInfo
+    std::vector<std::string> items;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(startHeight)
+      KV_MEMBER(currentHeight)
+      KV_MEMBER(fullOffset)
+      KV_MEMBER(items)
+    }
+  };
+};
+
+// Daemon side wallet scanning, available to local clients when the daemon runs with --enable-wallet-scan
+struct COMMAND_RPC_SCAN_REGISTER {
+  struct request {
+    crypto::SecretKey viewSecretKey;
+    std::vector<crypto::PublicKey> spendPublicKeys;
+    uint32_t startHeight;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(viewSecretKey)
+      serializeAsBinary(spendPublicKeys, "spendPublicKeys", s);
+      KV_MEMBER(startHeight)
+    }
+  };
+
+  struct response {
+    std::string status;
+    uint64_t registrationId;
+    crypto::Hash registrationToken; // authorizes the other scan calls, keep it as secret as the view key
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(registrationId)
+      KV_MEMBER(registrationToken)
+    }
+  };
+};
+
+struct COMMAND_RPC_SCAN_UNREGISTER {
+  struct request {
+    uint64_t registrationId;
+    crypto::Hash registrationToken;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(registrationId)
+      KV_MEMBER(registrationToken)
+    }
+  };
+
+  typedef STATUS_STRUCT response;
+};
+
+struct COMMAND_RPC_SCAN_WATCH_KEY_IMAGES {
+  struct request {
+    uint64_t registrationId;
+    crypto::Hash registrationToken;
+    std::vector<crypto::KeyImage> keyImages;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(registrationId)
+      KV_MEMBER(registrationToken)
+      serializeAsBinary(keyImages, "keyImages", s);
+    }
+  };
+
+  typedef STATUS_STRUCT response;
+};
+
+struct COMMAND_RPC_SCAN_GET_EVENTS {
+  struct request {
+    uint64_t registrationId;
+    crypto::Hash registrationToken;
+    uint64_t firstSequence; // events before it are acknowledged
+    uint32_t maxCount;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(registrationId)
+      KV_MEMBER(registrationToken)
+      KV_MEMBER(firstSequence)
+      KV_MEMBER(maxCount)
+    }
+  };
+
+  struct response {
+    std::string status;
+    uint32_t scannedHeight;
+    std::vector<WalletScanEvent> events;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(status)
+      KV_MEMBER(scannedHeight)
+      KV_MEMBER(events)
+    }
+  };
+};
+
 }
@@ -29,6 +29,10 @@ void HttpServer::stop() {
   workingContextGroup.wait();
 }
 
+void HttpServer::processClientRequest(const System::Ipv4Address& client, const HttpRequest& request, HttpResponse& response) {
+  processRequest(request, response);
+}
+
 void HttpServer::acceptLoop() {
   try {
     System::TcpConnection connection;
@@ -64,7 +68,7 @@ void HttpServer::acceptLoop() {
       HttpResponse resp;
 
       parser.receiveRequest(stream, req);
-      processRequest(req, resp);
+      processClientRequest(addr.first, req, resp);
 
       stream << resp;
       stream.flush();
@@ -14,6 +14,7 @@
 #include <system/TcpListener.h>
 #include <system/TcpConnection.h>
 #include <system/Event.h>
+#include <system/Ipv4Address.h>
 
 #include <logging/LoggerRef.h>
 
@@ -31,6 +32,8 @@ public:
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) = 0;
 
 protected:
+  // Called for every request with the address it came from, servers restricting some requests to certain clients override it
+  virtual void processClientRequest(const System::Ipv4Address& client, const HttpRequest& request, HttpResponse& response);
 
   System::Dispatcher& m_dispatcher;
 
@@ -6,6 +6,7 @@
 
 #include <boost/optional.hpp>
 #include <boost/foreach.hpp>
+#include <boost/utility/value_init.hpp>
 #include <functional>
 
 #include "CoreRpcServerCommandsDefinitions.h"
@@ -189,7 +190,8 @@ void invokeJsonRpcCommand(HttpClient& httpClient, const std::string& method, con
 
 template <typename Request, typename Response, typename Handler>
 bool invokeMethod(const JsonRpcRequest& jsReq, JsonRpcResponse& jsRes, Handler handler) {
-  Request req;
+  // fields missing in params keep zero values
+  Request req = boost::value_initialized<Request>();
   Response res;
 
   if (!std::is_same<Request, cryptonote::EMPTY_STRUCT>::value && !jsReq.loadParams(req)) {
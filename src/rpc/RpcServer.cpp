@@ -7,6 +7,13 @@
 #include <future>
 #include <unordered_map>
 
+#include <boost/scope_exit.hpp>
+
+#include <system/ContextGroup.h>
+#include <system/Event.h>
+#include <system/Timer.h>
+#include <system/InterruptedException.h>
+
 // CryptoNote
 #include "common/StringTools.h"
 #include "cryptonote/core/CryptoNoteTools.h"
@@ -15,6 +22,7 @@
 #include "cryptonote/core/IBlock.h"
 #include "cryptonote/core/Miner.h"
 #include "cryptonote/core/TransactionExtra.h"
+#include "cryptonote/core/WalletScanService.h"
 
 #include "cryptonote/protocol/i_query.h"
 
@@ -72,29 +80,67 @@ RpcServer::HandlerFunction jsonMethod(bool (RpcServer::*handler)(typename Comman
 std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction>> RpcServer::s_handlers = {
   
   // binary handlers
-  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false } },
-  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
-  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
-  { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
-  { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
-  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
-  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
+  { "/getblocks.bin", { binMethod<COMMAND_RPC_GET_BLOCKS_FAST>(&RpcServer::on_get_blocks), false, false } },
+  { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false, false } },
+  { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false, false } },
+  { "/queryblocksscan.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_SCAN>(&RpcServer::on_query_blocks_scan), false, false } },
+  { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false, false } },
+  { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false, false } },
+  { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false, false } },
+  { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false, false } },
+  { "/scan_register.bin", { binMethod<COMMAND_RPC_SCAN_REGISTER>(&RpcServer::onScanRegister), true, true } },
+  { "/scan_unregister.bin", { binMethod<COMMAND_RPC_SCAN_UNREGISTER>(&RpcServer::onScanUnregister), true, true } },
+  { "/scan_watch_key_images.bin", { binMethod<COMMAND_RPC_SCAN_WATCH_KEY_IMAGES>(&RpcServer::onScanWatchKeyImages), true, true } },
+  { "/scan_get_events.bin", { binMethod<COMMAND_RPC_SCAN_GET_EVENTS>(&RpcServer::onScanGetEvents), true, true } },
 
   // json handlers
-  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true } },
-  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true } },
-  { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
-  { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TX>(&RpcServer::on_send_raw_tx), false } },
-  { "/start_mining", { jsonMethod<COMMAND_RPC_START_MINING>(&RpcServer::on_start_mining), false } },
-  { "/stop_mining", { jsonMethod<COMMAND_RPC_STOP_MINING>(&RpcServer::on_stop_mining), false } },
-  { "/stop_daemon", { jsonMethod<COMMAND_RPC_STOP_DAEMON>(&RpcServer::on_stop_daemon), true } },
+  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true, false } },
+  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true, false } },
+  { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false, false } },
+  { "/sendrawtransaction", { jsonMethod<COMMAND_RPC_SEND_RAW_TX>(&RpcServer::on_send_raw_tx), false, false } },
+  { "/start_mining", { jsonMethod<COMMAND_RPC_START_MINING>(&RpcServer::on_start_mining), false, false } },
+  { "/stop_mining", { jsonMethod<COMMAND_RPC_STOP_MINING>(&RpcServer::on_stop_mining), false, false } },
+  { "/get_mining_stats", { jsonMethod<COMMAND_RPC_GET_MINING_STATS>(&RpcServer::onGetMiningStats), true, false } },
+  { "/stop_daemon", { jsonMethod<COMMAND_RPC_STOP_DAEMON>(&RpcServer::on_stop_daemon), true, false } },
+  { "/wait_update", { jsonMethod<COMMAND_RPC_WAIT_UPDATE>(&RpcServer::onWaitUpdate), true, false } },
 
   // json rpc
-  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
+  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true, false } }
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const ICryptoNoteProtocolQuery& protocolQuery) :
-  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery) {
+  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery), m_walletScanService(nullptr),
+  m_notificationsStopped(false), m_notificationsInFlight(0), m_poolVersion(0) {
+  m_core.addObserver(this);
+}
+
+RpcServer::~RpcServer() {
+  m_core.removeObserver(this);
+
+  {
+    std::lock_guard<std::mutex> lock(m_notificationsMutex);
+    m_notificationsStopped = true;
+  }
+
+  // run the notifications spawned before, they use this server
+  while (notificationsInFlight() != 0) {
+    m_dispatcher.yield();
+  }
+}
+
+void RpcServer::setWalletScanService(WalletScanService* service) {
+  m_walletScanService = service;
+}
+
+void RpcServer::processClientRequest(const System::Ipv4Address& client, const HttpRequest& request, HttpResponse& response) {
+  auto it = s_handlers.find(request.getUrl());
+  if (it != s_handlers.end() && it->second.localClientsOnly && !client.isLoopback()) {
+    logger(DEBUGGING) << "Rejected " << request.getUrl() << " from " << client.toDottedDecimal() << ", it is served to local clients only";
+    response.setStatus(HttpResponse::STATUS_403);
+    return;
+  }
+
+  processRequest(request, response);
 }
 
 void RpcServer::processRequest(const HttpRequest& request, HttpResponse& response) {
@@ -167,6 +213,50 @@ bool RpcServer::isCoreReady() {
   // return m_core.currency().isTestnet() || m_p2p.get_payload_object().isSynchronized();
 }
 
+void RpcServer::blockchainUpdated() {
+  spawnUpdateNotification(false);
+}
+
+void RpcServer::poolUpdated() {
+  spawnUpdateNotification(true);
+}
+
+void RpcServer::blockTemplateUpdated() {
+  spawnUpdateNotification(false);
+}
+
+void RpcServer::spawnUpdateNotification(bool poolUpdate) {
+  std::lock_guard<std::mutex> lock(m_notificationsMutex);
+  // the core may still notify observers it has just removed
+  if (m_notificationsStopped) {
+    return;
+  }
+
+  ++m_notificationsInFlight;
+  m_dispatcher.remoteSpawn([this, poolUpdate] {
+    notifyUpdateWaiters(poolUpdate);
+
+    std::lock_guard<std::mutex> lock(m_notificationsMutex);
+    --m_notificationsInFlight;
+  });
+}
+
+size_t RpcServer::notificationsInFlight() {
+  std::lock_guard<std::mutex> lock(m_notificationsMutex);
+  return m_notificationsInFlight;
+}
+
+void RpcServer::notifyUpdateWaiters(bool poolUpdate) {
+  if (poolUpdate) {
+    ++m_poolVersion;
+  }
+
+  // waiters check the state themselves and clear their event if they keep waiting
+  for (System::Event* waiter : m_updateWaiters) {
+    waiter->set();
+  }
+}
+
 //
 // Binary handlers
 //
@@ -190,18 +280,15 @@ bool RpcServer::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, C
   res.current_height = totalBlockCount;
   res.start_height = startBlockIndex;
 
-  for (const auto& blockId : supplement) {
-    assert(m_core.have_block(blockId));
-    auto completeBlock = m_core.getBlock(blockId);
-    assert(completeBlock != nullptr);
-
-    res.blocks.resize(res.blocks.size() + 1);
-    res.blocks.back().block = asString(toBinaryArray(completeBlock->getBlock()));
-
-    res.blocks.back().txs.reserve(completeBlock->getTransactionCount());
-    for (size_t i = 0; i < completeBlock->getTransactionCount(); ++i) {
-      res.blocks.back().txs.push_back(asString(toBinaryArray(completeBlock->getTransaction(i))));
-    }
+  std::vector<crypto::Hash> missedIds;
+  res.blocks.reserve(supplement.size());
+  m_core.getRawBlocks(supplement, res.blocks, missedIds);
+  // the chain may switch between the supplement lookup and the block reads
+  if (!missedIds.empty()) {
+    logger(DEBUGGING) << "Failed to get " << missedIds.size() << " of " << supplement.size() << " requested blocks";
+    res.blocks.clear();
+    res.status = "Failed to get requested blocks";
+    return false;
   }
 
   res.status = CORE_RPC_STATUS_OK;
@@ -241,6 +328,22 @@ bool RpcServer::on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::reques
   return true;
 }
 
+bool RpcServer::on_query_blocks_scan(const COMMAND_RPC_QUERY_BLOCKS_SCAN::request& req, COMMAND_RPC_QUERY_BLOCKS_SCAN::response& res) {
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  if (!m_core.queryBlocksScan(req.blockIds, req.timestamp, startHeight, currentHeight, fullOffset, res.items)) {
+    res.status = "Failed to perform query";
+    return false;
+  }
+
+  res.startHeight = startHeight;
+  res.currentHeight = currentHeight;
+  res.fullOffset = fullOffset;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res) {
   std::vector<uint32_t> outputIndexes;
   if (!m_core.get_tx_outputs_gindexs(req.txid, outputIndexes)) {
@@ -307,6 +410,57 @@ bool RpcServer::onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::re
   return true;
 }
 
+bool RpcServer::onScanRegister(const COMMAND_RPC_SCAN_REGISTER::request& req, COMMAND_RPC_SCAN_REGISTER::response& res) {
+  if (m_walletScanService == nullptr) {
+    res.status = "Wallet scan service is disabled";
+    return true;
+  }
+
+  if (!m_walletScanService->addRegistration(req.viewSecretKey, req.spendPublicKeys, req.startHeight, res.registrationId,
+    res.registrationToken)) {
+    res.status = "Too many registrations or start height is too deep";
+    return true;
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+bool RpcServer::onScanUnregister(const COMMAND_RPC_SCAN_UNREGISTER::request& req, COMMAND_RPC_SCAN_UNREGISTER::response& res) {
+  if (m_walletScanService == nullptr) {
+    res.status = "Wallet scan service is disabled";
+    return true;
+  }
+
+  res.status = m_walletScanService->removeRegistration(req.registrationId, req.registrationToken) ? CORE_RPC_STATUS_OK : "Unknown registration";
+  return true;
+}
+
+bool RpcServer::onScanWatchKeyImages(const COMMAND_RPC_SCAN_WATCH_KEY_IMAGES::request& req, COMMAND_RPC_SCAN_WATCH_KEY_IMAGES::response& res) {
+  if (m_walletScanService == nullptr) {
+    res.status = "Wallet scan service is disabled";
+    return true;
+  }
+
+  res.status = m_walletScanService->addKeyImages(req.registrationId, req.registrationToken, req.keyImages) ? CORE_RPC_STATUS_OK : "Unknown registration";
+  return true;
+}
+
+bool RpcServer::onScanGetEvents(const COMMAND_RPC_SCAN_GET_EVENTS::request& req, COMMAND_RPC_SCAN_GET_EVENTS::response& res) {
+  if (m_walletScanService == nullptr) {
+    res.status = "Wallet scan service is disabled";
+    return true;
+  }
+
+  if (!m_walletScanService->getEvents(req.registrationId, req.registrationToken, req.firstSequence, req.maxCount, res.events, res.scannedHeight)) {
+    res.status = "Unknown registration";
+    return true;
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 //
 // JSON handlers
 //
@@ -429,6 +583,38 @@ bool RpcServer::on_stop_mining(const COMMAND_RPC_STOP_MINING::request& req, COMM
   return true;
 }
 
+bool RpcServer::onGetMiningStats(const COMMAND_RPC_GET_MINING_STATS::request& req, COMMAND_RPC_GET_MINING_STATS::response& res) {
+  static_assert(miner::HASHRATE_WINDOW_COUNT == 3, "hashrate fields of COMMAND_RPC_GET_MINING_STATS follow miner::HASHRATE_WINDOWS");
+
+  miner::mining_stats stats = m_core.get_miner().get_stats();
+  res.mining = stats.mining;
+  res.hashes = stats.hashes;
+  res.hashrate_10s = stats.hashrates[0];
+  res.hashrate_60s = stats.hashrates[1];
+  res.hashrate_15m = stats.hashrates[2];
+
+  for (const miner::thread_stats& thread : stats.threads) {
+    mining_thread_stats_entry entry;
+    entry.cpu = thread.cpu;
+    entry.node = thread.node;
+    entry.hashes = thread.hashes;
+    entry.hashrate_10s = thread.hashrates[0];
+    entry.hashrate_60s = thread.hashrates[1];
+    entry.hashrate_15m = thread.hashrates[2];
+    res.threads.push_back(entry);
+  }
+
+  res.blocks_found = stats.blocks_found;
+  res.stale_templates = stats.stale_templates;
+  res.template_updates = stats.template_updates;
+  res.template_refresh_last_us = stats.template_refresh_last_us;
+  res.template_refresh_avg_us = stats.template_refresh_avg_us;
+  res.template_to_submit_last_ms = stats.template_to_submit_last_ms;
+  res.template_to_submit_avg_ms = stats.template_to_submit_avg_ms;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::on_stop_daemon(const COMMAND_RPC_STOP_DAEMON::request& req, COMMAND_RPC_STOP_DAEMON::response& res) {
   // if (m_core.currency().isTestnet()) {
   //   m_p2p.sendStopSignal();
@@ -440,6 +626,55 @@ bool RpcServer::on_stop_daemon(const COMMAND_RPC_STOP_DAEMON::request& req, COMM
   // return true;
 }
 
+void RpcServer::waitUpdate(uint32_t timeout, const std::function<bool()>& updated) {
+  if (updated()) {
+    return;
+  }
+
+  bool timedOut = false;
+  System::Event notified(m_dispatcher);
+  m_updateWaiters.insert(&notified);
+  BOOST_SCOPE_EXIT_ALL(this, &notified) {
+    m_updateWaiters.erase(&notified);
+  };
+
+  System::ContextGroup timeoutContext(m_dispatcher);
+  timeoutContext.spawn([&] {
+    try {
+      System::Timer(m_dispatcher).sleep(std::chrono::seconds(std::min(timeout, COMMAND_RPC_WAIT_UPDATE_MAX_TIMEOUT)));
+      timedOut = true;
+      notified.set();
+    } catch (System::InterruptedException&) {
+    }
+  });
+
+  do {
+    notified.wait();
+    notified.clear();
+  } while (!updated() && !timedOut);
+}
+
+bool RpcServer::onWaitUpdate(const COMMAND_RPC_WAIT_UPDATE::request& req, COMMAND_RPC_WAIT_UPDATE::response& res) {
+  Hash lastBlockHash = NULL_HASH;
+  if (!req.last_block_hash.empty() && !parse_hash256(req.last_block_hash, lastBlockHash)) {
+    res.status = "Failed to parse hex representation of block hash";
+    return false;
+  }
+
+  uint32_t height;
+  Hash blockHash;
+  waitUpdate(req.timeout, [&] {
+    m_core.get_blockchain_top(height, blockHash);
+    return blockHash != lastBlockHash || (req.watch_pool && m_poolVersion != req.pool_version);
+  });
+
+  res.height = height;
+  res.block_hash = Common::podToHex(blockHash);
+  res.pool_version = m_poolVersion;
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 //------------------------------------------------------------------------------------------------------------------------------
 // JSON RPC methods
 //------------------------------------------------------------------------------------------------------------------------------
@@ -495,10 +730,14 @@ bool RpcServer::on_getblocktemplate(const COMMAND_RPC_GETBLOCKTEMPLATE::request&
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_WRONG_WALLET_ADDRESS, "Failed to parse wallet address" };
   }
 
+  if (req.wait_timeout != 0) {
+    waitUpdate(req.wait_timeout, [&] { return m_core.getBlockTemplateVersion() != req.template_version; });
+  }
+
   Block b = boost::value_initialized<Block>();
   cryptonote::BinaryArray blob_reserve;
   blob_reserve.resize(req.reserve_size, 0);
-  if (!m_core.get_block_template(b, acc, res.difficulty, res.height, blob_reserve)) {
+  if (!m_core.getBlockTemplate(b, acc, res.difficulty, res.height, blob_reserve, res.template_version)) {
     logger(ERROR) << "Failed to create block template";
     throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: failed to create block template" };
   }
@@ -5,9 +5,12 @@
 #include "HttpServer.h"
 
 #include <functional>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <logging/LoggerRef.h>
+#include "cryptonote/core/ICoreObserver.h"
 #include "CoreRpcServerCommandsDefinitions.h"
 
 namespace cryptonote {
@@ -15,36 +18,58 @@ namespace cryptonote {
 class core;
 class NodeServer;
 class ICryptoNoteProtocolQuery;
+class WalletScanService;
 
-class RpcServer : public HttpServer {
+class RpcServer : public HttpServer, private ICoreObserver {
 public:
   RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const ICryptoNoteProtocolQuery& protocolQuery);
+  virtual ~RpcServer();
 
   typedef std::function<bool(RpcServer*, const HttpRequest& request, HttpResponse& response)> HandlerFunction;
 
+  // Serves the wallet scan requests, they fail while not set
+  void setWalletScanService(WalletScanService* service);
+
 private:
 
   template <class Handler>
   struct RpcHandler {
     const Handler handler;
     const bool allowBusyCore;
+    const bool localClientsOnly; // the wallet scan requests carry view keys
   };
 
   typedef void (RpcServer::*HandlerPtr)(const HttpRequest& request, HttpResponse& response);
   static std::unordered_map<std::string, RpcHandler<HandlerFunction>> s_handlers;
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) override;
+  virtual void processClientRequest(const System::Ipv4Address& client, const HttpRequest& request, HttpResponse& response) override;
   bool processJsonRpcRequest(const HttpRequest& request, HttpResponse& response);
   bool isCoreReady();
 
+  // ICoreObserver, called from any thread
+  virtual void blockchainUpdated() override;
+  virtual void poolUpdated() override;
+  virtual void blockTemplateUpdated() override;
+  void spawnUpdateNotification(bool poolUpdate);
+  size_t notificationsInFlight();
+  void notifyUpdateWaiters(bool poolUpdate);
+  // Returns when updated() is true, checked on core notifications, or after timeout seconds
+  void waitUpdate(uint32_t timeout, const std::function<bool()>& updated);
+
   // binary handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
   bool on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, COMMAND_RPC_QUERY_BLOCKS::response& res);
   bool on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::request& req, COMMAND_RPC_QUERY_BLOCKS_LITE::response& res);
+  bool on_query_blocks_scan(const COMMAND_RPC_QUERY_BLOCKS_SCAN::request& req, COMMAND_RPC_QUERY_BLOCKS_SCAN::response& res);
   bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
   bool on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
   bool onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp);
   bool onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::request& req, COMMAND_RPC_GET_POOL_CHANGES_LITE::response& rsp);
+  bool onScanRegister(const COMMAND_RPC_SCAN_REGISTER::request& req, COMMAND_RPC_SCAN_REGISTER::response& res);
+  bool onScanUnregister(const COMMAND_RPC_SCAN_UNREGISTER::request& req, COMMAND_RPC_SCAN_UNREGISTER::response& res);
+  bool onScanWatchKeyImages(const COMMAND_RPC_SCAN_WATCH_KEY_IMAGES::request& req, COMMAND_RPC_SCAN_WATCH_KEY_IMAGES::response& res);
+  bool onScanGetEvents(const COMMAND_RPC_SCAN_GET_EVENTS::request& req, COMMAND_RPC_SCAN_GET_EVENTS::response& res);
 
   // json handlers
   bool on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res);
@@ -53,7 +78,9 @@ private:
   bool on_send_raw_tx(const COMMAND_RPC_SEND_RAW_TX::request& req, COMMAND_RPC_SEND_RAW_TX::response& res);
   bool on_start_mining(const COMMAND_RPC_START_MINING::request& req, COMMAND_RPC_START_MINING::response& res);
   bool on_stop_mining(const COMMAND_RPC_STOP_MINING::request& req, COMMAND_RPC_STOP_MINING::response& res);
+  bool onGetMiningStats(const COMMAND_RPC_GET_MINING_STATS::request& req, COMMAND_RPC_GET_MINING_STATS::response& res);
   bool on_stop_daemon(const COMMAND_RPC_STOP_DAEMON::request& req, COMMAND_RPC_STOP_DAEMON::response& res);
+  bool onWaitUpdate(const COMMAND_RPC_WAIT_UPDATE::request& req, COMMAND_RPC_WAIT_UPDATE::response& res);
 
   // json rpc
   bool on_getblockcount(const COMMAND_RPC_GETBLOCKCOUNT::request& req, COMMAND_RPC_GETBLOCKCOUNT::response& res);
@@ -71,6 +98,15 @@ private:
   core& m_core;
   NodeServer& m_p2p;
   const ICryptoNoteProtocolQuery& m_protocolQuery;
+  WalletScanService* m_walletScanService;
+
+  std::mutex m_notificationsMutex;
+  bool m_notificationsStopped;
+  size_t m_notificationsInFlight; // spawned on the dispatcher and not finished yet
+
+  // accessed in dispatcher thread only
+  std::unordered_set<System::Event*> m_updateWaiters;
+  uint64_t m_poolVersion;
 };
 
 }
@@ -0,0 +1,50 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "DispatcherPool.h"
+#include <cassert>
+
+namespace System {
+
+DispatcherPool::DispatcherPool(size_t threadCount) : workers(threadCount) {
+  assert(threadCount > 0);
+  for (Worker& worker : workers) {
+    std::promise<void> started;
+    auto startedFuture = started.get_future();
+    worker.thread = std::thread(&DispatcherPool::workerProcedure, this, std::ref(worker), std::ref(started));
+    startedFuture.wait();
+  }
+}
+
+DispatcherPool::~DispatcherPool() {
+  for (Worker& worker : workers) {
+    auto stopEvent = worker.stopEvent;
+    worker.dispatcher->remoteSpawn([stopEvent] { stopEvent->set(); });
+  }
+
+  for (Worker& worker : workers) {
+    worker.thread.join();
+  }
+}
+
+size_t DispatcherPool::size() const {
+  return workers.size();
+}
+
+Dispatcher& DispatcherPool::getDispatcher(size_t shard) {
+  return *workers[shard % workers.size()].dispatcher;
+}
+
+void DispatcherPool::workerProcedure(Worker& worker, std::promise<void>& started) {
+  Dispatcher dispatcher;
+  Event stopEvent(dispatcher);
+  worker.dispatcher = &dispatcher;
+  worker.stopEvent = &stopEvent;
+  started.set_value();
+
+  // Remotely spawned operations are executed while the main context waits here
+  stopEvent.wait();
+}
+
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <system/Dispatcher.h>
+#include <system/Event.h>
+#include <system/InterruptedException.h>
+
+namespace System {
+
+// Fixed set of threads, each running its own dispatcher. Work is routed to a dispatcher by an index (a shard),
+// so operations submitted with the same index are executed on the same thread in submission order.
+class DispatcherPool {
+public:
+  explicit DispatcherPool(size_t threadCount);
+  DispatcherPool(const DispatcherPool&) = delete;
+  ~DispatcherPool();
+  DispatcherPool& operator=(const DispatcherPool&) = delete;
+
+  size_t size() const;
+  Dispatcher& getDispatcher(size_t shard);
+
+  // Execute operation on dispatcher 'shard % size()', running other tasks on the caller dispatcher until it completes.
+  // Returns operation's result or rethrows its exception. Interruption is deferred until the operation completes.
+  template<class T> T run(Dispatcher& caller, size_t shard, std::function<T()>&& operation);
+
+private:
+  struct Worker {
+    std::thread thread;
+    Dispatcher* dispatcher;
+    Event* stopEvent;
+  };
+
+  void workerProcedure(Worker& worker, std::promise<void>& started);
+
+  std::vector<Worker> workers;
+};
+
+template<class T> T DispatcherPool::run(Dispatcher& caller, size_t shard, std::function<T()>&& operation) {
+  std::packaged_task<T()> task(std::move(operation));
+  std::future<T> result = task.get_future();
+  Event completed(caller);
+
+  getDispatcher(shard).remoteSpawn([&] {
+    task();
+    // 'completed' is alive until it is set, the caller is waiting for it
+    auto localEvent = &completed;
+    caller.remoteSpawn([localEvent] { localEvent->set(); });
+  });
+
+  bool interrupted = false;
+  while (!completed.get()) {
+    try {
+      completed.wait();
+    } catch (InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    caller.interrupt();
+  }
+
+  return result.get();
+}
+
+}
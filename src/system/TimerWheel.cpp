@@ -0,0 +1,245 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "TimerWheel.h"
+#include <cassert>
+#include <limits>
+
+namespace System {
+
+namespace {
+
+const unsigned SLOT_MASK = TimerWheel::SLOT_COUNT - 1;
+
+// Ticks representable by the wheel, farther entries are parked in the last slot and placed again on cascade
+const uint64_t WHEEL_RANGE = uint64_t(1) << (TimerWheel::SLOT_BITS * TimerWheel::LEVEL_COUNT);
+
+unsigned levelShift(unsigned level) {
+  return TimerWheel::SLOT_BITS * level;
+}
+
+}
+
+TimerWheel::TimerWheel(uint64_t currentTick) : currentTick(currentTick), entryCount(0) {
+  for (Level& level : levels) {
+    for (Slot& slot : level.slots) {
+      slot.first = nullptr;
+      slot.last = nullptr;
+    }
+
+    for (uint64_t& word : level.occupied) {
+      word = 0;
+    }
+
+    level.count = 0;
+  }
+}
+
+bool TimerWheel::empty() const {
+  return entryCount == 0;
+}
+
+size_t TimerWheel::size() const {
+  return entryCount;
+}
+
+uint64_t TimerWheel::getCurrentTick() const {
+  return currentTick;
+}
+
+void TimerWheel::insert(Entry& entry) {
+  // current tick is already processed
+  if (entry.expires <= currentTick) {
+    entry.expires = currentTick + 1;
+  }
+
+  place(entry);
+}
+
+void TimerWheel::remove(Entry& entry) {
+  Level& level = levels[entry.level];
+  Slot& slot = level.slots[entry.slot];
+  if (entry.prev != nullptr) {
+    entry.prev->next = entry.next;
+  } else {
+    assert(slot.first == &entry);
+    slot.first = entry.next;
+  }
+
+  if (entry.next != nullptr) {
+    entry.next->prev = entry.prev;
+  } else {
+    assert(slot.last == &entry);
+    slot.last = entry.prev;
+  }
+
+  if (slot.first == nullptr) {
+    level.occupied[entry.slot / 64] &= ~(uint64_t(1) << (entry.slot % 64));
+  }
+
+  assert(level.count > 0 && entryCount > 0);
+  --level.count;
+  --entryCount;
+}
+
+TimerWheel::Entry* TimerWheel::advance(uint64_t tick) {
+  Entry* first = nullptr;
+  Entry* last = nullptr;
+  while (currentTick < tick) {
+    if (entryCount == 0) {
+      currentTick = tick;
+      break;
+    }
+
+    // Nothing happens until the next cascade of the lowest non-empty level
+    unsigned emptyLevels = 0;
+    while (levels[emptyLevels].count == 0) {
+      ++emptyLevels;
+    }
+
+    if (emptyLevels > 0) {
+      uint64_t lastQuietTick = currentTick | ((uint64_t(1) << levelShift(emptyLevels)) - 1);
+      if (lastQuietTick >= tick) {
+        currentTick = tick;
+        break;
+      }
+
+      currentTick = lastQuietTick;
+    }
+
+    ++currentTick;
+    if ((currentTick & SLOT_MASK) == 0) {
+      unsigned top = 1;
+      while (top + 1 < LEVEL_COUNT && ((currentTick >> levelShift(top)) & SLOT_MASK) == 0) {
+        ++top;
+      }
+
+      for (unsigned level = top; level > 0; --level) {
+        cascade(level);
+      }
+    }
+
+    unsigned index = currentTick & SLOT_MASK;
+    if (levels[0].slots[index].first != nullptr) {
+      append(first, last, levels[0].slots[index], 0, index);
+    }
+  }
+
+  if (last != nullptr) {
+    last->next = nullptr;
+  }
+
+  return first;
+}
+
+uint64_t TimerWheel::getNextTick() const {
+  assert(entryCount > 0);
+  uint64_t next = std::numeric_limits<uint64_t>::max();
+  for (unsigned level = 0; level < LEVEL_COUNT; ++level) {
+    if (levels[level].count == 0) {
+      continue;
+    }
+
+    uint64_t nextBlock = (currentTick >> levelShift(level)) + 1;
+    unsigned from = nextBlock & SLOT_MASK;
+    int index = findOccupied(level, from);
+    assert(index >= 0);
+    uint64_t tick = (nextBlock + ((static_cast<unsigned>(index) - from) & SLOT_MASK)) << levelShift(level);
+    if (tick < next) {
+      next = tick;
+    }
+  }
+
+  return next;
+}
+
+void TimerWheel::place(Entry& entry) {
+  uint64_t delta = entry.expires - currentTick;
+  uint64_t expires = entry.expires;
+  unsigned level = 0;
+  while (level + 1 < LEVEL_COUNT && delta >= (uint64_t(1) << levelShift(level + 1))) {
+    ++level;
+  }
+
+  if (delta >= WHEEL_RANGE) {
+    expires = currentTick + WHEEL_RANGE - 1;
+  }
+
+  unsigned index = (expires >> levelShift(level)) & SLOT_MASK;
+  Level& target = levels[level];
+  Slot& slot = target.slots[index];
+  entry.level = static_cast<uint8_t>(level);
+  entry.slot = static_cast<uint8_t>(index);
+  entry.next = nullptr;
+  entry.prev = slot.last;
+  if (slot.last != nullptr) {
+    slot.last->next = &entry;
+  } else {
+    slot.first = &entry;
+  }
+
+  slot.last = &entry;
+  target.occupied[index / 64] |= uint64_t(1) << (index % 64);
+  ++target.count;
+  ++entryCount;
+}
+
+void TimerWheel::cascade(unsigned level) {
+  unsigned index = (currentTick >> levelShift(level)) & SLOT_MASK;
+  Entry* first = nullptr;
+  Entry* last = nullptr;
+  if (levels[level].slots[index].first == nullptr) {
+    return;
+  }
+
+  append(first, last, levels[level].slots[index], level, index);
+  last->next = nullptr;
+  while (first != nullptr) {
+    Entry* entry = first;
+    first = first->next;
+    place(*entry);
+  }
+}
+
+void TimerWheel::append(Entry*& first, Entry*& last, Slot& slot, unsigned level, unsigned index) {
+  size_t count = 0;
+  for (Entry* entry = slot.first; entry != nullptr; entry = entry->next) {
+    ++count;
+  }
+
+  if (last != nullptr) {
+    last->next = slot.first;
+    slot.first->prev = last;
+  } else {
+    first = slot.first;
+  }
+
+  last = slot.last;
+  slot.first = nullptr;
+  slot.last = nullptr;
+  levels[level].occupied[index / 64] &= ~(uint64_t(1) << (index % 64));
+  levels[level].count -= count;
+  entryCount -= count;
+}
+
+int TimerWheel::findOccupied(unsigned level, unsigned from) const {
+  for (unsigned scanned = 0; scanned < SLOT_COUNT + 64;) {
+    unsigned index = (from + scanned) & SLOT_MASK;
+    uint64_t word = levels[level].occupied[index / 64] >> (index % 64);
+    if (word != 0) {
+      while ((word & 1) == 0) {
+        word >>= 1;
+        ++index;
+      }
+
+      return static_cast<int>(index);
+    }
+
+    scanned += 64 - index % 64;
+  }
+
+  return -1;
+}
+
+}
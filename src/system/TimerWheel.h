@@ -0,0 +1,69 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace System {
+
+// Hierarchical timing wheel: 4 levels of 256 slots, one tick per slot at the lowest level.
+// Entries are intrusive and owned by the caller, insertion and removal are O(1).
+class TimerWheel {
+public:
+  struct Entry {
+    uint64_t expires; // tick
+    void* context;
+    Entry* prev;
+    Entry* next;
+    uint8_t level;
+    uint8_t slot;
+  };
+
+  static const unsigned SLOT_BITS = 8;
+  static const unsigned SLOT_COUNT = 1 << SLOT_BITS;
+  static const unsigned LEVEL_COUNT = 4;
+
+  explicit TimerWheel(uint64_t currentTick = 0);
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  bool empty() const;
+  size_t size() const;
+  uint64_t getCurrentTick() const;
+
+  // Entry expiring at or before current tick expires on the next tick.
+  void insert(Entry& entry);
+  void remove(Entry& entry);
+
+  // Moves wheel to 'tick' and returns expired entries linked through 'next', or nullptr.
+  Entry* advance(uint64_t tick);
+
+  // Earliest tick the wheel has to be advanced to, never later than the earliest expiration. Wheel must not be empty.
+  uint64_t getNextTick() const;
+
+private:
+  struct Slot {
+    Entry* first;
+    Entry* last;
+  };
+
+  struct Level {
+    Slot slots[SLOT_COUNT];
+    uint64_t occupied[SLOT_COUNT / 64];
+    size_t count;
+  };
+
+  void place(Entry& entry);
+  void cascade(unsigned level);
+  void append(Entry*& first, Entry*& last, Slot& slot, unsigned level, unsigned index);
+  int findOccupied(unsigned level, unsigned from) const;
+
+  Level levels[LEVEL_COUNT];
+  uint64_t currentTick;
+  size_t entryCount;
+};
+
+}
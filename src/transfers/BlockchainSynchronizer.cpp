@@ -27,9 +27,11 @@ inline std::vector<uint8_t> stringToVector(const std::string& s) {
 
 namespace cryptonote {
 
-BlockchainSynchronizer::BlockchainSynchronizer(INode& node, const Hash& genesisBlockHash) :
+BlockchainSynchronizer::BlockchainSynchronizer(INode& node, const Hash& genesisBlockHash, size_t blockCacheSize) :
   m_node(node),
   m_genesisBlockHash(genesisBlockHash),
+  m_blockCacheSize(blockCacheSize),
+  m_blockCacheStart(0),
   m_currentState(State::stopped),
   m_futureState(State::stopped) {
 }
@@ -332,6 +334,8 @@ BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistor
 }
 
 void BlockchainSynchronizer::startBlockchainSync() {
+  updateConsumersFromCache();
+
   GetBlocksResponse response;
   GetBlocksRequest req = getCommonHistory();
 
@@ -340,7 +344,7 @@ void BlockchainSynchronizer::startBlockchainSync() {
       auto queryBlocksCompleted = std::promise<std::error_code>();
       auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
 
-      m_node.queryBlocks(
+      m_node.queryBlocksScan(
         std::move(req.knownBlocks),
         req.syncStart.timestamp,
         response.newBlocks,
@@ -376,15 +380,17 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
     }
 
     CompleteBlock completeBlock;
-    completeBlock.blockHash = block.blockHash;
+    completeBlock.blockHash = block.blockId;
     interval.blocks.push_back(completeBlock.blockHash);
-    if (block.hasBlock) {
-      completeBlock.block = std::move(block.block);
-      completeBlock.transactions.push_back(createTransactionPrefix(completeBlock.block->baseTransaction));
+    if (!block.transactions.empty()) {
+      completeBlock.block = Block();
+      static_cast<BlockHeader&>(*completeBlock.block) = block.header;
+      completeBlock.globalIndexes.reserve(block.transactions.size());
 
       try {
-        for (const auto& txShortInfo : block.txsShortInfo) {
-          completeBlock.transactions.push_back(createTransactionPrefix(txShortInfo.txPrefix, reinterpret_cast<const Hash&>(txShortInfo.txId)));
+        for (auto& tx : block.transactions) {
+          completeBlock.transactions.push_back(createTransactionPrefix(tx.txPrefix, tx.txHash));
+          completeBlock.globalIndexes.push_back(std::move(tx.globalIndexes));
         }
       } catch (std::exception&) {
         setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
@@ -401,6 +407,10 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
     response.newBlocks.clear();
     std::unique_lock<std::mutex> lk(m_consumersMutex);
     auto result = updateConsumers(interval, blocks);
+    if (result != UpdateConsumersResult::errorOccurred) {
+      addBlocksToCache(response.startHeight, blocks);
+    }
+
     lk.unlock();
 
     switch (result) {
@@ -464,6 +474,73 @@ BlockchainSynchronizer::UpdateConsumersResult BlockchainSynchronizer::updateCons
   return smthChanged ? UpdateConsumersResult::addedNewBlocks : UpdateConsumersResult::nothingChanged;
 }
 
+void BlockchainSynchronizer::updateConsumersFromCache() {
+  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  if (m_blockCache.empty()) {
+    return;
+  }
+
+  uint32_t cacheEnd = m_blockCacheStart + static_cast<uint32_t>(m_blockCache.size());
+  for (auto& kv : m_consumers) {
+    if (checkIfShouldStop()) {
+      break;
+    }
+
+    // the last known block of the consumer has to be cached, so that new blocks continue its chain
+    uint32_t height = kv.second->getHeight();
+    if (height <= m_blockCacheStart || height >= cacheEnd ||
+      kv.second->getKnownBlockHashes()[height - 1] != m_blockCache[height - 1 - m_blockCacheStart].blockHash) {
+      continue;
+    }
+
+    uint32_t offset = height - m_blockCacheStart;
+    uint32_t count = cacheEnd - height;
+    if (kv.first->onNewBlocks(m_blockCache.data() + offset, height, count)) {
+      std::vector<Hash> blockHashes;
+      blockHashes.reserve(count);
+      for (uint32_t i = offset; i < m_blockCache.size(); ++i) {
+        blockHashes.push_back(m_blockCache[i].blockHash);
+      }
+
+      kv.second->addBlocks(blockHashes.data(), height, count);
+    }
+  }
+}
+
+/// \pre m_consumersMutex is locked
+void BlockchainSynchronizer::addBlocksToCache(uint32_t startHeight, const std::vector<CompleteBlock>& blocks) {
+  if (m_blockCacheSize == 0 || blocks.empty()) {
+    return;
+  }
+
+  // blocks replace cached ones on the same heights, a gap restarts the cache
+  uint32_t cacheEnd = m_blockCacheStart + static_cast<uint32_t>(m_blockCache.size());
+  if (startHeight < m_blockCacheStart || startHeight > cacheEnd) {
+    m_blockCache.clear();
+    m_blockCacheStart = startHeight;
+  } else {
+    m_blockCache.resize(startHeight - m_blockCacheStart);
+  }
+
+  for (const auto& block : blocks) {
+    // blocks before the sync start of all consumers come without transactions
+    if (!block.block.is_initialized()) {
+      m_blockCache.clear();
+      m_blockCacheStart = startHeight + 1;
+    } else {
+      m_blockCache.push_back(block);
+    }
+
+    ++startHeight;
+  }
+
+  if (m_blockCache.size() > m_blockCacheSize) {
+    size_t excess = m_blockCache.size() - m_blockCacheSize;
+    m_blockCache.erase(m_blockCache.begin(), m_blockCache.begin() + excess);
+    m_blockCacheStart += static_cast<uint32_t>(excess);
+  }
+}
+
 void BlockchainSynchronizer::startPoolSync() {
   std::unordered_set<crypto::Hash> unionPoolHistory;
   std::unordered_set<crypto::Hash> intersectedPoolHistory;
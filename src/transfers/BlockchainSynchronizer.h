@@ -22,7 +22,9 @@ class BlockchainSynchronizer :
   public INodeObserver {
 public:
 
-  BlockchainSynchronizer(INode& node, const crypto::Hash& genesisBlockHash);
+  // Keeps up to 'blockCacheSize' of the most recently received blocks, consumers lagging behind within them
+  // catch up from the cache without querying the node
+  BlockchainSynchronizer(INode& node, const crypto::Hash& genesisBlockHash, size_t blockCacheSize = 0);
   ~BlockchainSynchronizer();
 
   // IBlockchainSynchronizer
@@ -50,7 +52,7 @@ private:
 
   struct GetBlocksResponse {
     uint32_t startHeight;
-    std::vector<BlockShortEntry> newBlocks;
+    std::vector<BlockScanInfo> newBlocks;
   };
 
   struct GetBlocksRequest {
@@ -92,6 +94,8 @@ private:
 
   void processBlocks(GetBlocksResponse& response);
   UpdateConsumersResult updateConsumers(const BlockchainInterval& interval, const std::vector<CompleteBlock>& blocks);
+  void updateConsumersFromCache();
+  void addBlocksToCache(uint32_t startHeight, const std::vector<CompleteBlock>& blocks);
   std::error_code processPoolTxs(GetPoolResponse& response);
   std::error_code getPoolSymmetricDifferenceSync(GetPoolRequest&& request, GetPoolResponse& response);
   std::error_code doAddUnconfirmedTransaction(const ITransactionReader& transaction);
@@ -119,6 +123,11 @@ private:
 
   crypto::Hash lastBlockId;
 
+  // Consecutive blocks with transactions, the first one is at 'm_blockCacheStart'. Guarded by m_consumersMutex.
+  const size_t m_blockCacheSize;
+  std::vector<CompleteBlock> m_blockCache;
+  uint32_t m_blockCacheStart;
+
   State m_currentState;
   State m_futureState;
   std::unique_ptr<std::thread> workingThread;
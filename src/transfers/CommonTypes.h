@@ -22,9 +22,12 @@ struct BlockchainInterval {
 
 struct CompleteBlock {
   crypto::Hash blockHash;
+  // only the header is filled in for blocks received as BlockScanInfo
   boost::optional<cryptonote::Block> block;
   // first transaction is always coinbase
   std::list<std::shared_ptr<ITransactionReader>> transactions;
+  // output global indexes of every transaction when the node sent them, they are requested separately otherwise
+  std::vector<std::vector<uint32_t>> globalIndexes;
 };
 
 }
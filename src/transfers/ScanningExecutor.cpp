@@ -0,0 +1,176 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ScanningExecutor.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace cryptonote {
+
+namespace {
+
+uint64_t makeRange(uint64_t begin, uint64_t end) {
+  return (begin << 32) | end;
+}
+
+}
+
+ScanningExecutor::ScanningExecutor(size_t threadCount) : m_stopped(false) {
+  m_threads.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_threads.emplace_back(&ScanningExecutor::workerProc, this, i);
+  }
+}
+
+ScanningExecutor::~ScanningExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+
+  m_haveJobs.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+ScanningExecutor& ScanningExecutor::instance() {
+  static ScanningExecutor executor(std::max(std::thread::hardware_concurrency(), 2u));
+  return executor;
+}
+
+size_t ScanningExecutor::getThreadCount() const {
+  return m_threads.size();
+}
+
+void ScanningExecutor::run(size_t chunkCount, const std::function<void(size_t)>& task) {
+  if (chunkCount == 0) {
+    return;
+  }
+
+  assert(chunkCount <= UINT32_MAX);
+
+  // the calling thread takes the last range
+  Job job;
+  job.task = &task;
+  job.rangeCount = m_threads.size() + 1;
+  job.ranges.reset(new std::atomic<uint64_t>[job.rangeCount]);
+  job.workers = 0;
+  for (size_t i = 0; i < job.rangeCount; ++i) {
+    job.ranges[i] = makeRange(chunkCount * i / job.rangeCount, chunkCount * (i + 1) / job.rangeCount);
+  }
+
+  if (chunkCount > 1 && !m_threads.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.push_back(&job);
+    }
+
+    m_haveJobs.notify_all();
+  }
+
+  runJob(job, m_threads.size());
+
+  // no chunks are left to take, wait for the ones taken by workers
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    removeJob(&job);
+    while (job.workers != 0) {
+      m_workerDone.wait(lock);
+    }
+  }
+
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+void ScanningExecutor::workerProc(size_t slot) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    while (!m_stopped && m_jobs.empty()) {
+      m_haveJobs.wait(lock);
+    }
+
+    if (m_stopped) {
+      break;
+    }
+
+    Job* job = m_jobs.front();
+    ++job->workers;
+    lock.unlock();
+
+    runJob(*job, slot);
+
+    lock.lock();
+    removeJob(job);
+    --job->workers;
+    m_workerDone.notify_all();
+  }
+}
+
+void ScanningExecutor::runJob(Job& job, size_t slot) {
+  size_t chunk;
+  for (;;) {
+    bool taken = takeFront(job.ranges[slot], chunk);
+    for (size_t i = 1; !taken && i < job.rangeCount; ++i) {
+      taken = takeBack(job.ranges[(slot + i) % job.rangeCount], chunk);
+    }
+
+    if (!taken) {
+      break;
+    }
+
+    try {
+      (*job.task)(chunk);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.errorMutex);
+      if (!job.error) {
+        job.error = std::current_exception();
+      }
+    }
+  }
+}
+
+void ScanningExecutor::removeJob(Job* job) {
+  auto it = std::find(m_jobs.begin(), m_jobs.end(), job);
+  if (it != m_jobs.end()) {
+    m_jobs.erase(it);
+  }
+}
+
+bool ScanningExecutor::takeFront(std::atomic<uint64_t>& range, size_t& chunk) {
+  uint64_t value = range.load();
+  for (;;) {
+    uint64_t begin = value >> 32;
+    uint64_t end = value & UINT32_MAX;
+    if (begin >= end) {
+      return false;
+    }
+
+    if (range.compare_exchange_weak(value, makeRange(begin + 1, end))) {
+      chunk = static_cast<size_t>(begin);
+      return true;
+    }
+  }
+}
+
+bool ScanningExecutor::takeBack(std::atomic<uint64_t>& range, size_t& chunk) {
+  uint64_t value = range.load();
+  for (;;) {
+    uint64_t begin = value >> 32;
+    uint64_t end = value & UINT32_MAX;
+    if (begin >= end) {
+      return false;
+    }
+
+    if (range.compare_exchange_weak(value, makeRange(begin, end - 1))) {
+      chunk = static_cast<size_t>(end - 1);
+      return true;
+    }
+  }
+}
+
+}
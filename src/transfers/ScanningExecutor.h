@@ -0,0 +1,66 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cryptonote {
+
+// Fixed set of threads scanning transactions for all transfers consumers of the process.
+// A job is split into chunks, every participating thread takes chunks from its own range and steals from the back of
+// others' ranges once it runs out. The thread running a job takes part in it, so jobs may run from any thread.
+class ScanningExecutor {
+public:
+  explicit ScanningExecutor(size_t threadCount);
+  ~ScanningExecutor();
+
+  ScanningExecutor(const ScanningExecutor&) = delete;
+  ScanningExecutor& operator=(const ScanningExecutor&) = delete;
+
+  // Shared executor with a thread per hardware thread, created on first use
+  static ScanningExecutor& instance();
+
+  size_t getThreadCount() const;
+
+  // Calls 'task' for every chunk index in [0, chunkCount) and returns when all calls are done.
+  // Each chunk is processed by a single thread. The first exception thrown by 'task' is rethrown.
+  void run(size_t chunkCount, const std::function<void(size_t)>& task);
+
+private:
+  struct Job {
+    const std::function<void(size_t)>* task;
+    // Unprocessed chunks of every participant, begin in the high half and end in the low half
+    std::unique_ptr<std::atomic<uint64_t>[]> ranges;
+    size_t rangeCount;
+    size_t workers;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+  };
+
+  void workerProc(size_t slot);
+  void runJob(Job& job, size_t slot);
+  // Called with the mutex locked
+  void removeJob(Job* job);
+  static bool takeFront(std::atomic<uint64_t>& range, size_t& chunk);
+  static bool takeBack(std::atomic<uint64_t>& range, size_t& chunk);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_haveJobs;
+  std::condition_variable m_workerDone;
+  std::deque<Job*> m_jobs;
+  bool m_stopped;
+};
+
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "SharedBlockchainSynchronizer.h"
+
+#include <cassert>
+
+namespace cryptonote {
+
+SharedBlockchainSynchronizer::SharedBlockchainSynchronizer(INode& node, const crypto::Hash& genesisBlockHash, size_t blockCacheSize) :
+  m_sync(node, genesisBlockHash, blockCacheSize),
+  m_pauseCount(0),
+  m_consumerCount(0),
+  m_started(false),
+  m_running(false) {
+}
+
+SharedBlockchainSynchronizer::~SharedBlockchainSynchronizer() {
+  m_sync.stop();
+}
+
+void SharedBlockchainSynchronizer::pause() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ++m_pauseCount;
+  update();
+}
+
+void SharedBlockchainSynchronizer::resume() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  assert(m_pauseCount > 0);
+  --m_pauseCount;
+  update();
+}
+
+void SharedBlockchainSynchronizer::addObserver(IBlockchainSynchronizerObserver* observer) {
+  m_sync.addObserver(observer);
+}
+
+void SharedBlockchainSynchronizer::removeObserver(IBlockchainSynchronizerObserver* observer) {
+  m_sync.removeObserver(observer);
+}
+
+void SharedBlockchainSynchronizer::addConsumer(IBlockchainConsumer* consumer) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ++m_pauseCount;
+  update();
+
+  try {
+    m_sync.addConsumer(consumer);
+    ++m_consumerCount;
+  } catch (...) {
+    --m_pauseCount;
+    update();
+    throw;
+  }
+
+  --m_pauseCount;
+  update();
+}
+
+bool SharedBlockchainSynchronizer::removeConsumer(IBlockchainConsumer* consumer) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  ++m_pauseCount;
+  update();
+
+  bool removed = m_sync.removeConsumer(consumer);
+  if (removed) {
+    --m_consumerCount;
+  }
+
+  --m_pauseCount;
+  update();
+  return removed;
+}
+
+IStreamSerializable* SharedBlockchainSynchronizer::getConsumerState(IBlockchainConsumer* consumer) const {
+  return m_sync.getConsumerState(consumer);
+}
+
+std::vector<crypto::Hash> SharedBlockchainSynchronizer::getConsumerKnownBlocks(IBlockchainConsumer& consumer) const {
+  return m_sync.getConsumerKnownBlocks(consumer);
+}
+
+std::future<std::error_code> SharedBlockchainSynchronizer::addUnconfirmedTransaction(const ITransactionReader& transaction) {
+  return m_sync.addUnconfirmedTransaction(transaction);
+}
+
+std::future<void> SharedBlockchainSynchronizer::removeUnconfirmedTransaction(const crypto::Hash& transactionHash) {
+  return m_sync.removeUnconfirmedTransaction(transactionHash);
+}
+
+void SharedBlockchainSynchronizer::start() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_started = true;
+  update();
+}
+
+void SharedBlockchainSynchronizer::stop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_started = false;
+  update();
+}
+
+void SharedBlockchainSynchronizer::save(std::ostream& os) {
+  m_sync.save(os);
+}
+
+void SharedBlockchainSynchronizer::load(std::istream& in) {
+  m_sync.load(in);
+}
+
+void SharedBlockchainSynchronizer::update() {
+  bool run = m_started && m_pauseCount == 0 && m_consumerCount != 0;
+  if (run && !m_running) {
+    m_sync.start();
+    m_running = true;
+  } else if (!run && m_running) {
+    m_sync.stop();
+    m_running = false;
+  }
+}
+
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "BlockchainSynchronizer.h"
+
+#include <mutex>
+
+namespace cryptonote {
+
+// Blockchain synchronizer shared by the wallets of a process, blocks are downloaded once for all of them.
+// Consumers may be added and removed at any time, the synchronizer is stopped for that while it runs. It runs when
+// started, has consumers and nobody holds it paused. Consumer states may only be accessed while holding it paused.
+class SharedBlockchainSynchronizer : public IBlockchainSynchronizer {
+public:
+  SharedBlockchainSynchronizer(INode& node, const crypto::Hash& genesisBlockHash, size_t blockCacheSize);
+  virtual ~SharedBlockchainSynchronizer();
+
+  void pause();
+  void resume();
+
+  // IObservable
+  virtual void addObserver(IBlockchainSynchronizerObserver* observer) override;
+  virtual void removeObserver(IBlockchainSynchronizerObserver* observer) override;
+
+  // IBlockchainSynchronizer
+  virtual void addConsumer(IBlockchainConsumer* consumer) override;
+  virtual bool removeConsumer(IBlockchainConsumer* consumer) override;
+  virtual IStreamSerializable* getConsumerState(IBlockchainConsumer* consumer) const override;
+  virtual std::vector<crypto::Hash> getConsumerKnownBlocks(IBlockchainConsumer& consumer) const override;
+
+  virtual std::future<std::error_code> addUnconfirmedTransaction(const ITransactionReader& transaction) override;
+  virtual std::future<void> removeUnconfirmedTransaction(const crypto::Hash& transactionHash) override;
+
+  // Start and stop synchronization for all consumers, start does nothing when already started
+  virtual void start() override;
+  virtual void stop() override;
+
+  // IStreamSerializable
+  virtual void save(std::ostream& os) override;
+  virtual void load(std::istream& in) override;
+
+private:
+  // Called with the mutex locked
+  void update();
+
+  BlockchainSynchronizer m_sync;
+  std::mutex m_mutex;
+  size_t m_pauseCount;
+  size_t m_consumerCount;
+  bool m_started;
+  bool m_running;
+};
+
+}
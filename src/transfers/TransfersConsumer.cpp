@@ -4,10 +4,12 @@
 
 #include "TransfersConsumer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <numeric>
 
 #include "CommonTypes.h"
-#include "common/BlockingQueue.h"
+#include "ScanningExecutor.h"
 #include "cryptonote/core/CryptoNoteFormatUtils.h"
 #include "cryptonote/core/TransactionApi.h"
 
@@ -21,6 +23,9 @@ namespace {
 
 using namespace cryptonote;
 
+// Transactions scanned by a single task of the scanning executor
+const size_t TRANSACTIONS_PER_SCAN_CHUNK = 8;
+
 void checkOutputKey(
   const KeyDerivation& derivation,
   const PublicKey& key,
@@ -180,105 +185,91 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   struct Tx {
     TransactionBlockInfo blockInfo;
     const ITransactionReader* tx;
+    const std::vector<uint32_t>* globalIdxs;
   };
 
   struct PreprocessedTx : Tx, PreprocessInfo {};
 
-  std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
-
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
+  std::vector<Tx> transactions;
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-  BlockingQueue<Tx> inputQueue(workers * 2);
-
-  std::atomic<bool> stopProcessing(false);
+    if (!block.is_initialized()) {
+      continue;
+    }
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      continue;
+    }
 
-      if (!block.is_initialized()) {
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
+
+    const auto& globalIndexes = blocks[i].globalIndexes;
+    bool hasGlobalIndexes = globalIndexes.size() == blocks[i].transactions.size();
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey == NULL_PUBLIC_KEY) {
+        ++blockInfo.transactionIndex;
         continue;
       }
 
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
-        continue;
-      }
+      Tx item = { blockInfo, tx.get(), hasGlobalIndexes ? &globalIndexes[blockInfo.transactionIndex] : nullptr };
+      transactions.push_back(item);
+      ++blockInfo.transactionIndex;
+    }
+  }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
+  // every chunk has its own result buffer, chunks are concatenated in order afterwards
+  size_t chunkCount = (transactions.size() + TRANSACTIONS_PER_SCAN_CHUNK - 1) / TRANSACTIONS_PER_SCAN_CHUNK;
+  std::vector<std::vector<PreprocessedTx>> chunkResults(chunkCount);
+  std::vector<std::error_code> chunkErrors(chunkCount);
+  std::atomic<bool> stopProcessing(false);
 
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
+  std::error_code processingError;
+  try {
+    ScanningExecutor::instance().run(chunkCount, [&](size_t chunk) {
+      size_t first = chunk * TRANSACTIONS_PER_SCAN_CHUNK;
+      size_t last = std::min(first + TRANSACTIONS_PER_SCAN_CHUNK, transactions.size());
+      auto& results = chunkResults[chunk];
+      results.reserve(last - first);
+      for (size_t i = first; i < last && !stopProcessing; ++i) {
+        PreprocessedTx output;
+        static_cast<Tx&>(output) = transactions[i];
+
+        std::error_code ec = preprocessOutputs(transactions[i].blockInfo, *transactions[i].tx, output, transactions[i].globalIdxs);
+        if (ec) {
+          chunkErrors[chunk] = ec;
+          stopProcessing = true;
+          break;
         }
 
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
-      }
-    }
-
-    inputQueue.close();
-  });
-
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
-
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+        results.push_back(std::move(output));
       }
+    });
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
-    }
-    return ec;
-  };
-
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
-
-  std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
-      }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
+    auto it = std::find_if(chunkErrors.begin(), chunkErrors.end(), [](const std::error_code& ec) { return static_cast<bool>(ec); });
+    if (it != chunkErrors.end()) {
+      processingError = *it;
     }
+  } catch (const std::system_error& e) {
+    processingError = e.code();
+  } catch (const std::exception&) {
+    processingError = std::make_error_code(std::errc::operation_canceled);
   }
 
   std::vector<crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
-
-    for (const auto& tx : preprocessedTransactions) {
-      processTransaction(tx.blockInfo, *tx.tx, tx);
+    // chunks hold consecutive transactions ordered by block height and position in block
+    for (const auto& results : chunkResults) {
+      for (const auto& tx : results) {
+        processTransaction(tx.blockInfo, *tx.tx, tx);
+      }
     }
   } else {
     forEachSubscription([&](TransfersSubscription& sub) {
@@ -414,7 +405,8 @@ std::error_code createTransfers(
   return std::error_code();
 }
 
-std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
+std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info,
+  const std::vector<uint32_t>* knownGlobalIdxs) {
   std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
   findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
 
@@ -425,9 +417,13 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
   std::error_code errorCode;
   auto txHash = tx.getTransactionHash();
   if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
-    errorCode = getGlobalIndices(reinterpret_cast<const Hash&>(txHash), info.globalIdxs);
-    if (errorCode) {
-      return errorCode;
+    if (knownGlobalIdxs != nullptr && knownGlobalIdxs->size() == tx.getOutputCount()) {
+      info.globalIdxs = *knownGlobalIdxs;
+    } else {
+      errorCode = getGlobalIndices(reinterpret_cast<const Hash&>(txHash), info.globalIdxs);
+      if (errorCode) {
+        return errorCode;
+      }
     }
   }
 
@@ -0,0 +1,152 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "WalletScanConsumer.h"
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <unordered_set>
+
+#include "CommonTypes.h"
+#include "cryptonote/core/TransactionApi.h"
+
+namespace cryptonote {
+
+WalletScanConsumer::WalletScanConsumer(INode& node, IBlockchainConsumer& consumer) :
+  m_node(node),
+  m_consumer(consumer),
+  m_registered(false),
+  m_registrationId(0),
+  m_registrationToken(NULL_HASH),
+  m_nextSequence(0) {
+}
+
+template <typename Request>
+std::error_code WalletScanConsumer::waitFor(Request&& request) {
+  auto completed = std::promise<std::error_code>();
+  auto waitFuture = completed.get_future();
+
+  request([&completed](std::error_code ec) {
+    auto detachedPromise = std::move(completed);
+    detachedPromise.set_value(ec);
+  });
+
+  return waitFuture.get();
+}
+
+std::error_code WalletScanConsumer::registerKeys(const crypto::SecretKey& viewSecretKey, const std::vector<crypto::PublicKey>& spendPublicKeys,
+  uint32_t startHeight) {
+  uint64_t registrationId = 0;
+  crypto::Hash registrationToken = NULL_HASH;
+  std::error_code ec = waitFor([&](const INode::Callback& callback) {
+    m_node.registerWalletScan(viewSecretKey, std::vector<crypto::PublicKey>(spendPublicKeys), startHeight, registrationId, registrationToken, callback);
+  });
+
+  if (!ec) {
+    m_registered = true;
+    m_registrationId = registrationId;
+    m_registrationToken = registrationToken;
+    m_nextSequence = 0;
+  }
+
+  return ec;
+}
+
+std::error_code WalletScanConsumer::unregister() {
+  if (!m_registered) {
+    return std::error_code();
+  }
+
+  std::error_code ec = waitFor([&](const INode::Callback& callback) {
+    m_node.unregisterWalletScan(m_registrationId, m_registrationToken, callback);
+  });
+
+  m_registered = false;
+  return ec;
+}
+
+std::error_code WalletScanConsumer::watchKeyImages(std::vector<crypto::KeyImage>&& keyImages) {
+  if (!m_registered) {
+    return std::make_error_code(std::errc::not_connected);
+  }
+
+  return waitFor([&](const INode::Callback& callback) {
+    m_node.watchWalletScanKeyImages(m_registrationId, m_registrationToken, std::move(keyImages), callback);
+  });
+}
+
+std::error_code WalletScanConsumer::processEvents(uint32_t& scannedHeight) {
+  if (!m_registered) {
+    return std::make_error_code(std::errc::not_connected);
+  }
+
+  for (;;) {
+    std::vector<WalletScanEvent> events;
+    std::error_code ec = waitFor([&](const INode::Callback& callback) {
+      m_node.getWalletScanEvents(m_registrationId, m_registrationToken, m_nextSequence, EVENTS_PER_REQUEST, events, scannedHeight, callback);
+    });
+
+    if (ec) {
+      return ec;
+    }
+
+    // Events come ordered by sequence, the transactions of a block are consecutive
+    auto it = events.cbegin();
+    while (it != events.cend()) {
+      if (it->sequence < m_nextSequence) {
+        ++it;
+        continue;
+      }
+
+      if (it->detach) {
+        m_consumer.onBlockchainDetach(it->height);
+        m_nextSequence = it->sequence + 1;
+        ++it;
+        continue;
+      }
+
+      auto blockEnd = std::find_if(it, events.cend(), [&it](const WalletScanEvent& event) {
+        return event.detach || event.blockId != it->blockId;
+      });
+
+      try {
+        if (!pushBlock(it, blockEnd)) {
+          return std::make_error_code(std::errc::invalid_argument);
+        }
+      } catch (std::exception&) {
+        return std::make_error_code(std::errc::invalid_argument);
+      }
+
+      m_nextSequence = std::prev(blockEnd)->sequence + 1;
+      it = blockEnd;
+    }
+
+    if (events.size() < EVENTS_PER_REQUEST) {
+      return std::error_code();
+    }
+  }
+}
+
+bool WalletScanConsumer::pushBlock(std::vector<WalletScanEvent>::const_iterator begin, std::vector<WalletScanEvent>::const_iterator end) {
+  CompleteBlock block;
+  block.blockHash = begin->blockId;
+  block.block = Block();
+  block.block->timestamp = begin->timestamp;
+
+  // A transaction both paying and spending from the wallet may be reported once for each
+  std::unordered_set<crypto::Hash> added;
+  for (auto event = begin; event != end; ++event) {
+    if (!added.insert(event->transaction.txHash).second) {
+      continue;
+    }
+
+    block.transactions.push_back(createTransactionPrefix(event->transaction.txPrefix, event->transaction.txHash));
+    block.globalIndexes.push_back(event->transaction.globalIndexes);
+  }
+
+  return m_consumer.onNewBlocks(&block, begin->height, 1);
+}
+
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+#include "INode.h"
+#include "IBlockchainSynchronizer.h"
+
+namespace cryptonote {
+
+// Receives the transactions found by the daemon side wallet scanner and pushes them to a blockchain consumer,
+// in place of the blocks the BlockchainSynchronizer downloads and scans locally
+class WalletScanConsumer {
+public:
+  static const uint32_t EVENTS_PER_REQUEST = 100;
+
+  WalletScanConsumer(INode& node, IBlockchainConsumer& consumer);
+
+  std::error_code registerKeys(const crypto::SecretKey& viewSecretKey, const std::vector<crypto::PublicKey>& spendPublicKeys, uint32_t startHeight);
+  std::error_code unregister();
+  std::error_code watchKeyImages(std::vector<crypto::KeyImage>&& keyImages);
+  // Fetches every pending event, scannedHeight is the height the daemon has scanned up to
+  std::error_code processEvents(uint32_t& scannedHeight);
+
+  bool isRegistered() const { return m_registered; }
+
+private:
+  template <typename Request>
+  std::error_code waitFor(Request&& request);
+
+  bool pushBlock(std::vector<WalletScanEvent>::const_iterator begin, std::vector<WalletScanEvent>::const_iterator end);
+
+  INode& m_node;
+  IBlockchainConsumer& m_consumer;
+  bool m_registered;
+  uint64_t m_registrationId;
+  crypto::Hash m_registrationToken;
+  uint64_t m_nextSequence;
+};
+
+}
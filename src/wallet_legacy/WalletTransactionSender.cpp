@@ -174,8 +174,6 @@ std::shared_ptr<WalletRequest> WalletTransactionSender::doSendTransaction(std::s
     Transaction tx;
     constructTx(m_keys, sources, splittedDests, transaction.extra, transaction.unlockTime, m_upperTransactionSizeLimit, tx);
 
-    getObjectHash(tx, transaction.hash);
-
     m_transactionsCache.updateTransaction(context->transactionId, tx, totalAmount, context->selectedTransfers);
 
     notifyBalanceChanged(events);
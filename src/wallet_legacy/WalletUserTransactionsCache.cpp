@@ -7,6 +7,7 @@
 #include "wallet_legacy/WalletUserTransactionsCache.h"
 #include "wallet_legacy/WalletLegacySerialization.h"
 #include "wallet_legacy/WalletUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
 
 #include "serialization/ISerializer.h"
 #include "serialization/SerializationOverloads.h"
@@ -25,6 +26,7 @@ bool WalletUserTransactionsCache::serialize(cryptonote::ISerializer& s) {
     s(m_transfers, "transfers");
     s(m_unconfirmedTransactions, "unconfirmed");
 
+    rebuildIndexes();
     updateUnconfirmedTransactions();
     deleteOutdatedTransactions();
   } else {
@@ -66,6 +68,8 @@ TransactionId WalletUserTransactionsCache::addNewTransaction(
   transaction.totalAmount = -static_cast<int64_t>(amount);
   transaction.fee = fee;
   transaction.sentTime = time(nullptr);
+  // known once the transaction is created, see updateTransaction
+  transaction.hash = NULL_HASH;
   transaction.isCoinbase = false;
   transaction.timestamp = 0;
   transaction.extra = extra;
@@ -78,9 +82,11 @@ TransactionId WalletUserTransactionsCache::addNewTransaction(
 
 void WalletUserTransactionsCache::updateTransaction(
   TransactionId transactionId, const cryptonote::Transaction& tx, uint64_t amount, const std::list<TransactionOutputInformation>& usedOutputs) {
-  // update extra field from created transaction
+  // update extra field and hash from created transaction
   auto& txInfo = m_transactions.at(transactionId);
   txInfo.extra.assign(tx.extra.begin(), tx.extra.end());
+  txInfo.hash = getObjectHash(tx);
+  m_transactionsByHash.emplace(txInfo.hash, transactionId);
   m_unconfirmedTransactions.add(tx, transactionId, amount, usedOutputs);
 }
 
@@ -166,21 +172,16 @@ std::shared_ptr<WalletLegacyEvent> WalletUserTransactionsCache::onTransactionDel
 
 TransactionId WalletUserTransactionsCache::findTransactionByTransferId(TransferId transferId) const
 {
-  TransactionId id;
-  for (id = 0; id < m_transactions.size(); ++id) {
-    const WalletLegacyTransaction& tx = m_transactions[id];
-
-    if (tx.firstTransferId == WALLET_LEGACY_INVALID_TRANSFER_ID || tx.transferCount == 0)
-      continue;
-
-    if (transferId >= tx.firstTransferId && transferId < (tx.firstTransferId + tx.transferCount))
-      break;
-  }
+  auto it = m_transactionsByTransfer.upper_bound(transferId);
+  if (it == m_transactionsByTransfer.begin())
+    return WALLET_LEGACY_INVALID_TRANSACTION_ID;
 
-  if (id == m_transactions.size())
+  --it;
+  const WalletLegacyTransaction& tx = m_transactions[it->second];
+  if (transferId >= tx.firstTransferId + tx.transferCount)
     return WALLET_LEGACY_INVALID_TRANSACTION_ID;
 
-  return id;
+  return it->second;
 }
 
 bool WalletUserTransactionsCache::getTransaction(TransactionId transactionId, WalletLegacyTransaction& transaction) const
@@ -205,16 +206,17 @@ bool WalletUserTransactionsCache::getTransfer(TransferId transferId, WalletLegac
 
 TransactionId WalletUserTransactionsCache::insertTransaction(WalletLegacyTransaction&& Transaction) {
   m_transactions.emplace_back(std::move(Transaction));
-  return m_transactions.size() - 1;
+  TransactionId id = m_transactions.size() - 1;
+  indexTransaction(id);
+  return id;
 }
 
 TransactionId WalletUserTransactionsCache::findTransactionByHash(const Hash& hash) {
-  auto it = std::find_if(m_transactions.begin(), m_transactions.end(), [&hash](const WalletLegacyTransaction& tx) { return tx.hash == hash; });
-
-  if (it == m_transactions.end())
+  auto it = m_transactionsByHash.find(hash);
+  if (it == m_transactionsByHash.end())
     return cryptonote::WALLET_LEGACY_INVALID_TRANSACTION_ID;
 
-  return std::distance(m_transactions.begin(), it);
+  return it->second;
 }
 
 bool WalletUserTransactionsCache::isUsed(const TransactionOutputInformation& out) const {
@@ -281,6 +283,27 @@ void WalletUserTransactionsCache::updateUnconfirmedTransactions() {
   }
 }
 
+void WalletUserTransactionsCache::indexTransaction(TransactionId id) {
+  const WalletLegacyTransaction& tx = m_transactions[id];
+
+  // transactions being sent get their hash once created, the first transaction with a hash is found by it
+  if (tx.hash != NULL_HASH) {
+    m_transactionsByHash.emplace(tx.hash, id);
+  }
+
+  if (tx.firstTransferId != WALLET_LEGACY_INVALID_TRANSFER_ID && tx.transferCount != 0) {
+    m_transactionsByTransfer.emplace(tx.firstTransferId, id);
+  }
+}
+
+void WalletUserTransactionsCache::rebuildIndexes() {
+  m_transactionsByHash.clear();
+  m_transactionsByTransfer.clear();
+  for (TransactionId id = 0; id < m_transactions.size(); ++id) {
+    indexTransaction(id);
+  }
+}
+
 WalletLegacyTransfer& WalletUserTransactionsCache::getTransfer(TransferId transferId) {
   return m_transfers.at(transferId);
 }
@@ -289,6 +312,8 @@ void WalletUserTransactionsCache::reset() {
   m_transactions.clear();
   m_transfers.clear();
   m_unconfirmedTransactions.reset();
+  m_transactionsByHash.clear();
+  m_transactionsByTransfer.clear();
 }
 
 std::vector<TransactionId> WalletUserTransactionsCache::deleteOutdatedTransactions() {
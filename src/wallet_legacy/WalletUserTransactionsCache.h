@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <map>
+#include <unordered_map>
+
 #include "crypto/hash.h"
 #include "IWalletLegacy.h"
 #include "ITransfersContainer.h"
@@ -54,6 +57,8 @@ private:
   TransactionId insertTransaction(WalletLegacyTransaction&& Transaction);
   TransferId insertTransfers(const std::vector<WalletLegacyTransfer>& transfers);
   void updateUnconfirmedTransactions();
+  void indexTransaction(TransactionId id);
+  void rebuildIndexes();
 
   typedef std::vector<WalletLegacyTransfer> UserTransfers;
   typedef std::vector<WalletLegacyTransaction> UserTransactions;
@@ -66,6 +71,11 @@ private:
   UserTransactions m_transactions;
   UserTransfers m_transfers;
   WalletUnconfirmedTransactions m_unconfirmedTransactions;
+
+  // Lookup indexes, not serialized and rebuilt on load
+  std::unordered_map<crypto::Hash, TransactionId> m_transactionsByHash;
+  // first transfer id -> transaction owning transfers [first, first + transferCount)
+  std::map<TransferId, TransactionId> m_transactionsByTransfer;
 };
 
 } //namespace cryptonote
@@ -0,0 +1,71 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ChainSwitchDepth.h"
+#include "TestGenerator.h"
+
+using namespace cryptonote;
+
+ChainSwitchDepth::ChainSwitchDepth(size_t depth) : m_depth(depth), m_mainChainHeight(0) {
+  REGISTER_CALLBACK_METHOD(ChainSwitchDepth, markSwitchStart);
+  REGISTER_CALLBACK_METHOD(ChainSwitchDepth, checkSwitched);
+}
+
+bool ChainSwitchDepth::generate(std::vector<test_event_entry>& events) const {
+  TestGenerator generator(m_currency, events);
+  generator.generateBlocks();
+
+  AccountBase altMinerAccount;
+  altMinerAccount.generate();
+
+  Block splitBlock = generator.lastBlock;
+  std::vector<Transaction> transactions;
+  for (size_t i = 0; i < m_depth; ++i) {
+    auto builder = generator.createTxBuilder(generator.minerAccount, generator.minerAccount, MK_COINS(1), m_currency.minimumFee());
+    auto tx = builder.build();
+    generator.addEvent(tx);
+    generator.makeNextBlock(tx);
+    transactions.push_back(tx);
+  }
+
+  Block altBlock = splitBlock;
+  for (size_t i = 0; i <= m_depth; ++i) {
+    std::list<Transaction> txs;
+    if (i < transactions.size()) {
+      txs.push_back(transactions[i]);
+    }
+
+    Block next;
+    generator.generator.constructBlock(next, altBlock, altMinerAccount, txs);
+    if (i == m_depth) {
+      generator.addCallback("markSwitchStart");
+    }
+
+    generator.addEvent(next);
+    altBlock = next;
+  }
+
+  generator.addCallback("checkSwitched");
+  return true;
+}
+
+bool ChainSwitchDepth::markSwitchStart(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  m_mainChainHeight = c.get_current_blockchain_height();
+  m_switchStart = std::chrono::steady_clock::now();
+  return true;
+}
+
+bool ChainSwitchDepth::checkSwitched(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events) {
+  DEFINE_TESTS_ERROR_CONTEXT("ChainSwitchDepth::checkSwitched");
+
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_switchStart).count();
+
+  CHECK_EQ(m_mainChainHeight + 1, c.get_current_blockchain_height());
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(boost::get<Block>(events[ev_index - 1])));
+  CHECK_EQ(m_depth, c.get_alternative_blocks_count());
+  CHECK_EQ(0, c.get_pool_transactions_count());
+
+  std::cout << "Chain switch of depth " << m_depth << " took " << duration << " us" << std::endl;
+  return true;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+
+#include "Chaingen.h"
+
+// Reorganization of the given depth: the main chain gets `depth` blocks with one transaction each
+// past the split point, then an alternative chain with the same transactions and one more block
+// takes over. Reports how long the block causing the switch took to be handled.
+struct ChainSwitchDepth : public test_chain_unit_base
+{
+  ChainSwitchDepth(size_t depth);
+
+  bool generate(std::vector<test_event_entry>& events) const;
+
+private:
+  bool markSwitchStart(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool checkSwitched(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+  const size_t m_depth;
+  uint32_t m_mainChainHeight;
+  std::chrono::steady_clock::time_point m_switchStart;
+};
@@ -10,6 +10,7 @@
 #include "BlockValidation.h"
 #include "ChainSplit1.h"
 #include "ChainSwitch1.h"
+#include "ChainSwitchDepth.h"
 #include "Chaingen001.h"
 #include "DoubleSpend.h"
 #include "IntegerOverflow.h"
@@ -74,6 +75,9 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(gen_simple_chain_split_1);
     GENERATE_AND_PLAY(one_block);
     GENERATE_AND_PLAY(gen_chain_switch_1);
+    GENERATE_AND_PLAY_EX(ChainSwitchDepth(1));
+    GENERATE_AND_PLAY_EX(ChainSwitchDepth(5));
+    GENERATE_AND_PLAY_EX(ChainSwitchDepth(20));
     GENERATE_AND_PLAY(gen_ring_signature_1);
     GENERATE_AND_PLAY(gen_ring_signature_2);
     //GENERATE_AND_PLAY(gen_ring_signature_big); // Takes up to XXX hours (if CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW == 10)
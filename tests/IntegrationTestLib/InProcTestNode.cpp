@@ -10,6 +10,7 @@
 #include <logging/ConsoleLogger.h>
 
 #include "cryptonote/core/Core.h"
+#include "cryptonote/core/CryptoNoteTools.h"
 #include "cryptonote/core/Account.h"
 #include "command_line/CoreConfig.h"
 #include "cryptonote/core/Miner.h"
@@ -188,4 +189,21 @@ uint64_t InProcTestNode::getLocalHeight() {
   return core->get_current_blockchain_height();
 }
 
+size_t InProcTestNode::getPoolTransactionsCount() {
+  return core->get_pool_transactions_count();
+}
+
+uint64_t InProcTestNode::getPoolTransactionsSize() {
+  uint64_t size = 0;
+  for (const auto& tx : core->getPoolTransactions()) {
+    size += cryptonote::getObjectBinarySize(tx);
+  }
+
+  return size;
+}
+
+uint64_t InProcTestNode::getP2pBytesSent() {
+  return p2pNode->getBytesSent();
+}
+
 }
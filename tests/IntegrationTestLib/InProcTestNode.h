@@ -37,6 +37,10 @@ public:
   virtual bool makeINode(std::unique_ptr<cryptonote::INode>& node) override;
   virtual uint64_t getLocalHeight() override;
 
+  size_t getPoolTransactionsCount();
+  uint64_t getPoolTransactionsSize();
+  uint64_t getP2pBytesSent();
+
 private:
 
   void workerThread(std::promise<std::string>& initPromise);
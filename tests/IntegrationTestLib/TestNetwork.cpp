@@ -55,6 +55,8 @@ void copyBlockchainFiles(bool testnet, const std::string& from, const std::strin
   auto files = {
     std::make_pair("blockindexes.dat", true),
     std::make_pair("blocks.dat", true),
+    std::make_pair("rawblockindexes.dat", false),
+    std::make_pair("rawblocks.dat", false),
     std::make_pair("blockscache.dat", false),
     std::make_pair("blockchainindices.dat", false)
   };
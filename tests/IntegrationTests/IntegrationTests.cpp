@@ -6,6 +6,7 @@
 #include <logging/LoggerRef.h>
 
 #include "../IntegrationTestLib/BaseFunctionalTests.h"
+#include "../IntegrationTestLib/InProcTestNode.h"
 #include "../IntegrationTestLib/NodeObserver.h"
 
 #include "wallet_legacy/WalletLegacy.h"
@@ -220,3 +221,46 @@ TEST_F(IntegrationTest, BlockPropagationSpeed) {
     nodeDaemons.front()->stopMining();
   }
 }
+
+TEST_F(IntegrationTest, TransactionPropagationTraffic) {
+  const size_t NODES_COUNT = 5;
+  const size_t TRANSACTIONS_COUNT = 5;
+
+  launchInprocTestnet(NODES_COUNT, Ring);
+  makeINodes();
+  makeWallets();
+
+  mineMoneyForWallet(0, 0);
+
+  auto bytesSent = [this] {
+    uint64_t bytes = 0;
+    for (auto& daemon : nodeDaemons) {
+      bytes += static_cast<Tests::InProcTestNode&>(*daemon).getP2pBytesSent();
+    }
+    return bytes;
+  };
+
+  uint64_t bytesBefore = bytesSent();
+  uint64_t amount = wallets[0]->actualBalance() / (2 * TRANSACTIONS_COUNT);
+  for (size_t i = 0; i < TRANSACTIONS_COUNT; ++i) {
+    ASSERT_TRUE(!transferMoney(0, 1, amount, currency.minimumFee()));
+  }
+
+  for (auto& daemon : nodeDaemons) {
+    auto& node = static_cast<Tests::InProcTestNode&>(*daemon);
+    size_t attempts = 0;
+    while (node.getPoolTransactionsCount() < TRANSACTIONS_COUNT) {
+      ASSERT_LT(attempts++, 100U) << "transactions were not propagated to every node";
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+
+  uint64_t bytesPerTransaction = (bytesSent() - bytesBefore) / TRANSACTIONS_COUNT;
+  uint64_t transactionSize = static_cast<Tests::InProcTestNode&>(*nodeDaemons.front()).getPoolTransactionsSize() / TRANSACTIONS_COUNT;
+  logger(INFO) << "Bytes sent per transaction propagated to " << NODES_COUNT << " nodes: " << bytesPerTransaction <<
+    ", transaction size " << transactionSize;
+
+  // flooding sends the blob over every ring link the transaction did not come from, NODES_COUNT + 1 times,
+  // announcements send it only to the NODES_COUNT - 1 nodes that miss it
+  ASSERT_LT(bytesPerTransaction, (NODES_COUNT + 1) * transactionSize);
+}
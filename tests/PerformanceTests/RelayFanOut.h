@@ -0,0 +1,182 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <list>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
+#include <logging/LoggerGroup.h>
+#include <system/Context.h>
+#include <system/ContextGroup.h>
+#include <system/Dispatcher.h>
+#include <system/Event.h>
+#include <system/InterruptedException.h>
+#include <system/Ipv4Address.h>
+#include <system/TcpConnection.h>
+#include <system/TcpConnector.h>
+
+#include "command_line/NetNodeConfig.h"
+#include "cryptonote/core/Core.h"
+#include "cryptonote/core/Currency.h"
+#include "cryptonote/core/Miner.h"
+#include "cryptonote/protocol/definitions.h"
+#include "cryptonote/protocol/handler.h"
+#include "p2p/LevinProtocol.h"
+#include "p2p/NetNode.h"
+#include "p2p/P2pNetworks.h"
+
+// Cost of relaying one notification to every peer: NodeServer::relay_notify_to_all queues the payload
+// to each connection, and the connection write handlers frame it with the Levin header and send it
+// with the gathered TcpConnection::write. Peers are local sockets that read the frames back.
+template<size_t peer_count, size_t payload_size>
+class test_relay_fan_out {
+public:
+  static const size_t loop_count = payload_size < 64 * 1024 ? 1000 : 10;
+  static const uint16_t node_port = 18190;
+  static const uint32_t relay_command = cryptonote::NOTIFY_NEW_TRANSACTIONS::ID;
+
+  test_relay_fan_out() :
+    m_dataDir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("relay_fan_out_%%%%%%%%%%%%")),
+    m_peers(m_dispatcher),
+    m_received(m_dispatcher),
+    m_pendingPeers(0),
+    m_bytesReceived(0) {
+  }
+
+  ~test_relay_fan_out() {
+    m_peers.interrupt();
+    m_peers.wait();
+
+    if (m_nodeContext) {
+      m_node->sendStopSignal();
+      m_nodeContext->get();
+      m_node->deinit();
+    }
+
+    if (m_core) {
+      m_core->deinit();
+    }
+
+    boost::filesystem::remove_all(m_dataDir);
+  }
+
+  bool init() {
+    using namespace cryptonote;
+
+    m_payload.resize(payload_size);
+    for (size_t i = 0; i < m_payload.size(); ++i) {
+      m_payload[i] = static_cast<uint8_t>(i);
+    }
+
+    boost::filesystem::create_directories(m_dataDir);
+    m_currency.reset(new Currency(CurrencyBuilder(m_logger, m_dataDir.string()).currency()));
+    m_core.reset(new core(*m_currency, nullptr, m_logger));
+    if (!m_core->init(MinerConfig(), false)) {
+      return false;
+    }
+
+    m_protocol.reset(new CryptoNoteProtocolHandler(*m_currency, m_dispatcher, *m_core, nullptr, m_logger));
+    m_node.reset(new NodeServer(m_dispatcher, *m_protocol, m_logger));
+    m_protocol->set_p2p_endpoint(m_node.get());
+
+    // testnet has no seed nodes, so the node doesn't connect anywhere by itself
+    NetNodeConfig config;
+    config.setTestnet(true);
+    config.setBindIp("127.0.0.1");
+    config.setBindPort(node_port);
+    config.setExternalPort(0);
+    config.setAllowLocalIp(true);
+    config.setHideMyPort(true);
+    config.setDispatcherThreads(1);
+    config.setConfigFolder(m_dataDir.string());
+    if (!m_node->init(config)) {
+      return false;
+    }
+
+    m_nodeContext.reset(new System::Context<>(m_dispatcher, [this] { m_node->run(); }));
+
+    try {
+      for (size_t i = 0; i < peer_count; ++i) {
+        m_connections.emplace_back(System::TcpConnector(m_dispatcher).connect(System::Ipv4Address("127.0.0.1"), node_port));
+        if (!handshake(m_connections.back(), i + 1)) {
+          return false;
+        }
+      }
+    } catch (std::exception&) {
+      return false;
+    }
+
+    for (auto& connection : m_connections) {
+      m_peers.spawn([this, &connection] { readFrames(connection); });
+    }
+
+    // the node sends its own messages right after the handshake, let the peers drain them
+    return test();
+  }
+
+  bool test() {
+    m_bytesReceived = 0;
+    m_pendingPeers = peer_count;
+    static_cast<cryptonote::IP2pEndpoint&>(*m_node).relay_notify_to_all(relay_command, m_payload, nullptr);
+
+    m_received.wait();
+    m_received.clear();
+    return m_bytesReceived == peer_count * (sizeof(cryptonote::bucket_head2) + payload_size);
+  }
+
+private:
+  bool handshake(System::TcpConnection& connection, cryptonote::PeerIdType peerId) {
+    using namespace cryptonote;
+
+    COMMAND_HANDSHAKE::request request;
+    request.node_data.network_id = CRYPTONOTE_NETWORK;
+    request.node_data.network_id.data[0] += 1;
+    request.node_data.version = P2PProtocolVersion::CURRENT;
+    request.node_data.local_time = time(nullptr);
+    request.node_data.my_port = 0;
+    request.node_data.peer_id = peerId;
+    m_protocol->get_payload_sync_data(request.payload_data);
+
+    COMMAND_HANDSHAKE::response response;
+    LevinProtocol proto(connection);
+    return proto.invoke(COMMAND_HANDSHAKE::ID, request, response);
+  }
+
+  void readFrames(System::TcpConnection& connection) {
+    try {
+      cryptonote::LevinProtocol proto(connection);
+      cryptonote::LevinProtocol::Command cmd;
+      while (proto.readCommand(cmd)) {
+        if (cmd.command != relay_command) {
+          continue;
+        }
+
+        m_bytesReceived += sizeof(cryptonote::bucket_head2) + cmd.buf.size();
+        if (--m_pendingPeers == 0) {
+          m_received.set();
+        }
+      }
+    } catch (System::InterruptedException&) {
+    } catch (std::exception&) {
+    }
+  }
+
+  Logging::LoggerGroup m_logger;
+  System::Dispatcher m_dispatcher;
+  boost::filesystem::path m_dataDir;
+  std::unique_ptr<cryptonote::Currency> m_currency;
+  std::unique_ptr<cryptonote::core> m_core;
+  std::unique_ptr<cryptonote::CryptoNoteProtocolHandler> m_protocol;
+  std::unique_ptr<cryptonote::NodeServer> m_node;
+  std::unique_ptr<System::Context<>> m_nodeContext;
+  std::list<System::TcpConnection> m_connections;
+  System::ContextGroup m_peers;
+  System::Event m_received;
+  size_t m_pendingPeers;
+  size_t m_bytesReceived;
+  cryptonote::BinaryArray m_payload;
+};
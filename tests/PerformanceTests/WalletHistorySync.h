@@ -0,0 +1,69 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "wallet_legacy/WalletUserTransactionsCache.h"
+
+// Transaction events a legacy wallet with a long history handles while syncing: every transaction is added when its
+// block arrives, the outgoing ones are found by their transfers, some are rolled back by a reorganization and confirmed again.
+template<size_t transaction_count>
+class test_wallet_history_sync {
+public:
+  static const size_t loop_count = 10;
+  static const size_t transfers_per_outgoing = 2;
+
+  bool init() {
+    m_transactions.resize(transaction_count);
+    for (size_t i = 0; i < m_transactions.size(); ++i) {
+      auto& tx = m_transactions[i];
+      tx.transactionHash = crypto::rand<crypto::Hash>();
+      tx.blockHeight = static_cast<uint32_t>(i + 1);
+      tx.timestamp = i;
+      tx.unlockTime = 0;
+      tx.totalAmountIn = 2000;
+      tx.totalAmountOut = 1000;
+    }
+
+    m_transfers.resize(transfers_per_outgoing);
+    return true;
+  }
+
+  bool test() {
+    using namespace cryptonote;
+
+    WalletUserTransactionsCache cache;
+    for (size_t i = 0; i < m_transactions.size(); ++i) {
+      if (i % 2 == 0) {
+        cache.addNewTransaction(1000, 10, std::string(), m_transfers, 0);
+      }
+
+      cache.onTransactionUpdated(m_transactions[i], 1000);
+    }
+
+    size_t found = 0;
+    for (TransferId id = 0; id < cache.getTransferCount(); ++id) {
+      if (cache.findTransactionByTransferId(id) != WALLET_LEGACY_INVALID_TRANSACTION_ID) {
+        ++found;
+      }
+    }
+
+    for (size_t i = m_transactions.size() / 2; i < m_transactions.size(); ++i) {
+      cache.onTransactionDeleted(m_transactions[i].transactionHash);
+    }
+
+    for (size_t i = m_transactions.size() / 2; i < m_transactions.size(); ++i) {
+      cache.onTransactionUpdated(m_transactions[i], 1000);
+    }
+
+    return found == cache.getTransferCount() && cache.getTransactionCount() == transaction_count + (transaction_count + 1) / 2;
+  }
+
+private:
+  std::vector<cryptonote::TransactionInformation> m_transactions;
+  std::vector<cryptonote::WalletLegacyTransfer> m_transfers;
+};
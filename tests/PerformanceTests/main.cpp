@@ -15,6 +15,8 @@
 #include "GenerateKeyImage.h"
 #include "GenerateKeyImageHelper.h"
 #include "IsOutToAccount.h"
+#include "RelayFanOut.h"
+#include "WalletHistorySync.h"
 
 int main(int argc, char** argv)
 {
@@ -59,6 +61,17 @@ int main(int argc, char** argv)
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
 
+  TEST_PERFORMANCE2(test_relay_fan_out, 1, 1024);
+  TEST_PERFORMANCE2(test_relay_fan_out, 10, 1024);
+  TEST_PERFORMANCE2(test_relay_fan_out, 100, 1024);
+  TEST_PERFORMANCE2(test_relay_fan_out, 1, 1048576);
+  TEST_PERFORMANCE2(test_relay_fan_out, 10, 1048576);
+  TEST_PERFORMANCE2(test_relay_fan_out, 100, 1048576);
+
+  TEST_PERFORMANCE1(test_wallet_history_sync, 1000);
+  TEST_PERFORMANCE1(test_wallet_history_sync, 10000);
+  TEST_PERFORMANCE1(test_wallet_history_sync, 100000);
+
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
   return 0;
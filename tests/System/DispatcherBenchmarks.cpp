@@ -0,0 +1,278 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <system/ContextGroup.h>
+#include <system/Dispatcher.h>
+#include <system/Event.h>
+#include <system/Ipv4Address.h>
+#include <system/TcpConnection.h>
+#include <system/TcpConnector.h>
+#include <system/TcpListener.h>
+#include <system/Timer.h>
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace System;
+
+// The benchmarks take a while, so they are kept out of the test runs. Run them with
+// system_tests --gtest_filter=DispatcherBenchmarks.* --gtest_also_run_disabled_tests [--io-uring]
+namespace {
+
+const size_t TIMER_COUNT = 10000;
+const size_t TIMER_ROUNDS = 5;
+const size_t CONNECTION_COUNT = 10000;
+const size_t CONNECTION_ROUNDS = 10;
+const size_t SWITCH_COUNT = 1000000;
+const size_t SPAWN_COUNT = 100000;
+const size_t STREAM_CONNECTION_COUNT = 64;
+const size_t STREAM_SIZE = 16 * 1024 * 1024;
+const size_t STREAM_CHUNK_SIZE = 16 * 1024;
+const Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+const uint16_t LISTEN_PORT = 6677;
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// Each connection takes two descriptors, keep some for the process itself
+size_t availableConnectionCount() {
+#ifndef _WIN32
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur != RLIM_INFINITY) {
+      return std::min<size_t>(CONNECTION_COUNT, limit.rlim_cur > 128 ? (limit.rlim_cur - 128) / 2 : 0);
+    }
+  }
+#endif
+
+  return CONNECTION_COUNT;
+}
+
+#ifdef __linux__
+// Streams data over connections of a dispatcher using the given backend, returns MiB/s
+uint64_t streamThroughput(bool ioUring, uint16_t port) {
+  bool ioUringEnabled = Dispatcher::isIoUringEnabled();
+  Dispatcher::setIoUringEnabled(ioUring);
+  Dispatcher dispatcher;
+  Dispatcher::setIoUringEnabled(ioUringEnabled);
+  if (ioUring && dispatcher.getRing() == nullptr) {
+    return 0;
+  }
+
+  TcpListener listener(dispatcher, LISTEN_ADDRESS, port);
+  std::vector<TcpConnection> clients(STREAM_CONNECTION_COUNT);
+  std::vector<TcpConnection> servers(STREAM_CONNECTION_COUNT);
+  for (size_t i = 0; i < STREAM_CONNECTION_COUNT; ++i) {
+    clients[i] = TcpConnector(dispatcher).connect(LISTEN_ADDRESS, port);
+    servers[i] = listener.accept();
+  }
+
+  size_t received = 0;
+  auto start = Clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < STREAM_CONNECTION_COUNT; ++i) {
+      contextGroup.spawn([&clients, i] {
+        std::vector<uint8_t> chunk(STREAM_CHUNK_SIZE, static_cast<uint8_t>(i));
+        for (size_t sent = 0; sent < STREAM_SIZE;) {
+          sent += clients[i].write(chunk.data(), std::min(chunk.size(), STREAM_SIZE - sent));
+        }
+      });
+
+      contextGroup.spawn([&servers, &received, i] {
+        std::vector<uint8_t> chunk(STREAM_CHUNK_SIZE);
+        for (size_t read = 0; read < STREAM_SIZE;) {
+          size_t transferred = servers[i].read(chunk.data(), chunk.size());
+          read += transferred;
+          received += transferred;
+        }
+      });
+    }
+
+    contextGroup.wait();
+  }
+
+  uint64_t elapsed = std::max<uint64_t>(millisecondsSince(start), 1);
+  EXPECT_EQ(STREAM_CONNECTION_COUNT * STREAM_SIZE, received);
+  return received * 1000 / elapsed / (1024 * 1024);
+}
+#endif
+
+}
+
+TEST(DispatcherBenchmarks, DISABLED_concurrentTimers) {
+  Dispatcher dispatcher;
+  ContextGroup contextGroup(dispatcher);
+  std::mt19937 random(0);
+  std::chrono::milliseconds longestSleep(0);
+  size_t fired = 0;
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < TIMER_COUNT; ++i) {
+    std::chrono::milliseconds duration(1 + random() % 100);
+    longestSleep = std::max(longestSleep, duration);
+    contextGroup.spawn([&dispatcher, &fired, duration] {
+      Timer timer(dispatcher);
+      for (size_t round = 0; round < TIMER_ROUNDS; ++round) {
+        timer.sleep(duration);
+        ++fired;
+      }
+    });
+  }
+
+  contextGroup.wait();
+  uint64_t elapsed = millisecondsSince(start);
+
+  ASSERT_EQ(TIMER_COUNT * TIMER_ROUNDS, fired);
+  ASSERT_LE(static_cast<uint64_t>(longestSleep.count() * TIMER_ROUNDS), elapsed);
+  std::cout << TIMER_COUNT << " timers x " << TIMER_ROUNDS << " sleeps: " << elapsed << " ms, ideal " <<
+    longestSleep.count() * TIMER_ROUNDS << " ms" << std::endl;
+}
+
+TEST(DispatcherBenchmarks, DISABLED_concurrentConnections) {
+  size_t connectionCount = availableConnectionCount();
+  ASSERT_LT(0u, connectionCount);
+
+  Dispatcher dispatcher;
+  TcpListener listener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT);
+  std::vector<TcpConnection> clients(connectionCount);
+  std::vector<TcpConnection> servers(connectionCount);
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < connectionCount; ++i) {
+    clients[i] = TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT);
+    servers[i] = listener.accept();
+  }
+
+  uint64_t connectTime = millisecondsSince(start);
+
+  // Every connection does ping-pong with an idle timer running alongside, as peer connections with timeouts do
+  size_t exchanged = 0;
+  start = Clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < connectionCount; ++i) {
+      contextGroup.spawn([&dispatcher, &servers, &exchanged, i] {
+        ContextGroup timeout(dispatcher);
+        timeout.spawn([&dispatcher] {
+          Timer(dispatcher).sleep(std::chrono::seconds(60));
+        });
+
+        uint8_t byte;
+        for (size_t round = 0; round < CONNECTION_ROUNDS; ++round) {
+          servers[i].read(&byte, 1);
+          servers[i].write(&byte, 1);
+          ++exchanged;
+        }
+
+        timeout.interrupt();
+      });
+
+      contextGroup.spawn([&clients, i] {
+        uint8_t byte = static_cast<uint8_t>(i);
+        for (size_t round = 0; round < CONNECTION_ROUNDS; ++round) {
+          clients[i].write(&byte, 1);
+          clients[i].read(&byte, 1);
+        }
+      });
+    }
+
+    contextGroup.wait();
+  }
+
+  uint64_t exchangeTime = millisecondsSince(start);
+
+  ASSERT_EQ(connectionCount * CONNECTION_ROUNDS, exchanged);
+  std::cout << connectionCount << " connections: connected in " << connectTime << " ms, " << exchanged << " round trips in " <<
+    exchangeTime << " ms" << std::endl;
+}
+
+TEST(DispatcherBenchmarks, DISABLED_contextSwitches) {
+  Dispatcher dispatcher;
+  Event ping(dispatcher);
+  Event pong(dispatcher);
+  size_t switches = 0;
+
+  // Two contexts hand control to each other through events, no IO or timers involved
+  auto start = Clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    contextGroup.spawn([&] {
+      for (size_t i = 0; i < SWITCH_COUNT / 2; ++i) {
+        ping.wait();
+        ping.clear();
+        ++switches;
+        pong.set();
+      }
+    });
+
+    contextGroup.spawn([&] {
+      for (size_t i = 0; i < SWITCH_COUNT / 2; ++i) {
+        ping.set();
+        pong.wait();
+        pong.clear();
+        ++switches;
+      }
+    });
+
+    contextGroup.wait();
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+  ASSERT_EQ(SWITCH_COUNT, switches);
+  std::cout << SWITCH_COUNT << " context switches: " << elapsed / 1000000 << " ms, " << elapsed / SWITCH_COUNT <<
+    " ns per switch" << std::endl;
+}
+
+TEST(DispatcherBenchmarks, DISABLED_contextSpawns) {
+  Dispatcher dispatcher;
+  size_t executed = 0;
+
+  // Every context needs a stack, reused contexts keep theirs
+  auto start = Clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < SPAWN_COUNT; ++i) {
+      contextGroup.spawn([&executed] {
+        ++executed;
+      });
+    }
+
+    contextGroup.wait();
+  }
+
+  uint64_t elapsed = millisecondsSince(start);
+
+  ASSERT_EQ(SPAWN_COUNT, executed);
+  std::cout << SPAWN_COUNT << " concurrent contexts spawned and finished in " << elapsed << " ms" << std::endl;
+}
+
+#ifdef __linux__
+TEST(DispatcherBenchmarks, DISABLED_streamThroughput) {
+  uint64_t epollThroughput = streamThroughput(false, LISTEN_PORT);
+  uint64_t ioUringThroughput = streamThroughput(true, LISTEN_PORT + 1);
+  std::cout << STREAM_CONNECTION_COUNT << " connections streaming " << STREAM_SIZE / (1024 * 1024) << " MiB each: epoll " <<
+    epollThroughput << " MiB/s, io_uring ";
+  if (ioUringThroughput == 0) {
+    std::cout << "not supported" << std::endl;
+  } else {
+    std::cout << ioUringThroughput << " MiB/s" << std::endl;
+  }
+}
+#endif
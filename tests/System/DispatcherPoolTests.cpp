@@ -0,0 +1,74 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <system/DispatcherPool.h>
+#include <system/ContextGroup.h>
+#include <system/Dispatcher.h>
+#include <system/InterruptedException.h>
+#include <gtest/gtest.h>
+
+using namespace System;
+
+class DispatcherPoolTests : public testing::Test {
+public:
+  Dispatcher dispatcher;
+};
+
+TEST_F(DispatcherPoolTests, runReturnsResult) {
+  DispatcherPool pool(2);
+  ASSERT_EQ(42, pool.run<int>(dispatcher, 0, [] { return 42; }));
+}
+
+TEST_F(DispatcherPoolTests, runRethrowsException) {
+  DispatcherPool pool(2);
+  ASSERT_THROW(pool.run<void>(dispatcher, 1, [] { throw std::string("Hi there!"); }), std::string);
+}
+
+TEST_F(DispatcherPoolTests, runExecutesOnPoolThread) {
+  DispatcherPool pool(1);
+  auto threadId = pool.run<std::thread::id>(dispatcher, 0, [] { return std::this_thread::get_id(); });
+  ASSERT_NE(std::this_thread::get_id(), threadId);
+}
+
+TEST_F(DispatcherPoolTests, sameShardUsesSameThread) {
+  DispatcherPool pool(3);
+  auto first = pool.run<std::thread::id>(dispatcher, 4, [] { return std::this_thread::get_id(); });
+  auto second = pool.run<std::thread::id>(dispatcher, 4, [] { return std::this_thread::get_id(); });
+  auto other = pool.run<std::thread::id>(dispatcher, 5, [] { return std::this_thread::get_id(); });
+  ASSERT_EQ(first, second);
+  ASSERT_NE(first, other);
+}
+
+TEST_F(DispatcherPoolTests, callerDispatcherRunsOtherContextsWhileWaiting) {
+  DispatcherPool pool(2);
+  bool otherContextRan = false;
+  ContextGroup cg(dispatcher);
+  cg.spawn([&] {
+    pool.run<void>(dispatcher, 0, [] { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    ASSERT_TRUE(otherContextRan);
+  });
+
+  cg.spawn([&] {
+    otherContextRan = true;
+  });
+
+  cg.wait();
+}
+
+TEST_F(DispatcherPoolTests, interruptIsDeferredUntilCompletion) {
+  DispatcherPool pool(1);
+  bool completed = false;
+  ContextGroup cg(dispatcher);
+  cg.spawn([&] {
+    ASSERT_NO_THROW(pool.run<void>(dispatcher, 0, [&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      completed = true;
+    }));
+    ASSERT_TRUE(completed);
+    ASSERT_TRUE(dispatcher.interrupted());
+  });
+
+  cg.interrupt();
+  cg.wait();
+}
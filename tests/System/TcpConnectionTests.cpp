@@ -262,6 +262,50 @@ TEST_F(TcpConnectionTests, sendBigChunk) {
   ASSERT_EQ(buf, incoming);
 }
 
+TEST_F(TcpConnectionTests, sendBigChunkWithHeader) {
+  connect();
+
+  std::vector<uint8_t> header(33);
+  fillRandomBuf(header);
+  const size_t bufsize = 15 * 1024 * 1024; // 15MB
+  std::vector<uint8_t> buf(bufsize);
+  fillRandomBuf(buf);
+
+  std::vector<uint8_t> incoming;
+  Event readComplete(dispatcher);
+
+  contextGroup.spawn([&]{
+    uint8_t readBuf[1024];
+    size_t readSize;
+    while ((readSize = connection2.read(readBuf, sizeof(readBuf))) > 0) {
+      incoming.insert(incoming.end(), readBuf, readBuf + readSize);
+    }
+
+    readComplete.set();
+  });
+
+  contextGroup.spawn([&]{
+    size_t offset = 0;
+    while (offset < header.size()) {
+      offset += connection1.write(&header[offset], header.size() - offset, &buf[0], buf.size());
+    }
+
+    offset -= header.size();
+    while (offset < buf.size()) {
+      offset += connection1.write(&buf[offset], buf.size() - offset);
+    }
+
+    connection1 = TcpConnection(); // close connection
+  });
+
+  readComplete.wait();
+
+  std::vector<uint8_t> expected(header);
+  expected.insert(expected.end(), buf.begin(), buf.end());
+  ASSERT_EQ(expected.size(), incoming.size());
+  ASSERT_EQ(expected, incoming);
+}
+
 TEST_F(TcpConnectionTests, writeWhenReadWaiting) {
   connect();
 
@@ -0,0 +1,117 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <system/TimerWheel.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace System;
+
+namespace {
+
+std::vector<TimerWheel::Entry*> collect(TimerWheel::Entry* first) {
+  std::vector<TimerWheel::Entry*> entries;
+  for (; first != nullptr; first = first->next) {
+    entries.push_back(first);
+  }
+
+  return entries;
+}
+
+}
+
+TEST(TimerWheelTests, entryExpiresAtItsTick) {
+  TimerWheel wheel(1000);
+  TimerWheel::Entry entry;
+  entry.expires = 1010;
+  wheel.insert(entry);
+
+  ASSERT_EQ(1010, wheel.getNextTick());
+  ASSERT_EQ(nullptr, wheel.advance(1009));
+  ASSERT_EQ(std::vector<TimerWheel::Entry*>{&entry}, collect(wheel.advance(1010)));
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTests, expiredEntryExpiresOnNextTick) {
+  TimerWheel wheel(1000);
+  TimerWheel::Entry entry;
+  entry.expires = 10;
+  wheel.insert(entry);
+
+  ASSERT_EQ(1001, wheel.getNextTick());
+  ASSERT_EQ(1u, collect(wheel.advance(1001)).size());
+}
+
+TEST(TimerWheelTests, removedEntryDoesNotExpire) {
+  TimerWheel wheel;
+  TimerWheel::Entry first;
+  TimerWheel::Entry second;
+  first.expires = 100000;
+  second.expires = 100000;
+  wheel.insert(first);
+  wheel.insert(second);
+  wheel.remove(first);
+
+  ASSERT_EQ(1u, wheel.size());
+  ASSERT_EQ(std::vector<TimerWheel::Entry*>{&second}, collect(wheel.advance(100000)));
+}
+
+TEST(TimerWheelTests, distantEntryIsCascaded) {
+  TimerWheel wheel(5);
+  TimerWheel::Entry entry;
+  entry.expires = (uint64_t(1) << 40) + 7;
+  wheel.insert(entry);
+
+  while (!wheel.empty()) {
+    uint64_t next = wheel.getNextTick();
+    ASSERT_LE(next, entry.expires);
+    auto expired = collect(wheel.advance(next));
+    if (!expired.empty()) {
+      ASSERT_EQ(entry.expires, next);
+    }
+  }
+}
+
+TEST(TimerWheelTests, entriesExpireInTime) {
+  std::mt19937_64 random(0);
+  TimerWheel wheel(123456789);
+  std::vector<TimerWheel::Entry> entries(5000);
+  std::set<TimerWheel::Entry*> pending;
+  for (auto& entry : entries) {
+    uint64_t range = random() % 2 == 0 ? 300 : (random() % 2 == 0 ? 100000 : uint64_t(1) << 30);
+    entry.expires = wheel.getCurrentTick() + 1 + random() % range;
+    wheel.insert(entry);
+    pending.insert(&entry);
+  }
+
+  for (size_t i = 0; i < entries.size(); i += 3) {
+    wheel.remove(entries[i]);
+    pending.erase(&entries[i]);
+  }
+
+  while (!pending.empty()) {
+    uint64_t earliest = (*std::min_element(pending.begin(), pending.end(), [](TimerWheel::Entry* a, TimerWheel::Entry* b) {
+      return a->expires < b->expires;
+    }))->expires;
+
+    uint64_t next = wheel.getNextTick();
+    ASSERT_GT(next, wheel.getCurrentTick());
+    ASSERT_LE(next, earliest);
+
+    uint64_t tick = next + random() % 50;
+    for (auto entry : collect(wheel.advance(tick))) {
+      ASSERT_LE(entry->expires, tick);
+      ASSERT_EQ(1u, pending.erase(entry));
+    }
+
+    for (auto entry : pending) {
+      ASSERT_GT(entry->expires, tick);
+    }
+
+    ASSERT_EQ(pending.size(), wheel.size());
+  }
+}
@@ -2,9 +2,23 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <cstring>
 #include <gtest/gtest.h>
 
+#ifdef __linux__
+#include <system/Dispatcher.h>
+#endif
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
+#ifdef __linux__
+  // Runs the suite against the io_uring backend, where the kernel does not support it epoll is tested again
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--io-uring") == 0) {
+      System::Dispatcher::setIoUringEnabled(true);
+    }
+  }
+#endif
+
   return RUN_ALL_TESTS();
 }
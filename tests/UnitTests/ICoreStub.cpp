@@ -28,10 +28,12 @@ ICoreStub::ICoreStub(const cryptonote::Block& genesisBlock) :
 }
 
 bool ICoreStub::addObserver(cryptonote::ICoreObserver* observer) {
+  observerManager.add(observer);
   return true;
 }
 
 bool ICoreStub::removeObserver(cryptonote::ICoreObserver* observer) {
+  observerManager.remove(observer);
   return true;
 }
 
@@ -146,6 +148,48 @@ bool ICoreStub::queryBlocksLite(const std::vector<crypto::Hash>& block_ids, uint
   return true;
 }
 
+bool ICoreStub::queryBlocksScan(const std::vector<crypto::Hash>& block_ids, uint64_t timestamp,
+  uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<std::string>& entries) {
+  //stub
+  return true;
+}
+
+bool ICoreStub::getBlockScanInfo(uint32_t height, cryptonote::BlockScanInfo& block) {
+  std::lock_guard<std::mutex> lock(blocksMutex);
+  auto hashIt = blockHashByHeightIndex.find(height);
+  if (hashIt == blockHashByHeightIndex.end()) {
+    return false;
+  }
+
+  const cryptonote::Block& rawBlock = blocks[hashIt->second];
+  block.blockId = hashIt->second;
+  block.header = rawBlock;
+  block.transactions.clear();
+
+  auto addTransaction = [&block](const cryptonote::TransactionPrefix& prefix, const crypto::Hash& hash) {
+    cryptonote::TransactionScanInfo tx;
+    tx.txHash = hash;
+    tx.txPrefix = prefix;
+    for (uint32_t i = 0; i < prefix.outputs.size(); ++i) {
+      tx.globalIndexes.push_back(i);
+    }
+
+    block.transactions.push_back(std::move(tx));
+  };
+
+  addTransaction(rawBlock.baseTransaction, cryptonote::getObjectHash(rawBlock.baseTransaction));
+  for (const auto& txHash : rawBlock.transactionHashes) {
+    auto txIt = transactions.find(txHash);
+    if (txIt == transactions.end()) {
+      return false;
+    }
+
+    addTransaction(txIt->second, txHash);
+  }
+
+  return true;
+}
+
 std::vector<crypto::Hash> ICoreStub::buildSparseChain() {
   std::vector<crypto::Hash> result;
   result.reserve(blockHashByHeightIndex.size());
@@ -278,24 +322,54 @@ bool ICoreStub::getMultisigOutputReference(const cryptonote::MultisignatureInput
 void ICoreStub::addBlock(const cryptonote::Block& block) {
   uint32_t height = boost::get<cryptonote::BaseInput>(block.baseTransaction.inputs.front()).blockIndex;
   crypto::Hash hash = cryptonote::get_block_hash(block);
-  if (height > topHeight) {
-    topHeight = height;
-    topId = hash;
-  }
-  blocks.emplace(std::make_pair(hash, block));
-  blockHashByHeightIndex.emplace(std::make_pair(height, hash));
+  {
+    std::lock_guard<std::mutex> lock(blocksMutex);
+    if (height > topHeight) {
+      topHeight = height;
+      topId = hash;
+    }
+    blocks.emplace(std::make_pair(hash, block));
+    blockHashByHeightIndex.emplace(std::make_pair(height, hash));
 
-  blockHashByTxHashIndex.emplace(std::make_pair(cryptonote::getObjectHash(block.baseTransaction), hash));
-  for (auto txHash : block.transactionHashes) {
-    blockHashByTxHashIndex.emplace(std::make_pair(txHash, hash));
+    blockHashByTxHashIndex.emplace(std::make_pair(cryptonote::getObjectHash(block.baseTransaction), hash));
+    for (auto txHash : block.transactionHashes) {
+      blockHashByTxHashIndex.emplace(std::make_pair(txHash, hash));
+    }
   }
+
+  observerManager.notify(&cryptonote::ICoreObserver::blockPushed, height, hash);
 }
 
 void ICoreStub::addTransaction(const cryptonote::Transaction& tx) {
   crypto::Hash hash = cryptonote::getObjectHash(tx);
+  std::lock_guard<std::mutex> lock(blocksMutex);
   transactions.emplace(std::make_pair(hash, tx));
 }
 
+void ICoreStub::removeTopBlock() {
+  uint32_t height;
+  crypto::Hash hash;
+  {
+    std::lock_guard<std::mutex> lock(blocksMutex);
+    assert(topHeight > 0);
+    height = topHeight;
+    hash = topId;
+
+    const cryptonote::Block& block = blocks[hash];
+    blockHashByTxHashIndex.erase(cryptonote::getObjectHash(block.baseTransaction));
+    for (auto txHash : block.transactionHashes) {
+      blockHashByTxHashIndex.erase(txHash);
+    }
+
+    blocks.erase(hash);
+    blockHashByHeightIndex.erase(height);
+    topHeight = height - 1;
+    topId = blockHashByHeightIndex[topHeight];
+  }
+
+  observerManager.notify(&cryptonote::ICoreObserver::blockPopped, height, hash);
+}
+
 bool ICoreStub::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
   return true;
 }
@@ -336,6 +410,10 @@ bool ICoreStub::have_block(const crypto::Hash& id) {
   return blocks.count(id) > 0;
 }
 
+bool ICoreStub::haveTransaction(const crypto::Hash& id) {
+  return transactions.count(id) > 0 || transactionPool.count(id) > 0;
+}
+
 void ICoreStub::setPoolTxVerificationResult(bool result) {
   poolTxVerificationResult = result;
 }
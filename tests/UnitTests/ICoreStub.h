@@ -5,8 +5,10 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
 #include <unordered_map>
 
+#include "common/ObserverManager.h"
 #include "cryptonote/core/key.h"
 #include "cryptonote/core/ICore.h"
 #include "cryptonote/core/ICoreObserver.h"
@@ -39,8 +41,12 @@ public:
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<cryptonote::BlockFullInfo>& entries) override;
   virtual bool queryBlocksLite(const std::vector<crypto::Hash>& block_ids, uint64_t timestamp,
     uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<cryptonote::BlockShortInfo>& entries) override;
+  virtual bool queryBlocksScan(const std::vector<crypto::Hash>& block_ids, uint64_t timestamp,
+    uint32_t& start_height, uint32_t& current_height, uint32_t& full_offset, std::vector<std::string>& entries) override;
+  virtual bool getBlockScanInfo(uint32_t height, cryptonote::BlockScanInfo& block) override;
 
   virtual bool have_block(const crypto::Hash& id) override;
+  virtual bool haveTransaction(const crypto::Hash& id) override;
   std::vector<crypto::Hash> buildSparseChain() override;
   std::vector<crypto::Hash> buildSparseChain(const crypto::Hash& startBlockId) override;
   virtual bool get_stat_info(cryptonote::CoreStateInfo& st_inf) override { return false; }
@@ -64,6 +70,7 @@ public:
       uint64_t& reward, int64_t& emissionChange) override;
   virtual bool scanOutputkeysForIndices(const cryptonote::KeyInput& txInToKey, std::list<std::pair<crypto::Hash, size_t>>& outputReferences) override;
   virtual bool getBlockDifficulty(uint32_t height, cryptonote::difficulty_type& difficulty) override;
+  virtual cryptonote::difficulty_type getNextBlockDifficulty() override { return 1; }
   virtual bool getBlockContainingTx(const crypto::Hash& txId, crypto::Hash& blockId, uint32_t& blockHeight) override;
   virtual bool getMultisigOutputReference(const cryptonote::MultisignatureInput& txInMultisig, std::pair<crypto::Hash, size_t>& outputReference) override;
 
@@ -86,11 +93,17 @@ public:
 
   void addBlock(const cryptonote::Block& block);
   void addTransaction(const cryptonote::Transaction& tx);
+  // Removes the top block added with addBlock, observers are notified about both
+  void removeTopBlock();
 
   void setPoolTxVerificationResult(bool result);
   void setPoolChangesResult(bool result);
 
 private:
+  // guards blocks and transactions for getBlockScanInfo, which is called from other threads
+  std::mutex blocksMutex;
+  Tools::ObserverManager<cryptonote::ICoreObserver> observerManager;
+
   uint32_t topHeight;
   crypto::Hash topId;
 
@@ -267,6 +267,39 @@ void INodeTrivialRefreshStub::queryBlocks(std::vector<crypto::Hash>&& knownBlock
 
 }
 
+void INodeTrivialRefreshStub::queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp,
+        std::vector<BlockScanInfo>& newBlocks, uint32_t& startHeight, const Callback& callback) {
+  auto resultHolder = std::make_shared<std::vector<BlockShortEntry>>();
+
+  queryBlocks(std::move(knownBlockIds), timestamp, *resultHolder, startHeight, [resultHolder, callback, &newBlocks](std::error_code ec) {
+    if (!ec) {
+      for (auto& entry : *resultHolder) {
+        BlockScanInfo info;
+        info.blockId = entry.blockHash;
+        if (entry.hasBlock) {
+          info.header = entry.block;
+
+          TransactionScanInfo baseTransaction;
+          baseTransaction.txHash = getObjectHash(entry.block.baseTransaction);
+          baseTransaction.txPrefix = entry.block.baseTransaction;
+          info.transactions.push_back(std::move(baseTransaction));
+
+          for (auto& tsi : entry.txsShortInfo) {
+            TransactionScanInfo tx;
+            tx.txHash = tsi.txId;
+            tx.txPrefix = std::move(tsi.txPrefix);
+            info.transactions.push_back(std::move(tx));
+          }
+        }
+
+        newBlocks.push_back(std::move(info));
+      }
+    }
+
+    callback(ec);
+  });
+}
+
 void INodeTrivialRefreshStub::startAlternativeChain(uint32_t height)
 {
   m_blockchainGenerator.cutBlockchain(height);
@@ -42,6 +42,15 @@ public:
   };
   virtual void queryBlocks(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<cryptonote::BlockShortEntry>& newBlocks,
           uint32_t& startHeight, const Callback& callback) override { callback(std::error_code()); };
+  virtual void queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<cryptonote::BlockScanInfo>& newBlocks,
+          uint32_t& startHeight, const Callback& callback) override { callback(std::error_code()); };
+  virtual void registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys, uint32_t startHeight,
+          uint64_t& registrationId, crypto::Hash& registrationToken, const Callback& callback) override { callback(std::error_code()); };
+  virtual void unregisterWalletScan(uint64_t registrationId, const crypto::Hash& registrationToken, const Callback& callback) override { callback(std::error_code()); };
+  virtual void watchWalletScanKeyImages(uint64_t registrationId, const crypto::Hash& registrationToken, std::vector<crypto::KeyImage>&& keyImages,
+          const Callback& callback) override { callback(std::error_code()); };
+  virtual void getWalletScanEvents(uint64_t registrationId, const crypto::Hash& registrationToken, uint64_t firstSequence, uint32_t maxCount,
+          std::vector<cryptonote::WalletScanEvent>& events, uint32_t& scannedHeight, const Callback& callback) override { callback(std::error_code()); };
 
   virtual void getBlocks(const std::vector<uint32_t>& blockHeights, std::vector<std::vector<cryptonote::BlockDetails>>& blocks, const Callback& callback) override { callback(std::error_code()); };
   virtual void getBlocks(const std::vector<crypto::Hash>& blockHashes, std::vector<cryptonote::BlockDetails>& blocks, const Callback& callback) override { callback(std::error_code()); };
@@ -78,6 +87,8 @@ public:
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<cryptonote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<cryptonote::BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
+  // Blocks of queryBlocks without global indexes, so that they are requested through getTransactionOutsGlobalIndices
+  virtual void queryBlocksScan(std::vector<crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<cryptonote::BlockScanInfo>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<crypto::Hash>&& known_pool_tx_ids, crypto::Hash known_block_id, bool& is_bc_actual,
           std::vector<std::unique_ptr<cryptonote::ITransactionReader>>& new_txs, std::vector<crypto::Hash>& deleted_tx_ids, const Callback& callback) override;
 
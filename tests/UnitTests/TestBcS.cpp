@@ -5,6 +5,7 @@
 #include "gtest/gtest.h"
 
 #include "transfers/BlockchainSynchronizer.h"
+#include "transfers/SharedBlockchainSynchronizer.h"
 #include "transfers/TransfersConsumer.h"
 
 #include "crypto/hash.h"
@@ -718,8 +719,8 @@ TEST_F(BcSTest, poolSynchronizationCheckError) {
   EventWaiter e;
   std::error_code errc;
   o1.syncFunc = [&](std::error_code ec) {
-    e.notify();
     errc = ec;
+    e.notify();
   };
 
   m_sync.addObserver(&o1);
@@ -1379,3 +1380,101 @@ TEST_F(BcSTest, checkTxOrder) {
 
   EXPECT_EQ(expectedTxHashes, receivedTxHashes);
 }
+
+TEST_F(BcSTest, checkLateConsumerCatchesUpFromBlockCache) {
+  BlockchainSynchronizer sync(m_node, m_currency.genesisBlockHash(), 100);
+  ConsumerStub first(m_currency.genesisBlockHash());
+  ConsumerStub late(m_currency.genesisBlockHash());
+  IBlockchainSynchronizerFunctorialObserver o1;
+  EventWaiter e;
+  o1.syncFunc = [&](std::error_code) {
+    e.notify();
+  };
+
+  generator.generateEmptyBlocks(20);
+
+  size_t blockRequests = 0;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>&, uint64_t, std::vector<BlockShortEntry>&, uint32_t&, const INode::Callback&) -> bool {
+    ++blockRequests;
+    return true;
+  };
+
+  sync.addObserver(&o1);
+  sync.addConsumer(&first);
+  sync.start();
+  e.wait();
+  sync.stop();
+
+  size_t firstConsumerRequests = blockRequests;
+  blockRequests = 0;
+
+  sync.addConsumer(&late);
+  sync.start();
+  e.wait();
+  sync.stop();
+  sync.removeObserver(&o1);
+  o1.syncFunc = [](std::error_code) {};
+
+  // one request finds out nothing is new, blocks come from the cache
+  EXPECT_LT(1, firstConsumerRequests);
+  EXPECT_EQ(1, blockRequests);
+  EXPECT_EQ(first.getBlockchain(), late.getBlockchain());
+  EXPECT_EQ(generator.getBlockchain().size(), late.getBlockchain().size());
+}
+
+TEST_F(BcSTest, checkSharedSynchronizerRequestsBlocksOnceForAllConsumers) {
+  const size_t consumerCount = 10;
+  SharedBlockchainSynchronizer sync(m_node, m_currency.genesisBlockHash(), 0);
+  std::vector<std::unique_ptr<ConsumerStub>> consumers;
+  IBlockchainSynchronizerFunctorialObserver o1;
+  EventWaiter e;
+  o1.syncFunc = [&](std::error_code) {
+    e.notify();
+  };
+
+  generator.generateEmptyBlocks(20);
+
+  size_t blockRequests = 0;
+  m_node.queryBlocksFunctor = [&](const std::vector<Hash>&, uint64_t, std::vector<BlockShortEntry>&, uint32_t&, const INode::Callback&) -> bool {
+    ++blockRequests;
+    return true;
+  };
+
+  sync.addObserver(&o1);
+  sync.pause();
+  sync.start();
+  for (size_t i = 0; i < consumerCount; ++i) {
+    consumers.emplace_back(new ConsumerStub(m_currency.genesisBlockHash()));
+    sync.addConsumer(consumers.back().get());
+  }
+
+  sync.resume();
+  e.wait();
+  sync.pause();
+  sync.removeObserver(&o1);
+  o1.syncFunc = [](std::error_code) {};
+
+  size_t sharedRequests = blockRequests;
+  blockRequests = 0;
+
+  ConsumerStub single(m_currency.genesisBlockHash());
+  m_sync.addObserver(this);
+  m_sync.addConsumer(&single);
+  syncCompleted = std::promise<std::error_code>();
+  syncCompletedFuture = syncCompleted.get_future();
+  m_sync.start();
+  syncCompletedFuture.get();
+  m_sync.stop();
+  m_sync.removeObserver(this);
+
+  EXPECT_EQ(blockRequests, sharedRequests);
+  for (const auto& consumer : consumers) {
+    EXPECT_EQ(single.getBlockchain(), consumer->getBlockchain());
+  }
+
+  for (const auto& consumer : consumers) {
+    EXPECT_TRUE(sync.removeConsumer(consumer.get()));
+  }
+
+  sync.resume();
+}
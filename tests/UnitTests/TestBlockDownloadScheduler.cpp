@@ -0,0 +1,324 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote/protocol/download_scheduler.h"
+#include "cryptonote/protocol/download_scheduler.cpp"
+
+using namespace cryptonote;
+
+namespace {
+
+typedef BlockDownloadScheduler::Clock Clock;
+typedef BlockDownloadScheduler::Delivery Delivery;
+
+const std::chrono::milliseconds CHUNK_TIMEOUT(30000);
+const std::chrono::milliseconds STALL_TIMEOUT(5000);
+const uint32_t START_HEIGHT = 1000;
+
+class BlockDownloadSchedulerTest : public ::testing::Test {
+public:
+  BlockDownloadSchedulerTest() : scheduler(CHUNK_TIMEOUT, STALL_TIMEOUT, 4), now(Clock::now()) {
+    for (uint8_t i = 0; i < 3; ++i) {
+      peers[i] = boost::uuids::uuid();
+      peers[i].data[0] = i + 1;
+    }
+  }
+
+  void addBlocks(uint32_t count) {
+    std::vector<crypto::Hash> ids;
+    for (uint32_t i = 0; i < count; ++i) {
+      ids.push_back(blockId(START_HEIGHT + i));
+    }
+
+    ASSERT_TRUE(scheduler.addBlocks(START_HEIGHT, ids));
+  }
+
+  static crypto::Hash blockId(uint32_t height) {
+    crypto::Hash id = crypto::Hash();
+    *reinterpret_cast<uint32_t*>(id.data) = height;
+    return id;
+  }
+
+  static std::vector<block_complete_entry> makeBlocks(const std::vector<crypto::Hash>& ids) {
+    std::vector<block_complete_entry> blocks(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      blocks[i].block.assign(reinterpret_cast<const char*>(ids[i].data), sizeof(ids[i].data));
+    }
+
+    return blocks;
+  }
+
+  Delivery deliver(const BlockDownloadScheduler::PeerId& peer, const std::vector<crypto::Hash>& ids, size_t size = 1000) {
+    return scheduler.deliver(peer, ids, makeBlocks(ids), size, now);
+  }
+
+  BlockDownloadScheduler scheduler;
+  BlockDownloadScheduler::PeerId peers[3];
+  Clock::time_point now;
+};
+
+}
+
+TEST_F(BlockDownloadSchedulerTest, chunksAreReassembledInHeightOrder) {
+  addBlocks(30);
+  auto first = scheduler.assign(peers[0], START_HEIGHT + 30, 10, now);
+  auto second = scheduler.assign(peers[1], START_HEIGHT + 30, 10, now);
+  auto third = scheduler.assign(peers[2], START_HEIGHT + 30, 10, now);
+  ASSERT_EQ(10, first.size());
+  ASSERT_EQ(blockId(START_HEIGHT), first.front());
+  ASSERT_EQ(blockId(START_HEIGHT + 10), second.front());
+  ASSERT_EQ(blockId(START_HEIGHT + 20), third.front());
+  ASSERT_FALSE(scheduler.hasUnassigned());
+
+  std::vector<block_complete_entry> blocks;
+  BlockDownloadScheduler::PeerId source;
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[2], third));
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[1], second));
+  ASSERT_FALSE(scheduler.popReady(blocks, source));
+
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[0], first));
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(scheduler.popReady(blocks, source));
+    ASSERT_EQ(peers[i], source);
+    ASSERT_EQ(10, blocks.size());
+    ASSERT_EQ(0, memcmp(blocks.front().block.data(), blockId(START_HEIGHT + 10 * static_cast<uint32_t>(i)).data, sizeof(crypto::Hash)));
+  }
+
+  ASSERT_FALSE(scheduler.popReady(blocks, source));
+  ASSERT_TRUE(scheduler.empty());
+  ASSERT_EQ(START_HEIGHT + 30, scheduler.getEndHeight());
+}
+
+TEST_F(BlockDownloadSchedulerTest, blocksAboveThePeerHeightAreNotAssigned) {
+  addBlocks(30);
+  auto ids = scheduler.assign(peers[0], START_HEIGHT + 5, 10, now);
+  ASSERT_EQ(5, ids.size());
+  ASSERT_TRUE(scheduler.assign(peers[1], START_HEIGHT + 5, 10, now).empty());
+}
+
+TEST_F(BlockDownloadSchedulerTest, overlappingIdsHaveToContinueTheQueue) {
+  addBlocks(10);
+  std::vector<crypto::Hash> ids;
+  for (uint32_t height = START_HEIGHT + 5; height < START_HEIGHT + 20; ++height) {
+    ids.push_back(blockId(height));
+  }
+
+  ASSERT_TRUE(scheduler.addBlocks(START_HEIGHT + 5, ids));
+  ASSERT_EQ(START_HEIGHT + 20, scheduler.getEndHeight());
+
+  ids.back() = crypto::Hash();
+  ASSERT_FALSE(scheduler.addBlocks(START_HEIGHT + 5, ids));
+  ASSERT_FALSE(scheduler.addBlocks(START_HEIGHT + 21, ids));
+}
+
+TEST_F(BlockDownloadSchedulerTest, timedOutChunkIsRequestedFromAnotherPeer) {
+  addBlocks(10);
+  auto ids = scheduler.assign(peers[0], START_HEIGHT + 10, 10, now);
+  ASSERT_EQ(10, ids.size());
+  ASSERT_TRUE(scheduler.assign(peers[1], START_HEIGHT + 10, 10, now).empty());
+
+  now += CHUNK_TIMEOUT;
+  ASSERT_EQ(1, scheduler.expire(now));
+  ASSERT_TRUE(scheduler.assign(peers[0], START_HEIGHT + 10, 10, now).empty());
+  ASSERT_EQ(ids, scheduler.assign(peers[1], START_HEIGHT + 10, 10, now));
+
+  BlockDownloadScheduler::PeerStats stats;
+  ASSERT_TRUE(scheduler.getPeerStats(peers[0], stats));
+  ASSERT_EQ(1, stats.timeouts);
+  ASSERT_EQ(1, stats.pendingRequests);
+}
+
+TEST_F(BlockDownloadSchedulerTest, stalledHeadChunkIsReassigned) {
+  addBlocks(20);
+  auto first = scheduler.assign(peers[0], START_HEIGHT + 20, 10, now);
+  auto second = scheduler.assign(peers[1], START_HEIGHT + 20, 10, now);
+  now += STALL_TIMEOUT;
+  ASSERT_EQ(0, scheduler.expire(now));
+
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[1], second));
+  ASSERT_EQ(1, scheduler.expire(now));
+  ASSERT_EQ(first, scheduler.assign(peers[1], START_HEIGHT + 20, 10, now));
+}
+
+TEST_F(BlockDownloadSchedulerTest, lateDeliveryIsIgnored) {
+  addBlocks(10);
+  auto ids = scheduler.assign(peers[0], START_HEIGHT + 10, 10, now);
+  now += CHUNK_TIMEOUT;
+  scheduler.expire(now);
+  ASSERT_EQ(ids, scheduler.assign(peers[1], START_HEIGHT + 10, 10, now));
+
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[1], ids));
+  ASSERT_EQ(Delivery::IGNORED, deliver(peers[0], ids));
+
+  std::vector<block_complete_entry> blocks;
+  BlockDownloadScheduler::PeerId source;
+  ASSERT_TRUE(scheduler.popReady(blocks, source));
+  ASSERT_EQ(peers[1], source);
+}
+
+TEST_F(BlockDownloadSchedulerTest, responsesInFlightAreIgnoredAfterClear) {
+  addBlocks(10);
+  auto ids = scheduler.assign(peers[0], START_HEIGHT + 10, 10, now);
+  scheduler.clear();
+  ASSERT_TRUE(scheduler.empty());
+  ASSERT_EQ(Delivery::IGNORED, deliver(peers[0], ids));
+}
+
+TEST_F(BlockDownloadSchedulerTest, unrequestedDeliveryIsInvalid) {
+  addBlocks(20);
+  auto ids = scheduler.assign(peers[0], START_HEIGHT + 20, 10, now);
+  ASSERT_EQ(Delivery::INVALID, deliver(peers[1], ids));
+
+  scheduler.assign(peers[1], START_HEIGHT + 20, 10, now);
+  ASSERT_EQ(Delivery::INVALID, deliver(peers[1], ids));
+
+  ids.pop_back();
+  ASSERT_EQ(Delivery::INVALID, deliver(peers[0], ids));
+}
+
+TEST_F(BlockDownloadSchedulerTest, fasterPeerGetsMoreRequests) {
+  addBlocks(100);
+  auto fast = scheduler.assign(peers[0], START_HEIGHT + 100, 10, now);
+  auto slow = scheduler.assign(peers[1], START_HEIGHT + 100, 10, now);
+  ASSERT_TRUE(scheduler.assign(peers[0], START_HEIGHT + 100, 10, now).empty());
+
+  now += std::chrono::seconds(1);
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[0], fast, 1000000));
+  ASSERT_EQ(Delivery::ACCEPTED, deliver(peers[1], slow, 100000));
+
+  size_t fastRequests = 0;
+  while (!scheduler.assign(peers[0], START_HEIGHT + 100, 10, now).empty()) {
+    ++fastRequests;
+  }
+
+  size_t slowRequests = 0;
+  while (!scheduler.assign(peers[1], START_HEIGHT + 100, 10, now).empty()) {
+    ++slowRequests;
+  }
+
+  ASSERT_EQ(4, fastRequests);
+  ASSERT_EQ(1, slowRequests);
+
+  BlockDownloadScheduler::PeerStats stats;
+  ASSERT_TRUE(scheduler.getPeerStats(peers[0], stats));
+  ASSERT_EQ(1000000, stats.throughput);
+}
+
+TEST_F(BlockDownloadSchedulerTest, chunksOfRemovedPeerAreReassigned) {
+  addBlocks(10);
+  auto ids = scheduler.assign(peers[0], START_HEIGHT + 10, 10, now);
+  scheduler.removePeer(peers[0]);
+  ASSERT_TRUE(scheduler.hasUnassigned());
+  ASSERT_EQ(ids, scheduler.assign(peers[1], START_HEIGHT + 10, 10, now));
+
+  BlockDownloadScheduler::PeerStats stats;
+  ASSERT_FALSE(scheduler.getPeerStats(peers[0], stats));
+}
+
+namespace {
+
+const BlockDownloadScheduler::BatchLimits BATCH_LIMITS = { 10, 100, 20, 5, 10000, std::chrono::milliseconds(2000) };
+
+class BlockDownloadSchedulerBatchTest : public BlockDownloadSchedulerTest {
+public:
+  BlockDownloadSchedulerBatchTest() : batchScheduler(CHUNK_TIMEOUT, STALL_TIMEOUT, 1, BATCH_LIMITS) {
+    std::vector<crypto::Hash> ids;
+    for (uint32_t height = START_HEIGHT; height < START_HEIGHT + 10000; ++height) {
+      ids.push_back(blockId(height));
+    }
+
+    batchScheduler.addBlocks(START_HEIGHT, ids);
+  }
+
+  // Requests a chunk from the first peer and delivers it after 'responseTime', returns the chunk size
+  size_t exchange(std::chrono::milliseconds responseTime, size_t blockSize) {
+    auto ids = batchScheduler.assign(peers[0], START_HEIGHT + 10000, 1000, now);
+    now += responseTime;
+    EXPECT_EQ(Delivery::ACCEPTED, batchScheduler.deliver(peers[0], ids, makeBlocks(ids), ids.size() * blockSize, now));
+    return ids.size();
+  }
+
+  size_t batchSize() {
+    BlockDownloadScheduler::PeerStats stats;
+    EXPECT_TRUE(batchScheduler.getPeerStats(peers[0], stats));
+    return stats.batchSize;
+  }
+
+  BlockDownloadScheduler batchScheduler;
+};
+
+}
+
+TEST_F(BlockDownloadSchedulerBatchTest, batchGrowsAdditivelyWhileResponsesAreFast) {
+  ASSERT_EQ(20, exchange(std::chrono::milliseconds(100), 10));
+  ASSERT_EQ(25, exchange(std::chrono::milliseconds(100), 10));
+  ASSERT_EQ(30, batchSize());
+
+  for (size_t i = 0; i < 50; ++i) {
+    exchange(std::chrono::milliseconds(100), 10);
+  }
+
+  ASSERT_EQ(100, batchSize());
+}
+
+TEST_F(BlockDownloadSchedulerBatchTest, batchHalvesOnSlowResponseAndTimeout) {
+  for (size_t i = 0; i < 8; ++i) {
+    exchange(std::chrono::milliseconds(100), 10);
+  }
+
+  ASSERT_EQ(60, batchSize());
+  exchange(std::chrono::milliseconds(3000), 10);
+  ASSERT_EQ(30, batchSize());
+
+  auto ids = batchScheduler.assign(peers[0], START_HEIGHT + 10000, 1000, now);
+  ASSERT_EQ(30, ids.size());
+  now += CHUNK_TIMEOUT;
+  ASSERT_EQ(1, batchScheduler.expire(now));
+  ASSERT_EQ(15, batchSize());
+
+  ASSERT_EQ(Delivery::ACCEPTED, batchScheduler.deliver(peers[0], ids, makeBlocks(ids), ids.size() * 10, now));
+  ASSERT_EQ(10, batchSize());
+}
+
+TEST_F(BlockDownloadSchedulerBatchTest, timedOutChunkIsRequestedAgainFromTheOnlyPeer) {
+  auto ids = batchScheduler.assign(peers[0], START_HEIGHT + 10000, 1000, now);
+  ASSERT_EQ(20, ids.size());
+
+  now += CHUNK_TIMEOUT;
+  ASSERT_EQ(1, batchScheduler.expire(now));
+
+  // the batch is halved, so the chunk is split
+  auto retry = batchScheduler.assign(peers[0], START_HEIGHT + 10000, 1000, now);
+  ASSERT_EQ(std::vector<crypto::Hash>(ids.begin(), ids.begin() + 10), retry);
+
+  BlockDownloadScheduler::PeerStats stats;
+  ASSERT_TRUE(batchScheduler.getPeerStats(peers[0], stats));
+  ASSERT_EQ(2, stats.pendingRequests);
+
+  // the response to the timed out request arrives late and does not match the split chunk
+  ASSERT_EQ(Delivery::IGNORED, batchScheduler.deliver(peers[0], ids, makeBlocks(ids), ids.size() * 10, now));
+  ASSERT_EQ(Delivery::ACCEPTED, batchScheduler.deliver(peers[0], retry, makeBlocks(retry), retry.size() * 10, now));
+  ASSERT_TRUE(batchScheduler.getPeerStats(peers[0], stats));
+  ASSERT_EQ(0, stats.pendingRequests);
+
+  std::vector<block_complete_entry> blocks;
+  BlockDownloadScheduler::PeerId source;
+  ASSERT_TRUE(batchScheduler.popReady(blocks, source));
+  ASSERT_EQ(peers[0], source);
+  ASSERT_EQ(10, blocks.size());
+
+  auto rest = batchScheduler.assign(peers[0], START_HEIGHT + 10000, 1000, now);
+  ASSERT_FALSE(rest.empty());
+  ASSERT_EQ(ids[10], rest.front());
+}
+
+TEST_F(BlockDownloadSchedulerBatchTest, batchIsLimitedByResponseSize) {
+  exchange(std::chrono::milliseconds(100), 1000);
+  ASSERT_EQ(10, batchSize());
+
+  ASSERT_EQ(10, exchange(std::chrono::milliseconds(100), 1000));
+  ASSERT_EQ(10, batchScheduler.assign(peers[0], START_HEIGHT + 10000, 1000, now).size());
+}
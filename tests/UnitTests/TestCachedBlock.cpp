@@ -0,0 +1,69 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote/core/CachedBlock.h"
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "cryptonote/core/Currency.h"
+
+#include <logging/LoggerGroup.h>
+
+using namespace cryptonote;
+
+class CachedBlockTest : public ::testing::Test {
+public:
+  CachedBlockTest() :
+    currency(CurrencyBuilder(logger, os::appdata::path()).currency()) {
+  }
+
+protected:
+  Logging::LoggerGroup logger;
+  Currency currency;
+};
+
+TEST_F(CachedBlockTest, blockHashMatchesFormatUtils) {
+  CachedBlock cachedBlock(currency.genesisBlock());
+
+  ASSERT_EQ(get_block_hash(currency.genesisBlock()), cachedBlock.getBlockHash());
+  ASSERT_EQ(currency.genesisBlockHash(), cachedBlock.getBlockHash());
+  ASSERT_EQ(getObjectHash(currency.genesisBlock().baseTransaction), cachedBlock.getMinerTransactionHash());
+
+  BinaryArray hashingBlob;
+  ASSERT_TRUE(get_block_hashing_blob(currency.genesisBlock(), hashingBlob));
+  ASSERT_EQ(hashingBlob, cachedBlock.getBlockHashingBinaryArray());
+}
+
+TEST_F(CachedBlockTest, blockHashIsComputedOnce) {
+  CachedBlock cachedBlock(currency.genesisBlock());
+  cachedBlock.getBlockHash();
+
+  uint64_t hashCount = getBinaryArrayHashCount();
+  cachedBlock.getBlockHash();
+  cachedBlock.getMinerTransactionHash();
+  cachedBlock.getTransactionTreeHash();
+
+  ASSERT_EQ(hashCount, getBinaryArrayHashCount());
+}
+
+TEST_F(CachedBlockTest, transactionHashesMatchFormatUtils) {
+  const Transaction& transaction = currency.genesisBlock().baseTransaction;
+  CachedTransaction cachedTransaction(transaction);
+
+  ASSERT_EQ(getObjectHash(transaction), cachedTransaction.getTransactionHash());
+  ASSERT_EQ(getObjectHash(static_cast<const TransactionPrefix&>(transaction)), cachedTransaction.getTransactionPrefixHash());
+  ASSERT_EQ(toBinaryArray(transaction), cachedTransaction.getTransactionBinaryArray());
+  ASSERT_EQ(getObjectBinarySize(transaction), cachedTransaction.getTransactionBinarySize());
+}
+
+TEST_F(CachedBlockTest, transactionUsesProvidedHash) {
+  const Transaction& transaction = currency.genesisBlock().baseTransaction;
+  crypto::Hash knownHash = getObjectHash(transaction);
+  CachedTransaction cachedTransaction(transaction, knownHash);
+
+  uint64_t hashCount = getBinaryArrayHashCount();
+  ASSERT_EQ(knownHash, cachedTransaction.getTransactionHash());
+  ASSERT_EQ(hashCount, getBinaryArrayHashCount());
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <logging/LoggerGroup.h>
+
+#include "common/StringTools.h"
+#include "cryptonote/core/Account.h"
+#include "cryptonote/core/Core.h"
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "cryptonote/core/Currency.h"
+#include "cryptonote/core/Miner.h"
+#include "cryptonote/protocol/definitions.h"
+
+using namespace cryptonote;
+
+namespace {
+
+class CoreQueryBlocksTest : public ::testing::Test {
+public:
+  CoreQueryBlocksTest() :
+    dataDir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("core_query_blocks_%%%%%%%%%%%%")),
+    currency(CurrencyBuilder(logger, (boost::filesystem::create_directories(dataDir), dataDir.string())).currency()),
+    core(currency, nullptr, logger) {
+    account.generate();
+  }
+
+  virtual void SetUp() override {
+    ASSERT_TRUE(core.init(MinerConfig(), false));
+
+    Block genesis;
+    ASSERT_TRUE(core.getBlockByHash(core.getBlockIdByHeight(0), genesis));
+    blocks.push_back(genesis);
+  }
+
+  virtual void TearDown() override {
+    core.deinit();
+    boost::filesystem::remove_all(dataDir);
+  }
+
+  // Blocks are spaced well above the difficulty target, so the difficulty stays at 1 and any nonce fits.
+  // The spacing also exceeds the future time limit the timestamp lookup allows for, so a query by the
+  // timestamp of a block starts its full entries exactly at that block.
+  void addBlocks(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      Block block;
+      difficulty_type difficulty;
+      uint32_t height;
+      uint64_t version;
+      ASSERT_TRUE(core.getBlockTemplate(block, account.getAccountKeys().address, difficulty, height, BinaryArray(), version));
+      block.timestamp = blocks.back().timestamp + currency.blockFutureTimeLimit() + currency.difficultyTarget();
+
+      BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
+      ASSERT_TRUE(core.handle_incoming_block_blob(toBinaryArray(block), bvc, false, false));
+      ASSERT_TRUE(bvc.m_added_to_main_chain);
+      blocks.push_back(block);
+    }
+  }
+
+  std::vector<BlockShortInfo> queryLite(uint32_t startHeight) {
+    uint32_t resStartHeight;
+    uint32_t currentHeight;
+    uint32_t fullOffset;
+    std::vector<BlockShortInfo> entries;
+    EXPECT_TRUE(core.queryBlocksLite({ get_block_hash(blocks[startHeight]), get_block_hash(blocks[0]) }, 0, resStartHeight, currentHeight, fullOffset, entries));
+    EXPECT_EQ(startHeight, resStartHeight);
+    return entries;
+  }
+
+  void checkLiteEntries(const std::vector<BlockShortInfo>& entries, uint32_t startHeight) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+      const Block& block = blocks[startHeight + i];
+      EXPECT_EQ(get_block_hash(block), entries[i].blockId);
+      EXPECT_EQ(Common::asString(toBinaryArray(block)), entries[i].block);
+      EXPECT_TRUE(entries[i].txPrefixes.empty());
+    }
+  }
+
+protected:
+  Logging::LoggerGroup logger;
+  boost::filesystem::path dataDir;
+  Currency currency;
+  cryptonote::core core;
+  AccountBase account;
+  std::vector<Block> blocks;
+};
+
+TEST_F(CoreQueryBlocksTest, queryBlocksServesStoredBlobs) {
+  addBlocks(5);
+
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  std::vector<BlockFullInfo> entries;
+  ASSERT_TRUE(core.queryBlocks({ get_block_hash(blocks[0]) }, 0, startHeight, currentHeight, fullOffset, entries));
+
+  EXPECT_EQ(0, startHeight);
+  EXPECT_EQ(blocks.size(), currentHeight);
+  EXPECT_EQ(0, fullOffset);
+  ASSERT_EQ(blocks.size(), entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(get_block_hash(blocks[i]), entries[i].block_id);
+    EXPECT_EQ(Common::asString(toBinaryArray(blocks[i])), entries[i].block);
+    EXPECT_TRUE(entries[i].txs.empty());
+  }
+}
+
+TEST_F(CoreQueryBlocksTest, queryBlocksReturnsOnlyIdsOfBlocksOlderThanTimestamp) {
+  addBlocks(5);
+
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  std::vector<BlockFullInfo> entries;
+  ASSERT_TRUE(core.queryBlocks({ get_block_hash(blocks[0]) }, blocks[3].timestamp, startHeight, currentHeight, fullOffset, entries));
+
+  EXPECT_EQ(3, fullOffset);
+  ASSERT_EQ(blocks.size(), entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(get_block_hash(blocks[i]), entries[i].block_id);
+    EXPECT_EQ(i < 3 ? std::string() : Common::asString(toBinaryArray(blocks[i])), entries[i].block);
+  }
+}
+
+TEST_F(CoreQueryBlocksTest, queryBlocksLiteServesStoredBlobs) {
+  addBlocks(5);
+
+  uint32_t startHeight;
+  uint32_t currentHeight;
+  uint32_t fullOffset;
+  std::vector<BlockShortInfo> entries;
+  ASSERT_TRUE(core.queryBlocksLite({ get_block_hash(blocks[0]) }, blocks[3].timestamp, startHeight, currentHeight, fullOffset, entries));
+
+  EXPECT_EQ(0, startHeight);
+  EXPECT_EQ(blocks.size(), currentHeight);
+  EXPECT_EQ(3, fullOffset);
+  ASSERT_EQ(blocks.size(), entries.size());
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(get_block_hash(blocks[i]), entries[i].blockId);
+    EXPECT_TRUE(entries[i].block.empty());
+  }
+
+  entries.erase(entries.begin(), entries.begin() + 3);
+  checkLiteEntries(entries, 3);
+}
+
+// Entries are rebuilt from the stored blobs once the cache evicts them
+TEST_F(CoreQueryBlocksTest, queryBlocksLiteRebuildsEntriesEvictedFromCache) {
+  addBlocks(COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE + 10);
+
+  std::vector<BlockShortInfo> first = queryLite(0);
+  ASSERT_EQ(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, first.size());
+  checkLiteEntries(first, 0);
+
+  // fills the cache with the later blocks
+  std::vector<BlockShortInfo> last = queryLite(static_cast<uint32_t>(blocks.size() - COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE));
+  ASSERT_EQ(COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE, last.size());
+  checkLiteEntries(last, static_cast<uint32_t>(blocks.size() - COMMAND_RPC_QUERY_BLOCKS_CACHE_SIZE));
+
+  std::vector<BlockShortInfo> again = queryLite(0);
+  ASSERT_EQ(first.size(), again.size());
+  checkLiteEntries(again, 0);
+}
+
+}
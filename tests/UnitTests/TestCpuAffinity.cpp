@@ -0,0 +1,65 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+#include <common/CpuAffinity.h>
+
+#include <algorithm>
+#include <set>
+
+using namespace Common;
+
+TEST(CpuAffinity, autoAssignsEveryThread) {
+  std::vector<CpuInfo> available = getAvailableCpus();
+  ASSERT_FALSE(available.empty());
+
+  std::vector<CpuInfo> cpus;
+  ASSERT_TRUE(parseCpuAffinity("auto", available.size() * 2 + 1, cpus));
+  ASSERT_EQ(available.size() * 2 + 1, cpus.size());
+
+  for (size_t i = 0; i < available.size(); ++i) {
+    auto it = std::find_if(available.begin(), available.end(), [&](const CpuInfo& info) { return info.cpu == cpus[i].cpu; });
+    ASSERT_NE(available.end(), it);
+    ASSERT_EQ(it->node, cpus[i].node);
+    ASSERT_EQ(cpus[i].cpu, cpus[i + available.size()].cpu);
+  }
+}
+
+TEST(CpuAffinity, autoSpreadsThreadsOverNodes) {
+  std::vector<CpuInfo> available = getAvailableCpus();
+  std::set<uint32_t> nodes;
+  for (const CpuInfo& info : available) {
+    nodes.insert(info.node);
+  }
+
+  std::vector<CpuInfo> cpus;
+  ASSERT_TRUE(parseCpuAffinity("auto", nodes.size(), cpus));
+
+  std::set<uint32_t> threadNodes;
+  for (const CpuInfo& info : cpus) {
+    threadNodes.insert(info.node);
+  }
+
+  ASSERT_EQ(nodes, threadNodes);
+}
+
+TEST(CpuAffinity, listIsReused) {
+  uint32_t cpu = getAvailableCpus().front().cpu;
+  std::vector<CpuInfo> cpus;
+  ASSERT_TRUE(parseCpuAffinity(std::to_string(cpu) + "-" + std::to_string(cpu), 3, cpus));
+  ASSERT_EQ(3, cpus.size());
+  for (const CpuInfo& info : cpus) {
+    ASSERT_EQ(cpu, info.cpu);
+  }
+}
+
+TEST(CpuAffinity, wrongListIsRejected) {
+  std::vector<CpuInfo> cpus;
+  ASSERT_FALSE(parseCpuAffinity("", 1, cpus));
+  ASSERT_FALSE(parseCpuAffinity("x", 1, cpus));
+  ASSERT_FALSE(parseCpuAffinity("0,", 1, cpus));
+  ASSERT_FALSE(parseCpuAffinity("3-1", 1, cpus));
+  ASSERT_FALSE(parseCpuAffinity("-1", 1, cpus));
+  ASSERT_FALSE(parseCpuAffinity("99999", 1, cpus));
+}
@@ -0,0 +1,341 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <list>
+
+#include <boost/uuid/random_generator.hpp>
+
+#include <common/os.h>
+#include <common/StringTools.h>
+#include <logging/LoggerGroup.h>
+#include <system/Dispatcher.h>
+
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "cryptonote/core/Currency.h"
+#include "cryptonote/core/VerificationContext.h"
+#include "cryptonote/protocol/handler.h"
+#include "p2p/LevinProtocol.h"
+
+#include "ICoreStub.h"
+
+using namespace cryptonote;
+using namespace Common;
+
+namespace {
+
+struct Notification {
+  int command;
+  BinaryArray data;
+  net_connection_id connection;
+};
+
+class P2pEndpointStub : public p2p_endpoint_stub {
+public:
+  virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const CryptoNoteConnectionContext& context) override {
+    notifications.push_back({ command, req_buff, context.m_connection_id });
+    return true;
+  }
+
+  virtual void for_each_connection(std::function<void(CryptoNoteConnectionContext&, PeerIdType)> f) override {
+    PeerIdType peerId = 0;
+    for (auto& connection : connections) {
+      f(connection, ++peerId);
+    }
+  }
+
+  virtual uint64_t get_connections_count() override {
+    return connections.size();
+  }
+
+  // requests of the command sent to the connection
+  template <typename Command>
+  std::vector<typename Command::request> sent(const net_connection_id& connection) const {
+    std::vector<typename Command::request> result;
+    for (const auto& notification : notifications) {
+      if (notification.command == Command::ID && notification.connection == connection) {
+        typename Command::request req;
+        EXPECT_TRUE(LevinProtocol::decode(notification.data, req));
+        result.push_back(std::move(req));
+      }
+    }
+
+    return result;
+  }
+
+  std::list<CryptoNoteConnectionContext> connections;
+  std::vector<Notification> notifications;
+};
+
+class CoreStub : public ICoreStub {
+public:
+  CoreStub(const Block& genesisBlock) : ICoreStub(genesisBlock), nextBlockDifficulty(1) {
+  }
+
+  virtual bool handle_incoming_block_blob(const BinaryArray& block_blob, BlockVerificationContext& bvc, bool control_miner, bool relay_block) override {
+    receivedBlocks.push_back(block_blob);
+    bvc.m_added_to_main_chain = true;
+    return true;
+  }
+
+  virtual difficulty_type getNextBlockDifficulty() override {
+    return nextBlockDifficulty;
+  }
+
+  std::vector<BinaryArray> receivedBlocks;
+  difficulty_type nextBlockDifficulty;
+};
+
+class CryptoNoteProtocolHandlerTest : public ::testing::Test {
+public:
+  CryptoNoteProtocolHandlerTest() :
+    currency(CurrencyBuilder(logger, os::appdata::path()).currency()),
+    core(currency.genesisBlock()),
+    handler(currency, dispatcher, core, &p2p, logger),
+    nonce(0) {
+    core.set_blockchain_top(0, get_block_hash(currency.genesisBlock()));
+  }
+
+protected:
+  CryptoNoteConnectionContext& addConnection() {
+    p2p.connections.emplace_back();
+    CryptoNoteConnectionContext& context = p2p.connections.back();
+    context.version = P2PProtocolVersion::V3;
+    context.m_connection_id = uuidGenerator();
+    context.m_state = CryptoNoteConnectionContext::state_normal;
+    return context;
+  }
+
+  Transaction createTransaction() {
+    Transaction tx;
+    tx.version = CURRENT_TRANSACTION_VERSION;
+    tx.unlockTime = ++nonce;
+    return tx;
+  }
+
+  Block createBlock(const std::vector<Transaction>& txs) {
+    Block block;
+    block.majorVersion = BLOCK_MAJOR_VERSION_1;
+    block.minorVersion = BLOCK_MINOR_VERSION_0;
+    block.timestamp = 0;
+    block.nonce = ++nonce;
+    block.previousBlockHash = get_block_hash(currency.genesisBlock());
+
+    BaseInput input;
+    input.blockIndex = 1;
+    block.baseTransaction.version = CURRENT_TRANSACTION_VERSION;
+    block.baseTransaction.unlockTime = 0;
+    block.baseTransaction.inputs.push_back(input);
+
+    for (const auto& tx : txs) {
+      block.transactionHashes.push_back(getObjectHash(tx));
+    }
+
+    return block;
+  }
+
+  void sendCompactBlock(const Block& block, CryptoNoteConnectionContext& context) {
+    NOTIFY_NEW_COMPACT_BLOCK::request req;
+    req.block = asString(toBinaryArray(block));
+    req.current_blockchain_height = 2;
+    req.hop = 0;
+    send<NOTIFY_NEW_COMPACT_BLOCK>(req, context);
+  }
+
+  template <typename Command>
+  void send(const typename Command::request& req, CryptoNoteConnectionContext& context) {
+    BinaryArray out;
+    bool handled = false;
+    handler.handleCommand(true, Command::ID, LevinProtocol::encode(req), out, context, handled);
+    ASSERT_TRUE(handled);
+  }
+
+  Logging::LoggerGroup logger;
+  System::Dispatcher dispatcher;
+  Currency currency;
+  CoreStub core;
+  P2pEndpointStub p2p;
+  CryptoNoteProtocolHandler handler;
+  boost::uuids::random_generator uuidGenerator;
+  uint64_t nonce;
+};
+
+TEST_F(CryptoNoteProtocolHandlerTest, compactBlockIsReconstructedFromKnownTransactions) {
+  auto& peer = addConnection();
+  Transaction tx1 = createTransaction();
+  Transaction tx2 = createTransaction();
+  core.addTransaction(tx1);
+  core.addTransaction(tx2);
+  Block block = createBlock({ tx1, tx2 });
+
+  sendCompactBlock(block, peer);
+
+  ASSERT_EQ(1, core.receivedBlocks.size());
+  EXPECT_EQ(toBinaryArray(block), core.receivedBlocks[0]);
+  EXPECT_TRUE(p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id).empty());
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, onlyMissingTransactionsOfCompactBlockAreRequested) {
+  auto& peer = addConnection();
+  Transaction tx1 = createTransaction();
+  Transaction tx2 = createTransaction();
+  core.addTransaction(tx1);
+  Block block = createBlock({ tx1, tx2 });
+
+  sendCompactBlock(block, peer);
+
+  EXPECT_TRUE(core.receivedBlocks.empty());
+  auto requests = p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id);
+  ASSERT_EQ(1, requests.size());
+  EXPECT_EQ(get_block_hash(block), requests[0].block_id);
+  EXPECT_EQ(std::vector<crypto::Hash>{ getObjectHash(tx2) }, requests[0].txs);
+
+  NOTIFY_NEW_BLOCK::request rsp;
+  rsp.b.block = asString(toBinaryArray(block));
+  rsp.b.txs.push_back(asString(toBinaryArray(tx2)));
+  rsp.current_blockchain_height = 2;
+  rsp.hop = 0;
+  send<NOTIFY_NEW_BLOCK>(rsp, peer);
+
+  ASSERT_EQ(1, core.receivedBlocks.size());
+  EXPECT_EQ(toBinaryArray(block), core.receivedBlocks[0]);
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, compactBlockAnnouncedAgainIsRequestedOnce) {
+  auto& peer1 = addConnection();
+  auto& peer2 = addConnection();
+  Block block = createBlock({ createTransaction() });
+
+  sendCompactBlock(block, peer1);
+  sendCompactBlock(block, peer2);
+  sendCompactBlock(block, peer1);
+
+  EXPECT_EQ(1, p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer1.m_connection_id).size());
+  EXPECT_TRUE(p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer2.m_connection_id).empty());
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, fullBlockIsRequestedFromNextAnnouncerWhenTransactionsTimeOut) {
+  auto& peer1 = addConnection();
+  auto& peer2 = addConnection();
+  Transaction tx1 = createTransaction();
+  Transaction tx2 = createTransaction();
+  core.addTransaction(tx1);
+  Block block = createBlock({ tx1, tx2 });
+
+  sendCompactBlock(block, peer1);
+  sendCompactBlock(block, peer2);
+  handler.expireCompactBlockRequests(std::chrono::steady_clock::now() + std::chrono::seconds(P2P_COMPACT_BLOCK_TXS_TIMEOUT + 1));
+
+  auto requests = p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer2.m_connection_id);
+  ASSERT_EQ(1, requests.size());
+  EXPECT_EQ(get_block_hash(block), requests[0].block_id);
+  EXPECT_EQ(block.transactionHashes, requests[0].txs);
+  EXPECT_EQ(1, p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer1.m_connection_id).size());
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, fullBlockIsRequestedFromTheOnlyAnnouncerWhenTransactionsTimeOut) {
+  auto& peer = addConnection();
+  Block block = createBlock({ createTransaction() });
+
+  sendCompactBlock(block, peer);
+  auto now = std::chrono::steady_clock::now();
+  handler.expireCompactBlockRequests(now + std::chrono::seconds(P2P_COMPACT_BLOCK_TXS_TIMEOUT + 1));
+
+  auto requests = p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id);
+  ASSERT_EQ(2, requests.size());
+  EXPECT_EQ(block.transactionHashes, requests[1].txs);
+
+  // the block is dropped after the full block request times out as well
+  handler.expireCompactBlockRequests(now + std::chrono::seconds(2 * P2P_COMPACT_BLOCK_TXS_TIMEOUT + 2));
+  handler.expireCompactBlockRequests(now + std::chrono::seconds(3 * P2P_COMPACT_BLOCK_TXS_TIMEOUT + 3));
+  EXPECT_EQ(2, p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id).size());
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, compactBlockWithUnknownPreviousBlockStartsSynchronization) {
+  auto& peer = addConnection();
+  Block block = createBlock({ createTransaction() });
+  block.previousBlockHash = crypto::Hash{ { 1 } };
+
+  sendCompactBlock(block, peer);
+
+  EXPECT_TRUE(p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id).empty());
+  EXPECT_EQ(1, p2p.sent<NOTIFY_REQUEST_CHAIN>(peer.m_connection_id).size());
+  EXPECT_EQ(CryptoNoteConnectionContext::state_synchronizing, peer.m_state);
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, compactBlockWithInsufficientProofOfWorkDropsConnection) {
+  auto& peer = addConnection();
+  core.nextBlockDifficulty = std::numeric_limits<difficulty_type>::max();
+
+  sendCompactBlock(createBlock({ createTransaction() }), peer);
+
+  EXPECT_TRUE(p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id).empty());
+  EXPECT_EQ(CryptoNoteConnectionContext::state_shutdown, peer.m_state);
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, compactBlocksWaitingForTransactionsAreLimited) {
+  auto& peer = addConnection();
+  for (size_t i = 0; i <= P2P_COMPACT_BLOCK_MAX_PENDING; ++i) {
+    sendCompactBlock(createBlock({ createTransaction() }), peer);
+  }
+
+  EXPECT_EQ(P2P_COMPACT_BLOCK_MAX_PENDING, p2p.sent<NOTIFY_REQUEST_COMPACT_BLOCK_TXS>(peer.m_connection_id).size());
+  EXPECT_EQ(CryptoNoteConnectionContext::state_normal, peer.m_state);
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, transactionInventoryOverLimitDropsConnection) {
+  auto& peer = addConnection();
+  NOTIFY_TX_INVENTORY::request inventory;
+  for (size_t i = 0; i <= P2P_TX_INVENTORY_MAX_COUNT; ++i) {
+    inventory.txs.push_back(getObjectHash(createTransaction()));
+  }
+
+  send<NOTIFY_TX_INVENTORY>(inventory, peer);
+
+  EXPECT_TRUE(p2p.sent<NOTIFY_REQUEST_TXS>(peer.m_connection_id).empty());
+  EXPECT_EQ(CryptoNoteConnectionContext::state_shutdown, peer.m_state);
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, undeliveredAnnouncedTransactionsOverLimitDropConnection) {
+  auto& peer = addConnection();
+  size_t requested = 0;
+  while (peer.m_state == CryptoNoteConnectionContext::state_normal) {
+    NOTIFY_TX_INVENTORY::request inventory;
+    for (size_t i = 0; i < P2P_TX_INVENTORY_MAX_COUNT; ++i) {
+      inventory.txs.push_back(getObjectHash(createTransaction()));
+    }
+
+    send<NOTIFY_TX_INVENTORY>(inventory, peer);
+    ASSERT_LE(requested, P2P_TX_MAX_REQUESTS_IN_FLIGHT);
+    requested += P2P_TX_INVENTORY_MAX_COUNT;
+  }
+
+  size_t requestedTxs = 0;
+  for (const auto& req : p2p.sent<NOTIFY_REQUEST_TXS>(peer.m_connection_id)) {
+    requestedTxs += req.txs.size();
+  }
+
+  EXPECT_EQ(P2P_TX_MAX_REQUESTS_IN_FLIGHT, requestedTxs);
+  EXPECT_EQ(CryptoNoteConnectionContext::state_shutdown, peer.m_state);
+}
+
+TEST_F(CryptoNoteProtocolHandlerTest, transactionAnnouncementsAreSplitByLimit) {
+  auto& peer = addConnection();
+  for (size_t i = 0; i < 2 * P2P_TX_INVENTORY_MAX_COUNT + 1; ++i) {
+    peer.m_pending_tx_announcements.push_back(getObjectHash(createTransaction()));
+  }
+
+  handler.flushTransactionAnnouncements();
+
+  auto inventories = p2p.sent<NOTIFY_TX_INVENTORY>(peer.m_connection_id);
+  ASSERT_EQ(3, inventories.size());
+  EXPECT_EQ(P2P_TX_INVENTORY_MAX_COUNT, inventories[0].txs.size());
+  EXPECT_EQ(P2P_TX_INVENTORY_MAX_COUNT, inventories[1].txs.size());
+  EXPECT_EQ(1, inventories[2].txs.size());
+  EXPECT_TRUE(peer.m_pending_tx_announcements.empty());
+}
+
+}
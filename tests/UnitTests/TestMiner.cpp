@@ -0,0 +1,194 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <logging/LoggerGroup.h>
+
+#include "cryptonote/core/Account.h"
+#include "cryptonote/core/Currency.h"
+#include "cryptonote/core/IMinerHandler.h"
+#include "cryptonote/core/Miner.h"
+
+using namespace cryptonote;
+
+namespace {
+
+// Hands out templates on a fixed previous block, a rejected block switches the miner to the next one
+class MinerHandlerStub : public IMinerHandler {
+public:
+  MinerHandlerStub() : miner(nullptr), difficulty(1), acceptBlocks(true), acceptedBlocks(0), rejectedBlocks(0), templateRequests(0) {
+  }
+
+  virtual bool handle_block_found(Block& b) override {
+    if (acceptBlocks) {
+      ++acceptedBlocks;
+      return true;
+    }
+
+    ++rejectedBlocks;
+    miner->set_block_template(makeTemplate(rejectedBlocks), difficulty);
+    return false;
+  }
+
+  virtual bool get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) override {
+    ++templateRequests;
+    b = makeTemplate(rejectedBlocks);
+    diffic = difficulty;
+    height = 1;
+    return true;
+  }
+
+  cryptonote::miner* miner;
+  difficulty_type difficulty;
+  bool acceptBlocks;
+  std::atomic<size_t> acceptedBlocks;
+  std::atomic<size_t> rejectedBlocks;
+  std::atomic<size_t> templateRequests;
+
+private:
+  static Block makeTemplate(size_t previousBlock) {
+    Block block = boost::value_initialized<Block>();
+    block.majorVersion = BLOCK_MAJOR_VERSION_1;
+    block.previousBlockHash.data[0] = static_cast<uint8_t>(previousBlock);
+    return block;
+  }
+};
+
+class MinerTest : public ::testing::Test {
+public:
+  MinerTest() :
+    dataDir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("miner_%%%%%%%%%%%%")),
+    currency(CurrencyBuilder(logger, (boost::filesystem::create_directories(dataDir), dataDir.string())).currency()),
+    miner(currency, handler, logger) {
+    handler.miner = &miner;
+    account.generate();
+  }
+
+  virtual void SetUp() override {
+    // the miner saves its config next to the extra messages after every accepted block
+    std::string extraMessages = (dataDir / "extra_messages").string();
+    std::ofstream(extraMessages) << "dGVzdA==" << std::endl;
+
+    MinerConfig config;
+    config.extraMessages = extraMessages;
+    ASSERT_TRUE(miner.init(config));
+  }
+
+  virtual void TearDown() override {
+    miner.stop();
+    boost::filesystem::remove_all(dataDir);
+  }
+
+  bool waitFor(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!condition()) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return true;
+  }
+
+  static uint64_t threadHashes(const miner::mining_stats& stats) {
+    uint64_t hashes = 0;
+    for (const miner::thread_stats& thread : stats.threads) {
+      hashes += thread.hashes;
+    }
+
+    return hashes;
+  }
+
+protected:
+  Logging::LoggerGroup logger;
+  boost::filesystem::path dataDir;
+  Currency currency;
+  MinerHandlerStub handler;
+  cryptonote::miner miner;
+  AccountBase account;
+};
+
+TEST_F(MinerTest, countsHashesAndFoundBlocks) {
+  ASSERT_TRUE(miner.start(account.getAccountKeys().address, 2));
+  ASSERT_TRUE(waitFor([this] { return handler.acceptedBlocks >= 10; }));
+  EXPECT_TRUE(miner.get_stats().mining);
+  miner.stop();
+
+  miner::mining_stats stats = miner.get_stats();
+  EXPECT_FALSE(stats.mining);
+  ASSERT_EQ(2, stats.threads.size());
+  EXPECT_EQ(threadHashes(stats), stats.hashes);
+  EXPECT_EQ(handler.acceptedBlocks, stats.blocks_found);
+  EXPECT_GE(stats.hashes, stats.blocks_found);
+  EXPECT_EQ(0, stats.stale_templates);
+  EXPECT_EQ(1, stats.template_updates);
+  EXPECT_EQ(1, handler.templateRequests);
+}
+
+TEST_F(MinerTest, countsBlocksOfOutdatedTemplatesAsStale) {
+  handler.acceptBlocks = false;
+
+  ASSERT_TRUE(miner.start(account.getAccountKeys().address, 1));
+  ASSERT_TRUE(waitFor([this] { return handler.rejectedBlocks >= 5; }));
+  miner.stop();
+
+  miner::mining_stats stats = miner.get_stats();
+  EXPECT_EQ(0, stats.blocks_found);
+  EXPECT_EQ(handler.rejectedBlocks, stats.stale_templates);
+  EXPECT_EQ(1 + handler.rejectedBlocks, stats.template_updates);
+}
+
+// The miner runs shorter than the shortest window, so every window averages the whole run
+TEST_F(MinerTest, hashrateWindowsAverageTheWholeRunWhileItIsShorter) {
+  handler.difficulty = std::numeric_limits<difficulty_type>::max();
+
+  ASSERT_TRUE(miner.start(account.getAccountKeys().address, 2));
+  ASSERT_TRUE(waitFor([this] {
+    miner.on_idle();
+    return miner.get_stats().hashrates[0] != 0;
+  }));
+
+  miner::mining_stats stats = miner.get_stats();
+  ASSERT_EQ(2, stats.threads.size());
+  uint64_t threadHashrates = 0;
+  for (const miner::thread_stats& thread : stats.threads) {
+    for (size_t window = 1; window != miner::HASHRATE_WINDOW_COUNT; ++window) {
+      EXPECT_EQ(thread.hashrates[0], thread.hashrates[window]);
+    }
+
+    threadHashrates += thread.hashrates[0];
+  }
+
+  EXPECT_EQ(threadHashrates, stats.hashrates[0]);
+  for (size_t window = 1; window != miner::HASHRATE_WINDOW_COUNT; ++window) {
+    EXPECT_EQ(stats.hashrates[0], stats.hashrates[window]);
+  }
+
+  EXPECT_EQ(0, stats.blocks_found);
+}
+
+TEST_F(MinerTest, rejectsMoreThreadsThanItHasCountersFor) {
+  EXPECT_FALSE(miner.start(account.getAccountKeys().address, miner::MAX_THREADS + 1));
+  EXPECT_FALSE(miner.is_mining());
+  EXPECT_TRUE(miner.get_stats().threads.empty());
+
+  cryptonote::miner configuredMiner(currency, handler, logger);
+  MinerConfig config;
+  config.startMining = AccountBase::getAddress(account.getAccountKeys().address);
+  config.miningThreads = miner::MAX_THREADS + 1;
+  EXPECT_FALSE(configuredMiner.init(config));
+}
+
+}
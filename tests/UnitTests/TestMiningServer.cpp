@@ -0,0 +1,351 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+#include <logging/LoggerGroup.h>
+#include <system/ContextGroup.h>
+#include <system/Dispatcher.h>
+#include <system/Event.h>
+#include <system/Ipv4Address.h>
+#include <system/TcpConnection.h>
+#include <system/TcpConnector.h>
+#include <system/Timer.h>
+
+#include "common/StringTools.h"
+#include "CryptoNoteConfig.h"
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "miner/MiningServer.h"
+#include "rpc/HttpServer.h"
+
+using namespace cryptonote;
+using namespace Miner;
+
+namespace {
+
+const uint16_t DAEMON_PORT = 18181;
+const uint16_t JOB_SERVER_PORT = 18182;
+const uint32_t NONCE_RANGE_SIZE = 1 << 24;
+
+// Answers getblocktemplate with a template of the test and waits for its change when asked to, records submitted blocks
+class DaemonStub : public HttpServer {
+public:
+  DaemonStub(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
+    HttpServer(dispatcher, logger), difficulty(1), templateVersion(1), templateChanged(dispatcher), previousBlockHash(NULL_HASH) {
+  }
+
+  void changeTemplate(bool newBlock) {
+    if (newBlock) {
+      previousBlockHash = crypto::rand<crypto::Hash>();
+    }
+
+    ++templateVersion;
+    templateChanged.set();
+  }
+
+  virtual void processRequest(const HttpRequest& request, HttpResponse& response) override {
+    JsonRpc::JsonRpcRequest jsonRequest;
+    JsonRpc::JsonRpcResponse jsonResponse;
+    jsonRequest.parseRequest(request.getBody());
+    jsonResponse.setId(jsonRequest.getId());
+
+    if (jsonRequest.getMethod() == "getblocktemplate") {
+      COMMAND_RPC_GETBLOCKTEMPLATE::request params;
+      jsonRequest.loadParams(params);
+      while (params.wait_timeout != 0 && params.template_version == templateVersion) {
+        templateChanged.wait();
+        templateChanged.clear();
+      }
+
+      jsonResponse.setResult(makeTemplate());
+    } else if (jsonRequest.getMethod() == "submitblock") {
+      COMMAND_RPC_SUBMITBLOCK::request params;
+      jsonRequest.loadParams(params);
+      submittedBlocks.insert(submittedBlocks.end(), params.begin(), params.end());
+
+      COMMAND_RPC_SUBMITBLOCK::response result;
+      result.status = CORE_RPC_STATUS_OK;
+      jsonResponse.setResult(result);
+    }
+
+    response.setBody(jsonResponse.getBody());
+  }
+
+  uint64_t difficulty;
+  uint64_t templateVersion;
+  std::vector<std::string> submittedBlocks;
+
+private:
+  COMMAND_RPC_GETBLOCKTEMPLATE::response makeTemplate() {
+    const uint8_t reservedMarker[] = { 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5 };
+
+    Block block = boost::value_initialized<Block>();
+    block.majorVersion = BLOCK_MAJOR_VERSION_1;
+    block.previousBlockHash = previousBlockHash;
+    block.baseTransaction.version = CURRENT_TRANSACTION_VERSION;
+    block.baseTransaction.inputs.push_back(BaseInput{ 10 });
+    block.baseTransaction.extra.assign(std::begin(reservedMarker), std::end(reservedMarker));
+
+    BinaryArray blob = toBinaryArray(block);
+    auto reserved = std::search(blob.begin(), blob.end(), std::begin(reservedMarker), std::end(reservedMarker));
+
+    COMMAND_RPC_GETBLOCKTEMPLATE::response response = boost::value_initialized<COMMAND_RPC_GETBLOCKTEMPLATE::response>();
+    response.difficulty = difficulty;
+    response.height = 10;
+    response.reserved_offset = static_cast<uint64_t>(reserved - blob.begin());
+    response.blocktemplate_blob = Common::toHex(blob);
+    response.template_version = templateVersion;
+    response.status = CORE_RPC_STATUS_OK;
+    return response;
+  }
+
+  System::Event templateChanged;
+  crypto::Hash previousBlockHash;
+};
+
+class MinerClient {
+public:
+  MinerClient(System::Dispatcher& dispatcher) :
+    connection(System::TcpConnector(dispatcher).connect(System::Ipv4Address("127.0.0.1"), JOB_SERVER_PORT)),
+    miningConnection(connection) {
+  }
+
+  bool readMessage(JsonRpc::JsonRpcRequest& message) {
+    return miningConnection.readMessage(message);
+  }
+
+  MiningJob readJob() {
+    JsonRpc::JsonRpcRequest message;
+    EXPECT_TRUE(readMessage(message));
+    EXPECT_EQ(MINING_METHOD_JOB, message.getMethod());
+
+    MiningJob job = boost::value_initialized<MiningJob>();
+    message.loadParams(job);
+    return job;
+  }
+
+  void getJob(uint64_t jobId) {
+    MiningGetJob request;
+    request.job_id = jobId;
+    miningConnection.writeMessage(makeMiningMessage(MINING_METHOD_GET_JOB, request));
+  }
+
+  void sendShare(uint64_t jobId, uint32_t nonce, const crypto::Hash& hash) {
+    MiningShare share;
+    share.job_id = jobId;
+    share.nonce = nonce;
+    share.hash = Common::podToHex(hash);
+    miningConnection.writeMessage(makeMiningMessage(MINING_METHOD_SUBMIT, share));
+  }
+
+  MiningShareResult submit(uint64_t jobId, uint32_t nonce, const crypto::Hash& hash) {
+    sendShare(jobId, nonce, hash);
+
+    JsonRpc::JsonRpcRequest message;
+    MiningShareResult result = boost::value_initialized<MiningShareResult>();
+    if (readMessage(message)) {
+      EXPECT_EQ(MINING_METHOD_RESULT, message.getMethod());
+      message.loadParams(result);
+    }
+
+    return result;
+  }
+
+  System::TcpConnection connection;
+  MiningConnection miningConnection;
+};
+
+crypto::Hash getLongHash(const MiningJob& job, uint32_t nonce) {
+  BinaryArray blob;
+  Block block;
+  EXPECT_TRUE(Common::fromHex(job.blob, blob));
+  EXPECT_TRUE(fromBinaryArray(block, blob));
+
+  block.nonce = nonce;
+  crypto::Hash hash;
+  EXPECT_TRUE(get_block_longhash(block, hash));
+  return hash;
+}
+
+crypto::Hash filledHash(uint8_t value) {
+  crypto::Hash hash;
+  std::fill(std::begin(hash.data), std::end(hash.data), value);
+  return hash;
+}
+
+class MiningServerTest : public ::testing::Test {
+public:
+  MiningServerTest() : daemon(dispatcher, logger), contextGroup(dispatcher) {
+    config.miningAddress = "address";
+    config.daemonHost = "127.0.0.1";
+    config.daemonPort = DAEMON_PORT;
+    config.scanPeriod = 1;
+    config.jobServerBindIp = "127.0.0.1";
+    config.jobServerBindPort = JOB_SERVER_PORT;
+  }
+
+  virtual void SetUp() override {
+    daemon.start("127.0.0.1", DAEMON_PORT);
+  }
+
+  virtual void TearDown() override {
+    server.reset();
+    daemon.stop();
+  }
+
+protected:
+  void startServer() {
+    server.reset(new MiningServer(dispatcher, config, logger));
+    contextGroup.spawn([this] { server->start(); });
+    dispatcher.yield();
+  }
+
+  System::Dispatcher dispatcher;
+  Logging::LoggerGroup logger;
+  DaemonStub daemon;
+  MiningConfig config;
+  System::ContextGroup contextGroup;
+  std::unique_ptr<MiningServer> server;
+};
+
+}
+
+TEST_F(MiningServerTest, givesEveryMinerItsOwnNonceRange) {
+  startServer();
+  MinerClient miner1(dispatcher);
+  MiningJob job1 = miner1.readJob();
+  MinerClient miner2(dispatcher);
+  MiningJob job2 = miner2.readJob();
+
+  ASSERT_EQ(job1.job_id, job2.job_id);
+  ASSERT_EQ(job1.blob, job2.blob);
+  ASSERT_EQ(0, job1.nonce_start);
+  ASSERT_EQ(NONCE_RANGE_SIZE, job1.nonce_count);
+  ASSERT_EQ(NONCE_RANGE_SIZE, job2.nonce_start);
+  ASSERT_EQ(NONCE_RANGE_SIZE, job2.nonce_count);
+
+  miner1.getJob(job1.job_id);
+  MiningJob nextRange = miner1.readJob();
+  ASSERT_EQ(job1.job_id, nextRange.job_id);
+  ASSERT_EQ(2 * NONCE_RANGE_SIZE, nextRange.nonce_start);
+}
+
+TEST_F(MiningServerTest, startsNewJobWhenNonceSpaceIsExhausted) {
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+
+  for (uint32_t i = 1; i < (1ULL << 32) / NONCE_RANGE_SIZE; ++i) {
+    miner.getJob(job.job_id);
+    ASSERT_EQ(i * NONCE_RANGE_SIZE, miner.readJob().nonce_start);
+  }
+
+  miner.getJob(job.job_id);
+  MiningJob newJob = miner.readJob();
+  ASSERT_NE(job.job_id, newJob.job_id);
+  ASSERT_NE(job.blob, newJob.blob);
+  ASSERT_EQ(0, newJob.nonce_start);
+}
+
+TEST_F(MiningServerTest, sendsNewJobOnTemplateChange) {
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+
+  daemon.changeTemplate(false);
+  MiningJob newJob = miner.readJob();
+  ASSERT_NE(job.job_id, newJob.job_id);
+  ASSERT_EQ(0, newJob.nonce_start);
+
+  // a getjob for an old job is answered by the job already sent
+  miner.getJob(job.job_id);
+  crypto::Hash hash = getLongHash(newJob, 0);
+  ASSERT_EQ(MINING_SHARE_STATUS_OK, miner.submit(newJob.job_id, 0, hash).status);
+}
+
+TEST_F(MiningServerTest, acceptsValidShareAndSubmitsBlock) {
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+
+  crypto::Hash hash = getLongHash(job, 5);
+  MiningShareResult result = miner.submit(job.job_id, 5, hash);
+  ASSERT_EQ(MINING_SHARE_STATUS_OK, result.status);
+  ASSERT_TRUE(result.block);
+  ASSERT_EQ(1, daemon.submittedBlocks.size());
+
+  ASSERT_EQ("DUPLICATE", miner.submit(job.job_id, 5, hash).status);
+}
+
+TEST_F(MiningServerTest, acceptsSharesOfOlderJobsOnSameBlock) {
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+
+  daemon.changeTemplate(false);
+  miner.readJob();
+  ASSERT_EQ(MINING_SHARE_STATUS_OK, miner.submit(job.job_id, 1, getLongHash(job, 1)).status);
+}
+
+TEST_F(MiningServerTest, rejectsSharesOfJobsOnPreviousBlock) {
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+
+  daemon.changeTemplate(true);
+  miner.readJob();
+  ASSERT_EQ(MINING_SHARE_STATUS_OUTDATED_JOB, miner.submit(job.job_id, 1, getLongHash(job, 1)).status);
+}
+
+TEST_F(MiningServerTest, rejectsNonceOutsideAssignedRanges) {
+  startServer();
+  MinerClient miner1(dispatcher);
+  MiningJob job1 = miner1.readJob();
+  MinerClient miner2(dispatcher);
+  MiningJob job2 = miner2.readJob();
+
+  uint32_t nonce = job2.nonce_start;
+  ASSERT_EQ("WRONG_NONCE", miner1.submit(job1.job_id, nonce, getLongHash(job1, nonce)).status);
+  ASSERT_EQ(MINING_SHARE_STATUS_OK, miner2.submit(job2.job_id, nonce, getLongHash(job2, nonce)).status);
+
+  miner1.getJob(job1.job_id);
+  MiningJob nextRange = miner1.readJob();
+  nonce = nextRange.nonce_start + nextRange.nonce_count - 1;
+  ASSERT_EQ(MINING_SHARE_STATUS_OK, miner1.submit(job1.job_id, nonce, getLongHash(job1, nonce)).status);
+  ASSERT_EQ("WRONG_NONCE", miner1.submit(job1.job_id, nonce + 1, getLongHash(job1, nonce + 1)).status);
+}
+
+TEST_F(MiningServerTest, rejectsLowDifficultyShareWithoutVerifyingHash) {
+  daemon.difficulty = 1000;
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+  ASSERT_EQ(1000, job.difficulty);
+
+  // a wrong hash isn't noticed, so the miner stays connected
+  ASSERT_EQ("LOW_DIFFICULTY", miner.submit(job.job_id, 1, filledHash(0xff)).status);
+  ASSERT_EQ("LOW_DIFFICULTY", miner.submit(job.job_id, 2, filledHash(0xff)).status);
+}
+
+TEST_F(MiningServerTest, bansMinerSendingWrongHash) {
+  startServer();
+  MinerClient miner(dispatcher);
+  MiningJob job = miner.readJob();
+
+  miner.sendShare(job.job_id, 1, filledHash(0));
+
+  // the connection is closed, possibly before the result is sent
+  JsonRpc::JsonRpcRequest message;
+  while (miner.readMessage(message)) {
+    MiningShareResult result;
+    message.loadParams(result);
+    ASSERT_EQ(MINING_SHARE_STATUS_WRONG_HASH, result.status);
+  }
+
+  MinerClient reconnected(dispatcher);
+  ASSERT_FALSE(reconnected.readMessage(message));
+}
@@ -0,0 +1,180 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <future>
+
+#include <logging/LoggerGroup.h>
+#include <system/Dispatcher.h>
+#include <system/Event.h>
+#include <system/Timer.h>
+
+#include "common/StringTools.h"
+#include "NodeRpcProxy/NodeRpcProxy.h"
+#include "rpc/CoreRpcServerCommandsDefinitions.h"
+#include "rpc/HttpServer.h"
+#include "rpc/JsonRpc.h"
+#include "serialization/SerializationTools.h"
+
+using namespace cryptonote;
+
+namespace {
+
+const uint16_t DAEMON_PORT = 18183;
+
+// Reports a top block of the test, answers /wait_update when the top changes unless it pretends to be an older daemon
+class DaemonStub : public HttpServer {
+public:
+  DaemonStub(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
+    HttpServer(dispatcher, logger), waitUpdateSupported(true), statusRequests(0), waitUpdateRequests(0),
+    height(0), topHash(crypto::rand<crypto::Hash>()), topChanged(dispatcher) {
+  }
+
+  void addBlock() {
+    ++height;
+    topHash = crypto::rand<crypto::Hash>();
+    topChanged.set();
+  }
+
+  virtual void processRequest(const HttpRequest& request, HttpResponse& response) override {
+    if (request.getUrl() == "/json_rpc") {
+      JsonRpc::JsonRpcRequest jsonRequest;
+      JsonRpc::JsonRpcResponse jsonResponse;
+      jsonRequest.parseRequest(request.getBody());
+      jsonResponse.setId(jsonRequest.getId());
+
+      if (jsonRequest.getMethod() == "getlastblockheader") {
+        ++statusRequests;
+
+        COMMAND_RPC_GET_LAST_BLOCK_HEADER::response result = boost::value_initialized<COMMAND_RPC_GET_LAST_BLOCK_HEADER::response>();
+        result.block_header.height = height;
+        result.block_header.hash = Common::podToHex(topHash);
+        result.status = CORE_RPC_STATUS_OK;
+        jsonResponse.setResult(result);
+      }
+
+      response.setBody(jsonResponse.getBody());
+    } else if (request.getUrl() == "/wait_update") {
+      ++waitUpdateRequests;
+      if (!waitUpdateSupported) {
+        response.setStatus(HttpResponse::STATUS_404);
+        return;
+      }
+
+      COMMAND_RPC_WAIT_UPDATE::request req;
+      loadFromJson(req, request.getBody());
+      while (req.last_block_hash == Common::podToHex(topHash)) {
+        topChanged.wait();
+        topChanged.clear();
+      }
+
+      COMMAND_RPC_WAIT_UPDATE::response res = boost::value_initialized<COMMAND_RPC_WAIT_UPDATE::response>();
+      res.height = height;
+      res.block_hash = Common::podToHex(topHash);
+      res.pool_version = req.pool_version;
+      res.status = CORE_RPC_STATUS_OK;
+      response.setBody(storeToJson(res));
+    } else {
+      response.setStatus(HttpResponse::STATUS_404);
+    }
+  }
+
+  bool waitUpdateSupported;
+  std::atomic<size_t> statusRequests;
+  std::atomic<size_t> waitUpdateRequests;
+
+private:
+  uint32_t height;
+  crypto::Hash topHash;
+  System::Event topChanged;
+};
+
+class HeightObserver : public INodeObserver {
+public:
+  HeightObserver() : height(0) {
+  }
+
+  virtual void localBlockchainUpdated(uint32_t newHeight) override {
+    height = newHeight;
+  }
+
+  std::atomic<uint32_t> height;
+};
+
+class NodeRpcProxyTest : public ::testing::Test {
+public:
+  NodeRpcProxyTest() : daemon(dispatcher, logger), node("127.0.0.1", DAEMON_PORT) {
+  }
+
+  virtual void SetUp() override {
+    daemon.start("127.0.0.1", DAEMON_PORT);
+    node.addObserver(&observer);
+  }
+
+  virtual void TearDown() override {
+    node.shutdown();
+    node.removeObserver(&observer);
+    daemon.stop();
+  }
+
+  void initNode() {
+    std::promise<std::error_code> initPromise;
+    node.init([&initPromise](std::error_code ec) { initPromise.set_value(ec); });
+    auto initFuture = initPromise.get_future();
+    ASSERT_FALSE(initFuture.get());
+  }
+
+  // runs the daemon until the condition is true or the timeout expires
+  bool runDaemonUntil(const std::function<bool()>& condition, std::chrono::milliseconds timeout) {
+    System::Timer timer(dispatcher);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+
+      timer.sleep(std::chrono::milliseconds(10));
+    }
+
+    return true;
+  }
+
+protected:
+  Logging::LoggerGroup logger;
+  System::Dispatcher dispatcher;
+  DaemonStub daemon;
+  NodeRpcProxy node;
+  HeightObserver observer;
+};
+
+TEST_F(NodeRpcProxyTest, waitsForUpdatesInsteadOfPolling) {
+  node.pullInterval(60 * 1000);
+  initNode();
+
+  // the first request returns at once, the node doesn't know the top block yet
+  ASSERT_TRUE(runDaemonUntil([this] { return daemon.waitUpdateRequests == 2; }, std::chrono::seconds(5)));
+  EXPECT_EQ(2, daemon.statusRequests);
+
+  daemon.addBlock();
+  ASSERT_TRUE(runDaemonUntil([this] { return observer.height == 1; }, std::chrono::seconds(5)));
+  ASSERT_TRUE(runDaemonUntil([this] { return daemon.waitUpdateRequests == 3; }, std::chrono::seconds(5)));
+  EXPECT_EQ(3, daemon.statusRequests);
+}
+
+TEST_F(NodeRpcProxyTest, fallsBackToPollingIfWaitUpdateIsNotFound) {
+  daemon.waitUpdateSupported = false;
+  node.pullInterval(50);
+  initNode();
+
+  ASSERT_TRUE(runDaemonUntil([this] { return daemon.statusRequests >= 3; }, std::chrono::seconds(5)));
+  EXPECT_EQ(1, daemon.waitUpdateRequests);
+
+  daemon.addBlock();
+  ASSERT_TRUE(runDaemonUntil([this] { return observer.height == 1; }, std::chrono::seconds(5)));
+  EXPECT_EQ(1, daemon.waitUpdateRequests);
+}
+
+}
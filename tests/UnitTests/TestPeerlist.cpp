@@ -60,3 +60,108 @@ TEST(peer_list, merge_peer_lists)
 
 
 }
+
+namespace {
+
+PeerlistEntry makeEntry(uint32_t ip, uint32_t port, uint64_t lastSeen) {
+  PeerlistEntry entry;
+  entry.adr.ip = ip;
+  entry.adr.port = port;
+  entry.id = ip;
+  entry.last_seen = lastSeen;
+  return entry;
+}
+
+}
+
+TEST(peer_list, subnet_bucket_keeps_most_recently_seen)
+{
+  PeerlistManager::Peerlist peerlist(100, 3);
+  for (uint32_t i = 1; i <= 3; ++i) {
+    peerlist.insert(makeEntry(MAKE_IP(123, 43, 12, i), 8080, 100 + i));
+  }
+
+  // same /16 subnet, the oldest entry is replaced, an older one is dropped
+  peerlist.insert(makeEntry(MAKE_IP(123, 43, 200, 1), 8080, 200));
+  peerlist.insert(makeEntry(MAKE_IP(123, 43, 200, 2), 8080, 50));
+  peerlist.insert(makeEntry(MAKE_IP(124, 43, 12, 1), 8080, 10));
+
+  ASSERT_EQ(4, peerlist.count());
+  ASSERT_FALSE(peerlist.contains(makeEntry(MAKE_IP(123, 43, 12, 1), 8080, 0).adr));
+  ASSERT_TRUE(peerlist.contains(makeEntry(MAKE_IP(123, 43, 200, 1), 8080, 0).adr));
+  ASSERT_FALSE(peerlist.contains(makeEntry(MAKE_IP(123, 43, 200, 2), 8080, 0).adr));
+  ASSERT_TRUE(peerlist.contains(makeEntry(MAKE_IP(124, 43, 12, 1), 8080, 0).adr));
+
+  // an update does not need a free slot
+  peerlist.insert(makeEntry(MAKE_IP(123, 43, 12, 2), 8080, 300));
+  std::list<PeerlistEntry> newest;
+  peerlist.getNewest(newest, 2, true);
+  ASSERT_EQ(2, newest.size());
+  ASSERT_EQ(300, newest.front().last_seen);
+  ASSERT_EQ(200, newest.back().last_seen);
+}
+
+TEST(peer_list, full_list_evicts_old_entries)
+{
+  const size_t maxSize = 1000;
+  PeerlistManager::Peerlist peerlist(maxSize, maxSize);
+  for (uint32_t i = 0; i < 100000; ++i) {
+    uint32_t a2 = i & 0xff;
+    uint32_t a3 = (i >> 8) & 0xff;
+    peerlist.insert(makeEntry(MAKE_IP(10, a2, a3, 1), 1000 + (i >> 16), i + 1));
+  }
+
+  ASSERT_EQ(maxSize, peerlist.count());
+
+  // sampled eviction keeps recent entries
+  uint64_t seenSum = 0;
+  PeerlistEntry entry;
+  for (size_t i = 0; i < peerlist.count(); ++i) {
+    ASSERT_TRUE(peerlist.get(entry, i));
+    seenSum += entry.last_seen;
+  }
+
+  ASSERT_LT(100000 - 10000, seenSum / maxSize);
+
+  ASSERT_TRUE(peerlist.remove(entry.adr));
+  ASSERT_FALSE(peerlist.remove(entry.adr));
+  ASSERT_EQ(maxSize - 1, peerlist.count());
+}
+
+TEST(peer_list, random_pick_prefers_recent_peers)
+{
+  PeerlistManager::Peerlist peerlist(100, 100);
+  PeerlistEntry entry;
+  ASSERT_FALSE(peerlist.getRandom(entry));
+
+  for (uint32_t i = 1; i <= 100; ++i) {
+    peerlist.insert(makeEntry(MAKE_IP(123, 43, 12, i), 8080, i));
+  }
+
+  size_t recent = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(peerlist.getRandom(entry));
+    if (entry.last_seen > 50) {
+      ++recent;
+    }
+  }
+
+  // three quarters expected
+  ASSERT_LT(650, recent);
+}
+
+TEST(peer_list, white_peer_is_removed_from_gray_list)
+{
+  PeerlistManager plm;
+  plm.init(false);
+  ASSERT_TRUE(plm.append_with_peer_gray(makeEntry(MAKE_IP(123, 43, 12, 1), 8080, 1)));
+  ASSERT_TRUE(plm.append_with_peer_white(makeEntry(MAKE_IP(123, 43, 12, 1), 8080, 2)));
+  ASSERT_TRUE(plm.append_with_peer_gray(makeEntry(MAKE_IP(123, 43, 12, 1), 8080, 3)));
+  ASSERT_EQ(0, plm.get_gray_peers_count());
+  ASSERT_EQ(1, plm.get_white_peers_count());
+
+  PeerlistEntry entry;
+  ASSERT_TRUE(plm.get_random_white_peer(entry));
+  ASSERT_EQ(2, entry.last_seen);
+  ASSERT_FALSE(plm.get_random_gray_peer(entry));
+}
@@ -25,3 +25,27 @@ TEST(protocol_pack, protocol_pack_command)
     ASSERT_TRUE(r.total_height == 3);
   }
 }
+
+TEST(protocol_pack, protocol_pack_compact_block)
+{
+  cryptonote::NOTIFY_NEW_COMPACT_BLOCK::request block;
+  block.block = "block";
+  block.current_blockchain_height = 10;
+  block.hop = 2;
+
+  cryptonote::NOTIFY_NEW_COMPACT_BLOCK::request block2;
+  ASSERT_TRUE(cryptonote::loadFromBinaryKeyValue(block2, cryptonote::storeToBinaryKeyValue(block)));
+  ASSERT_EQ(block.block, block2.block);
+  ASSERT_EQ(block.current_blockchain_height, block2.current_blockchain_height);
+  ASSERT_EQ(block.hop, block2.hop);
+
+  cryptonote::NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request request;
+  request.block_id = cryptonote::NULL_HASH;
+  request.txs.resize(3, cryptonote::NULL_HASH);
+  request.hop = 2;
+
+  cryptonote::NOTIFY_REQUEST_COMPACT_BLOCK_TXS::request request2;
+  ASSERT_TRUE(cryptonote::loadFromBinaryKeyValue(request2, cryptonote::storeToBinaryKeyValue(request)));
+  ASSERT_EQ(request.txs, request2.txs);
+  ASSERT_EQ(request.hop, request2.hop);
+}
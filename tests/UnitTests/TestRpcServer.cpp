@@ -0,0 +1,459 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <logging/LoggerGroup.h>
+#include <system/ContextGroup.h>
+#include <system/Dispatcher.h>
+
+#include "common/StringTools.h"
+#include "cryptonote/core/Account.h"
+#include "cryptonote/core/Core.h"
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "cryptonote/core/Currency.h"
+#include "cryptonote/core/Miner.h"
+#include "cryptonote/protocol/handler.h"
+#include "p2p/NetNode.h"
+#include "rpc/CoreRpcServerCommandsDefinitions.h"
+#include "rpc/JsonRpc.h"
+#include "rpc/RpcServer.h"
+#include "serialization/SerializationTools.h"
+
+using namespace cryptonote;
+
+namespace {
+
+class RpcServerTest : public ::testing::Test {
+public:
+  RpcServerTest() :
+    dataDir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("rpc_server_%%%%%%%%%%%%")),
+    currency(CurrencyBuilder(logger, (boost::filesystem::create_directories(dataDir), dataDir.string())).currency()),
+    core(currency, nullptr, logger),
+    protocol(currency, dispatcher, core, nullptr, logger),
+    nodeServer(dispatcher, protocol, logger) {
+    account.generate();
+  }
+
+  virtual void SetUp() override {
+    ASSERT_TRUE(core.init(MinerConfig(), false));
+    rpcServer.reset(new RpcServer(dispatcher, logger, core, nodeServer, protocol));
+  }
+
+  virtual void TearDown() override {
+    rpcServer.reset();
+    core.deinit();
+    boost::filesystem::remove_all(dataDir);
+  }
+
+  void addBlock() {
+    Block block;
+    difficulty_type difficulty;
+    uint32_t height;
+    uint64_t version;
+    ASSERT_TRUE(core.getBlockTemplate(block, account.getAccountKeys().address, difficulty, height, BinaryArray(), version));
+
+    BlockVerificationContext bvc = boost::value_initialized<BlockVerificationContext>();
+    ASSERT_TRUE(core.handle_incoming_block_blob(toBinaryArray(block), bvc, false, false));
+    ASSERT_TRUE(bvc.m_added_to_main_chain);
+  }
+
+  // The pool keeps transactions of disconnected blocks without checking their inputs
+  void addPoolTransaction() {
+    Transaction tx = boost::value_initialized<Transaction>();
+    tx.version = CURRENT_TRANSACTION_VERSION;
+
+    KeyInput input;
+    input.amount = 1000;
+    input.outputIndexes.push_back(0);
+    input.keyImage = crypto::rand<crypto::KeyImage>();
+    tx.inputs.push_back(input);
+
+    crypto::PublicKey outputKey;
+    crypto::SecretKey outputSecretKey;
+    crypto::generate_keys(outputKey, outputSecretKey);
+
+    TransactionOutput output;
+    output.amount = 900;
+    output.target = KeyOutput{ outputKey };
+    tx.outputs.push_back(output);
+    tx.signatures.resize(1);
+    tx.signatures[0].push_back(crypto::rand<crypto::Signature>());
+
+    TxVerificationContext tvc = boost::value_initialized<TxVerificationContext>();
+    ASSERT_TRUE(core.handleIncomingTransaction(tx, getObjectHash(tx), getObjectBinarySize(tx), tvc, true));
+    ASSERT_TRUE(tvc.m_added_to_pool);
+  }
+
+  crypto::Hash topHash() {
+    uint32_t height;
+    crypto::Hash hash;
+    core.get_blockchain_top(height, hash);
+    return hash;
+  }
+
+  template <typename Request, typename Response>
+  void request(const std::string& url, const Request& req, Response& res) {
+    HttpRequest httpRequest;
+    HttpResponse httpResponse;
+    httpRequest.setUrl(url);
+    httpRequest.setBody(storeToJson(req));
+    static_cast<HttpServer&>(*rpcServer).processRequest(httpRequest, httpResponse);
+
+    ASSERT_EQ(HttpResponse::STATUS_200, httpResponse.getStatus());
+    ASSERT_TRUE(loadFromJson(res, httpResponse.getBody()));
+  }
+
+  template <typename Request, typename Response>
+  void jsonRpcRequest(const std::string& method, const Request& req, Response& res) {
+    JsonRpc::JsonRpcRequest jsonRequest;
+    jsonRequest.setMethod(method);
+    jsonRequest.setParams(req);
+
+    HttpRequest httpRequest;
+    HttpResponse httpResponse;
+    httpRequest.setUrl("/json_rpc");
+    httpRequest.setBody(jsonRequest.getBody());
+    static_cast<HttpServer&>(*rpcServer).processRequest(httpRequest, httpResponse);
+
+    JsonRpc::JsonRpcResponse jsonResponse;
+    jsonResponse.parse(httpResponse.getBody());
+    JsonRpc::JsonRpcError error;
+    ASSERT_FALSE(jsonResponse.getError(error)) << error.message;
+    ASSERT_TRUE(jsonResponse.getResult(res));
+  }
+
+  // The protocol handler reports the core synchronized after a peer with the same top block connects
+  void markSynchronized() {
+    CORE_SYNC_DATA syncData;
+    protocol.get_payload_sync_data(syncData);
+    CryptoNoteConnectionContext context;
+    ASSERT_TRUE(protocol.process_payload_sync_data(syncData, context, true));
+    ASSERT_TRUE(protocol.isSynchronized());
+  }
+
+  Transaction getMinerTx(const AccountBase& minerAccount, const BinaryArray& extraNonce, uint64_t& version) {
+    Block block;
+    difficulty_type difficulty;
+    uint32_t height;
+    EXPECT_TRUE(core.getBlockTemplate(block, minerAccount.getAccountKeys().address, difficulty, height, extraNonce, version));
+    return block.baseTransaction;
+  }
+
+  COMMAND_RPC_GETBLOCKTEMPLATE::response getBlockTemplate(uint64_t templateVersion, uint32_t waitTimeout) {
+    COMMAND_RPC_GETBLOCKTEMPLATE::request req;
+    req.reserve_size = 8;
+    req.wallet_address = AccountBase::getAddress(account.getAccountKeys().address);
+    req.template_version = templateVersion;
+    req.wait_timeout = waitTimeout;
+
+    COMMAND_RPC_GETBLOCKTEMPLATE::response res = boost::value_initialized<COMMAND_RPC_GETBLOCKTEMPLATE::response>();
+    jsonRpcRequest("getblocktemplate", req, res);
+    return res;
+  }
+
+  COMMAND_RPC_WAIT_UPDATE::response waitUpdate(const crypto::Hash& lastBlockHash, uint64_t poolVersion, bool watchPool, uint32_t timeout) {
+    COMMAND_RPC_WAIT_UPDATE::request req;
+    req.last_block_hash = Common::podToHex(lastBlockHash);
+    req.pool_version = poolVersion;
+    req.watch_pool = watchPool;
+    req.timeout = timeout;
+
+    COMMAND_RPC_WAIT_UPDATE::response res = boost::value_initialized<COMMAND_RPC_WAIT_UPDATE::response>();
+    request("/wait_update", req, res);
+    return res;
+  }
+
+protected:
+  Logging::LoggerGroup logger;
+  System::Dispatcher dispatcher;
+  boost::filesystem::path dataDir;
+  Currency currency;
+  cryptonote::core core;
+  CryptoNoteProtocolHandler protocol;
+  NodeServer nodeServer;
+  std::unique_ptr<RpcServer> rpcServer;
+  AccountBase account;
+};
+
+TEST_F(RpcServerTest, waitUpdateReturnsImmediatelyIfTopBlockDiffers) {
+  auto res = waitUpdate(NULL_HASH, 0, false, 10);
+
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_EQ(Common::podToHex(topHash()), res.block_hash);
+  EXPECT_EQ(0, res.height);
+}
+
+TEST_F(RpcServerTest, waitUpdateWakesOnNewBlock) {
+  crypto::Hash lastBlockHash = topHash();
+  COMMAND_RPC_WAIT_UPDATE::response res;
+  bool returned = false;
+
+  System::ContextGroup waiter(dispatcher);
+  waiter.spawn([&] {
+    res = waitUpdate(lastBlockHash, 0, false, 10);
+    returned = true;
+  });
+
+  dispatcher.yield();
+  ASSERT_FALSE(returned);
+
+  auto start = std::chrono::steady_clock::now();
+  addBlock();
+  waiter.wait();
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_EQ(Common::podToHex(topHash()), res.block_hash);
+  EXPECT_NE(Common::podToHex(lastBlockHash), res.block_hash);
+  EXPECT_EQ(1, res.height);
+}
+
+TEST_F(RpcServerTest, waitUpdateWakesOnPoolChangeIfWatched) {
+  crypto::Hash lastBlockHash = topHash();
+  uint64_t poolVersion = waitUpdate(NULL_HASH, 0, false, 0).pool_version;
+  COMMAND_RPC_WAIT_UPDATE::response res;
+  bool returned = false;
+
+  System::ContextGroup waiter(dispatcher);
+  waiter.spawn([&] {
+    res = waitUpdate(lastBlockHash, poolVersion, true, 10);
+    returned = true;
+  });
+
+  dispatcher.yield();
+  ASSERT_FALSE(returned);
+
+  auto start = std::chrono::steady_clock::now();
+  addPoolTransaction();
+  waiter.wait();
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_EQ(Common::podToHex(lastBlockHash), res.block_hash);
+  EXPECT_GT(res.pool_version, poolVersion);
+}
+
+TEST_F(RpcServerTest, waitUpdateReturnsOnTimeout) {
+  crypto::Hash lastBlockHash = topHash();
+  uint64_t poolVersion = waitUpdate(NULL_HASH, 0, false, 0).pool_version;
+
+  auto start = std::chrono::steady_clock::now();
+  auto res = waitUpdate(lastBlockHash, poolVersion, true, 1);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_GE(elapsed, std::chrono::milliseconds(900));
+  EXPECT_LT(elapsed, std::chrono::seconds(5));
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_EQ(Common::podToHex(lastBlockHash), res.block_hash);
+  EXPECT_EQ(poolVersion, res.pool_version);
+}
+
+TEST_F(RpcServerTest, waitUpdateIgnoresPoolChangeIfNotWatched) {
+  crypto::Hash lastBlockHash = topHash();
+  COMMAND_RPC_WAIT_UPDATE::response res;
+  bool returned = false;
+
+  System::ContextGroup waiter(dispatcher);
+  waiter.spawn([&] {
+    res = waitUpdate(lastBlockHash, 0, false, 1);
+    returned = true;
+  });
+
+  dispatcher.yield();
+  addPoolTransaction();
+  dispatcher.yield();
+  EXPECT_FALSE(returned);
+
+  waiter.wait();
+  EXPECT_TRUE(returned);
+  EXPECT_EQ(Common::podToHex(lastBlockHash), res.block_hash);
+}
+
+TEST_F(RpcServerTest, destructorRunsPendingNotifications) {
+  addBlock();
+  addPoolTransaction();
+
+  // notifications are spawned on the dispatcher but haven't run yet
+  rpcServer.reset();
+  addBlock();
+  dispatcher.yield();
+}
+
+TEST_F(RpcServerTest, blockTemplateMinerTxIsReusedForSameAddressAndReserveSize) {
+  BinaryArray extraNonce(8, 0);
+  uint64_t version1;
+  uint64_t version2;
+  Transaction minerTx1 = getMinerTx(account, extraNonce, version1);
+  Transaction minerTx2 = getMinerTx(account, extraNonce, version2);
+
+  EXPECT_EQ(version1, version2);
+  EXPECT_EQ(getObjectHash(minerTx1), getObjectHash(minerTx2));
+}
+
+TEST_F(RpcServerTest, blockTemplateMinerTxIsRebuiltForAnotherAddressOrReserveSize) {
+  AccountBase otherAccount;
+  otherAccount.generate();
+  BinaryArray extraNonce(8, 0);
+  uint64_t version;
+  Transaction minerTx = getMinerTx(account, extraNonce, version);
+
+  uint64_t otherVersion;
+  EXPECT_NE(getObjectHash(minerTx), getObjectHash(getMinerTx(otherAccount, extraNonce, otherVersion)));
+  EXPECT_EQ(version, otherVersion);
+
+  // the miner tx of the other address replaced the cached one
+  Transaction rebuiltMinerTx = getMinerTx(account, extraNonce, otherVersion);
+  EXPECT_NE(getObjectHash(minerTx), getObjectHash(rebuiltMinerTx));
+  EXPECT_NE(getObjectHash(rebuiltMinerTx), getObjectHash(getMinerTx(account, BinaryArray(16, 0), otherVersion)));
+  EXPECT_EQ(version, otherVersion);
+
+  // without a reserve the miner tx is never cached
+  Transaction noReserveMinerTx = getMinerTx(account, BinaryArray(), otherVersion);
+  EXPECT_NE(getObjectHash(noReserveMinerTx), getObjectHash(getMinerTx(account, BinaryArray(), otherVersion)));
+}
+
+TEST_F(RpcServerTest, blockTemplateIsReusedUntilTopBlockChanges) {
+  Block block1;
+  Block block2;
+  difficulty_type difficulty;
+  uint32_t height1;
+  uint32_t height2;
+  uint64_t version1;
+  uint64_t version2;
+  const auto& address = account.getAccountKeys().address;
+  BinaryArray extraNonce(8, 0);
+
+  ASSERT_TRUE(core.getBlockTemplate(block1, address, difficulty, height1, extraNonce, version1));
+  ASSERT_TRUE(core.getBlockTemplate(block2, address, difficulty, height2, extraNonce, version2));
+  EXPECT_EQ(version1, version2);
+  EXPECT_EQ(height1, height2);
+  EXPECT_EQ(block1.previousBlockHash, block2.previousBlockHash);
+  EXPECT_EQ(getObjectHash(block1.baseTransaction), getObjectHash(block2.baseTransaction));
+
+  addBlock();
+  EXPECT_GT(core.getBlockTemplateVersion(), version1);
+
+  ASSERT_TRUE(core.getBlockTemplate(block2, address, difficulty, height2, extraNonce, version2));
+  EXPECT_EQ(core.getBlockTemplateVersion(), version2);
+  EXPECT_EQ(height1 + 1, height2);
+  EXPECT_EQ(topHash(), block2.previousBlockHash);
+  EXPECT_NE(getObjectHash(block1.baseTransaction), getObjectHash(block2.baseTransaction));
+}
+
+TEST_F(RpcServerTest, blockTemplateVersionChangesOnPoolUpdateAtMostOncePerRefreshInterval) {
+  uint64_t version = core.getBlockTemplateVersion();
+
+  addPoolTransaction();
+  EXPECT_EQ(version, core.getBlockTemplateVersion());
+
+  // the first pool change is picked up on the next idle call
+  core.on_idle();
+  EXPECT_EQ(version + 1, core.getBlockTemplateVersion());
+
+  addPoolTransaction();
+  core.on_idle();
+  EXPECT_EQ(version + 1, core.getBlockTemplateVersion());
+
+  // a new block includes the pool and drops the pending change
+  addBlock();
+  uint64_t blockVersion = core.getBlockTemplateVersion();
+  EXPECT_GT(blockVersion, version + 1);
+  core.on_idle();
+  EXPECT_EQ(blockVersion, core.getBlockTemplateVersion());
+}
+
+TEST_F(RpcServerTest, getBlockTemplateLongPollWakesOnNewBlock) {
+  markSynchronized();
+  auto current = getBlockTemplate(0, 0);
+  ASSERT_EQ(CORE_RPC_STATUS_OK, current.status);
+
+  COMMAND_RPC_GETBLOCKTEMPLATE::response res;
+  bool returned = false;
+
+  System::ContextGroup waiter(dispatcher);
+  waiter.spawn([&] {
+    res = getBlockTemplate(current.template_version, 10);
+    returned = true;
+  });
+
+  dispatcher.yield();
+  ASSERT_FALSE(returned);
+
+  auto start = std::chrono::steady_clock::now();
+  addBlock();
+  waiter.wait();
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_GT(res.template_version, current.template_version);
+  EXPECT_EQ(current.height + 1, res.height);
+}
+
+TEST_F(RpcServerTest, getBlockTemplateLongPollReturnsCurrentTemplateOnTimeout) {
+  markSynchronized();
+  auto current = getBlockTemplate(0, 0);
+  ASSERT_EQ(CORE_RPC_STATUS_OK, current.status);
+
+  auto start = std::chrono::steady_clock::now();
+  auto res = getBlockTemplate(current.template_version, 1);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_GE(elapsed, std::chrono::milliseconds(900));
+  EXPECT_LT(elapsed, std::chrono::seconds(5));
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_EQ(current.template_version, res.template_version);
+  EXPECT_EQ(current.height, res.height);
+}
+
+TEST_F(RpcServerTest, getMiningStatsReportsCountersOfDaemonMiner) {
+  // the miner saves its config next to the extra messages after every accepted block
+  std::string extraMessages = (dataDir / "extra_messages").string();
+  std::ofstream(extraMessages) << "dGVzdA==" << std::endl;
+  MinerConfig config;
+  config.extraMessages = extraMessages;
+  ASSERT_TRUE(core.get_miner().init(config));
+
+  ASSERT_TRUE(core.get_miner().start(account.getAccountKeys().address, 1));
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (core.get_miner().get_stats().blocks_found < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  core.get_miner().stop();
+  miner::mining_stats stats = core.get_miner().get_stats();
+  ASSERT_LE(2, stats.blocks_found);
+
+  COMMAND_RPC_GET_MINING_STATS::response res = boost::value_initialized<COMMAND_RPC_GET_MINING_STATS::response>();
+  request("/get_mining_stats", COMMAND_RPC_GET_MINING_STATS::request(), res);
+
+  EXPECT_EQ(CORE_RPC_STATUS_OK, res.status);
+  EXPECT_FALSE(res.mining);
+  EXPECT_EQ(stats.hashes, res.hashes);
+  EXPECT_EQ(stats.hashrates[0], res.hashrate_10s);
+  EXPECT_EQ(stats.hashrates[1], res.hashrate_60s);
+  EXPECT_EQ(stats.hashrates[2], res.hashrate_15m);
+  ASSERT_EQ(1, res.threads.size());
+  EXPECT_EQ(stats.hashes, res.threads[0].hashes);
+  EXPECT_EQ(-1, res.threads[0].cpu);
+  EXPECT_EQ(stats.blocks_found, res.blocks_found);
+  EXPECT_EQ(stats.stale_templates, res.stale_templates);
+  EXPECT_EQ(stats.template_updates, res.template_updates);
+  EXPECT_LE(res.blocks_found, res.template_updates);
+  EXPECT_EQ(stats.template_to_submit_avg_ms, res.template_to_submit_avg_ms);
+
+  uint32_t height;
+  crypto::Hash hash;
+  core.get_blockchain_top(height, hash);
+  EXPECT_EQ(res.blocks_found, height);
+}
+
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+#include "transfers/ScanningExecutor.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace cryptonote;
+
+TEST(ScanningExecutor, runsEveryChunkOnce) {
+  ScanningExecutor executor(4);
+  const size_t chunkCount = 1000;
+  std::vector<std::atomic<size_t>> calls(chunkCount);
+  for (auto& count : calls) {
+    count = 0;
+  }
+
+  executor.run(chunkCount, [&](size_t chunk) {
+    ++calls[chunk];
+  });
+
+  for (size_t i = 0; i < chunkCount; ++i) {
+    ASSERT_EQ(1, calls[i].load()) << "chunk " << i;
+  }
+}
+
+TEST(ScanningExecutor, runsWithoutWorkerThreads) {
+  ScanningExecutor executor(0);
+  std::vector<size_t> chunks;
+  executor.run(10, [&](size_t chunk) {
+    chunks.push_back(chunk);
+  });
+
+  ASSERT_EQ(10, chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    ASSERT_EQ(i, chunks[i]);
+  }
+}
+
+TEST(ScanningExecutor, spreadsChunksOverThreads) {
+  ScanningExecutor executor(3);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+
+  executor.run(64, [&](size_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  });
+
+  ASSERT_LT(1, threads.size());
+}
+
+TEST(ScanningExecutor, rethrowsTaskException) {
+  ScanningExecutor executor(2);
+  std::atomic<size_t> calls(0);
+  ASSERT_THROW(executor.run(100, [&](size_t chunk) {
+    ++calls;
+    if (chunk == 50) {
+      throw std::runtime_error("chunk failed");
+    }
+  }), std::runtime_error);
+
+  ASSERT_EQ(100, calls.load());
+}
+
+TEST(ScanningExecutor, runsJobsFromSeveralThreads) {
+  ScanningExecutor executor(2);
+  std::vector<std::future<size_t>> jobs;
+  for (size_t i = 0; i < 8; ++i) {
+    jobs.push_back(std::async(std::launch::async, [&executor] {
+      std::atomic<size_t> sum(0);
+      executor.run(500, [&](size_t chunk) {
+        sum += chunk;
+      });
+
+      return sum.load();
+    }));
+  }
+
+  for (auto& job : jobs) {
+    ASSERT_EQ(499 * 500 / 2, job.get());
+  }
+}
@@ -587,6 +587,46 @@ TEST_F(TransfersConsumerTest, onNewBlocks_getTransactionOutsGlobalIndicesIsNotCa
   ASSERT_FALSE(node.called);
 }
 
+TEST_F(TransfersConsumerTest, onNewBlocks_usesGlobalIndicesSentWithBlock) {
+  class INodeGlobalIndicesStub: public INodeDummyStub {
+  public:
+    INodeGlobalIndicesStub() : called(false) {};
+
+    virtual void getTransactionOutsGlobalIndices(const crypto::Hash& transactionHash,
+      std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override {
+      called = true;
+      callback(std::error_code());
+    };
+
+    bool called;
+  };
+
+  INodeGlobalIndicesStub node;
+  TransfersConsumer consumer(m_currency, node, m_accountKeys.viewSecretKey);
+
+  AccountSubscription subscription = getAccountSubscription(m_accountKeys);
+  subscription.syncStart.height = 0;
+  subscription.syncStart.timestamp = 0;
+  auto& container = consumer.addSubscription(subscription).getContainer();
+
+  std::shared_ptr<ITransaction> tx(createTransaction());
+  addTestInput(*tx, 10000);
+  addTestKeyOutput(*tx, 100, 2, generateAccount());
+  addTestKeyOutput(*tx, 900, 2, m_accountKeys);
+
+  CompleteBlock block;
+  block.block = cryptonote::Block();
+  block.block->timestamp = 0;
+  block.transactions.push_back(tx);
+  block.globalIndexes.push_back({ 7, 15 });
+  ASSERT_TRUE(consumer.onNewBlocks(&block, 1, 1));
+
+  ASSERT_FALSE(node.called);
+  auto outs = container.getTransactionOutputs(tx->getTransactionHash(), ITransfersContainer::IncludeAll);
+  ASSERT_EQ(1, outs.size());
+  ASSERT_EQ(15, outs[0].globalOutputIndex);
+}
+
 TEST_F(TransfersConsumerTest, onNewBlocks_markTransactionConfirmed) {
   auto& container = addSubscription().getContainer();
   
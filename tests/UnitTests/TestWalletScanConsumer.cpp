@@ -0,0 +1,275 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <deque>
+#include <unordered_set>
+
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "transfers/CommonTypes.h"
+#include "transfers/WalletScanConsumer.h"
+
+#include "INodeStubs.h"
+
+using namespace cryptonote;
+
+namespace {
+
+class WalletScanNodeStub : public INodeDummyStub {
+public:
+  WalletScanNodeStub() : registrationId(7), registrationToken(crypto::rand<crypto::Hash>()), scannedHeight(0) {
+  }
+
+  virtual void registerWalletScan(const crypto::SecretKey& viewSecretKey, std::vector<crypto::PublicKey>&& spendPublicKeys, uint32_t startHeight,
+    uint64_t& id, crypto::Hash& token, const Callback& callback) override {
+    registeredSpendKeys = std::move(spendPublicKeys);
+    id = registrationId;
+    token = registrationToken;
+    callback(std::error_code());
+  }
+
+  virtual void getWalletScanEvents(uint64_t id, const crypto::Hash& token, uint64_t firstSequence, uint32_t maxCount,
+    std::vector<WalletScanEvent>& result, uint32_t& height, const Callback& callback) override {
+    if (id != registrationId || token != registrationToken) {
+      callback(make_error_code(std::errc::permission_denied));
+      return;
+    }
+
+    requestedSequences.push_back(firstSequence);
+    while (!events.empty() && events.front().sequence < firstSequence) {
+      events.pop_front();
+    }
+
+    result.assign(events.begin(), events.begin() + std::min<size_t>(maxCount, events.size()));
+    height = scannedHeight;
+    callback(std::error_code());
+  }
+
+  void addTransaction(uint32_t height, const crypto::Hash& blockId, const crypto::Hash& txHash) {
+    WalletScanEvent event = boost::value_initialized<WalletScanEvent>();
+    event.sequence = nextSequence();
+    event.height = height;
+    event.blockId = blockId;
+    event.timestamp = 1000 + height;
+    event.transaction.txHash = txHash;
+    event.transaction.txPrefix.version = 1;
+    event.transaction.globalIndexes.push_back(height);
+    events.push_back(event);
+  }
+
+  void addDetach(uint32_t height) {
+    WalletScanEvent event = boost::value_initialized<WalletScanEvent>();
+    event.sequence = nextSequence();
+    event.detach = true;
+    event.height = height;
+    events.push_back(event);
+  }
+
+  uint64_t registrationId;
+  crypto::Hash registrationToken;
+  uint32_t scannedHeight;
+  std::vector<crypto::PublicKey> registeredSpendKeys;
+  std::deque<WalletScanEvent> events;
+  std::vector<uint64_t> requestedSequences;
+
+private:
+  uint64_t nextSequence() {
+    return events.empty() ? 0 : events.back().sequence + 1;
+  }
+};
+
+class RecordingConsumer : public IBlockchainConsumer {
+public:
+  struct PushedBlock {
+    uint32_t height;
+    crypto::Hash blockHash;
+    uint64_t timestamp;
+    std::vector<crypto::Hash> transactions;
+    std::vector<std::vector<uint32_t>> globalIndexes;
+  };
+
+  RecordingConsumer() : acceptBlocks(true) {
+  }
+
+  virtual SynchronizationStart getSyncStart() override {
+    SynchronizationStart start = { 0, 0 };
+    return start;
+  }
+
+  virtual void addObserver(IBlockchainConsumerObserver* observer) override {
+  }
+
+  virtual void removeObserver(IBlockchainConsumerObserver* observer) override {
+  }
+
+  virtual const std::unordered_set<crypto::Hash>& getKnownPoolTxIds() const override {
+    return pool;
+  }
+
+  virtual void onBlockchainDetach(uint32_t height) override {
+    detachHeights.push_back(height);
+  }
+
+  virtual bool onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) override {
+    if (!acceptBlocks) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+      PushedBlock pushed;
+      pushed.height = startHeight + i;
+      pushed.blockHash = blocks[i].blockHash;
+      pushed.timestamp = blocks[i].block->timestamp;
+      for (const auto& tx : blocks[i].transactions) {
+        pushed.transactions.push_back(tx->getTransactionHash());
+      }
+      pushed.globalIndexes = blocks[i].globalIndexes;
+      pushedBlocks.push_back(pushed);
+    }
+
+    return true;
+  }
+
+  virtual std::error_code onPoolUpdated(const std::vector<std::unique_ptr<ITransactionReader>>& addedTransactions,
+    const std::vector<crypto::Hash>& deletedTransactions) override {
+    return std::error_code();
+  }
+
+  virtual std::error_code addUnconfirmedTransaction(const ITransactionReader& transaction) override {
+    return std::error_code();
+  }
+
+  virtual void removeUnconfirmedTransaction(const crypto::Hash& transactionHash) override {
+  }
+
+  bool acceptBlocks;
+  std::vector<PushedBlock> pushedBlocks;
+  std::vector<uint32_t> detachHeights;
+  std::unordered_set<crypto::Hash> pool;
+};
+
+class WalletScanConsumerTest : public ::testing::Test {
+public:
+  WalletScanConsumerTest() : scanConsumer(node, consumer) {
+  }
+
+protected:
+  void registerKeys() {
+    crypto::PublicKey viewPublicKey;
+    crypto::SecretKey viewSecretKey;
+    crypto::generate_keys(viewPublicKey, viewSecretKey);
+    ASSERT_FALSE(scanConsumer.registerKeys(viewSecretKey, { viewPublicKey }, 0));
+  }
+
+  WalletScanNodeStub node;
+  RecordingConsumer consumer;
+  WalletScanConsumer scanConsumer;
+};
+
+}
+
+TEST_F(WalletScanConsumerTest, processEventsFailsWhenNotRegistered) {
+  uint32_t scannedHeight;
+  ASSERT_TRUE(static_cast<bool>(scanConsumer.processEvents(scannedHeight)));
+  ASSERT_TRUE(node.requestedSequences.empty());
+}
+
+TEST_F(WalletScanConsumerTest, pushesTransactionsGroupedByBlock) {
+  registerKeys();
+  ASSERT_EQ(1, node.registeredSpendKeys.size());
+
+  crypto::Hash block1 = crypto::rand<crypto::Hash>();
+  crypto::Hash block2 = crypto::rand<crypto::Hash>();
+  crypto::Hash tx1 = crypto::rand<crypto::Hash>();
+  crypto::Hash tx2 = crypto::rand<crypto::Hash>();
+  crypto::Hash tx3 = crypto::rand<crypto::Hash>();
+  node.addTransaction(3, block1, tx1);
+  node.addTransaction(3, block1, tx2);
+  node.addTransaction(5, block2, tx3);
+  node.scannedHeight = 6;
+
+  uint32_t scannedHeight = 0;
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+  ASSERT_EQ(6, scannedHeight);
+
+  ASSERT_EQ(2, consumer.pushedBlocks.size());
+  ASSERT_EQ(3, consumer.pushedBlocks[0].height);
+  ASSERT_EQ(block1, consumer.pushedBlocks[0].blockHash);
+  ASSERT_EQ(1003, consumer.pushedBlocks[0].timestamp);
+  ASSERT_EQ(std::vector<crypto::Hash>({ tx1, tx2 }), consumer.pushedBlocks[0].transactions);
+  ASSERT_EQ(2, consumer.pushedBlocks[0].globalIndexes.size());
+  ASSERT_EQ(std::vector<uint32_t>({ 3 }), consumer.pushedBlocks[0].globalIndexes[0]);
+  ASSERT_EQ(5, consumer.pushedBlocks[1].height);
+  ASSERT_EQ(std::vector<crypto::Hash>({ tx3 }), consumer.pushedBlocks[1].transactions);
+}
+
+TEST_F(WalletScanConsumerTest, acknowledgesProcessedEvents) {
+  registerKeys();
+  node.addTransaction(3, crypto::rand<crypto::Hash>(), crypto::rand<crypto::Hash>());
+  node.addTransaction(4, crypto::rand<crypto::Hash>(), crypto::rand<crypto::Hash>());
+
+  uint32_t scannedHeight;
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+
+  ASSERT_EQ(std::vector<uint64_t>({ 0, 2 }), node.requestedSequences);
+  ASSERT_EQ(2, consumer.pushedBlocks.size());
+}
+
+TEST_F(WalletScanConsumerTest, pagesThroughEvents) {
+  registerKeys();
+  for (uint32_t i = 0; i < WalletScanConsumer::EVENTS_PER_REQUEST + 10; ++i) {
+    node.addTransaction(i, crypto::rand<crypto::Hash>(), crypto::rand<crypto::Hash>());
+  }
+
+  uint32_t scannedHeight;
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+
+  ASSERT_EQ(WalletScanConsumer::EVENTS_PER_REQUEST + 10, consumer.pushedBlocks.size());
+  ASSERT_EQ(std::vector<uint64_t>({ 0, WalletScanConsumer::EVENTS_PER_REQUEST }), node.requestedSequences);
+}
+
+TEST_F(WalletScanConsumerTest, passesDetachToConsumer) {
+  registerKeys();
+  node.addTransaction(3, crypto::rand<crypto::Hash>(), crypto::rand<crypto::Hash>());
+  node.addDetach(3);
+  crypto::Hash block = crypto::rand<crypto::Hash>();
+  node.addTransaction(3, block, crypto::rand<crypto::Hash>());
+
+  uint32_t scannedHeight;
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+
+  ASSERT_EQ(std::vector<uint32_t>({ 3 }), consumer.detachHeights);
+  ASSERT_EQ(2, consumer.pushedBlocks.size());
+  ASSERT_EQ(block, consumer.pushedBlocks[1].blockHash);
+}
+
+TEST_F(WalletScanConsumerTest, reportsTransactionOnce) {
+  registerKeys();
+  crypto::Hash block = crypto::rand<crypto::Hash>();
+  crypto::Hash tx = crypto::rand<crypto::Hash>();
+  node.addTransaction(3, block, tx);
+  node.addTransaction(3, block, tx);
+
+  uint32_t scannedHeight;
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+
+  ASSERT_EQ(1, consumer.pushedBlocks.size());
+  ASSERT_EQ(std::vector<crypto::Hash>({ tx }), consumer.pushedBlocks[0].transactions);
+}
+
+TEST_F(WalletScanConsumerTest, keepsEventsRejectedByConsumer) {
+  registerKeys();
+  node.addTransaction(3, crypto::rand<crypto::Hash>(), crypto::rand<crypto::Hash>());
+
+  consumer.acceptBlocks = false;
+  uint32_t scannedHeight;
+  ASSERT_TRUE(static_cast<bool>(scanConsumer.processEvents(scannedHeight)));
+
+  consumer.acceptBlocks = true;
+  ASSERT_FALSE(scanConsumer.processEvents(scannedHeight));
+  ASSERT_EQ(std::vector<uint64_t>({ 0, 0 }), node.requestedSequences);
+  ASSERT_EQ(1, consumer.pushedBlocks.size());
+}
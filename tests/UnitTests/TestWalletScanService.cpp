@@ -0,0 +1,426 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <logging/LoggerGroup.h>
+
+#include "cryptonote/core/Account.h"
+#include "cryptonote/core/CryptoNoteFormatUtils.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "cryptonote/core/TransactionApi.h"
+#include "cryptonote/core/WalletScanService.h"
+
+#include "ICoreStub.h"
+
+using namespace cryptonote;
+
+namespace {
+
+class WalletScanServiceTest : public ::testing::Test {
+public:
+  WalletScanServiceTest() :
+    fileName((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("wallet_scan_%%%%%%%%%%%%")).string()),
+    nonce(0) {
+    alice.generate();
+    bob.generate();
+    addBlock({});
+  }
+
+  ~WalletScanServiceTest() {
+    boost::filesystem::remove(fileName);
+  }
+
+protected:
+  Transaction createTransfer(const AccountBase& to, uint64_t amount, const crypto::KeyImage* spentKeyImage = nullptr) {
+    std::unique_ptr<ITransaction> tx = createTransaction();
+    tx->addOutput(amount / 2, generateAddress());
+    tx->addOutput(amount / 2, to.getAccountKeys().address);
+
+    Transaction transaction;
+    EXPECT_TRUE(fromBinaryArray(transaction, tx->getTransactionData()));
+
+    if (spentKeyImage != nullptr) {
+      // the service does not check signatures, so the input is added unsigned after parsing
+      KeyInput input;
+      input.amount = amount;
+      input.outputIndexes.push_back(1);
+      input.keyImage = *spentKeyImage;
+      transaction.inputs.push_back(input);
+      transaction.signatures.resize(1);
+      transaction.signatures[0].resize(1);
+    }
+
+    return transaction;
+  }
+
+  AccountPublicAddress generateAddress() {
+    AccountBase account;
+    account.generate();
+    return account.getAccountKeys().address;
+  }
+
+  crypto::Hash addBlock(const std::vector<Transaction>& transactions) {
+    uint32_t height = static_cast<uint32_t>(heights.size());
+
+    Block block = boost::value_initialized<Block>();
+    block.majorVersion = 1;
+    block.timestamp = 1000 + height;
+    block.nonce = ++nonce;
+    block.previousBlockHash = height == 0 ? NULL_HASH : heights.back();
+    block.baseTransaction.version = 1;
+    block.baseTransaction.unlockTime = 0;
+    block.baseTransaction.inputs.push_back(BaseInput{ height });
+
+    for (const auto& transaction : transactions) {
+      core.addTransaction(transaction);
+      block.transactionHashes.push_back(getObjectHash(transaction));
+    }
+
+    crypto::Hash blockId = get_block_hash(block);
+    heights.push_back(blockId);
+    core.addBlock(block);
+    return blockId;
+  }
+
+  void removeBlock() {
+    heights.pop_back();
+    core.removeTopBlock();
+  }
+
+  uint64_t registerAccount(WalletScanService& service, const AccountBase& account, uint32_t startHeight = 0) {
+    const AccountKeys& keys = account.getAccountKeys();
+    uint64_t id = 0;
+    crypto::Hash token;
+    EXPECT_TRUE(service.addRegistration(keys.viewSecretKey, { keys.address.spendPublicKey }, startHeight, id, token));
+    tokens[id] = token;
+    return id;
+  }
+
+  bool getEvents(WalletScanService& service, uint64_t id, uint64_t firstSequence, std::vector<WalletScanEvent>& events,
+    uint32_t& scannedHeight) {
+    return service.getEvents(id, tokens[id], firstSequence, 100, events, scannedHeight);
+  }
+
+  std::vector<WalletScanEvent> waitEvents(WalletScanService& service, uint64_t id, uint64_t firstSequence = 0) {
+    std::vector<WalletScanEvent> events;
+    uint32_t scannedHeight = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      EXPECT_TRUE(getEvents(service, id, firstSequence, events, scannedHeight));
+      if (scannedHeight == heights.size()) {
+        return events;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ADD_FAILURE() << "Blocks were not scanned, scanned height " << scannedHeight;
+    return events;
+  }
+
+  Logging::LoggerGroup logger;
+  ICoreStub core;
+  std::string fileName;
+  AccountBase alice;
+  AccountBase bob;
+  std::vector<crypto::Hash> heights;
+  std::map<uint64_t, crypto::Hash> tokens;
+  uint64_t nonce;
+};
+
+TEST_F(WalletScanServiceTest, reportsOnlyTransactionsOfEachWallet) {
+  Transaction toAlice = createTransfer(alice, 100);
+  Transaction toBob = createTransfer(bob, 200);
+  addBlock({});
+  crypto::Hash blockId = addBlock({ toAlice, toBob });
+
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t aliceId = registerAccount(service, alice);
+  uint64_t bobId = registerAccount(service, bob);
+
+  auto aliceEvents = waitEvents(service, aliceId);
+  ASSERT_EQ(1, aliceEvents.size());
+  EXPECT_FALSE(aliceEvents[0].detach);
+  EXPECT_EQ(2, aliceEvents[0].height);
+  EXPECT_EQ(blockId, aliceEvents[0].blockId);
+  EXPECT_EQ(getObjectHash(toAlice), aliceEvents[0].transaction.txHash);
+  EXPECT_EQ(std::vector<uint32_t>{ 1 }, aliceEvents[0].outputs);
+  EXPECT_EQ(std::vector<uint32_t>({ 0, 1 }), aliceEvents[0].transaction.globalIndexes);
+
+  auto bobEvents = waitEvents(service, bobId);
+  ASSERT_EQ(1, bobEvents.size());
+  EXPECT_EQ(getObjectHash(toBob), bobEvents[0].transaction.txHash);
+}
+
+TEST_F(WalletScanServiceTest, scansNewBlocks) {
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t id = registerAccount(service, alice);
+  ASSERT_TRUE(waitEvents(service, id).empty());
+
+  Transaction toAlice = createTransfer(alice, 100);
+  addBlock({ toAlice });
+
+  auto events = waitEvents(service, id);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(getObjectHash(toAlice), events[0].transaction.txHash);
+}
+
+TEST_F(WalletScanServiceTest, skipsBlocksBeforeStartHeight) {
+  addBlock({ createTransfer(alice, 100) });
+  addBlock({ createTransfer(alice, 200) });
+
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t id = registerAccount(service, alice, 2);
+
+  auto events = waitEvents(service, id);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(2, events[0].height);
+}
+
+TEST_F(WalletScanServiceTest, reportsSpentKeyImages) {
+  crypto::KeyImage keyImage = crypto::rand<crypto::KeyImage>();
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t id = registerAccount(service, alice);
+  ASSERT_TRUE(service.addKeyImages(id, tokens[id], { keyImage }));
+
+  Transaction spending = createTransfer(bob, 100, &keyImage);
+  addBlock({ spending });
+
+  auto events = waitEvents(service, id);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(getObjectHash(spending), events[0].transaction.txHash);
+  EXPECT_EQ(std::vector<uint32_t>{ 0 }, events[0].inputs);
+  EXPECT_TRUE(events[0].outputs.empty());
+}
+
+TEST_F(WalletScanServiceTest, reportsDetachAndRescansNewBranch) {
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t id = registerAccount(service, alice);
+
+  addBlock({});
+  addBlock({ createTransfer(alice, 100) });
+  ASSERT_EQ(1, waitEvents(service, id).size());
+
+  removeBlock();
+  removeBlock();
+  Transaction toAlice = createTransfer(alice, 300);
+  addBlock({ toAlice });
+
+  auto events = waitEvents(service, id);
+  ASSERT_EQ(3, events.size());
+  EXPECT_TRUE(events[1].detach);
+  EXPECT_EQ(1, events[1].height);
+  EXPECT_EQ(1, events[2].height);
+  EXPECT_EQ(getObjectHash(toAlice), events[2].transaction.txHash);
+}
+
+TEST_F(WalletScanServiceTest, dropsAcknowledgedEvents) {
+  addBlock({ createTransfer(alice, 100) });
+  addBlock({ createTransfer(alice, 200) });
+
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t id = registerAccount(service, alice);
+
+  auto events = waitEvents(service, id);
+  ASSERT_EQ(2, events.size());
+
+  events = waitEvents(service, id, events[0].sequence + 1);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(2, events[0].height);
+}
+
+TEST_F(WalletScanServiceTest, keepsRegistrationsAndEventsAcrossRestarts) {
+  addBlock({ createTransfer(alice, 100) });
+  uint64_t id;
+  {
+    WalletScanService service(core, logger, fileName);
+    ASSERT_TRUE(service.init());
+    id = registerAccount(service, alice);
+    ASSERT_EQ(1, waitEvents(service, id).size());
+    service.deinit();
+  }
+
+  addBlock({ createTransfer(alice, 200) });
+
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  auto events = waitEvents(service, id);
+  ASSERT_EQ(2, events.size());
+  EXPECT_EQ(1, events[0].height);
+  EXPECT_EQ(2, events[1].height);
+  EXPECT_EQ(1, events[1].sequence);
+
+  crypto::Hash token = tokens[id];
+  EXPECT_EQ(id, registerAccount(service, alice));
+  EXPECT_EQ(token, tokens[id]);
+}
+
+TEST_F(WalletScanServiceTest, rejectsCallsWithWrongToken) {
+  WalletScanService service(core, logger, fileName);
+  ASSERT_TRUE(service.init());
+  uint64_t aliceId = registerAccount(service, alice);
+  uint64_t bobId = registerAccount(service, bob);
+  ASSERT_NE(tokens[aliceId], tokens[bobId]);
+
+  std::vector<WalletScanEvent> events;
+  uint32_t scannedHeight;
+  EXPECT_FALSE(service.getEvents(aliceId, tokens[bobId], 0, 100, events, scannedHeight));
+  EXPECT_FALSE(service.addKeyImages(aliceId, tokens[bobId], { crypto::rand<crypto::KeyImage>() }));
+  EXPECT_FALSE(service.removeRegistration(aliceId, tokens[bobId]));
+
+  EXPECT_TRUE(service.removeRegistration(aliceId, tokens[aliceId]));
+  EXPECT_FALSE(service.getEvents(aliceId, tokens[aliceId], 0, 100, events, scannedHeight));
+}
+
+TEST_F(WalletScanServiceTest, pausesScanningUntilEventsAreAcknowledged) {
+  addBlock({ createTransfer(alice, 100) });
+  addBlock({ createTransfer(alice, 200) });
+
+  WalletScanService service(core, logger, fileName, 1);
+  ASSERT_TRUE(service.init());
+  uint64_t id = registerAccount(service, alice);
+
+  std::vector<WalletScanEvent> events;
+  uint32_t scannedHeight = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (events.empty() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_TRUE(getEvents(service, id, 0, events, scannedHeight));
+  }
+
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(1, events[0].height);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(getEvents(service, id, 0, events, scannedHeight));
+  EXPECT_EQ(1, events.size());
+  EXPECT_EQ(2, scannedHeight);
+
+  events = waitEvents(service, id, events[0].sequence + 1);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(2, events[0].height);
+}
+
+TEST_F(WalletScanServiceTest, limitsNumberOfRegistrations) {
+  WalletScanService service(core, logger, fileName, parameters::CRYPTONOTE_WALLET_SCAN_MAX_PENDING_EVENTS, 1);
+  ASSERT_TRUE(service.init());
+  uint64_t aliceId = registerAccount(service, alice);
+
+  const AccountKeys& bobKeys = bob.getAccountKeys();
+  uint64_t id;
+  crypto::Hash token;
+  EXPECT_FALSE(service.addRegistration(bobKeys.viewSecretKey, { bobKeys.address.spendPublicKey }, 0, id, token));
+
+  // registering the same view key again does not count
+  const AccountKeys& aliceKeys = alice.getAccountKeys();
+  ASSERT_TRUE(service.addRegistration(aliceKeys.viewSecretKey, { bobKeys.address.spendPublicKey }, 0, id, token));
+  EXPECT_EQ(aliceId, id);
+  EXPECT_EQ(tokens[aliceId], token);
+
+  ASSERT_TRUE(service.removeRegistration(aliceId, tokens[aliceId]));
+  EXPECT_TRUE(service.addRegistration(bobKeys.viewSecretKey, { bobKeys.address.spendPublicKey }, 0, id, token));
+}
+
+TEST_F(WalletScanServiceTest, limitsRescanDepth) {
+  for (int i = 0; i < 5; ++i) {
+    addBlock({});
+  }
+
+  WalletScanService service(core, logger, fileName, parameters::CRYPTONOTE_WALLET_SCAN_MAX_PENDING_EVENTS,
+    parameters::CRYPTONOTE_WALLET_SCAN_MAX_REGISTRATIONS, 3);
+  ASSERT_TRUE(service.init());
+
+  const AccountKeys& keys = alice.getAccountKeys();
+  uint64_t id;
+  crypto::Hash token;
+  EXPECT_FALSE(service.addRegistration(keys.viewSecretKey, { keys.address.spendPublicKey }, 0, id, token));
+  EXPECT_FALSE(service.addRegistration(keys.viewSecretKey, { keys.address.spendPublicKey }, 2, id, token));
+  EXPECT_TRUE(service.addRegistration(keys.viewSecretKey, { keys.address.spendPublicKey }, 3, id, token));
+}
+
+TEST(BatchKeyDerivationTest, derivationsMatchSingleKeyFunctions) {
+  const size_t KEY_COUNT = 5;
+  crypto::PublicKey txPublicKey;
+  crypto::SecretKey txSecretKey;
+  crypto::generate_keys(txPublicKey, txSecretKey);
+
+  std::vector<crypto::SecretKey> viewSecretKeys(KEY_COUNT);
+  for (auto& viewSecretKey : viewSecretKeys) {
+    crypto::PublicKey viewPublicKey;
+    crypto::generate_keys(viewPublicKey, viewSecretKey);
+  }
+
+  std::vector<crypto::KeyDerivation> derivations(KEY_COUNT);
+  ASSERT_TRUE(crypto::generate_key_derivations(txPublicKey, viewSecretKeys.data(), KEY_COUNT, derivations.data()));
+
+  crypto::PublicKey outputKey;
+  crypto::SecretKey outputSecretKey;
+  crypto::generate_keys(outputKey, outputSecretKey);
+
+  std::vector<crypto::PublicKey> spendKeys(KEY_COUNT);
+  ASSERT_TRUE(crypto::underive_public_keys(derivations.data(), KEY_COUNT, 3, outputKey, spendKeys.data()));
+
+  for (size_t i = 0; i < KEY_COUNT; ++i) {
+    crypto::KeyDerivation derivation;
+    ASSERT_TRUE(crypto::generate_key_derivation(txPublicKey, viewSecretKeys[i], derivation));
+    EXPECT_EQ(0, memcmp(&derivation, &derivations[i], sizeof(derivation)));
+
+    crypto::PublicKey spendKey;
+    ASSERT_TRUE(crypto::underive_public_key(derivation, 3, outputKey, spendKey));
+    EXPECT_EQ(spendKey, spendKeys[i]);
+  }
+}
+
+TEST(BatchKeyDerivationTest, underivedKeyOfOwnOutputIsSpendKey) {
+  AccountBase account;
+  account.generate();
+  const AccountKeys& keys = account.getAccountKeys();
+
+  crypto::PublicKey txPublicKey;
+  crypto::SecretKey txSecretKey;
+  crypto::generate_keys(txPublicKey, txSecretKey);
+
+  crypto::KeyDerivation senderDerivation;
+  ASSERT_TRUE(crypto::generate_key_derivation(keys.address.viewPublicKey, txSecretKey, senderDerivation));
+  crypto::PublicKey outputKey;
+  ASSERT_TRUE(crypto::derive_public_key(senderDerivation, 1, keys.address.spendPublicKey, outputKey));
+
+  AccountBase other;
+  other.generate();
+  crypto::SecretKey viewSecretKeys[] = { other.getAccountKeys().viewSecretKey, keys.viewSecretKey };
+  crypto::KeyDerivation derivations[2];
+  ASSERT_TRUE(crypto::generate_key_derivations(txPublicKey, viewSecretKeys, 2, derivations));
+
+  crypto::PublicKey spendKeys[2];
+  ASSERT_TRUE(crypto::underive_public_keys(derivations, 2, 1, outputKey, spendKeys));
+  EXPECT_NE(keys.address.spendPublicKey, spendKeys[0]);
+  EXPECT_EQ(keys.address.spendPublicKey, spendKeys[1]);
+}
+
+TEST(BatchKeyDerivationTest, invalidTransactionKeyFailsLikeSingleKeyFunction) {
+  crypto::PublicKey invalidKey;
+  memset(&invalidKey, 0xff, sizeof(invalidKey));
+  crypto::PublicKey viewPublicKey;
+  crypto::SecretKey viewSecretKey;
+  crypto::generate_keys(viewPublicKey, viewSecretKey);
+
+  crypto::KeyDerivation derivation;
+  EXPECT_FALSE(crypto::generate_key_derivation(invalidKey, viewSecretKey, derivation));
+  EXPECT_FALSE(crypto::generate_key_derivations(invalidKey, &viewSecretKey, 1, &derivation));
+}
+
+}
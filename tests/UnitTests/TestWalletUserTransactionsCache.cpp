@@ -0,0 +1,130 @@
+// Copyright (c) 2011-2016 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "crypto/crypto.h"
+#include "cryptonote/core/CryptoNoteTools.h"
+#include "serialization/BinaryInputStreamSerializer.h"
+#include "serialization/BinaryOutputStreamSerializer.h"
+#include "stream/StdInputStream.h"
+#include "stream/StdOutputStream.h"
+#include "wallet_legacy/WalletUserTransactionsCache.h"
+
+using namespace cryptonote;
+using namespace Common;
+
+namespace {
+
+TransactionInformation createTransactionInfo(uint32_t height) {
+  TransactionInformation info = {};
+  info.transactionHash = crypto::rand<crypto::Hash>();
+  info.blockHeight = height;
+  info.totalAmountIn = 2000;
+  info.totalAmountOut = 1000;
+  return info;
+}
+
+class TransactionIdObserver : public IWalletLegacyObserver {
+public:
+  TransactionIdObserver() : id(WALLET_LEGACY_INVALID_TRANSACTION_ID) {}
+
+  virtual void externalTransactionCreated(TransactionId transactionId) override { id = transactionId; }
+  virtual void transactionUpdated(TransactionId transactionId) override { id = transactionId; }
+
+  TransactionId id;
+};
+
+TransactionId getEventTransactionId(const std::shared_ptr<WalletLegacyEvent>& event) {
+  TransactionIdObserver observer;
+  Tools::ObserverManager<IWalletLegacyObserver> observers;
+  observers.add(&observer);
+  event->notify(observers);
+  return observer.id;
+}
+
+}
+
+class WalletUserTransactionsCacheTest : public ::testing::Test {
+public:
+  TransactionId addOutgoing(size_t transferCount) {
+    std::vector<WalletLegacyTransfer> transfers(transferCount);
+    return cache.addNewTransaction(1000, 10, std::string(), transfers, 0);
+  }
+
+  WalletUserTransactionsCache cache;
+};
+
+TEST_F(WalletUserTransactionsCacheTest, updatedTransactionIsFoundByHash) {
+  std::vector<TransactionInformation> infos;
+  for (uint32_t i = 0; i < 100; ++i) {
+    infos.push_back(createTransactionInfo(i + 1));
+    ASSERT_EQ(i, getEventTransactionId(cache.onTransactionUpdated(infos.back(), 1000)));
+  }
+
+  for (size_t i = 0; i < infos.size(); ++i) {
+    ASSERT_EQ(i, getEventTransactionId(cache.onTransactionUpdated(infos[i], 1000)));
+    ASSERT_EQ(i, getEventTransactionId(cache.onTransactionDeleted(infos[i].transactionHash)));
+  }
+
+  ASSERT_EQ(infos.size(), cache.getTransactionCount());
+}
+
+TEST_F(WalletUserTransactionsCacheTest, sentTransactionIsFoundByHashOnceConfirmed) {
+  TransactionId id = addOutgoing(1);
+  Transaction tx = boost::value_initialized<Transaction>();
+  tx.unlockTime = 10;
+  TransactionInformation info = createTransactionInfo(10);
+  info.transactionHash = getObjectHash(tx);
+  cache.updateTransaction(id, tx, 1000, std::list<TransactionOutputInformation>());
+  cache.updateTransactionSendingState(id, std::error_code());
+  ASSERT_EQ(info.transactionHash, cache.getTransaction(id).hash);
+
+  ASSERT_EQ(id, getEventTransactionId(cache.onTransactionUpdated(info, -1000)));
+  ASSERT_EQ(id, getEventTransactionId(cache.onTransactionDeleted(info.transactionHash)));
+  ASSERT_EQ(1, cache.getTransactionCount());
+}
+
+TEST_F(WalletUserTransactionsCacheTest, findTransactionByTransferId) {
+  TransactionId first = addOutgoing(2);
+  cache.onTransactionUpdated(createTransactionInfo(1), 1000);
+  addOutgoing(0);
+  TransactionId second = addOutgoing(3);
+
+  ASSERT_EQ(5, cache.getTransferCount());
+  ASSERT_EQ(first, cache.findTransactionByTransferId(0));
+  ASSERT_EQ(first, cache.findTransactionByTransferId(1));
+  ASSERT_EQ(second, cache.findTransactionByTransferId(2));
+  ASSERT_EQ(second, cache.findTransactionByTransferId(4));
+  ASSERT_EQ(WALLET_LEGACY_INVALID_TRANSACTION_ID, cache.findTransactionByTransferId(5));
+
+  cache.reset();
+  ASSERT_EQ(WALLET_LEGACY_INVALID_TRANSACTION_ID, cache.findTransactionByTransferId(0));
+}
+
+TEST_F(WalletUserTransactionsCacheTest, indexesAreRebuiltOnLoad) {
+  addOutgoing(2);
+  TransactionInformation info = createTransactionInfo(1);
+  TransactionId incoming = getEventTransactionId(cache.onTransactionUpdated(info, 1000));
+  TransactionId outgoing = addOutgoing(1);
+  cache.updateTransactionSendingState(outgoing, std::error_code());
+
+  std::stringstream stream;
+  StdOutputStream output(stream);
+  BinaryOutputStreamSerializer outputSerializer(output);
+  cache.serialize(outputSerializer);
+
+  WalletUserTransactionsCache loaded;
+  StdInputStream input(stream);
+  BinaryInputStreamSerializer inputSerializer(input);
+  loaded.serialize(inputSerializer);
+
+  ASSERT_EQ(3, loaded.getTransactionCount());
+  ASSERT_EQ(0, loaded.findTransactionByTransferId(1));
+  ASSERT_EQ(outgoing, loaded.findTransactionByTransferId(2));
+  ASSERT_EQ(incoming, getEventTransactionId(loaded.onTransactionDeleted(info.transactionHash)));
+  ASSERT_EQ(3, loaded.getTransactionCount());
+}